@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.cpp
+// ============
+// count every heap allocation the program makes through new
+//
+//  The global new and delete operators are replaced with ones that
+//  count calls and bytes before handing the work to malloc and free.
+//  Reading the counters before and after a frame shows whether the
+//  frame touched the heap at all.  The threads that build the frame
+//  are also counted on their own, so threads working beside it, such
+//  as the capture encoder or the scene loader, do not show up in the
+//  frame's figure.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// declaration of global variables
+namespace
+{
+	// constant initialized, so they count allocations made
+	// while other globals are constructed
+	std::atomic<size_t> g_AllocationCount(0);
+	std::atomic<size_t> g_AllocationBytes(0);
+
+	// a counter for each tracked thread; a slot stays claimed
+	// after its thread ends, keeping its count in the total
+	const int g_MaxTrackedThreads = 64;
+	std::atomic<size_t> g_TrackedCounts[g_MaxTrackedThreads];
+	std::atomic<int> g_TrackedThreads(0);
+	// the calling thread's slot, -1 while it is not tracked
+	thread_local int t_trackedSlot = -1;
+
+	/***********************************************************
+	 *  CountedAllocate()
+	 *
+	 *  This function counts one allocation and takes it from
+	 *  malloc, or returns NULL when there is no memory left.
+	 ***********************************************************/
+	void* CountedAllocate(size_t bytes)
+	{
+		g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+		g_AllocationBytes.fetch_add(bytes, std::memory_order_relaxed);
+		if (t_trackedSlot >= 0)
+		{
+			g_TrackedCounts[t_trackedSlot].fetch_add(1, std::memory_order_relaxed);
+		}
+		return(malloc((bytes > 0) ? bytes : 1));
+	}
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method returns the allocations made so far.
+ ***********************************************************/
+size_t AllocationCounter::GetCount()
+{
+	return(g_AllocationCount.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  GetBytes()
+ *
+ *  This method returns the bytes requested so far.
+ ***********************************************************/
+size_t AllocationCounter::GetBytes()
+{
+	return(g_AllocationBytes.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  TrackThread()
+ *
+ *  This method gives the calling thread a counter of its
+ *  own, unless it has one or they have all been claimed.
+ ***********************************************************/
+void AllocationCounter::TrackThread()
+{
+	if (t_trackedSlot >= 0)
+	{
+		return;
+	}
+
+	int slot = g_TrackedThreads.fetch_add(1);
+	if (slot >= g_MaxTrackedThreads)
+	{
+		return;
+	}
+	t_trackedSlot = slot;
+}
+
+/***********************************************************
+ *  GetTrackedCount()
+ *
+ *  This method returns the allocations made so far by the
+ *  tracked threads.
+ ***********************************************************/
+size_t AllocationCounter::GetTrackedCount()
+{
+	const int trackedThreads = std::min(g_TrackedThreads.load(), g_MaxTrackedThreads);
+	size_t count = 0;
+	for (int i = 0; i < trackedThreads; i++)
+	{
+		count += g_TrackedCounts[i].load(std::memory_order_relaxed);
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  operator new()
+ *
+ *  The replaced allocation operators.  The aligned forms are
+ *  left to the library, which pairs them with its own
+ *  deletes.
+ ***********************************************************/
+void* operator new(size_t bytes)
+{
+	void* pMemory = CountedAllocate(bytes);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new[](size_t bytes)
+{
+	void* pMemory = CountedAllocate(bytes);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(bytes));
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(bytes));
+}
+
+/***********************************************************
+ *  operator delete()
+ *
+ *  The replaced release operators, matching the above.
+ ***********************************************************/
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
@@ -0,0 +1,38 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// count every heap allocation the program makes through new
+//
+//  The global new and delete operators are replaced with ones that
+//  count calls and bytes before handing the work to malloc and free.
+//  Reading the counters before and after a frame shows whether the
+//  frame touched the heap at all.  The threads that build the frame
+//  are also counted on their own, so threads working beside it, such
+//  as the capture encoder or the scene loader, do not show up in the
+//  frame's figure.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  AllocationCounter
+ *
+ *  This class reads the counters kept by the replaced
+ *  operators, which count from the start of the program on
+ *  every thread, and on each tracked thread.
+ ***********************************************************/
+class AllocationCounter
+{
+public:
+	// allocations made and bytes requested so far
+	static size_t GetCount();
+	static size_t GetBytes();
+
+	// count the calling thread's allocations from now on in
+	// GetTrackedCount(); calling it again does nothing
+	static void TrackThread();
+	// allocations made so far by the tracked threads
+	static size_t GetTrackedCount();
+};
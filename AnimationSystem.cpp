@@ -0,0 +1,281 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationsystem.cpp
+// ============
+// play keyframed position, rotation and scale tracks on scene objects
+//
+//  Tracks are resampled at a fixed rate when they are added, and the
+//  tracks sharing a length are laid out side by side, so one frame of
+//  them all is a single blend of two rows of floats.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AnimationSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define ANIMATION_USE_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	// samples per second the keys are resampled at
+	const float g_SampleRate = 30.0f;
+
+	/***********************************************************
+	 *  EarlierKey()
+	 *
+	 *  Orders keyframes by their time.
+	 ***********************************************************/
+	bool EarlierKey(const AnimationSystem::KEYFRAME& a, const AnimationSystem::KEYFRAME& b)
+	{
+		return(a.time < b.time);
+	}
+}
+
+/***********************************************************
+ *  AnimationSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AnimationSystem::AnimationSystem()
+{
+}
+
+/***********************************************************
+ *  GetClip()
+ *
+ *  This method returns the clip that loops over the passed
+ *  in length, adding it when there is none yet.
+ ***********************************************************/
+AnimationSystem::ANIMATION_CLIP& AnimationSystem::GetClip(float duration)
+{
+	for (ANIMATION_CLIP& clip : m_clips)
+	{
+		if (clip.duration == duration)
+		{
+			return(clip);
+		}
+	}
+
+	ANIMATION_CLIP clip;
+	clip.duration = duration;
+	clip.time = 0.0f;
+	// the last sample lands on the end of the loop
+	clip.sampleCount = std::max((int)ceil(duration * g_SampleRate), 1) + 1;
+	clip.rowStride = 0;
+	clip.bRowsBuilt = false;
+	m_clips.push_back(clip);
+	return(m_clips.back());
+}
+
+/***********************************************************
+ *  AddTrack()
+ *
+ *  This method resamples the keys of a track at the fixed
+ *  rate and adds it to the clip of its length.  Before its
+ *  first key a track holds the first value.
+ ***********************************************************/
+bool AnimationSystem::AddTrack(
+	ObjectStore::OBJECT_HANDLE object,
+	CHANNEL channel,
+	std::vector<KEYFRAME> keys,
+	glm::vec3 offset)
+{
+	std::stable_sort(keys.begin(), keys.end(), EarlierKey);
+	if (keys.empty() || (keys.back().time <= 0.0f))
+	{
+		return(false);
+	}
+
+	ANIMATION_CLIP& clip = GetClip(keys.back().time);
+	const float step = clip.duration / (float)(clip.sampleCount - 1);
+
+	std::vector<float> samples(clip.sampleCount * 3);
+	size_t key = 0;
+	for (int i = 0; i < clip.sampleCount; i++)
+	{
+		float time = std::min(step * (float)i, clip.duration);
+		while ((key + 1 < keys.size()) && (keys[key + 1].time <= time))
+		{
+			key++;
+		}
+
+		glm::vec3 value = keys[key].value;
+		if ((key + 1 < keys.size()) && (time > keys[key].time))
+		{
+			float t = (time - keys[key].time) / (keys[key + 1].time - keys[key].time);
+			value = glm::mix(keys[key].value, keys[key + 1].value, t);
+		}
+		value += offset;
+
+		samples[i * 3 + 0] = value.x;
+		samples[i * 3 + 1] = value.y;
+		samples[i * 3 + 2] = value.z;
+	}
+
+	TRACK_TARGET target;
+	target.object = object;
+	target.channel = channel;
+	clip.targets.push_back(target);
+	clip.trackSamples.push_back(samples);
+	clip.bRowsBuilt = false;
+	return(true);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method removes every track.
+ ***********************************************************/
+void AnimationSystem::Clear()
+{
+	m_clips.clear();
+}
+
+/***********************************************************
+ *  GetTrackCount()
+ *
+ *  This method returns the number of tracks in all clips.
+ ***********************************************************/
+int AnimationSystem::GetTrackCount() const
+{
+	int count = 0;
+	for (const ANIMATION_CLIP& clip : m_clips)
+	{
+		count += (int)clip.targets.size();
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  IsAnimated()
+ *
+ *  This method returns whether any track targets the
+ *  passed in object.
+ ***********************************************************/
+bool AnimationSystem::IsAnimated(ObjectStore::OBJECT_HANDLE object) const
+{
+	for (const ANIMATION_CLIP& clip : m_clips)
+	{
+		for (const TRACK_TARGET& target : clip.targets)
+		{
+			if ((target.object.slot == object.slot) && (target.object.generation == object.generation))
+			{
+				return(true);
+			}
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  BuildRows()
+ *
+ *  This method lays the tracks of a clip out side by side,
+ *  one row per sample time.
+ ***********************************************************/
+void AnimationSystem::BuildRows(ANIMATION_CLIP& clip)
+{
+	const int trackCount = (int)clip.targets.size();
+	clip.rowStride = (trackCount * 3 + 3) & ~3;
+	clip.samples.assign((size_t)clip.rowStride * clip.sampleCount, 0.0f);
+	clip.output.assign(clip.rowStride, 0.0f);
+
+	for (int track = 0; track < trackCount; track++)
+	{
+		const std::vector<float>& samples = clip.trackSamples[track];
+		for (int i = 0; i < clip.sampleCount; i++)
+		{
+			float* row = &clip.samples[(size_t)i * clip.rowStride + track * 3];
+			row[0] = samples[i * 3 + 0];
+			row[1] = samples[i * 3 + 1];
+			row[2] = samples[i * 3 + 2];
+		}
+	}
+	clip.bRowsBuilt = true;
+}
+
+/***********************************************************
+ *  SampleClip()
+ *
+ *  This method blends the rows on either side of the clip's
+ *  time into its output, four floats at a time.
+ ***********************************************************/
+void AnimationSystem::SampleClip(ANIMATION_CLIP& clip)
+{
+	float position = clip.time / clip.duration * (float)(clip.sampleCount - 1);
+	int sample = std::min((int)position, clip.sampleCount - 2);
+	float blend = position - (float)sample;
+
+	const float* first = &clip.samples[(size_t)sample * clip.rowStride];
+	const float* second = first + clip.rowStride;
+	float* output = clip.output.data();
+
+#ifdef ANIMATION_USE_SSE
+	const __m128 weight = _mm_set1_ps(blend);
+	for (int i = 0; i < clip.rowStride; i += 4)
+	{
+		__m128 a = _mm_loadu_ps(first + i);
+		__m128 b = _mm_loadu_ps(second + i);
+		_mm_storeu_ps(output + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), weight)));
+	}
+#else
+	for (int i = 0; i < clip.rowStride; i++)
+	{
+		output[i] = first[i] + (second[i] - first[i]) * blend;
+	}
+#endif
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method moves every clip along its loop, samples it
+ *  and copies each track's value into its object.  Tracks
+ *  whose object was removed are skipped.
+ ***********************************************************/
+bool AnimationSystem::Update(float deltaSeconds, ObjectStore& objects, std::vector<int>& movedObjects)
+{
+	bool bMoved = false;
+
+	for (ANIMATION_CLIP& clip : m_clips)
+	{
+		if (!clip.bRowsBuilt)
+		{
+			BuildRows(clip);
+		}
+
+		clip.time = fmod(clip.time + std::max(deltaSeconds, 0.0f), clip.duration);
+		SampleClip(clip);
+
+		const float* output = clip.output.data();
+		for (size_t track = 0; track < clip.targets.size(); track++)
+		{
+			int index = objects.GetIndex(clip.targets[track].object);
+			if (index < 0)
+			{
+				continue;
+			}
+
+			glm::vec3 value(output[track * 3 + 0], output[track * 3 + 1], output[track * 3 + 2]);
+			switch (clip.targets[track].channel)
+			{
+			case CHANNEL_POSITION:
+				objects.GetPositions()[index] = value;
+				break;
+			case CHANNEL_ROTATION:
+				objects.GetRotations()[index] = value;
+				break;
+			case CHANNEL_SCALE:
+				objects.GetScales()[index] = value;
+				break;
+			}
+			movedObjects.push_back(index);
+			bMoved = true;
+		}
+	}
+	return(bMoved);
+}
@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationsystem.h
+// ============
+// play keyframed position, rotation and scale tracks on scene objects
+//
+//  Tracks are resampled at a fixed rate when they are added, and the
+//  tracks sharing a length are laid out side by side, so one frame of
+//  them all is a single blend of two rows of floats.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ObjectStore.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  AnimationSystem
+ *
+ *  This class loops keyframed transform tracks and writes
+ *  the sampled values into the object store, where the
+ *  transform update picks them up.  Values between keys
+ *  are blended linearly, rotations as their angles.
+ ***********************************************************/
+class AnimationSystem
+{
+public:
+	// constructor
+	AnimationSystem();
+
+	// the transform component a track drives
+	enum CHANNEL
+	{
+		CHANNEL_POSITION,
+		CHANNEL_ROTATION,
+		CHANNEL_SCALE
+	};
+
+	struct KEYFRAME
+	{
+		// seconds from the start of the loop
+		float time;
+		glm::vec3 value;
+	};
+
+	// add a track that loops over the time of its last key, with
+	// the offset added to every value; false when the keys do not
+	// span any time
+	bool AddTrack(
+		ObjectStore::OBJECT_HANDLE object,
+		CHANNEL channel,
+		std::vector<KEYFRAME> keys,
+		glm::vec3 offset = glm::vec3(0.0f));
+	// remove every track
+	void Clear();
+
+	int GetTrackCount() const;
+	// true when any track moves the object
+	bool IsAnimated(ObjectStore::OBJECT_HANDLE object) const;
+
+	// advance every track and write its value to its object,
+	// adding the index of each object moved to the list, once
+	// per track; returns true when any object moved
+	bool Update(float deltaSeconds, ObjectStore& objects, std::vector<int>& movedObjects);
+
+private:
+	struct TRACK_TARGET
+	{
+		ObjectStore::OBJECT_HANDLE object;
+		CHANNEL channel;
+	};
+
+	// the tracks of one length; each row of samples holds three
+	// floats per track, padded to a multiple of four
+	struct ANIMATION_CLIP
+	{
+		float duration;
+		float time;
+		int sampleCount;
+		std::vector<TRACK_TARGET> targets;
+		// samples of each track on its own while tracks are added
+		std::vector<std::vector<float>> trackSamples;
+		// the interleaved rows, rebuilt when a track was added
+		std::vector<float> samples;
+		int rowStride;
+		bool bRowsBuilt;
+		// the values of the current frame
+		std::vector<float> output;
+	};
+
+	std::vector<ANIMATION_CLIP> m_clips;
+
+	// find or add the clip for tracks of this length
+	ANIMATION_CLIP& GetClip(float duration);
+	// interleave the samples of every track into rows
+	void BuildRows(ANIMATION_CLIP& clip);
+	// blend the two rows around the clip's time
+	void SampleClip(ANIMATION_CLIP& clip);
+};
@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.cpp
+// ============
+// map a baked asset pack into memory and read it in place
+//
+//  The pack is written offline by Tools/AssetBaker.cpp.  It holds the
+//  pooled meshes, textures with all of their mip levels, and the
+//  materials, lights and objects of the scene, each in a section laid
+//  out exactly as it is used, so loading is a file mapping followed
+//  by uploads straight from the mapped memory.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetPack.h"
+
+#include <cstring>
+#include <iostream>
+
+// the records are read in place, so their layout is part of the
+// file format and must not change without a version bump
+static_assert(sizeof(AssetPack::PACK_HEADER) == 24, "pack header layout changed");
+static_assert(sizeof(AssetPack::PACK_SECTION) == 24, "pack section layout changed");
+static_assert(sizeof(AssetPack::PACK_TEXTURE) == 64, "pack texture layout changed");
+static_assert(sizeof(AssetPack::PACK_MATERIAL) == 80, "pack material layout changed");
+static_assert(sizeof(AssetPack::PACK_LIGHT) == 80, "pack light layout changed");
+static_assert(sizeof(AssetPack::PACK_OBJECT) == 112, "pack object layout changed");
+static_assert(sizeof(AssetPack::PACK_SCENE) == 16, "pack scene layout changed");
+static_assert(sizeof(MeshPool::MESH_VERTEX) == 32, "mesh vertex layout changed");
+static_assert(sizeof(MeshPool::MESH_RANGE) == 28, "mesh range layout changed");
+
+// declaration of global variables
+namespace
+{
+	const char g_PackMagic[8] = { 'C', 'S', '3', '3', '0', 'P', 'A', 'K' };
+}
+
+/***********************************************************
+ *  AssetPack()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AssetPack::AssetPack()
+{
+}
+
+/***********************************************************
+ *  ~AssetPack()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AssetPack::~AssetPack()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method maps the pack file and checks that its
+ *  header matches this build and that every section lies
+ *  inside the file on its alignment.  Nothing is copied;
+ *  the pages are read in as the sections are used.
+ ***********************************************************/
+bool AssetPack::Open(const std::string& filename)
+{
+	Close();
+
+	if (!m_file.Open(filename))
+	{
+		std::cout << "ERROR: Could not map asset pack: " << filename << std::endl;
+		return(false);
+	}
+
+	const unsigned char* pData = m_file.GetData();
+	const uint64_t fileSize = m_file.GetSize();
+	const PACK_HEADER* pHeader = reinterpret_cast<const PACK_HEADER*>(pData);
+	bool bValid = (fileSize >= sizeof(PACK_HEADER)) &&
+		(memcmp(pHeader->magic, g_PackMagic, sizeof(g_PackMagic)) == 0);
+	if (!bValid)
+	{
+		std::cout << "ERROR: Not an asset pack: " << filename << std::endl;
+		Close();
+		return(false);
+	}
+	if (pHeader->version != FORMAT_VERSION)
+	{
+		std::cout << "ERROR: Asset pack " << filename << " is version " << pHeader->version
+			<< ", this build reads version " << FORMAT_VERSION << "; bake it again" << std::endl;
+		Close();
+		return(false);
+	}
+
+	uint64_t tableEnd = sizeof(PACK_HEADER) + (uint64_t)pHeader->sectionCount * sizeof(PACK_SECTION);
+	bValid = (pHeader->fileSize == fileSize) && (tableEnd <= fileSize);
+	const PACK_SECTION* sections = reinterpret_cast<const PACK_SECTION*>(pData + sizeof(PACK_HEADER));
+	for (uint32_t i = 0; bValid && (i < pHeader->sectionCount); i++)
+	{
+		bValid = (sections[i].offset % SECTION_ALIGNMENT == 0) &&
+			(sections[i].offset >= tableEnd) && (sections[i].offset <= fileSize) &&
+			(sections[i].size <= fileSize - sections[i].offset);
+	}
+	if (!bValid)
+	{
+		std::cout << "ERROR: Asset pack " << filename << " is damaged" << std::endl;
+		Close();
+		return(false);
+	}
+
+	std::cout << "INFO: Mapped asset pack " << filename << ", " << pHeader->sectionCount
+		<< " sections, " << fileSize << " bytes" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method unmaps the pack, invalidating every pointer
+ *  handed out for it.
+ ***********************************************************/
+void AssetPack::Close()
+{
+	m_file.Close();
+}
+
+/***********************************************************
+ *  GetSectionData()
+ *
+ *  This method returns the bytes of a section along with
+ *  their number.
+ ***********************************************************/
+const unsigned char* AssetPack::GetSectionData(SECTION_TYPE type, uint64_t& size) const
+{
+	const PACK_SECTION* pSection = FindSection(type, 1);
+	size = (NULL != pSection) ? pSection->size : 0;
+	return((NULL != pSection) ? m_file.GetData() + pSection->offset : NULL);
+}
+
+/***********************************************************
+ *  FindSection()
+ *
+ *  This method looks the section up in the section table.
+ *  A section whose size does not match its record count is
+ *  treated as missing, which catches a record that changed
+ *  size without a version bump.
+ ***********************************************************/
+const AssetPack::PACK_SECTION* AssetPack::FindSection(SECTION_TYPE type, size_t recordSize) const
+{
+	if (!m_file.IsOpen())
+	{
+		return(NULL);
+	}
+
+	const PACK_HEADER* pHeader = reinterpret_cast<const PACK_HEADER*>(m_file.GetData());
+	const PACK_SECTION* sections = reinterpret_cast<const PACK_SECTION*>(m_file.GetData() + sizeof(PACK_HEADER));
+	for (uint32_t i = 0; i < pHeader->sectionCount; i++)
+	{
+		if (sections[i].type != (uint32_t)type)
+		{
+			continue;
+		}
+		if ((recordSize > 1) && (sections[i].size != (uint64_t)sections[i].count * recordSize))
+		{
+			std::cout << "ERROR: Asset pack section " << type << " has the wrong record size" << std::endl;
+			return(NULL);
+		}
+		return(&sections[i]);
+	}
+	return(NULL);
+}
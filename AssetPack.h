@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.h
+// ============
+// map a baked asset pack into memory and read it in place
+//
+//  The pack is written offline by Tools/AssetBaker.cpp.  It holds the
+//  pooled meshes, textures with all of their mip levels, and the
+//  materials, lights and objects of the scene, each in a section laid
+//  out exactly as it is used, so loading is a file mapping followed
+//  by uploads straight from the mapped memory.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+#include "MeshPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  AssetPack
+ *
+ *  This class maps a pack file read-only and hands out
+ *  typed pointers into its sections.  The pointers stay
+ *  valid until the pack is closed.
+ ***********************************************************/
+class AssetPack
+{
+public:
+	// constructor
+	AssetPack();
+	// destructor
+	~AssetPack();
+
+	// bumped whenever the layout of any record changes
+	static const uint32_t FORMAT_VERSION = 1;
+	// every section starts on this boundary in the file
+	static const uint32_t SECTION_ALIGNMENT = 64;
+
+	enum SECTION_TYPE
+	{
+		// MeshPool::MESH_VERTEX array
+		SECTION_VERTICES = 1,
+		// GLuint array
+		SECTION_INDICES,
+		// MeshPool::MESH_RANGE array, in MESH_TYPE order
+		SECTION_MESHES,
+		// PACK_TEXTURE array
+		SECTION_TEXTURES,
+		// the mip levels of every texture, largest first
+		SECTION_TEXTURE_DATA,
+		// PACK_MATERIAL array
+		SECTION_MATERIALS,
+		// PACK_LIGHT array
+		SECTION_LIGHTS,
+		// PACK_OBJECT array
+		SECTION_OBJECTS,
+		// one PACK_SCENE
+		SECTION_SCENE
+	};
+
+	struct PACK_HEADER
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t sectionCount;
+		uint64_t fileSize;
+	};
+
+	// the section table follows the header
+	struct PACK_SECTION
+	{
+		uint32_t type;
+		uint32_t count;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// names are zero terminated within their arrays
+	static const int NAME_LENGTH = 32;
+
+	struct PACK_TEXTURE
+	{
+		char tag[NAME_LENGTH];
+		uint32_t width;
+		uint32_t height;
+		// 3 for RGB or 4 for RGBA, one byte each, rows unpadded
+		uint32_t channels;
+		uint32_t levelCount;
+		// offset of the first level within the texture data section
+		uint64_t dataOffset;
+		uint64_t dataSize;
+	};
+
+	struct PACK_MATERIAL
+	{
+		char tag[NAME_LENGTH];
+		float ambientColor[3];
+		float ambientStrength;
+		float diffuseColor[3];
+		float shininess;
+		float specularColor[3];
+		float padding;
+	};
+
+	struct PACK_LIGHT
+	{
+		float position[3];
+		float focalStrength;
+		float direction[3];
+		float specularIntensity;
+		float ambientColor[3];
+		float padding0;
+		float diffuseColor[3];
+		float padding1;
+		float specularColor[3];
+		float padding2;
+	};
+
+	struct PACK_OBJECT
+	{
+		char name[NAME_LENGTH];
+		uint32_t mesh;
+		// combination of ObjectStore::OBJECT_FLAGS
+		uint32_t flags;
+		// indices into the texture and material sections, or -1
+		int32_t textureIndex;
+		int32_t materialIndex;
+		float scaleXYZ[3];
+		float padding0;
+		// rotation about the X, Y and Z axes in degrees
+		float rotationXYZ[3];
+		float padding1;
+		float positionXYZ[3];
+		float padding2;
+		float color[4];
+	};
+
+	struct PACK_SCENE
+	{
+		float globalAmbientLight[3];
+		float padding;
+	};
+
+	// map the pack, checking its header and section table
+	bool Open(const std::string& filename);
+	void Close();
+	bool IsOpen() const { return m_file.IsOpen(); }
+
+	// typed view of a section, NULL with a zero count when the
+	// pack does not have it
+	template <typename T>
+	const T* GetSection(SECTION_TYPE type, uint32_t& count) const
+	{
+		const PACK_SECTION* pSection = FindSection(type, sizeof(T));
+		count = (NULL != pSection) ? pSection->count : 0;
+		return (NULL != pSection) ? reinterpret_cast<const T*>(m_file.GetData() + pSection->offset) : NULL;
+	}
+	// raw bytes of a section, NULL when the pack does not have it
+	const unsigned char* GetSectionData(SECTION_TYPE type, uint64_t& size) const;
+
+private:
+	MappedFile m_file;
+
+	// the section of the passed in type, if its records have the
+	// expected size and it lies inside the file
+	const PACK_SECTION* FindSection(SECTION_TYPE type, size_t recordSize) const;
+};
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// hand out memory for the current frame from one reused block
+//
+//  Allocating is a single atomic add to an offset, so any thread can
+//  take memory while the frame is built, and the whole frame's memory
+//  is given back at once by resetting the offset.  A frame that needs
+//  more than the block holds is served from the heap, and the block
+//  grows to fit at the next reset, so a steady frame never allocates.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t capacity)
+{
+	m_capacity = std::max(capacity, (size_t)alignof(std::max_align_t));
+	m_pBlock = static_cast<unsigned char*>(::operator new(m_capacity));
+	m_offset = 0;
+	m_frameBytes = 0;
+	m_overflowBytes = 0;
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	for (void* pMemory : m_overflow)
+	{
+		::operator delete(pMemory);
+	}
+	m_overflow.clear();
+	::operator delete(m_pBlock);
+	m_pBlock = NULL;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method reserves the bytes plus room to align them
+ *  with one atomic add.  The block itself is aligned as new
+ *  aligns, so aligning the offset aligns the address.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t bytes, size_t alignment)
+{
+	size_t reserved = bytes + alignment - 1;
+	size_t offset = m_offset.fetch_add(reserved);
+	size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+	if (aligned + bytes <= m_capacity)
+	{
+		return(m_pBlock + aligned);
+	}
+
+	// the block is full for this frame
+	void* pMemory = ::operator new(bytes);
+	std::lock_guard<std::mutex> lock(m_overflowMutex);
+	m_overflow.push_back(pMemory);
+	m_overflowBytes += reserved;
+	return(pMemory);
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method frees the frame's overflow and, when there
+ *  was any, replaces the block with one that would have held
+ *  the whole frame.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+	size_t blockBytes = std::min(m_offset.load(), m_capacity);
+	m_frameBytes = blockBytes + m_overflowBytes;
+
+	if (!m_overflow.empty())
+	{
+		for (void* pMemory : m_overflow)
+		{
+			::operator delete(pMemory);
+		}
+		m_overflow.clear();
+
+		::operator delete(m_pBlock);
+		m_capacity = std::max(m_capacity * 2, m_frameBytes);
+		m_pBlock = static_cast<unsigned char*>(::operator new(m_capacity));
+	}
+
+	m_overflowBytes = 0;
+	m_offset = 0;
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// hand out memory for the current frame from one reused block
+//
+//  Allocating is a single atomic add to an offset, so any thread can
+//  take memory while the frame is built, and the whole frame's memory
+//  is given back at once by resetting the offset.  A frame that needs
+//  more than the block holds is served from the heap, and the block
+//  grows to fit at the next reset, so a steady frame never allocates.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class is a bump allocator whose memory lives until
+ *  the next Reset().  Nothing is destroyed by the arena;
+ *  objects with destructors must be destroyed by whoever
+ *  created them before the reset.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// constructor
+	FrameArena(size_t capacity);
+	// destructor
+	~FrameArena();
+
+	// memory for bytes aligned to alignment, at most the
+	// alignment new gives, until the next Reset(); safe to
+	// call from any thread
+	void* Allocate(size_t bytes, size_t alignment);
+
+	// construct an object or an uninitialized array in the arena
+	template<typename TYPE, typename... ARGUMENTS>
+	TYPE* Create(ARGUMENTS&&... arguments)
+	{
+		return new (Allocate(sizeof(TYPE), alignof(TYPE))) TYPE(std::forward<ARGUMENTS>(arguments)...);
+	}
+	template<typename TYPE>
+	TYPE* AllocateArray(size_t count)
+	{
+		return static_cast<TYPE*>(Allocate(sizeof(TYPE) * count, alignof(TYPE)));
+	}
+
+	// give back everything allocated since the last reset, and
+	// grow the block when it overflowed; call once nothing uses
+	// the memory any more
+	void Reset();
+
+	// bytes the last frame took, including any overflow, and
+	// the size of the block
+	size_t GetFrameBytes() const { return m_frameBytes; }
+	size_t GetCapacity() const { return m_capacity; }
+
+private:
+	unsigned char* m_pBlock;
+	size_t m_capacity;
+	std::atomic<size_t> m_offset;
+	size_t m_frameBytes;
+
+	// allocations that did not fit in the block this frame
+	std::mutex m_overflowMutex;
+	std::vector<void*> m_overflow;
+	size_t m_overflowBytes;
+};
@@ -0,0 +1,478 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// record the displayed frames to disk without stalling the render loop
+//
+//  Frames are read back into a ring of persistently mapped pixel
+//  buffer objects.  A fence marks when each readback lands, and the
+//  mapped pixels are then handed to a worker thread that encodes them
+//  as a Y4M stream or a PNG sequence.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// bytes per pixel of the readback format
+	const int g_BytesPerPixel = 4;
+
+	/***********************************************************
+	 *  Crc32()
+	 *
+	 *  Update a PNG chunk checksum with the passed in bytes.
+	 ***********************************************************/
+	unsigned int Crc32(unsigned int crc, const unsigned char* pData, size_t length)
+	{
+		static unsigned int table[256] = { 0 };
+		if (table[1] == 0)
+		{
+			for (unsigned int n = 0; n < 256; n++)
+			{
+				unsigned int c = n;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				table[n] = c;
+			}
+		}
+
+		crc = ~crc;
+		for (size_t i = 0; i < length; i++)
+		{
+			crc = table[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return(~crc);
+	}
+
+	/***********************************************************
+	 *  AppendBigEndian()
+	 *
+	 *  Append a 32-bit value in network byte order.
+	 ***********************************************************/
+	void AppendBigEndian(std::vector<unsigned char>& out, unsigned int value)
+	{
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	/***********************************************************
+	 *  AppendChunk()
+	 *
+	 *  Append one length-prefixed, checksummed PNG chunk.
+	 ***********************************************************/
+	void AppendChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+	{
+		AppendBigEndian(out, (unsigned int)data.size());
+		size_t typeStart = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		AppendBigEndian(out, Crc32(0, &out[typeStart], out.size() - typeStart));
+	}
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture()
+{
+	for (int i = 0; i < READBACK_SLOT_COUNT; i++)
+	{
+		m_slots[i].buffer = 0;
+		m_slots[i].pPixels = NULL;
+		m_slots[i].fence = 0;
+		m_slots[i].state = SLOT_FREE;
+		m_slots[i].frameNumber = 0;
+	}
+	m_nextSlot = 0;
+	m_bCapturing = false;
+	m_bWriteY4M = false;
+	m_width = 0;
+	m_height = 0;
+	m_pStreamFile = NULL;
+	m_bStopWorker = false;
+	m_framesCaptured = 0;
+	m_framesWritten = 0;
+	m_droppedBusy = 0;
+	m_droppedResized = 0;
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method allocates the readback ring, opens the output
+ *  and starts the encoding thread.  Persistent mapping needs
+ *  OpenGL 4.4.
+ ***********************************************************/
+bool FrameCapture::Start(const std::string& path, int width, int height, int framesPerSecond)
+{
+	if (m_bCapturing)
+	{
+		return(false);
+	}
+	if (!GLEW_VERSION_4_4)
+	{
+		std::cout << "Frame capture needs OpenGL 4.4 for persistently mapped buffers" << std::endl;
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	m_bWriteY4M = (path.size() > 4) && (path.compare(path.size() - 4, 4, ".y4m") == 0);
+	m_path = path;
+	if (!m_bWriteY4M && (path.size() > 4) && (path.compare(path.size() - 4, 4, ".png") == 0))
+	{
+		m_path = path.substr(0, path.size() - 4);
+	}
+
+	if (m_bWriteY4M)
+	{
+		m_pStreamFile = fopen(m_path.c_str(), "wb");
+		if (m_pStreamFile == NULL)
+		{
+			std::cout << "Could not open capture file:" << m_path << std::endl;
+			return(false);
+		}
+		fprintf(m_pStreamFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", m_width, m_height, framesPerSecond);
+	}
+
+	// the buffers stay mapped for the whole recording, so the
+	// worker reads the pixels in place without another copy
+	GLsizeiptr frameSize = (GLsizeiptr)m_width * m_height * g_BytesPerPixel;
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	for (int i = 0; i < READBACK_SLOT_COUNT; i++)
+	{
+		glGenBuffers(1, &m_slots[i].buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].buffer);
+		glBufferStorage(GL_PIXEL_PACK_BUFFER, frameSize, NULL, flags);
+		m_slots[i].pPixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameSize, flags);
+		m_slots[i].fence = 0;
+		m_slots[i].state = SLOT_FREE;
+		if (m_slots[i].pPixels == NULL)
+		{
+			std::cout << "Could not map a capture readback buffer of " << frameSize << " bytes" << std::endl;
+			// release the buffers made so far, including this one,
+			// which holds storage but no mapping
+			for (int j = 0; j <= i; j++)
+			{
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[j].buffer);
+				if (m_slots[j].pPixels != NULL)
+				{
+					glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				}
+				glDeleteBuffers(1, &m_slots[j].buffer);
+				m_slots[j].buffer = 0;
+				m_slots[j].pPixels = NULL;
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			if (m_pStreamFile != NULL)
+			{
+				fclose(m_pStreamFile);
+				m_pStreamFile = NULL;
+			}
+			return(false);
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_nextSlot = 0;
+	m_framesCaptured = 0;
+	m_framesWritten = 0;
+	m_droppedBusy = 0;
+	m_droppedResized = 0;
+	m_bStopWorker = false;
+	m_worker = std::thread(&FrameCapture::EncodeLoop, this);
+	m_bCapturing = true;
+
+	std::cout << "INFO: Capturing " << m_width << "x" << m_height << " frames to " << path << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method waits for the frames still in flight, stops
+ *  the encoding thread, frees the ring and reports the
+ *  frame counters.
+ ***********************************************************/
+void FrameCapture::Stop()
+{
+	if (!m_bCapturing)
+	{
+		return;
+	}
+
+	// the recording is over, so waiting on the GPU is fine here
+	CollectReadbacks(true);
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bStopWorker = true;
+	}
+	m_queueSignal.notify_one();
+	m_worker.join();
+
+	for (int i = 0; i < READBACK_SLOT_COUNT; i++)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].buffer);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glDeleteBuffers(1, &m_slots[i].buffer);
+		m_slots[i].buffer = 0;
+		m_slots[i].pPixels = NULL;
+		m_slots[i].state = SLOT_FREE;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (m_pStreamFile != NULL)
+	{
+		fclose(m_pStreamFile);
+		m_pStreamFile = NULL;
+	}
+	m_bCapturing = false;
+
+	std::cout << "INFO: Capture finished, " << m_framesWritten << " frames written, "
+		<< m_droppedBusy << " dropped with every readback buffer busy, "
+		<< m_droppedResized << " dropped after a window resize" << std::endl;
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method passes finished readbacks to the worker and
+ *  starts an asynchronous readback of the current frame
+ *  into the next free buffer.  It never waits.
+ ***********************************************************/
+void FrameCapture::CaptureFrame(int width, int height)
+{
+	if (!m_bCapturing)
+	{
+		return;
+	}
+
+	CollectReadbacks(false);
+
+	// the output has a fixed size, so frames drawn at another
+	// window size are skipped
+	if ((width != m_width) || (height != m_height))
+	{
+		m_droppedResized++;
+		return;
+	}
+
+	READBACK_SLOT& slot = m_slots[m_nextSlot];
+	if (slot.state != SLOT_FREE)
+	{
+		m_droppedBusy++;
+		return;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frameNumber = m_framesCaptured++;
+	slot.state = SLOT_READING;
+	m_nextSlot = (m_nextSlot + 1) % READBACK_SLOT_COUNT;
+}
+
+/***********************************************************
+ *  CollectReadbacks()
+ *
+ *  This method queues every readback whose fence has been
+ *  signaled for encoding, in frame order.  The fences are
+ *  only polled unless bWait is set.
+ ***********************************************************/
+void FrameCapture::CollectReadbacks(bool bWait)
+{
+	// the oldest readback follows the newest in the ring
+	for (int i = 0; i < READBACK_SLOT_COUNT; i++)
+	{
+		READBACK_SLOT& slot = m_slots[(m_nextSlot + i) % READBACK_SLOT_COUNT];
+		if (slot.state != SLOT_READING)
+		{
+			continue;
+		}
+
+		GLuint64 timeout = bWait ? 1000000000 : 0;
+		GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+		{
+			// later readbacks cannot have finished before this one
+			break;
+		}
+
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		slot.state = SLOT_ENCODING;
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_encodeQueue.push_back((int)(&slot - m_slots));
+		}
+		m_queueSignal.notify_one();
+	}
+}
+
+/***********************************************************
+ *  EncodeLoop()
+ *
+ *  The worker thread encodes the queued frames in order and
+ *  returns each buffer to the ring when it is done.
+ ***********************************************************/
+void FrameCapture::EncodeLoop()
+{
+	for (;;)
+	{
+		int slotIndex = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueSignal.wait(lock, [this] { return m_bStopWorker || !m_encodeQueue.empty(); });
+			if (m_encodeQueue.empty())
+			{
+				return;
+			}
+			slotIndex = m_encodeQueue.front();
+			m_encodeQueue.pop_front();
+		}
+
+		READBACK_SLOT& slot = m_slots[slotIndex];
+		if (m_bWriteY4M)
+			EncodeY4MFrame(slot.pPixels);
+		else
+			EncodePNGFrame(slot.pPixels, slot.frameNumber);
+
+		m_framesWritten++;
+		slot.state = SLOT_FREE;
+	}
+}
+
+/***********************************************************
+ *  EncodeY4MFrame()
+ *
+ *  This method converts one RGBA frame to full resolution
+ *  BT.601 YCbCr planes and appends it to the stream.  The
+ *  rows are flipped since OpenGL reads bottom up.
+ ***********************************************************/
+void FrameCapture::EncodeY4MFrame(const unsigned char* pPixels)
+{
+	const size_t planeSize = (size_t)m_width * m_height;
+	std::vector<unsigned char> planes(planeSize * 3);
+	unsigned char* pY = &planes[0];
+	unsigned char* pU = &planes[planeSize];
+	unsigned char* pV = &planes[planeSize * 2];
+
+	for (int row = 0; row < m_height; row++)
+	{
+		const unsigned char* pSource = pPixels + (size_t)(m_height - 1 - row) * m_width * g_BytesPerPixel;
+		size_t destination = (size_t)row * m_width;
+		for (int column = 0; column < m_width; column++)
+		{
+			int r = pSource[0];
+			int g = pSource[1];
+			int b = pSource[2];
+			pY[destination] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+			pU[destination] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			pV[destination] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+			pSource += g_BytesPerPixel;
+			destination++;
+		}
+	}
+
+	fputs("FRAME\n", m_pStreamFile);
+	fwrite(planes.data(), 1, planes.size(), m_pStreamFile);
+}
+
+/***********************************************************
+ *  EncodePNGFrame()
+ *
+ *  This method writes one frame as an RGB PNG file.  The
+ *  image data is stored without compression, which keeps
+ *  the worker fast enough to hold the frame rate.
+ ***********************************************************/
+void FrameCapture::EncodePNGFrame(const unsigned char* pPixels, unsigned int frameNumber)
+{
+	// filtered scanlines: a zero filter byte then RGB per row
+	const size_t rowSize = 1 + (size_t)m_width * 3;
+	std::vector<unsigned char> scanlines(rowSize * m_height);
+	for (int row = 0; row < m_height; row++)
+	{
+		const unsigned char* pSource = pPixels + (size_t)(m_height - 1 - row) * m_width * g_BytesPerPixel;
+		unsigned char* pDestination = &scanlines[row * rowSize];
+		*pDestination++ = 0;
+		for (int column = 0; column < m_width; column++)
+		{
+			*pDestination++ = pSource[0];
+			*pDestination++ = pSource[1];
+			*pDestination++ = pSource[2];
+			pSource += g_BytesPerPixel;
+		}
+	}
+
+	// zlib stream made of stored deflate blocks
+	std::vector<unsigned char> compressed;
+	compressed.reserve(scanlines.size() + scanlines.size() / 65535 * 5 + 16);
+	compressed.push_back(0x78);
+	compressed.push_back(0x01);
+	unsigned int adlerA = 1;
+	unsigned int adlerB = 0;
+	size_t offset = 0;
+	do
+	{
+		size_t blockSize = std::min<size_t>(scanlines.size() - offset, 65535);
+		bool bFinal = (offset + blockSize == scanlines.size());
+		compressed.push_back(bFinal ? 1 : 0);
+		compressed.push_back((unsigned char)(blockSize & 0xFF));
+		compressed.push_back((unsigned char)(blockSize >> 8));
+		compressed.push_back((unsigned char)(~blockSize & 0xFF));
+		compressed.push_back((unsigned char)((~blockSize >> 8) & 0xFF));
+		for (size_t i = 0; i < blockSize; i++)
+		{
+			unsigned char value = scanlines[offset + i];
+			compressed.push_back(value);
+			adlerA = (adlerA + value) % 65521;
+			adlerB = (adlerB + adlerA) % 65521;
+		}
+		offset += blockSize;
+	} while (offset < scanlines.size());
+	AppendBigEndian(compressed, (adlerB << 16) | adlerA);
+
+	std::vector<unsigned char> header;
+	AppendBigEndian(header, (unsigned int)m_width);
+	AppendBigEndian(header, (unsigned int)m_height);
+	header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8-bit RGB, no interlace
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<unsigned char> file(signature, signature + 8);
+	AppendChunk(file, "IHDR", header);
+	AppendChunk(file, "IDAT", compressed);
+	AppendChunk(file, "IEND", std::vector<unsigned char>());
+
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "_%05u.png", frameNumber);
+	FILE* pFile = fopen((m_path + fileName).c_str(), "wb");
+	if (pFile != NULL)
+	{
+		fwrite(file.data(), 1, file.size(), pFile);
+		fclose(pFile);
+	}
+}
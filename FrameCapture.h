@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// record the displayed frames to disk without stalling the render loop
+//
+//  Frames are read back into a ring of persistently mapped pixel
+//  buffer objects.  A fence marks when each readback lands, and the
+//  mapped pixels are then handed to a worker thread that encodes them
+//  as a Y4M stream or a PNG sequence.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class reads back the window each frame and encodes
+ *  it on a worker thread.  When every readback buffer is
+ *  still busy the frame is dropped and counted instead of
+ *  waiting on the GPU or the encoder.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor
+	FrameCapture();
+	// destructor
+	~FrameCapture();
+
+	// start recording - a path ending in .y4m writes one raw
+	// video stream, anything else is used as the prefix of a
+	// numbered PNG sequence
+	bool Start(const std::string& path, int width, int height, int framesPerSecond);
+	// finish the outstanding frames and report the counters
+	void Stop();
+	bool IsCapturing() const { return m_bCapturing; }
+
+	// read back the current framebuffer, call after the frame
+	// is presented and before the buffers are swapped
+	void CaptureFrame(int width, int height);
+
+	// frame counters
+	unsigned int GetFramesWritten() const { return m_framesWritten; }
+	unsigned int GetFramesDropped() const { return m_droppedBusy + m_droppedResized; }
+
+private:
+	// readback buffers in the ring; enough to cover the GPU
+	// latency plus one frame being encoded
+	static const int READBACK_SLOT_COUNT = 4;
+
+	enum SLOT_STATE
+	{
+		SLOT_FREE = 0,
+		SLOT_READING,
+		SLOT_ENCODING
+	};
+
+	struct READBACK_SLOT
+	{
+		GLuint buffer;
+		const unsigned char* pPixels;
+		GLsync fence;
+		// written by the render thread when a readback starts and
+		// by the worker thread when the encoding has finished
+		std::atomic<int> state;
+		unsigned int frameNumber;
+	};
+
+	READBACK_SLOT m_slots[READBACK_SLOT_COUNT];
+	int m_nextSlot;
+
+	// recording settings
+	bool m_bCapturing;
+	bool m_bWriteY4M;
+	std::string m_path;
+	int m_width;
+	int m_height;
+	FILE* m_pStreamFile;
+
+	// worker thread and its queue of slots ready to encode
+	std::thread m_worker;
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueSignal;
+	std::deque<int> m_encodeQueue;
+	bool m_bStopWorker;
+
+	// counters
+	unsigned int m_framesCaptured;
+	std::atomic<unsigned int> m_framesWritten;
+	unsigned int m_droppedBusy;
+	unsigned int m_droppedResized;
+
+	// hand every readback whose fence has signaled to the worker
+	void CollectReadbacks(bool bWait);
+	// worker thread loop and encoders
+	void EncodeLoop();
+	void EncodeY4MFrame(const unsigned char* pPixels);
+	void EncodePNGFrame(const unsigned char* pPixels, unsigned int frameNumber);
+};
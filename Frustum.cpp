@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.cpp
+// ============
+// test bounding volumes against the camera's view volume
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Frustum.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  Frustum()
+ *
+ *  The constructor extracts the six normalized clip planes
+ *  from the rows of the combined matrix.
+ ***********************************************************/
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		m_planes[i * 2] = rows[3] + rows[i];
+		m_planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		m_planes[i] /= glm::length(glm::vec3(m_planes[i]));
+	}
+}
+
+/***********************************************************
+ *  IsSphereVisible()
+ *
+ *  This method rejects a sphere that lies entirely behind
+ *  any one of the planes.
+ ***********************************************************/
+bool Frustum::IsSphereVisible(const glm::vec4& sphere) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (glm::dot(glm::vec3(m_planes[i]), glm::vec3(sphere)) + m_planes[i].w < -sphere.w)
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  TransformSphere()
+ *
+ *  This method moves a local bounding sphere into world
+ *  space.  Non-uniform scale grows the radius by the
+ *  largest axis so the sphere stays conservative.
+ ***********************************************************/
+glm::vec4 Frustum::TransformSphere(const glm::mat4& model, const glm::vec4& sphere)
+{
+	glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f));
+	float scale = std::max(glm::length(glm::vec3(model[0])),
+		std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	return(glm::vec4(center, sphere.w * scale));
+}
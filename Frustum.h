@@ -0,0 +1,35 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.h
+// ============
+// test bounding volumes against the camera's view volume
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  Frustum
+ *
+ *  This class holds the six clip planes of a view volume,
+ *  each normalized with its normal pointing inward.
+ ***********************************************************/
+class Frustum
+{
+public:
+	// extract the planes from a combined projection * view
+	Frustum(const glm::mat4& viewProjection);
+
+	// true when a world space sphere (xyz = center, w = radius)
+	// is at least partly inside the volume
+	bool IsSphereVisible(const glm::vec4& sphere) const;
+
+	const glm::vec4* GetPlanes() const { return m_planes; }
+
+	// transform a local bounding sphere into world space, scaling
+	// the radius by the largest axis scale of the model matrix
+	static glm::vec4 TransformSphere(const glm::mat4& model, const glm::vec4& sphere);
+
+private:
+	glm::vec4 m_planes[6];
+};
@@ -0,0 +1,850 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpudrivenrenderer.cpp
+// ============
+// cull the scene objects and build the draw commands on the GPU
+//
+//  All per-object data lives in shader storage buffers.  A compute
+//  shader tests every object against the view frustum and writes the
+//  indirect draw commands and visible instance lists, so the CPU only
+//  issues one dispatch plus one multi-draw per texture binding.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GPUDrivenRenderer.h"
+#include "Frustum.h"
+#include "UniformCounter.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+// declaration of global variables
+namespace
+{
+	// work group size of the culling compute shader
+	const GLuint g_CullGroupSize = 64;
+	// the number of light sources supported by the draw shader
+	const int g_MaxLights = GPUDrivenRenderer::MAX_LIGHTS;
+
+	// shader storage buffer binding points
+	const GLuint g_ObjectBinding = 0;
+	const GLuint g_MaterialBinding = 1;
+	const GLuint g_CommandBinding = 2;
+	const GLuint g_VisibleBinding = 3;
+
+	// vertex attribute carrying the visible object index
+	const GLuint g_ObjectIndexAttribute = 3;
+
+	// per-object data, laid out to match the std430 ObjectData
+	// struct in the shaders
+	struct GPU_OBJECT
+	{
+		glm::mat4 model;
+		glm::vec4 normalMatrix[3];
+		glm::vec4 color;
+		// world space bounding sphere, xyz = center, w = radius
+		glm::vec4 boundingSphere;
+		GLuint drawCommand;
+		GLuint materialIndex;
+		GLuint bUseTexture;
+		// reflection probe to sample plus one, or 0 for none
+		GLuint probeLayer;
+		glm::vec4 uvScale;
+		// scale in xy and offset in zw into the lightmap atlas,
+		// zero for an object lit dynamically
+		glm::vec4 lightmapRect;
+	};
+
+	// material data, laid out to match the std430 MaterialData
+	// struct in the shaders
+	struct GPU_MATERIAL
+	{
+		// rgb = ambient color, a = ambient strength
+		glm::vec4 ambientColor;
+		glm::vec4 diffuseColor;
+		// rgb = specular color, a = shininess
+		glm::vec4 specularColor;
+	};
+
+	// the layout glMultiDrawElementsIndirect() reads
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	const char* g_CullShaderSource = R"(
+#version 430
+layout(local_size_x = 64) in;
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 normalMatrix[3];
+	vec4 color;
+	vec4 boundingSphere;
+	uvec4 info;
+	vec4 uvScale;
+	vec4 lightmapRect;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectData objects[]; };
+layout(std430, binding = 2) buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 3) writeonly buffer Visible { uint visibleObjects[]; };
+
+uniform vec4 frustumPlanes[6];
+uniform uint objectCount;
+// left out of the frame, or -1
+uniform int hiddenObject;
+
+void main()
+{
+	uint objectIndex = gl_GlobalInvocationID.x;
+	if ((objectIndex >= objectCount) || (int(objectIndex) == hiddenObject))
+		return;
+
+	vec4 sphere = objects[objectIndex].boundingSphere;
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(frustumPlanes[i].xyz, sphere.xyz) + frustumPlanes[i].w < -sphere.w)
+			return;
+	}
+
+	uint command = objects[objectIndex].info.x;
+	uint slot = atomicAdd(commands[command].instanceCount, 1u);
+	visibleObjects[commands[command].baseInstance + slot] = objectIndex;
+}
+)";
+
+	const char* g_VertexShaderSource = R"(
+#version 430
+layout(location = 0) in vec3 inVertexPosition;
+layout(location = 1) in vec3 inVertexNormal;
+layout(location = 2) in vec2 inTextureCoordinate;
+layout(location = 3) in uint inObjectIndex;
+layout(location = 4) in vec2 inLightmapCoordinate;
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 normalMatrix[3];
+	vec4 color;
+	vec4 boundingSphere;
+	uvec4 info;
+	vec4 uvScale;
+	vec4 lightmapRect;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectData objects[]; };
+
+uniform mat4 view;
+uniform mat4 projection;
+// the mesh pool holds compact vertices, whose normals arrive
+// octahedral encoded in xy; their positions are decoded by the
+// model matrix
+uniform bool bCompactVertices;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+out vec2 fragmentLightmapCoordinate;
+flat out uint fragmentObjectIndex;
+// the depth pre-pass links this same source into its own program,
+// so both passes must compute identical depths for GL_LEQUAL
+invariant gl_Position;
+
+vec3 DecodeOctahedral(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (normal.z < 0.0)
+	{
+		normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(normal);
+}
+
+void main()
+{
+	ObjectData object = objects[inObjectIndex];
+	vec4 worldPosition = object.model * vec4(inVertexPosition, 1.0);
+	mat3 normalMatrix = mat3(object.normalMatrix[0].xyz, object.normalMatrix[1].xyz, object.normalMatrix[2].xyz);
+	vec3 normal = bCompactVertices ? DecodeOctahedral(inVertexNormal.xy) : inVertexNormal;
+
+	fragmentPosition = worldPosition.xyz;
+	fragmentVertexNormal = normalMatrix * normal;
+	fragmentTextureCoordinate = inTextureCoordinate * object.uvScale.xy;
+	fragmentLightmapCoordinate = inLightmapCoordinate * object.lightmapRect.xy + object.lightmapRect.zw;
+	fragmentObjectIndex = inObjectIndex;
+	gl_Position = projection * view * worldPosition;
+}
+)";
+
+	const char* g_FragmentShaderSource = R"(
+#version 430
+#define TOTAL_LIGHTS 4
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+in vec2 fragmentLightmapCoordinate;
+flat in uint fragmentObjectIndex;
+
+out vec4 outFragmentColor;
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 normalMatrix[3];
+	vec4 color;
+	vec4 boundingSphere;
+	uvec4 info;
+	vec4 uvScale;
+	vec4 lightmapRect;
+};
+
+struct MaterialData
+{
+	vec4 ambientColor;
+	vec4 diffuseColor;
+	vec4 specularColor;
+};
+
+struct LightSource
+{
+	vec3 position;
+	// the way a directed light points, or zero for a light that
+	// shines all around
+	vec3 direction;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	// exponent and scale of the specular highlight
+	float focalStrength;
+	float specularIntensity;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectData objects[]; };
+layout(std430, binding = 1) readonly buffer Materials { MaterialData materials[]; };
+
+uniform LightSource lightSources[TOTAL_LIGHTS];
+uniform int lightCount;
+uniform vec3 globalAmbient;
+uniform vec3 viewPosition;
+uniform sampler2D objectTexture;
+// the global ambient and the ambient and diffuse light of the
+// first bakedLightCount lights, baked for the static objects;
+// -1 when the lights changed since the bake
+uniform sampler2D lightmapTexture;
+uniform int bakedLightCount = -1;
+// prefiltered cubemaps of the scene around the glossy objects,
+// one mip level per step of roughness
+uniform samplerCubeArray probeTexture;
+uniform int probeLevelCount = 0;
+
+// a directed light fades out away from its direction
+float CalcFalloff(LightSource light, vec3 lightDirection)
+{
+	if (dot(light.direction, light.direction) == 0.0)
+		return 1.0;
+	return max(dot(-lightDirection, normalize(light.direction)), 0.0);
+}
+
+vec3 CalcSpecular(LightSource light, MaterialData material, vec3 normal, vec3 viewDirection)
+{
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0), max(light.focalStrength, 1.0));
+	return light.specularIntensity * specularComponent * CalcFalloff(light, lightDirection) *
+		light.specularColor * material.specularColor.rgb;
+}
+
+vec3 CalcLightSource(LightSource light, MaterialData material, vec3 normal, vec3 viewDirection)
+{
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+	float impact = max(dot(normal, lightDirection), 0.0) * CalcFalloff(light, lightDirection);
+
+	vec3 ambient = light.ambientColor * material.ambientColor.rgb * material.ambientColor.a;
+	vec3 diffuse = impact * light.diffuseColor * material.diffuseColor.rgb;
+	return ambient + diffuse + CalcSpecular(light, material, normal, viewDirection);
+}
+
+void main()
+{
+	ObjectData object = objects[fragmentObjectIndex];
+	MaterialData material = materials[object.info.y];
+
+	vec4 baseColor = object.color;
+	if (object.info.z != 0u)
+		baseColor = texture(objectTexture, fragmentTextureCoordinate);
+
+	vec3 normal = normalize(fragmentVertexNormal);
+	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+	vec3 lighting = globalAmbient;
+	int firstDynamicLight = 0;
+	if ((object.lightmapRect.x > 0.0) && (bakedLightCount >= 0))
+	{
+		// the baked lights only add their view dependent part
+		lighting = texture(lightmapTexture, fragmentLightmapCoordinate).rgb;
+		for (int i = 0; i < bakedLightCount; i++)
+		{
+			lighting += CalcSpecular(lightSources[i], material, normal, viewDirection);
+		}
+		firstDynamicLight = bakedLightCount;
+	}
+	for (int i = firstDynamicLight; i < lightCount; i++)
+	{
+		lighting += CalcLightSource(lightSources[i], material, normal, viewDirection);
+	}
+
+	vec3 color = lighting * baseColor.rgb;
+	if ((object.info.w != 0u) && (probeLevelCount > 0))
+	{
+		// the blur level matching the shininess, blended in by
+		// Schlick's approximation with the specular color as the
+		// reflectance facing the surface
+		vec3 reflectDirection = reflect(-viewDirection, normal);
+		float roughness = sqrt(2.0 / (max(material.specularColor.a, 1.0) + 2.0));
+		vec3 reflection = textureLod(probeTexture, vec4(reflectDirection, float(object.info.w - 1u)),
+			roughness * float(probeLevelCount - 1)).rgb;
+		float grazing = pow(1.0 - max(dot(normal, viewDirection), 0.0), 5.0);
+		vec3 fresnel = material.specularColor.rgb + (1.0 - material.specularColor.rgb) * grazing;
+		color = mix(color, reflection, fresnel);
+	}
+
+	outFragmentColor = vec4(color, baseColor.a);
+}
+)";
+
+	const char* g_DepthFragmentShaderSource = R"(
+#version 430
+void main()
+{
+}
+)";
+
+	/***********************************************************
+	 *  CompileProgram()
+	 *
+	 *  Compile and link the passed in shader stages into a
+	 *  program, returning 0 and logging on failure.
+	 ***********************************************************/
+	GLuint CompileProgram(const GLenum types[], const char* const sources[], int stageCount)
+	{
+		GLuint program = glCreateProgram();
+		GLint success = 0;
+		char infoLog[1024];
+
+		for (int i = 0; i < stageCount; i++)
+		{
+			GLuint shader = glCreateShader(types[i]);
+			glShaderSource(shader, 1, &sources[i], NULL);
+			glCompileShader(shader);
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+				std::cout << "ERROR: GPU-driven shader compilation failed\n" << infoLog << std::endl;
+				glDeleteShader(shader);
+				glDeleteProgram(program);
+				return 0;
+			}
+			glAttachShader(program, shader);
+			// flagged for deletion once the program is deleted
+			glDeleteShader(shader);
+		}
+
+		glLinkProgram(program);
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+			std::cout << "ERROR: GPU-driven shader linking failed\n" << infoLog << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+
+		return(program);
+	}
+
+	/***********************************************************
+	 *  BuildGPUObject()
+	 *
+	 *  Fill the shader data of one object drawn by the passed
+	 *  in command.
+	 ***********************************************************/
+	void BuildGPUObject(
+		const MeshPool& meshPool,
+		const GPUDrivenRenderer::OBJECT_INSTANCE& object,
+		GLuint drawCommand,
+		GLuint defaultMaterial,
+		GPU_OBJECT& gpuObject)
+	{
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(object.model)));
+		const glm::vec4& localSphere = meshPool.GetMesh(object.meshIndex).boundingSphere;
+
+		// scale the radius by the longest transformed axis so the
+		// sphere stays conservative under non-uniform scaling
+		float maxScale = std::max(
+			glm::length(glm::vec3(object.model[0])),
+			std::max(glm::length(glm::vec3(object.model[1])), glm::length(glm::vec3(object.model[2]))));
+
+		// compact positions are stored normalized to the mesh's
+		// box, so the decode goes in front of the model matrix;
+		// the normal matrix and bounds stay in local space
+		gpuObject.model = object.model * meshPool.GetPositionDecode(object.meshIndex);
+		for (int i = 0; i < 3; i++)
+		{
+			gpuObject.normalMatrix[i] = glm::vec4(normalMatrix[i], 0.0f);
+		}
+		gpuObject.color = object.color;
+		gpuObject.boundingSphere = glm::vec4(
+			glm::vec3(object.model * glm::vec4(glm::vec3(localSphere), 1.0f)),
+			localSphere.w * maxScale);
+		gpuObject.drawCommand = drawCommand;
+		gpuObject.materialIndex = (object.materialIndex < 0) ? defaultMaterial : (GLuint)object.materialIndex;
+		gpuObject.bUseTexture = (object.textureSlot >= 0) ? 1 : 0;
+		gpuObject.probeLayer = (object.probeIndex < 0) ? 0 : (GLuint)(object.probeIndex + 1);
+		gpuObject.uvScale = glm::vec4(object.uvScale, 0.0f, 0.0f);
+		gpuObject.lightmapRect = object.lightmapRect;
+	}
+}
+
+/***********************************************************
+ *  GPUDrivenRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GPUDrivenRenderer::GPUDrivenRenderer(MeshPool* pMeshPool)
+{
+	m_pMeshPool = pMeshPool;
+	m_cullProgram = 0;
+	m_drawProgram = 0;
+	m_depthProgram = 0;
+	m_vertexArray = 0;
+	m_objectBuffer = 0;
+	m_materialBuffer = 0;
+	m_commandBuffer = 0;
+	m_commandResetBuffer = 0;
+	m_visibleBuffer = 0;
+	m_defaultMaterial = 0;
+	m_objectCount = 0;
+	m_commandCount = 0;
+}
+
+/***********************************************************
+ *  ~GPUDrivenRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GPUDrivenRenderer::~GPUDrivenRenderer()
+{
+	GLuint buffers[] = {
+		m_objectBuffer, m_materialBuffer, m_commandBuffer,
+		m_commandResetBuffer, m_visibleBuffer };
+
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		glDeleteBuffers(5, buffers);
+	}
+	if (m_cullProgram != 0)
+	{
+		glDeleteProgram(m_cullProgram);
+	}
+	if (m_drawProgram != 0)
+	{
+		glDeleteProgram(m_drawProgram);
+	}
+	if (m_depthProgram != 0)
+	{
+		glDeleteProgram(m_depthProgram);
+	}
+	m_pMeshPool = NULL;
+	m_drawGroups.clear();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method compiles the culling and drawing programs,
+ *  creates the buffers, and sets up the vertex array over
+ *  the mesh pool.
+ ***********************************************************/
+bool GPUDrivenRenderer::Initialize()
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "GPU-driven rendering needs OpenGL 4.3, falling back to CPU submission" << std::endl;
+		return false;
+	}
+
+	const GLenum cullTypes[] = { GL_COMPUTE_SHADER };
+	const char* const cullSources[] = { g_CullShaderSource };
+	const GLenum drawTypes[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const char* const drawSources[] = { g_VertexShaderSource, g_FragmentShaderSource };
+	const char* const depthSources[] = { g_VertexShaderSource, g_DepthFragmentShaderSource };
+
+	m_cullProgram = CompileProgram(cullTypes, cullSources, 1);
+	m_drawProgram = CompileProgram(drawTypes, drawSources, 2);
+	m_depthProgram = CompileProgram(drawTypes, depthSources, 2);
+	if ((m_cullProgram == 0) || (m_drawProgram == 0) || (m_depthProgram == 0))
+	{
+		return false;
+	}
+
+	glGenBuffers(1, &m_objectBuffer);
+	glGenBuffers(1, &m_materialBuffer);
+	glGenBuffers(1, &m_commandBuffer);
+	glGenBuffers(1, &m_commandResetBuffer);
+	glGenBuffers(1, &m_visibleBuffer);
+
+	// the mesh pool supplies the vertices and indices, and the
+	// visible list supplies one object index per instance; the
+	// draw command's base instance offsets into that list
+	glGenVertexArrays(1, &m_vertexArray);
+	glBindVertexArray(m_vertexArray);
+
+	m_pMeshPool->SetVertexAttributes();
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_visibleBuffer);
+	glEnableVertexAttribArray(g_ObjectIndexAttribute);
+	glVertexAttribIPointer(g_ObjectIndexAttribute, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+	glVertexAttribDivisor(g_ObjectIndexAttribute, 1);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_pMeshPool->GetIndexBuffer());
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::cout << "INFO: GPU-driven culling enabled" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetMaterials()
+ *
+ *  This method uploads the material list, followed by the
+ *  default material for objects that do not name one.
+ ***********************************************************/
+void GPUDrivenRenderer::SetMaterials(const std::vector<SceneManager::OBJECT_MATERIAL>& materials)
+{
+	std::vector<GPU_MATERIAL> gpuMaterials;
+
+	for (const SceneManager::OBJECT_MATERIAL& material : materials)
+	{
+		GPU_MATERIAL gpuMaterial;
+		gpuMaterial.ambientColor = glm::vec4(material.ambientColor, material.ambientStrength);
+		gpuMaterial.diffuseColor = glm::vec4(material.diffuseColor, 1.0f);
+		gpuMaterial.specularColor = glm::vec4(material.specularColor, material.shininess);
+		gpuMaterials.push_back(gpuMaterial);
+	}
+
+	GPU_MATERIAL defaultMaterial;
+	defaultMaterial.ambientColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.2f);
+	defaultMaterial.diffuseColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	defaultMaterial.specularColor = glm::vec4(0.3f, 0.3f, 0.3f, 16.0f);
+	m_defaultMaterial = (GLuint)gpuMaterials.size();
+	gpuMaterials.push_back(defaultMaterial);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, gpuMaterials.size() * sizeof(GPU_MATERIAL), gpuMaterials.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method sets the light sources into the draw program.
+ ***********************************************************/
+void GPUDrivenRenderer::SetLights(const std::vector<SceneManager::LIGHT_SOURCE>& lights, glm::vec3 globalAmbient)
+{
+	int lightCount = std::min((int)lights.size(), g_MaxLights);
+
+	for (int i = 0; i < lightCount; i++)
+	{
+		std::string prefix = "lightSources[" + std::to_string(i) + "].";
+		glProgramUniform3fv(m_drawProgram, glGetUniformLocation(m_drawProgram, (prefix + "position").c_str()), 1, glm::value_ptr(lights[i].position));
+		glProgramUniform3fv(m_drawProgram, glGetUniformLocation(m_drawProgram, (prefix + "direction").c_str()), 1, glm::value_ptr(lights[i].direction));
+		glProgramUniform3fv(m_drawProgram, glGetUniformLocation(m_drawProgram, (prefix + "ambientColor").c_str()), 1, glm::value_ptr(lights[i].ambientColor));
+		glProgramUniform3fv(m_drawProgram, glGetUniformLocation(m_drawProgram, (prefix + "diffuseColor").c_str()), 1, glm::value_ptr(lights[i].diffuseColor));
+		glProgramUniform3fv(m_drawProgram, glGetUniformLocation(m_drawProgram, (prefix + "specularColor").c_str()), 1, glm::value_ptr(lights[i].specularColor));
+		glProgramUniform1f(m_drawProgram, glGetUniformLocation(m_drawProgram, (prefix + "focalStrength").c_str()), lights[i].focalStrength);
+		glProgramUniform1f(m_drawProgram, glGetUniformLocation(m_drawProgram, (prefix + "specularIntensity").c_str()), lights[i].specularIntensity);
+	}
+	glProgramUniform1i(m_drawProgram, glGetUniformLocation(m_drawProgram, "lightCount"), lightCount);
+	glProgramUniform3fv(m_drawProgram, glGetUniformLocation(m_drawProgram, "globalAmbient"), 1, glm::value_ptr(globalAmbient));
+}
+
+/***********************************************************
+ *  SetLightmap()
+ *
+ *  This method points the draw program at the lightmap atlas
+ *  and the number of lights baked into it.  The pool only
+ *  streams lightmap coordinates once there is a lightmap,
+ *  so the vertex array takes up the stream here.
+ ***********************************************************/
+void GPUDrivenRenderer::SetLightmap(int textureUnit, int bakedLightCount)
+{
+	glBindVertexArray(m_vertexArray);
+	m_pMeshPool->SetVertexAttributes();
+	glBindVertexArray(0);
+
+	glProgramUniform1i(m_drawProgram, glGetUniformLocation(m_drawProgram, "lightmapTexture"), textureUnit);
+	glProgramUniform1i(m_drawProgram, glGetUniformLocation(m_drawProgram, "bakedLightCount"), bakedLightCount);
+}
+
+/***********************************************************
+ *  SetReflectionProbes()
+ *
+ *  This method points the draw program at the probe cubemaps.
+ ***********************************************************/
+void GPUDrivenRenderer::SetReflectionProbes(int textureUnit, int levelCount)
+{
+	glProgramUniform1i(m_drawProgram, glGetUniformLocation(m_drawProgram, "probeTexture"), textureUnit);
+	glProgramUniform1i(m_drawProgram, glGetUniformLocation(m_drawProgram, "probeLevelCount"), levelCount);
+}
+
+/***********************************************************
+ *  SetObjects()
+ *
+ *  This method groups the objects into one draw command per
+ *  texture and mesh pair, then uploads the object data, the
+ *  command reset template and room for the visible lists.
+ ***********************************************************/
+void GPUDrivenRenderer::SetObjects(const std::vector<OBJECT_INSTANCE>& objects)
+{
+	// commands ordered opaque before transparent, then by texture
+	// slot, so that each texture's commands are contiguous for one
+	// multi-draw in each pass
+	typedef std::tuple<bool, int, int> COMMAND_KEY;
+	std::map<COMMAND_KEY, GLuint> commandCapacity;
+	for (const OBJECT_INSTANCE& object : objects)
+	{
+		commandCapacity[COMMAND_KEY(object.bTransparent, object.textureSlot, object.meshIndex)]++;
+	}
+
+	std::map<COMMAND_KEY, GLuint> commandIndex;
+	std::vector<DRAW_COMMAND> commands;
+	GLuint baseInstance = 0;
+
+	m_drawGroups.clear();
+	for (const auto& entry : commandCapacity)
+	{
+		bool bTransparent = std::get<0>(entry.first);
+		int textureSlot = std::get<1>(entry.first);
+		const MeshPool::MESH_RANGE& mesh = m_pMeshPool->GetMesh(std::get<2>(entry.first));
+		DRAW_COMMAND command;
+		command.count = mesh.indexCount;
+		command.instanceCount = 0;
+		command.firstIndex = mesh.firstIndex;
+		command.baseVertex = mesh.baseVertex;
+		command.baseInstance = baseInstance;
+		baseInstance += entry.second;
+
+		if (m_drawGroups.empty() ||
+			(m_drawGroups.back().bTransparent != bTransparent) ||
+			(m_drawGroups.back().textureSlot != textureSlot))
+		{
+			m_drawGroups.push_back({ bTransparent, textureSlot, (GLuint)commands.size(), 0 });
+		}
+		m_drawGroups.back().commandCount++;
+
+		commandIndex[entry.first] = (GLuint)commands.size();
+		commands.push_back(command);
+	}
+
+	std::vector<GPU_OBJECT> gpuObjects(objects.size());
+	m_objectCommands.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const OBJECT_INSTANCE& object = objects[i];
+		m_objectCommands[i] = commandIndex[COMMAND_KEY(object.bTransparent, object.textureSlot, object.meshIndex)];
+		BuildGPUObject(*m_pMeshPool, object, m_objectCommands[i], m_defaultMaterial, gpuObjects[i]);
+	}
+
+	m_objectCount = (GLuint)gpuObjects.size();
+	m_commandCount = (GLuint)commands.size();
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, gpuObjects.size() * sizeof(GPU_OBJECT), gpuObjects.data(), GL_DYNAMIC_DRAW);
+
+	// the culling pass counts instances up from zero, so each frame
+	// starts by copying these zeroed commands over the live ones
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandResetBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, commands.size() * sizeof(DRAW_COMMAND), commands.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, commands.size() * sizeof(DRAW_COMMAND), NULL, GL_DYNAMIC_COPY);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibleBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(gpuObjects.size(), 1) * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UpdateObjects()
+ *
+ *  This method uploads the data of the listed objects into
+ *  their own slots, leaving the rest of the buffer and the
+ *  draw commands as they are.
+ ***********************************************************/
+void GPUDrivenRenderer::UpdateObjects(const int* indices, const OBJECT_INSTANCE* objects, int count)
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	for (int i = 0; i < count; i++)
+	{
+		int index = indices[i];
+		if ((index < 0) || ((GLuint)index >= m_objectCount))
+		{
+			continue;
+		}
+
+		GPU_OBJECT gpuObject;
+		BuildGPUObject(*m_pMeshPool, objects[i], m_objectCommands[index], m_defaultMaterial, gpuObject);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, index * sizeof(GPU_OBJECT), sizeof(GPU_OBJECT), &gpuObject);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method resets the draw commands, dispatches the
+ *  culling shader, and issues one indirect multi-draw for
+ *  each texture binding.  Opaque objects are drawn first,
+ *  after an optional depth-only pass, then the transparent
+ *  objects are blended over them.
+ ***********************************************************/
+void GPUDrivenRenderer::Render(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	glm::vec3 viewPosition,
+	bool bDepthPrePass,
+	SceneManager::FRAME_STATS& stats,
+	int hiddenObject)
+{
+	if (m_objectCount == 0)
+	{
+		return;
+	}
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	// reset the instance counts of every command
+	glBindBuffer(GL_COPY_READ_BUFFER, m_commandResetBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_commandCount * sizeof(DRAW_COMMAND));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// cull the objects and fill in the commands and visible lists
+	Frustum frustum(projection * view);
+	UniformCounter uniforms(NULL, stats.uniformUploads);
+
+	glUseProgram(m_cullProgram);
+	uniforms.Uniform4fv(glGetUniformLocation(m_cullProgram, "frustumPlanes"), 6, frustum.GetPlanes());
+	uniforms.Uniform1ui(glGetUniformLocation(m_cullProgram, "objectCount"), m_objectCount);
+	uniforms.Uniform1i(glGetUniformLocation(m_cullProgram, "hiddenObject"), hiddenObject);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ObjectBinding, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CommandBinding, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_VisibleBinding, m_visibleBuffer);
+	glDispatchCompute((m_objectCount + g_CullGroupSize - 1) / g_CullGroupSize, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+
+	if (bDepthPrePass)
+	{
+		// depth only, the shading pass then runs the fragment
+		// shader once per visible pixel
+		glUseProgram(m_depthProgram);
+		uniforms.UniformMatrix4fv(glGetUniformLocation(m_depthProgram, "view"), view);
+		uniforms.UniformMatrix4fv(glGetUniformLocation(m_depthProgram, "projection"), projection);
+		uniforms.Uniform1i(glGetUniformLocation(m_depthProgram, "bCompactVertices"), m_pMeshPool->HasCompactVertices());
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		DrawGroups(false, -1, stats);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_FALSE);
+		glDepthFunc(GL_LEQUAL);
+	}
+
+	// draw the visible objects
+	glUseProgram(m_drawProgram);
+	uniforms.UniformMatrix4fv(glGetUniformLocation(m_drawProgram, "view"), view);
+	uniforms.UniformMatrix4fv(glGetUniformLocation(m_drawProgram, "projection"), projection);
+	uniforms.Uniform3fv(glGetUniformLocation(m_drawProgram, "viewPosition"), viewPosition);
+	uniforms.Uniform1i(glGetUniformLocation(m_drawProgram, "bCompactVertices"), m_pMeshPool->HasCompactVertices());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_MaterialBinding, m_materialBuffer);
+
+	GLint textureLocation = glGetUniformLocation(m_drawProgram, "objectTexture");
+	DrawGroups(false, textureLocation, stats);
+
+	if (bDepthPrePass)
+	{
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+	}
+
+	// the culling shader appends in no particular order, so the
+	// transparent objects are blended unsorted on this path
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+	DrawGroups(true, textureLocation, stats);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+
+	glUseProgram(previousProgram);
+}
+
+/***********************************************************
+ *  DrawGroups()
+ *
+ *  This method issues one indirect multi-draw for each
+ *  opaque or transparent group.  The texture uniform is
+ *  skipped when the location is -1.
+ ***********************************************************/
+void GPUDrivenRenderer::DrawGroups(bool bTransparent, GLint textureLocation, SceneManager::FRAME_STATS& stats)
+{
+	UniformCounter uniforms(NULL, stats.uniformUploads);
+	for (const DRAW_GROUP& group : m_drawGroups)
+	{
+		if (group.bTransparent != bTransparent)
+		{
+			continue;
+		}
+
+		// texture slots match the texture units bound by the scene
+		if (textureLocation != -1)
+		{
+			uniforms.Uniform1i(textureLocation, std::max(group.textureSlot, 0));
+			stats.textureBinds++;
+		}
+		glMultiDrawElementsIndirect(
+			GL_TRIANGLES,
+			GL_UNSIGNED_INT,
+			(const void*)(group.firstCommand * sizeof(DRAW_COMMAND)),
+			group.commandCount,
+			0);
+		stats.drawCalls++;
+	}
+}
@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpudrivenrenderer.h
+// ============
+// cull the scene objects and build the draw commands on the GPU
+//
+//  All per-object data lives in shader storage buffers.  A compute
+//  shader tests every object against the view frustum and writes the
+//  indirect draw commands and visible instance lists, so the CPU only
+//  issues one dispatch plus one multi-draw per texture binding.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshPool.h"
+#include "SceneManager.h"
+
+#include <vector>
+
+/***********************************************************
+ *  GPUDrivenRenderer
+ *
+ *  This class owns the shader programs and buffers for the
+ *  GPU-driven render path.  It needs OpenGL 4.3 for compute
+ *  shaders and shader storage buffers, which Mesa's software
+ *  rasterizer provides.
+ ***********************************************************/
+class GPUDrivenRenderer
+{
+public:
+	// constructor
+	GPUDrivenRenderer(MeshPool* pMeshPool);
+	// destructor
+	~GPUDrivenRenderer();
+
+	// the number of light sources the draw shader supports
+	static const int MAX_LIGHTS = 4;
+
+	// one object to be drawn by the GPU-driven path
+	struct OBJECT_INSTANCE
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		int meshIndex;
+		// index into the material list, or -1 for the default material
+		int materialIndex;
+		// texture slot to sample, or -1 for an untextured object
+		int textureSlot;
+		// drawn with blending after all opaque objects
+		bool bTransparent;
+		// scale in xy and offset in zw from the mesh's lightmap
+		// coordinates into the atlas, or zero to light the object
+		// dynamically
+		glm::vec4 lightmapRect;
+		// reflection probe the object samples, or -1
+		int probeIndex;
+	};
+
+	// compile the shaders and create the buffers, returns false
+	// when the OpenGL context cannot run this path
+	bool Initialize();
+
+	// upload the materials, lights and objects to the GPU
+	void SetMaterials(const std::vector<SceneManager::OBJECT_MATERIAL>& materials);
+	void SetLights(const std::vector<SceneManager::LIGHT_SOURCE>& lights, glm::vec3 globalAmbient);
+	void SetObjects(const std::vector<OBJECT_INSTANCE>& objects);
+	// upload the objects at the listed indices again, one
+	// instance for each; they must keep the mesh, texture and
+	// transparency they were set with
+	void UpdateObjects(const int* indices, const OBJECT_INSTANCE* objects, int count);
+	// sample the baked light of the static objects from this
+	// texture unit, which holds the first bakedLightCount lights
+	// and the global ambient, or -1 to light everything dynamically
+	void SetLightmap(int textureUnit, int bakedLightCount);
+	// sample the reflection probes from this texture unit, which
+	// holds a cubemap array with levelCount roughness levels, or
+	// 0 levels to turn reflections off; the unit must be set even
+	// then, as no other sampler type may share it
+	void SetReflectionProbes(int textureUnit, int levelCount);
+
+	// cull and draw the uploaded objects, optionally laying down
+	// the opaque depth before shading, and count the calls made;
+	// the hidden object, such as the one a reflection probe sits
+	// in, is left out
+	void Render(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		glm::vec3 viewPosition,
+		bool bDepthPrePass,
+		SceneManager::FRAME_STATS& stats,
+		int hiddenObject = -1);
+
+private:
+	// a run of draw commands that share one texture binding
+	struct DRAW_GROUP
+	{
+		bool bTransparent;
+		int textureSlot;
+		GLuint firstCommand;
+		GLsizei commandCount;
+	};
+
+	// pointer to the pooled meshes
+	MeshPool* m_pMeshPool;
+
+	// shader programs
+	GLuint m_cullProgram;
+	GLuint m_drawProgram;
+	GLuint m_depthProgram;
+
+	// vertex array over the mesh pool and the visible instance list
+	GLuint m_vertexArray;
+
+	// shader storage and indirect buffers
+	GLuint m_objectBuffer;
+	GLuint m_materialBuffer;
+	GLuint m_commandBuffer;
+	GLuint m_commandResetBuffer;
+	GLuint m_visibleBuffer;
+
+	// index of the material used by objects without one
+	GLuint m_defaultMaterial;
+	GLuint m_objectCount;
+	GLuint m_commandCount;
+	// draw command of each object, for the objects updated later
+	std::vector<GLuint> m_objectCommands;
+	std::vector<DRAW_GROUP> m_drawGroups;
+
+	// issue the multi-draws of the opaque or transparent groups
+	void DrawGroups(bool bTransparent, GLint textureLocation, SceneManager::FRAME_STATS& stats);
+};
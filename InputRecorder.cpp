@@ -0,0 +1,304 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.cpp
+// ============
+// record the camera input of a session and play it back frame for frame
+//
+//  Each frame is stored as its time delta and step count, followed by
+//  one flag byte per step that says which of the step's inputs are
+//  present.  Idle steps cost a single byte, and the held keys are only
+//  written when they change.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputRecorder.h"
+
+#include <cstring>
+#include <iostream>
+
+static_assert(sizeof(float) == 4, "input records store 32-bit floats");
+
+// declaration of global variables
+namespace
+{
+	const char g_InputMagic[8] = { 'C', 'S', '3', '3', '0', 'I', 'N', 'P' };
+
+	// pending recording bytes written out at a time
+	const size_t g_FlushSize = 64 * 1024;
+
+	// flag bits of a step record
+	enum TICK_FLAG
+	{
+		TICK_MOUSE = 1 << 0,
+		TICK_SCROLL = 1 << 1,
+		TICK_KEYS = 1 << 2,
+		TICK_RESET = 1 << 3,
+		TICK_PROJECTION = 1 << 4
+	};
+
+	/***********************************************************
+	 *  Append()
+	 *
+	 *  Append the bytes of a value to a buffer.
+	 ***********************************************************/
+	template <typename T>
+	void Append(std::vector<uint8_t>& buffer, const T& value)
+	{
+		const uint8_t* pBytes = (const uint8_t*)&value;
+		buffer.insert(buffer.end(), pBytes, pBytes + sizeof(T));
+	}
+}
+
+/***********************************************************
+ *  InputRecorder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputRecorder::InputRecorder()
+{
+	m_pFile = NULL;
+	m_bRecording = false;
+	m_bReplaying = false;
+	m_frameCount = 0;
+	m_readOffset = 0;
+	m_heldKeys = 0;
+}
+
+/***********************************************************
+ *  ~InputRecorder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InputRecorder::~InputRecorder()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  StartRecording()
+ *
+ *  This method opens the output file and writes its header.
+ ***********************************************************/
+bool InputRecorder::StartRecording(const std::string& path, float tickStep)
+{
+	if (m_bRecording || m_bReplaying)
+	{
+		return(false);
+	}
+
+	m_pFile = fopen(path.c_str(), "wb");
+	if (m_pFile == NULL)
+	{
+		std::cout << "ERROR: could not open input recording: " << path << std::endl;
+		return(false);
+	}
+
+	INPUT_HEADER header;
+	memcpy(header.magic, g_InputMagic, sizeof(g_InputMagic));
+	header.version = FORMAT_VERSION;
+	header.tickStep = tickStep;
+
+	m_path = path;
+	m_buffer.clear();
+	Append(m_buffer, header);
+	m_frameCount = 0;
+	m_heldKeys = 0;
+	m_bRecording = true;
+	std::cout << "INFO: Recording input to " << path << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  StartReplay()
+ *
+ *  This method reads a whole recording into memory and
+ *  checks that it was made with this build's step length.
+ ***********************************************************/
+bool InputRecorder::StartReplay(const std::string& path, float tickStep)
+{
+	if (m_bRecording || m_bReplaying)
+	{
+		return(false);
+	}
+
+	FILE* pFile = fopen(path.c_str(), "rb");
+	if (pFile == NULL)
+	{
+		std::cout << "ERROR: could not open input recording: " << path << std::endl;
+		return(false);
+	}
+	fseek(pFile, 0, SEEK_END);
+	long size = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	m_buffer.resize((size > 0) ? (size_t)size : 0);
+	size_t bytesRead = fread(m_buffer.data(), 1, m_buffer.size(), pFile);
+	fclose(pFile);
+
+	INPUT_HEADER header;
+	m_readOffset = 0;
+	if ((bytesRead != m_buffer.size()) ||
+		!Read(&header, sizeof(header)) ||
+		(memcmp(header.magic, g_InputMagic, sizeof(g_InputMagic)) != 0))
+	{
+		std::cout << "ERROR: " << path << " is not an input recording" << std::endl;
+		m_buffer.clear();
+		return(false);
+	}
+	if ((header.version != FORMAT_VERSION) || (header.tickStep != tickStep))
+	{
+		std::cout << "ERROR: " << path << " was recorded with version " << header.version
+			<< " and a step of " << header.tickStep << "s, this build replays version "
+			<< FORMAT_VERSION << " with a step of " << tickStep << "s" << std::endl;
+		m_buffer.clear();
+		return(false);
+	}
+
+	m_path = path;
+	m_frameCount = 0;
+	m_heldKeys = 0;
+	m_bReplaying = true;
+	std::cout << "INFO: Replaying input from " << path << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method finishes a recording or drops a replay.
+ ***********************************************************/
+void InputRecorder::Stop()
+{
+	if (m_bRecording)
+	{
+		Flush();
+		fclose(m_pFile);
+		m_pFile = NULL;
+		std::cout << "INFO: Recorded " << m_frameCount << " frames of input to " << m_path << std::endl;
+	}
+	m_bRecording = false;
+	m_bReplaying = false;
+	m_buffer.clear();
+	m_readOffset = 0;
+}
+
+/***********************************************************
+ *  RecordFrame()
+ *
+ *  This method appends a frame and its steps, writing the
+ *  buffer out once it is large enough.
+ ***********************************************************/
+void InputRecorder::RecordFrame(float frameDelta, const std::vector<TICK_INPUT>& ticks)
+{
+	if (!m_bRecording)
+	{
+		return;
+	}
+
+	Append(m_buffer, frameDelta);
+	Append(m_buffer, (uint16_t)ticks.size());
+	for (const TICK_INPUT& tick : ticks)
+	{
+		uint8_t flags = 0;
+		if ((tick.mouseDeltaX != 0.0f) || (tick.mouseDeltaY != 0.0f))
+			flags |= TICK_MOUSE;
+		if (tick.scrollDelta != 0.0f)
+			flags |= TICK_SCROLL;
+		if (tick.heldKeys != m_heldKeys)
+			flags |= TICK_KEYS;
+		if (tick.bResetCamera)
+			flags |= TICK_RESET;
+		if (tick.bToggleProjection)
+			flags |= TICK_PROJECTION;
+
+		Append(m_buffer, flags);
+		if (flags & TICK_MOUSE)
+		{
+			Append(m_buffer, tick.mouseDeltaX);
+			Append(m_buffer, tick.mouseDeltaY);
+		}
+		if (flags & TICK_SCROLL)
+			Append(m_buffer, tick.scrollDelta);
+		if (flags & TICK_KEYS)
+			Append(m_buffer, (uint8_t)tick.heldKeys);
+		m_heldKeys = tick.heldKeys;
+	}
+	m_frameCount++;
+
+	if (m_buffer.size() >= g_FlushSize)
+	{
+		Flush();
+	}
+}
+
+/***********************************************************
+ *  ReadFrame()
+ *
+ *  This method decodes the next frame of a replay.  A file
+ *  cut short ends the replay at its last whole frame.
+ ***********************************************************/
+bool InputRecorder::ReadFrame(float& frameDelta, std::vector<TICK_INPUT>& ticks)
+{
+	ticks.clear();
+	uint16_t tickCount = 0;
+	if (!m_bReplaying ||
+		!Read(&frameDelta, sizeof(frameDelta)) ||
+		!Read(&tickCount, sizeof(tickCount)))
+	{
+		return(false);
+	}
+
+	for (int i = 0; i < tickCount; i++)
+	{
+		TICK_INPUT tick = TICK_INPUT();
+		uint8_t flags = 0;
+		uint8_t heldKeys = (uint8_t)m_heldKeys;
+		bool bRead = Read(&flags, sizeof(flags));
+		if (bRead && (flags & TICK_MOUSE))
+			bRead = Read(&tick.mouseDeltaX, sizeof(float)) && Read(&tick.mouseDeltaY, sizeof(float));
+		if (bRead && (flags & TICK_SCROLL))
+			bRead = Read(&tick.scrollDelta, sizeof(float));
+		if (bRead && (flags & TICK_KEYS))
+			bRead = Read(&heldKeys, sizeof(heldKeys));
+		if (!bRead)
+		{
+			ticks.clear();
+			return(false);
+		}
+		tick.heldKeys = heldKeys;
+		tick.bResetCamera = (flags & TICK_RESET) != 0;
+		tick.bToggleProjection = (flags & TICK_PROJECTION) != 0;
+		m_heldKeys = heldKeys;
+		ticks.push_back(tick);
+	}
+	m_frameCount++;
+	return(true);
+}
+
+/***********************************************************
+ *  Flush()
+ *
+ *  This method writes the pending recording bytes.
+ ***********************************************************/
+void InputRecorder::Flush()
+{
+	if ((m_pFile != NULL) && !m_buffer.empty())
+	{
+		fwrite(m_buffer.data(), 1, m_buffer.size(), m_pFile);
+		m_buffer.clear();
+	}
+}
+
+/***********************************************************
+ *  Read()
+ *
+ *  This method copies the next bytes of a replay, false
+ *  when the file ends first.
+ ***********************************************************/
+bool InputRecorder::Read(void* pData, size_t size)
+{
+	if (m_readOffset + size > m_buffer.size())
+	{
+		return(false);
+	}
+	memcpy(pData, m_buffer.data() + m_readOffset, size);
+	m_readOffset += size;
+	return(true);
+}
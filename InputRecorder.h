@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.h
+// ============
+// record the camera input of a session and play it back frame for frame
+//
+//  The recording holds, for every pass of the render loop, the time
+//  since the previous pass and the input of each fixed simulation step
+//  run during it.  Replaying the file runs the same steps with the same
+//  input before the same frames, so a camera path can be profiled again
+//  on any machine regardless of how fast it draws.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  InputRecorder
+ *
+ *  This class reads and writes the compact binary input
+ *  file.  A recording is buffered in memory and written out
+ *  in large blocks; a replay reads the whole file up front,
+ *  so neither touches the disk during a frame.
+ ***********************************************************/
+class InputRecorder
+{
+public:
+	// constructor
+	InputRecorder();
+	// destructor
+	~InputRecorder();
+
+	// bumped whenever the layout of a record changes
+	static const uint32_t FORMAT_VERSION = 1;
+
+	// the input one simulation step applies to the camera
+	struct TICK_INPUT
+	{
+		float mouseDeltaX;
+		float mouseDeltaY;
+		float scrollDelta;
+		// one bit per movement key that is held down
+		uint32_t heldKeys;
+		bool bResetCamera;
+		bool bToggleProjection;
+	};
+
+	// start writing a recording of steps of the given length
+	bool StartRecording(const std::string& path, float tickStep);
+	// load a recording, which must use the same step length
+	bool StartReplay(const std::string& path, float tickStep);
+	// write out what is left of a recording and close it
+	void Stop();
+
+	bool IsRecording() const { return m_bRecording; }
+	bool IsReplaying() const { return m_bReplaying; }
+	// frames written or read so far
+	int GetFrameCount() const { return m_frameCount; }
+
+	// append a frame with its time since the previous frame and
+	// the steps run during it
+	void RecordFrame(float frameDelta, const std::vector<TICK_INPUT>& ticks);
+	// read the next frame, false once the recording has ended
+	bool ReadFrame(float& frameDelta, std::vector<TICK_INPUT>& ticks);
+
+private:
+	struct INPUT_HEADER
+	{
+		char magic[8];
+		uint32_t version;
+		float tickStep;
+	};
+
+	std::string m_path;
+	FILE* m_pFile;
+	bool m_bRecording;
+	bool m_bReplaying;
+	int m_frameCount;
+	// pending bytes of a recording, or the whole replayed file
+	std::vector<uint8_t> m_buffer;
+	size_t m_readOffset;
+	// held keys of the last step, which are only stored when
+	// they change
+	uint32_t m_heldKeys;
+
+	void Flush();
+	bool Read(void* pData, size_t size);
+};
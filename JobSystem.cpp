@@ -0,0 +1,515 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// schedule the per-frame work across every core
+//
+//  Each thread owns a queue of jobs.  It works through its own jobs
+//  newest first and, when it runs dry, steals the oldest job from
+//  another thread.  Jobs can depend on other jobs and can spawn
+//  children, and every job is timed so the frame can be inspected.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// index of the calling thread's queue, -1 outside the system
+	thread_local int t_workerIndex = -1;
+	// the job whose function is running on this thread
+	thread_local JobSystem::JOB* t_pCurrentJob = NULL;
+
+	// times an idle worker looks for work before it sleeps
+	const int g_IdleSpinCount = 64;
+
+	// starting size of the frame arena; it grows to fit the
+	// busiest frame seen
+	const size_t g_FrameArenaSize = 64 * 1024;
+	// starting size of each thread's queue, which grows the same
+	// way between frames
+	const size_t g_QueueCapacity = 256;
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem(int workerThreadCount)
+	: m_frameArena(g_FrameArenaSize)
+{
+	m_queuedJobs = 0;
+	m_bRunning = true;
+	m_frameStart = std::chrono::steady_clock::now();
+	m_frameTime = 0.0;
+
+	workerThreadCount = std::max(workerThreadCount, 0);
+	for (int i = 0; i <= workerThreadCount; i++)
+	{
+		JOB_QUEUE* pQueue = new JOB_QUEUE();
+		pQueue->jobs.resize(g_QueueCapacity);
+		pQueue->head = 0;
+		pQueue->count = 0;
+		pQueue->peak = 0;
+		pQueue->overflowed = 0;
+		m_queues.push_back(pQueue);
+	}
+
+	// the frame's heap use is counted on the threads running it
+	t_workerIndex = 0;
+	AllocationCounter::TrackThread();
+	for (int i = 1; i <= workerThreadCount; i++)
+	{
+		m_threads.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bRunning = false;
+	}
+	m_wakeSignal.notify_all();
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+
+	for (JOB_QUEUE* pQueue : m_queues)
+	{
+		delete pQueue;
+	}
+	m_queues.clear();
+	t_workerIndex = -1;
+}
+
+/***********************************************************
+ *  Now()
+ *
+ *  This method returns the milliseconds since BeginFrame().
+ ***********************************************************/
+double JobSystem::Now() const
+{
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - m_frameStart).count());
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method starts the clock for the frame's jobs.  When
+ *  a queue ran out of room in the last frame, every queue
+ *  grows to hold the most jobs any of them was asked to,
+ *  since whichever thread splits the work next frame takes
+ *  the same load, and a steady frame then never allocates.
+ ***********************************************************/
+void JobSystem::BeginFrame()
+{
+	m_frameStart = std::chrono::steady_clock::now();
+
+	size_t peak = 0;
+	for (JOB_QUEUE* pQueue : m_queues)
+	{
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		peak = std::max(peak, pQueue->peak);
+		pQueue->peak = 0;
+		pQueue->overflowed = 0;
+	}
+
+	for (JOB_QUEUE* pQueue : m_queues)
+	{
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		if ((peak > pQueue->jobs.size()) && (pQueue->count == 0))
+		{
+			size_t capacity = pQueue->jobs.size();
+			while (capacity < peak)
+			{
+				capacity *= 2;
+			}
+			pQueue->jobs.assign(capacity, NULL);
+			pQueue->head = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method makes sure every job of the frame is done,
+ *  keeps their timings and frees them along with the rest
+ *  of the frame arena.
+ ***********************************************************/
+void JobSystem::EndFrame()
+{
+	// a job still running may add more jobs, which can move the
+	// list, so it is read by index under the lock on every step
+	for (size_t i = 0; ; i++)
+	{
+		JOB* job = NULL;
+		{
+			std::lock_guard<std::mutex> lock(m_jobMutex);
+			if (i == m_jobs.size())
+			{
+				break;
+			}
+			job = m_jobs[i];
+		}
+		Wait(job);
+	}
+
+	m_frameTimings.clear();
+	for (const JOB* job : m_jobs)
+	{
+		JOB_TIMING timing;
+		timing.name = job->name;
+		timing.worker = job->worker;
+		timing.startTime = job->startTime;
+		timing.endTime = job->endTime;
+		m_frameTimings.push_back(timing);
+	}
+	m_frameTime = Now();
+
+	for (JOB* job : m_jobs)
+	{
+		job->pDestroy(job->pFunction);
+		job->~JOB();
+	}
+	m_jobs.clear();
+	m_frameArena.Reset();
+}
+
+/***********************************************************
+ *  AllocateJob()
+ *
+ *  This method takes a job from the frame arena and counts
+ *  it as a child of its parent.
+ ***********************************************************/
+JobSystem::JOB* JobSystem::AllocateJob(const char* name, JOB* parent)
+{
+	JOB* job = m_frameArena.Create<JOB>();
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_jobs.push_back(job);
+	}
+
+	job->name = name;
+	job->pFunction = NULL;
+	job->pCall = NULL;
+	job->pDestroy = NULL;
+	job->parent = parent;
+	job->unfinished = 1;
+	job->bFinished = false;
+	job->blockers = 1;
+	job->pContinuations = NULL;
+	job->worker = -1;
+	job->startTime = 0.0;
+	job->endTime = 0.0;
+
+	if (NULL != parent)
+	{
+		parent->unfinished++;
+	}
+
+	return(job);
+}
+
+/***********************************************************
+ *  AddDependency()
+ *
+ *  This method holds job back until prerequisite is done.
+ ***********************************************************/
+void JobSystem::AddDependency(JOB* job, JOB* prerequisite)
+{
+	CONTINUATION* pContinuation = m_frameArena.Create<CONTINUATION>();
+	pContinuation->job = job;
+	pContinuation->next = prerequisite->pContinuations;
+
+	job->blockers++;
+	prerequisite->pContinuations = pContinuation;
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method releases the job; it is queued right away
+ *  unless it still waits on a prerequisite.
+ ***********************************************************/
+void JobSystem::Submit(JOB* job)
+{
+	if (job->blockers.fetch_sub(1) == 1)
+	{
+		Enqueue(job);
+	}
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method runs queued jobs on the calling thread until
+ *  the passed in job and all of its children are done.
+ ***********************************************************/
+void JobSystem::Wait(JOB* job)
+{
+	while (!job->bFinished)
+	{
+		JOB* next = FindJob();
+		if (NULL != next)
+			Execute(next);
+		else
+			std::this_thread::yield();
+	}
+}
+
+/***********************************************************
+ *  GetCurrentJob()
+ *
+ *  This method returns the job running on this thread.
+ ***********************************************************/
+JobSystem::JOB* JobSystem::GetCurrentJob() const
+{
+	return(t_pCurrentJob);
+}
+
+/***********************************************************
+ *  Enqueue()
+ *
+ *  This method pushes a ready job onto the calling thread's
+ *  queue and wakes a sleeping worker to steal it.  A job
+ *  that finds the queue full runs right away instead, and
+ *  the queue grows at the next BeginFrame().
+ ***********************************************************/
+void JobSystem::Enqueue(JOB* job)
+{
+	JOB_QUEUE* pQueue = m_queues[std::max(t_workerIndex, 0)];
+	bool bQueued = false;
+	{
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		const size_t capacity = pQueue->jobs.size();
+		if (pQueue->count < capacity)
+		{
+			pQueue->jobs[(pQueue->head + pQueue->count) & (capacity - 1)] = job;
+			pQueue->count++;
+			bQueued = true;
+		}
+		else
+		{
+			pQueue->overflowed++;
+		}
+		pQueue->peak = std::max(pQueue->peak, pQueue->count + pQueue->overflowed);
+	}
+	if (!bQueued)
+	{
+		Execute(job);
+		return;
+	}
+	m_queuedJobs++;
+
+	// taking the lock orders this wake-up after the check of a
+	// worker that is about to sleep
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_wakeSignal.notify_one();
+}
+
+/***********************************************************
+ *  FindJob()
+ *
+ *  This method pops the newest job from the calling thread's
+ *  own queue, which is likely still warm in its cache, or
+ *  steals the oldest job from another thread.
+ ***********************************************************/
+JobSystem::JOB* JobSystem::FindJob()
+{
+	const int queueCount = (int)m_queues.size();
+	const int own = std::max(t_workerIndex, 0);
+
+	for (int i = 0; i < queueCount; i++)
+	{
+		JOB_QUEUE* pQueue = m_queues[(own + i) % queueCount];
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		if (pQueue->count == 0)
+		{
+			continue;
+		}
+
+		const size_t mask = pQueue->jobs.size() - 1;
+		JOB* job = NULL;
+		if (i == 0)
+		{
+			job = pQueue->jobs[(pQueue->head + pQueue->count - 1) & mask];
+		}
+		else
+		{
+			job = pQueue->jobs[pQueue->head];
+			pQueue->head = (pQueue->head + 1) & mask;
+		}
+		pQueue->count--;
+		m_queuedJobs--;
+		return(job);
+	}
+
+	return(NULL);
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method runs and times one job.
+ ***********************************************************/
+void JobSystem::Execute(JOB* job)
+{
+	JOB* previous = t_pCurrentJob;
+	t_pCurrentJob = job;
+
+	job->worker = std::max(t_workerIndex, 0);
+	job->startTime = Now();
+	job->pCall(job->pFunction);
+	job->endTime = Now();
+
+	t_pCurrentJob = previous;
+	Finish(job);
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method retires one unit of a job.  When the job and
+ *  its children are all done, the jobs waiting on it are
+ *  released and its parent is told.
+ ***********************************************************/
+void JobSystem::Finish(JOB* job)
+{
+	if (job->unfinished.fetch_sub(1) > 1)
+	{
+		return;
+	}
+
+	for (CONTINUATION* pContinuation = job->pContinuations; NULL != pContinuation; pContinuation = pContinuation->next)
+	{
+		Submit(pContinuation->job);
+	}
+
+	// the job may be freed as soon as it reads as finished, so
+	// that has to be the last thing done with it
+	JOB* parent = job->parent;
+	job->bFinished = true;
+	if (NULL != parent)
+	{
+		Finish(parent);
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  Each worker runs jobs while there are any, and sleeps
+ *  once it has found nothing for a while.
+ ***********************************************************/
+void JobSystem::WorkerLoop(int workerIndex)
+{
+	t_workerIndex = workerIndex;
+	AllocationCounter::TrackThread();
+
+	int idleCount = 0;
+	while (m_bRunning)
+	{
+		JOB* job = FindJob();
+		if (NULL != job)
+		{
+			Execute(job);
+			idleCount = 0;
+			continue;
+		}
+
+		if (++idleCount < g_IdleSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wakeSignal.wait(lock, [this] { return !m_bRunning || (m_queuedJobs > 0); });
+		idleCount = 0;
+	}
+}
+
+/***********************************************************
+ *  PrintFrameTimings()
+ *
+ *  This method prints the jobs of the last frame grouped by
+ *  name, with the time spent in them, the time from the
+ *  first start to the last finish, and the threads used.
+ ***********************************************************/
+void JobSystem::PrintFrameTimings() const
+{
+	struct JOB_GROUP
+	{
+		const char* name;
+		int count;
+		double busyTime;
+		double firstStart;
+		double lastEnd;
+		std::vector<bool> workers;
+	};
+
+	std::vector<JOB_GROUP> groups;
+	for (const JOB_TIMING& timing : m_frameTimings)
+	{
+		JOB_GROUP* pGroup = NULL;
+		for (JOB_GROUP& group : groups)
+		{
+			if (strcmp(group.name, timing.name) == 0)
+			{
+				pGroup = &group;
+				break;
+			}
+		}
+		if (NULL == pGroup)
+		{
+			JOB_GROUP group;
+			group.name = timing.name;
+			group.count = 0;
+			group.busyTime = 0.0;
+			group.firstStart = timing.startTime;
+			group.lastEnd = timing.endTime;
+			group.workers.resize(m_queues.size(), false);
+			groups.push_back(group);
+			pGroup = &groups.back();
+		}
+
+		pGroup->count++;
+		pGroup->busyTime += timing.endTime - timing.startTime;
+		pGroup->firstStart = std::min(pGroup->firstStart, timing.startTime);
+		pGroup->lastEnd = std::max(pGroup->lastEnd, timing.endTime);
+		pGroup->workers[timing.worker] = true;
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "INFO: Frame jobs, " << m_frameTime << " ms on "
+		<< m_queues.size() << " threads" << std::endl;
+	for (const JOB_GROUP& group : groups)
+	{
+		std::cout << "  " << std::left << std::setw(18) << group.name << std::right
+			<< std::setw(5) << group.count << " jobs"
+			<< "  start " << std::setw(7) << group.firstStart << " ms"
+			<< "  span " << std::setw(7) << (group.lastEnd - group.firstStart) << " ms"
+			<< "  busy " << std::setw(7) << group.busyTime << " ms"
+			<< "  on " << std::count(group.workers.begin(), group.workers.end(), true) << " threads"
+			<< std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+}
@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// schedule the per-frame work across every core
+//
+//  Each thread owns a queue of jobs.  It works through its own jobs
+//  newest first and, when it runs dry, steals the oldest job from
+//  another thread.  Jobs can depend on other jobs and can spawn
+//  children, and every job is timed so the frame can be inspected.
+//  Jobs and their functions live in a frame arena, so a frame's jobs
+//  cost no heap allocations once the arena has grown to fit them.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs jobs on a set of worker threads plus the
+ *  thread that created it, which joins in whenever it waits
+ *  on a job.  Jobs live for one frame, between BeginFrame()
+ *  and EndFrame().
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor, the calling thread becomes worker zero
+	JobSystem(int workerThreadCount);
+	// destructor
+	~JobSystem();
+
+	struct JOB;
+
+	// one job waiting on another, in a list per prerequisite
+	struct CONTINUATION
+	{
+		JOB* job;
+		CONTINUATION* next;
+	};
+
+	struct JOB
+	{
+		const char* name;
+		// the job's function object, copied into the frame arena,
+		// and how to call and destroy it
+		void* pFunction;
+		void (*pCall)(void* pFunction);
+		void (*pDestroy)(void* pFunction);
+		// finishes only once all of its children have finished
+		JOB* parent;
+		// this job plus its unfinished children
+		std::atomic<int> unfinished;
+		// set once the job is completely done with, after which
+		// it may be freed
+		std::atomic<bool> bFinished;
+		// unfinished prerequisites, plus one until submitted
+		std::atomic<int> blockers;
+		// jobs waiting on this one to finish
+		CONTINUATION* pContinuations;
+		// timing of the job's own function
+		int worker;
+		double startTime;
+		double endTime;
+	};
+
+	struct JOB_TIMING
+	{
+		const char* name;
+		int worker;
+		// milliseconds from the start of the frame
+		double startTime;
+		double endTime;
+	};
+
+	// start and finish a frame of jobs; every job must have
+	// finished by EndFrame(), which keeps the frame's timings
+	void BeginFrame();
+	void EndFrame();
+
+	// create a job running function(), as a child of parent when
+	// one is given
+	template<typename FUNCTION>
+	JOB* CreateJob(const char* name, FUNCTION&& function, JOB* parent = NULL);
+	// make job wait for prerequisite, call before submitting either
+	void AddDependency(JOB* job, JOB* prerequisite);
+	// queue a job to run once its prerequisites are done
+	void Submit(JOB* job);
+	// run jobs on this thread until the passed in job has finished
+	void Wait(JOB* job);
+
+	// create a job that runs function(begin, end) over [0, count)
+	// in ranges of at most grainSize, spread over the threads
+	template<typename FUNCTION>
+	JOB* ParallelFor(
+		const char* name,
+		int count,
+		int grainSize,
+		FUNCTION&& function,
+		JOB* parent = NULL);
+
+	// the job running on the calling thread, if any
+	JOB* GetCurrentJob() const;
+
+	int GetThreadCount() const { return (int)m_queues.size(); }
+	// job timings of the last finished frame
+	const std::vector<JOB_TIMING>& GetFrameTimings() const { return m_frameTimings; }
+	double GetFrameTime() const { return m_frameTime; }
+	// print the last frame's jobs grouped by name
+	void PrintFrameTimings() const;
+
+	// memory for data that lives until EndFrame(), such as the
+	// frame's job lists; safe to use from any job
+	FrameArena& GetFrameArena() { return m_frameArena; }
+
+private:
+	// one queue per thread, index zero for the owning thread;
+	// the owner pops the newest job and thieves take the oldest
+	struct JOB_QUEUE
+	{
+		std::mutex mutex;
+		// ring of jobs from the oldest at head, sized to a power
+		// of two and only resized by BeginFrame()
+		std::vector<JOB*> jobs;
+		size_t head;
+		size_t count;
+		// most jobs the queue was asked to hold this frame,
+		// counting those it had no room for
+		size_t peak;
+		size_t overflowed;
+	};
+
+	std::vector<std::thread> m_threads;
+	std::vector<JOB_QUEUE*> m_queues;
+
+	// jobs of the current frame, in the frame arena, which is
+	// reset once they are all done
+	FrameArena m_frameArena;
+	std::mutex m_jobMutex;
+	std::vector<JOB*> m_jobs;
+
+	// idle workers sleep until a job is queued
+	std::atomic<int> m_queuedJobs;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeSignal;
+	std::atomic<bool> m_bRunning;
+
+	// timing
+	std::chrono::steady_clock::time_point m_frameStart;
+	std::vector<JOB_TIMING> m_frameTimings;
+	double m_frameTime;
+
+	// take a new job from the arena, its function still unset
+	JOB* AllocateJob(const char* name, JOB* parent);
+	void WorkerLoop(int workerIndex);
+	// push a job whose prerequisites are done
+	void Enqueue(JOB* job);
+	// take a job from this thread's queue or steal one
+	JOB* FindJob();
+	void Execute(JOB* job);
+	void Finish(JOB* job);
+	double Now() const;
+};
+
+/***********************************************************
+ *  CreateJob()
+ *
+ *  This method creates a job that runs once submitted and
+ *  once all of its prerequisites have finished.  A child
+ *  must be created before its parent finishes, normally
+ *  from inside the parent's own function.  The function
+ *  object is copied into the frame arena, next to the job.
+ ***********************************************************/
+template<typename FUNCTION>
+JobSystem::JOB* JobSystem::CreateJob(const char* name, FUNCTION&& function, JOB* parent)
+{
+	typedef typename std::decay<FUNCTION>::type CALLABLE;
+
+	JOB* job = AllocateJob(name, parent);
+	job->pFunction = m_frameArena.Create<CALLABLE>(std::forward<FUNCTION>(function));
+	job->pCall = [](void* pFunction) { (*static_cast<CALLABLE*>(pFunction))(); };
+	job->pDestroy = [](void* pFunction) { static_cast<CALLABLE*>(pFunction)->~CALLABLE(); };
+	return(job);
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method creates a job that, once it runs, splits the
+ *  range into child jobs of grainSize iterations each.  The
+ *  returned job finishes when the whole range is done.
+ ***********************************************************/
+template<typename FUNCTION>
+JobSystem::JOB* JobSystem::ParallelFor(
+	const char* name,
+	int count,
+	int grainSize,
+	FUNCTION&& function,
+	JOB* parent)
+{
+	typedef typename std::decay<FUNCTION>::type RANGE_FUNCTION;
+
+	grainSize = std::max(grainSize, 1);
+	return(CreateJob(name, [this, name, count, grainSize,
+		rangeFunction = RANGE_FUNCTION(std::forward<FUNCTION>(function))]() mutable
+	{
+		// the children share the function stored in this job,
+		// which outlives them
+		RANGE_FUNCTION* pFunction = &rangeFunction;
+		JOB* self = GetCurrentJob();
+		for (int begin = 0; begin < count; begin += grainSize)
+		{
+			int end = std::min(begin + grainSize, count);
+			Submit(CreateJob(name, [pFunction, begin, end]() { (*pFunction)(begin, end); }, self));
+		}
+	}, parent));
+}
@@ -0,0 +1,795 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.cpp
+// ============
+// bake the light falling on the static objects into one lightmap atlas
+//
+//  Every static object gets a square of the atlas, sized by its surface
+//  area and addressed through the mesh pool's lightmap coordinates.  Each
+//  texel holds the ambient light, the shadowed diffuse light of every
+//  light source and one bounce of indirect light, traced against the
+//  scene on all cores.  The atlas is saved to a file once and loaded by
+//  later runs.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightmapBaker.h"
+#include "GPUDrivenRenderer.h"
+#include "JobSystem.h"
+
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// the records are written as they are, so their layout is part
+// of the file format and must not change without a version bump
+static_assert(sizeof(LightmapBaker::BAKE_LIGHT) == 48, "lightmap light layout changed");
+static_assert(sizeof(LightmapBaker::LIGHTMAP_OBJECT) == 120, "lightmap object layout changed");
+
+// declaration of global variables
+namespace
+{
+	const char g_LightmapMagic[8] = { 'C', 'S', '3', '3', '0', 'L', 'M', 'P' };
+	const float g_PI = 3.14159265358979f;
+
+	// texels per unit of surface, lowered until the atlas fits
+	const float g_TexelsPerUnit = 8.0f;
+	const float g_MinTexelsPerUnit = 1.0f;
+	// size limits of one object's square, and of the atlas
+	const int g_MinResolution = 16;
+	const int g_MaxResolution = 256;
+	const int g_AtlasWidth = 1024;
+	const int g_MaxAtlasHeight = 4096;
+	// texels left between the objects' squares
+	const int g_AtlasPadding = 2;
+	// rays per texel; the soft shadows come from jittering the
+	// light over a small sphere
+	const int g_ShadowSamples = 8;
+	const int g_IndirectSamples = 64;
+	const float g_LightRadius = 0.5f;
+	// rays start this far off the surface
+	const float g_RayOffset = 0.002f;
+	// passes of growing the lit texels past the chart edges
+	const int g_DilatePasses = 2;
+	// highest object index a loaded file may name
+	const int32_t g_MaxObjectIndex = 1 << 20;
+
+	/***********************************************************
+	 *  NextRandom()
+	 *
+	 *  Step a xorshift generator and return a value in [0, 1).
+	 ***********************************************************/
+	float NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return((state >> 8) * (1.0f / 16777216.0f));
+	}
+
+	/***********************************************************
+	 *  SeedRandom()
+	 *
+	 *  Mix a texel's coordinates into a non-zero seed, so each
+	 *  texel draws the same samples however the rows are split
+	 *  over the threads.
+	 ***********************************************************/
+	uint32_t SeedRandom(int object, int x, int y)
+	{
+		uint32_t seed = (uint32_t)object * 73856093u ^ (uint32_t)x * 19349663u ^ (uint32_t)y * 83492791u;
+		seed ^= seed >> 16;
+		seed *= 0x7feb352du;
+		seed ^= seed >> 15;
+		return((seed != 0) ? seed : 1u);
+	}
+
+	/***********************************************************
+	 *  CosineDirection()
+	 *
+	 *  A random direction over the hemisphere around a normal,
+	 *  more likely where it faces the normal, which weights
+	 *  the bounced light by its angle without multiplying.
+	 ***********************************************************/
+	glm::vec3 CosineDirection(glm::vec3 normal, uint32_t& random)
+	{
+		float angle = 2.0f * g_PI * NextRandom(random);
+		float radiusSquared = NextRandom(random);
+		float radius = sqrtf(radiusSquared);
+
+		glm::vec3 tangent = (fabsf(normal.x) > 0.5f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		tangent = glm::normalize(glm::cross(tangent, normal));
+		glm::vec3 bitangent = glm::cross(normal, tangent);
+		return(tangent * (radius * cosf(angle)) +
+			bitangent * (radius * sinf(angle)) +
+			normal * sqrtf(std::max(0.0f, 1.0f - radiusSquared)));
+	}
+
+	/***********************************************************
+	 *  TriangleNormal()
+	 *
+	 *  The world space face normal of a triangle of an object.
+	 ***********************************************************/
+	glm::vec3 TriangleNormal(const ObjectStore& objects, const MeshPool& meshPool, int object, int triangle)
+	{
+		const MeshPool::MESH_RANGE& range = meshPool.GetMesh(objects.GetMeshes()[object]);
+		const MeshPool::MESH_VERTEX* vertices = meshPool.GetVertexData() + range.baseVertex;
+		const GLuint* indices = meshPool.GetIndexData() + range.firstIndex + triangle * 3;
+		const glm::mat4& model = objects.GetModelMatrices()[object];
+
+		glm::vec3 p0 = glm::vec3(model * glm::vec4(vertices[indices[0]].position, 1.0f));
+		glm::vec3 p1 = glm::vec3(model * glm::vec4(vertices[indices[1]].position, 1.0f));
+		glm::vec3 p2 = glm::vec3(model * glm::vec4(vertices[indices[2]].position, 1.0f));
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		return((length > 0.0f) ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+}
+
+/***********************************************************
+ *  LightmapBaker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightmapBaker::LightmapBaker()
+{
+	m_width = 0;
+	m_height = 0;
+	m_globalAmbient = glm::vec3(0.0f);
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method sizes and packs every static object's square,
+ *  finds the surface point under each texel, then lights the
+ *  texels a row at a time as jobs spread over every thread.
+ ***********************************************************/
+bool LightmapBaker::Bake(
+	const ObjectStore& objects,
+	MeshPool& meshPool,
+	const std::vector<BAKE_SURFACE>& surfaces,
+	const std::vector<BAKE_LIGHT>& lights,
+	glm::vec3 globalAmbient,
+	JobSystem& jobSystem)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	meshPool.GenerateLightmapCoords();
+	m_bvh.Build(objects);
+	m_bvh.BuildMeshTrees(meshPool);
+
+	const int objectCount = std::min(objects.GetCount(), (int)surfaces.size());
+	m_skippedObjects.assign(objects.GetCount(), 0);
+	for (int i = 0; i < objectCount; i++)
+	{
+		m_skippedObjects[i] = surfaces[i].bAnimated ? 1 : 0;
+	}
+
+	std::vector<OBJECT_BAKE> bakes;
+	for (int i = 0; i < objectCount; i++)
+	{
+		if (surfaces[i].bStatic && meshPool.HasLightmapCoords(objects.GetMeshes()[i]))
+		{
+			OBJECT_BAKE bake;
+			bake.objectIndex = i;
+			bake.texelScale = 0.0f;
+			bake.resolution = 0;
+			bake.atlasX = 0;
+			bake.atlasY = 0;
+
+			// compare the surface area to the area it covers in the
+			// lightmap coordinates, so texels come out evenly sized
+			const MeshPool::MESH_RANGE& range = meshPool.GetMesh(objects.GetMeshes()[i]);
+			const MeshPool::MESH_VERTEX* vertices = meshPool.GetVertexData() + range.baseVertex;
+			const glm::vec2* coords = meshPool.GetLightmapCoords() + range.baseVertex;
+			const GLuint* indices = meshPool.GetIndexData() + range.firstIndex;
+			const glm::mat4& model = objects.GetModelMatrices()[i];
+			float surfaceArea = 0.0f;
+			float coordArea = 0.0f;
+			for (GLuint t = 0; t + 2 < range.indexCount; t += 3)
+			{
+				glm::vec3 p0 = glm::vec3(model * glm::vec4(vertices[indices[t]].position, 1.0f));
+				glm::vec3 p1 = glm::vec3(model * glm::vec4(vertices[indices[t + 1]].position, 1.0f));
+				glm::vec3 p2 = glm::vec3(model * glm::vec4(vertices[indices[t + 2]].position, 1.0f));
+				glm::vec2 c0 = coords[indices[t]];
+				glm::vec2 e1 = coords[indices[t + 1]] - c0;
+				glm::vec2 e2 = coords[indices[t + 2]] - c0;
+				surfaceArea += 0.5f * glm::length(glm::cross(p1 - p0, p2 - p0));
+				coordArea += 0.5f * fabsf(e1.x * e2.y - e1.y * e2.x);
+			}
+			if (coordArea > 0.0f)
+			{
+				bake.texelScale = sqrtf(surfaceArea / coordArea);
+				bakes.push_back(bake);
+			}
+		}
+	}
+	if (bakes.empty())
+	{
+		std::cout << "ERROR: The scene has no static objects to bake lightmaps for" << std::endl;
+		return(false);
+	}
+	if (!PackAtlas(bakes))
+	{
+		std::cout << "ERROR: The static objects do not fit in a "
+			<< g_AtlasWidth << "x" << g_MaxAtlasHeight << " lightmap" << std::endl;
+		return(false);
+	}
+
+	// the rows holding any texel to light are the units of work
+	std::vector<std::pair<int, int>> rows;
+	int texelCount = 0;
+	for (int b = 0; b < (int)bakes.size(); b++)
+	{
+		RasterizeObject(objects, meshPool, bakes[b]);
+		const OBJECT_BAKE& bake = bakes[b];
+		for (int y = 0; y < bake.resolution; y++)
+		{
+			int covered = (int)std::count(
+				bake.covered.begin() + y * bake.resolution,
+				bake.covered.begin() + (y + 1) * bake.resolution, (unsigned char)1);
+			if (covered > 0)
+			{
+				rows.push_back(std::make_pair(b, y));
+				texelCount += covered;
+			}
+		}
+	}
+
+	m_lights = lights;
+	m_globalAmbient = globalAmbient;
+
+	jobSystem.BeginFrame();
+	JobSystem::JOB* job = jobSystem.ParallelFor("bake lightmap rows", (int)rows.size(), 1,
+		[&](int begin, int end)
+	{
+		for (int r = begin; r < end; r++)
+		{
+			OBJECT_BAKE& bake = bakes[rows[r].first];
+			const BAKE_SURFACE& surface = surfaces[bake.objectIndex];
+			const int y = rows[r].second;
+			for (int x = 0; x < bake.resolution; x++)
+			{
+				int texel = y * bake.resolution + x;
+				if (bake.covered[texel] != 0)
+				{
+					uint32_t random = SeedRandom(bake.objectIndex, x, y);
+					bake.colors[texel] = BakeTexel(objects, meshPool, surfaces, surface,
+						bake.positions[texel], bake.normals[texel], random);
+				}
+			}
+		}
+	});
+	jobSystem.Submit(job);
+	jobSystem.Wait(job);
+	jobSystem.EndFrame();
+
+	// copy each square into the atlas, and remember where it went
+	m_texels.assign((size_t)m_width * m_height * 4, glm::packHalf1x16(0.0f));
+	m_objects.clear();
+	for (OBJECT_BAKE& bake : bakes)
+	{
+		DilateObject(bake);
+		for (int y = 0; y < bake.resolution; y++)
+		{
+			for (int x = 0; x < bake.resolution; x++)
+			{
+				const glm::vec3& color = bake.colors[y * bake.resolution + x];
+				uint16_t* texel = &m_texels[((size_t)(bake.atlasY + y) * m_width + bake.atlasX + x) * 4];
+				texel[0] = glm::packHalf1x16(color.r);
+				texel[1] = glm::packHalf1x16(color.g);
+				texel[2] = glm::packHalf1x16(color.b);
+				texel[3] = glm::packHalf1x16(1.0f);
+			}
+		}
+
+		LIGHTMAP_OBJECT entry;
+		memset(&entry, 0, sizeof(entry));
+		strncpy(entry.name, objects.GetName(bake.objectIndex).c_str(), NAME_LENGTH - 1);
+		entry.objectIndex = bake.objectIndex;
+		entry.mesh = objects.GetMeshes()[bake.objectIndex];
+		memcpy(entry.model, glm::value_ptr(objects.GetModelMatrices()[bake.objectIndex]), sizeof(entry.model));
+		entry.rect[0] = (float)bake.resolution / m_width;
+		entry.rect[1] = (float)bake.resolution / m_height;
+		entry.rect[2] = (float)bake.atlasX / m_width;
+		entry.rect[3] = (float)bake.atlasY / m_height;
+		m_objects.push_back(entry);
+	}
+	BuildObjectEntries();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "INFO: Baked lightmaps for " << bakes.size() << " of " << objectCount << " objects, "
+		<< texelCount << " texels in a " << m_width << "x" << m_height << " atlas, in "
+		<< seconds << "s on " << jobSystem.GetThreadCount() << " threads" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  PackAtlas()
+ *
+ *  This method sizes each object's square so its texels
+ *  cover about the same surface everywhere, then places the
+ *  squares largest first on shelves across the atlas.  When
+ *  they run past the atlas height the density is lowered
+ *  and the packing starts over.
+ ***********************************************************/
+bool LightmapBaker::PackAtlas(std::vector<OBJECT_BAKE>& bakes)
+{
+	for (float density = g_TexelsPerUnit; density >= g_MinTexelsPerUnit; density *= 0.7f)
+	{
+		for (OBJECT_BAKE& bake : bakes)
+		{
+			// whole multiples of four texels per side
+			int resolution = (int)ceilf(bake.texelScale * density / 4.0f) * 4;
+			bake.resolution = std::max(g_MinResolution, std::min(g_MaxResolution, resolution));
+		}
+
+		std::vector<int> order(bakes.size());
+		for (int i = 0; i < (int)order.size(); i++)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+		{
+			return(bakes[a].resolution > bakes[b].resolution);
+		});
+
+		int shelfX = 0;
+		int shelfY = 0;
+		int shelfHeight = 0;
+		for (int i : order)
+		{
+			OBJECT_BAKE& bake = bakes[i];
+			int size = bake.resolution + g_AtlasPadding;
+			if (shelfX + size > g_AtlasWidth)
+			{
+				shelfY += shelfHeight;
+				shelfX = 0;
+				shelfHeight = 0;
+			}
+			bake.atlasX = shelfX;
+			bake.atlasY = shelfY;
+			shelfX += size;
+			shelfHeight = std::max(shelfHeight, size);
+		}
+
+		int height = ((shelfY + shelfHeight + 3) / 4) * 4;
+		if (height <= g_MaxAtlasHeight)
+		{
+			// a single shelf only needs to be as wide as its squares
+			m_width = (shelfY == 0) ? ((shelfX + 3) / 4) * 4 : g_AtlasWidth;
+			m_height = height;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  RasterizeObject()
+ *
+ *  This method walks each triangle of the object over the
+ *  texels of its square, interpolating the world position
+ *  and normal at every texel center the triangle covers.
+ ***********************************************************/
+void LightmapBaker::RasterizeObject(const ObjectStore& objects, const MeshPool& meshPool, OBJECT_BAKE& bake)
+{
+	const int resolution = bake.resolution;
+	const int texelCount = resolution * resolution;
+	bake.positions.assign(texelCount, glm::vec3(0.0f));
+	bake.normals.assign(texelCount, glm::vec3(0.0f));
+	bake.covered.assign(texelCount, 0);
+	bake.colors.assign(texelCount, glm::vec3(0.0f));
+
+	const MeshPool::MESH_RANGE& range = meshPool.GetMesh(objects.GetMeshes()[bake.objectIndex]);
+	const MeshPool::MESH_VERTEX* vertices = meshPool.GetVertexData() + range.baseVertex;
+	const glm::vec2* coords = meshPool.GetLightmapCoords() + range.baseVertex;
+	const GLuint* indices = meshPool.GetIndexData() + range.firstIndex;
+	const glm::mat4& model = objects.GetModelMatrices()[bake.objectIndex];
+	const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+	for (GLuint t = 0; t + 2 < range.indexCount; t += 3)
+	{
+		glm::vec2 c[3];
+		for (int v = 0; v < 3; v++)
+		{
+			c[v] = coords[indices[t + v]] * (float)resolution;
+		}
+		float area = (c[1].x - c[0].x) * (c[2].y - c[0].y) - (c[1].y - c[0].y) * (c[2].x - c[0].x);
+		if (fabsf(area) < 1e-8f)
+		{
+			continue;
+		}
+
+		int minX = std::max(0, (int)floorf(std::min(c[0].x, std::min(c[1].x, c[2].x))));
+		int minY = std::max(0, (int)floorf(std::min(c[0].y, std::min(c[1].y, c[2].y))));
+		int maxX = std::min(resolution - 1, (int)ceilf(std::max(c[0].x, std::max(c[1].x, c[2].x))));
+		int maxY = std::min(resolution - 1, (int)ceilf(std::max(c[0].y, std::max(c[1].y, c[2].y))));
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				glm::vec2 p((float)x + 0.5f, (float)y + 0.5f);
+				float w0 = ((c[1].x - p.x) * (c[2].y - p.y) - (c[1].y - p.y) * (c[2].x - p.x)) / area;
+				float w1 = ((c[2].x - p.x) * (c[0].y - p.y) - (c[2].y - p.y) * (c[0].x - p.x)) / area;
+				float w2 = 1.0f - w0 - w1;
+				if ((w0 < -1e-4f) || (w1 < -1e-4f) || (w2 < -1e-4f))
+				{
+					continue;
+				}
+
+				const MeshPool::MESH_VERTEX& v0 = vertices[indices[t]];
+				const MeshPool::MESH_VERTEX& v1 = vertices[indices[t + 1]];
+				const MeshPool::MESH_VERTEX& v2 = vertices[indices[t + 2]];
+				glm::vec3 position = v0.position * w0 + v1.position * w1 + v2.position * w2;
+				glm::vec3 normal = normalMatrix * (v0.normal * w0 + v1.normal * w1 + v2.normal * w2);
+				float length = glm::length(normal);
+
+				int texel = y * resolution + x;
+				bake.positions[texel] = glm::vec3(model * glm::vec4(position, 1.0f));
+				bake.normals[texel] = (length > 0.0f) ? normal / length : TriangleNormal(objects, meshPool, bake.objectIndex, t / 3);
+				bake.covered[texel] = 1;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BakeTexel()
+ *
+ *  This method adds up the light one texel receives: the
+ *  ambient terms, the direct light with soft shadows, and
+ *  the direct light bounced once off the surfaces around.
+ ***********************************************************/
+glm::vec3 LightmapBaker::BakeTexel(
+	const ObjectStore& objects,
+	const MeshPool& meshPool,
+	const std::vector<BAKE_SURFACE>& surfaces,
+	const BAKE_SURFACE& surface,
+	glm::vec3 position,
+	glm::vec3 normal,
+	uint32_t& random)
+{
+	glm::vec3 lighting = m_globalAmbient;
+	for (const BAKE_LIGHT& light : m_lights)
+	{
+		lighting += light.ambientColor * surface.ambient;
+	}
+	lighting += DirectLight(objects, meshPool, surface, position, normal, g_ShadowSamples, random);
+
+	glm::vec3 bounced(0.0f);
+	for (int s = 0; s < g_IndirectSamples; s++)
+	{
+		glm::vec3 direction = CosineDirection(normal, random);
+		SceneBVH::RAY_HIT hit;
+		if (!m_bvh.Intersect(position + normal * g_RayOffset, direction, objects, meshPool,
+			hit, FLT_MAX, ObjectStore::OBJECT_TRANSPARENT, m_skippedObjects.data()))
+		{
+			continue;
+		}
+
+		// direct light leaving the hit surface toward this texel,
+		// lit from whichever side the ray arrived on
+		const BAKE_SURFACE& hitSurface = surfaces[hit.objectIndex];
+		glm::vec3 hitNormal = TriangleNormal(objects, meshPool, hit.objectIndex, hit.triangle);
+		if (glm::dot(hitNormal, direction) > 0.0f)
+		{
+			hitNormal = -hitNormal;
+		}
+		bounced += hitSurface.albedo *
+			DirectLight(objects, meshPool, hitSurface, hit.position, hitNormal, 1, random);
+	}
+	lighting += bounced * surface.diffuse / (float)g_IndirectSamples;
+	return(lighting);
+}
+
+/***********************************************************
+ *  DirectLight()
+ *
+ *  This method sums the diffuse light of each light at a
+ *  point, each weighted by the share of shadow rays toward
+ *  points around the light that reach it unblocked.
+ ***********************************************************/
+glm::vec3 LightmapBaker::DirectLight(
+	const ObjectStore& objects,
+	const MeshPool& meshPool,
+	const BAKE_SURFACE& surface,
+	glm::vec3 position,
+	glm::vec3 normal,
+	int shadowSamples,
+	uint32_t& random)
+{
+	glm::vec3 lighting(0.0f);
+	glm::vec3 origin = position + normal * g_RayOffset;
+	for (const BAKE_LIGHT& light : m_lights)
+	{
+		if (light.diffuseColor == glm::vec3(0.0f))
+		{
+			continue;
+		}
+		glm::vec3 lightDirection = glm::normalize(light.position - position);
+		float impact = glm::dot(normal, lightDirection);
+		// a directed light fades out away from its direction, the
+		// same as in the shader
+		if (light.direction != glm::vec3(0.0f))
+		{
+			impact *= std::max(glm::dot(-lightDirection, glm::normalize(light.direction)), 0.0f);
+		}
+		if (impact <= 0.0f)
+		{
+			continue;
+		}
+
+		int unblocked = 0;
+		for (int s = 0; s < shadowSamples; s++)
+		{
+			// a point in the sphere around the light; the ray runs
+			// from the surface to it, so a distance of 1 reaches it
+			glm::vec3 jitter;
+			do
+			{
+				jitter = glm::vec3(NextRandom(random), NextRandom(random), NextRandom(random)) * 2.0f - 1.0f;
+			} while (glm::dot(jitter, jitter) > 1.0f);
+
+			SceneBVH::RAY_HIT hit;
+			glm::vec3 target = light.position + jitter * g_LightRadius;
+			if (!m_bvh.Intersect(origin, target - origin, objects, meshPool,
+				hit, 1.0f, ObjectStore::OBJECT_TRANSPARENT, m_skippedObjects.data()))
+			{
+				unblocked++;
+			}
+		}
+		lighting += impact * ((float)unblocked / shadowSamples) * light.diffuseColor * surface.diffuse;
+	}
+	return(lighting);
+}
+
+/***********************************************************
+ *  DilateObject()
+ *
+ *  This method copies the average of the covered neighbors
+ *  into each uncovered texel next to them, a pass at a time,
+ *  so bilinear filtering at the chart edges blends in light
+ *  from the chart rather than black.
+ ***********************************************************/
+void LightmapBaker::DilateObject(OBJECT_BAKE& bake)
+{
+	const int resolution = bake.resolution;
+	for (int pass = 0; pass < g_DilatePasses; pass++)
+	{
+		std::vector<unsigned char> covered = bake.covered;
+		for (int y = 0; y < resolution; y++)
+		{
+			for (int x = 0; x < resolution; x++)
+			{
+				int texel = y * resolution + x;
+				if (bake.covered[texel] != 0)
+				{
+					continue;
+				}
+
+				glm::vec3 sum(0.0f);
+				int count = 0;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int nx = x + dx;
+						int ny = y + dy;
+						if ((nx >= 0) && (ny >= 0) && (nx < resolution) && (ny < resolution) &&
+							(bake.covered[ny * resolution + nx] != 0))
+						{
+							sum += bake.colors[ny * resolution + nx];
+							count++;
+						}
+					}
+				}
+				if (count > 0)
+				{
+					bake.colors[texel] = sum / (float)count;
+					covered[texel] = 1;
+				}
+			}
+		}
+		bake.covered.swap(covered);
+	}
+}
+
+/***********************************************************
+ *  BuildObjectEntries()
+ *
+ *  This method indexes the lightmapped objects by their
+ *  object index for FindObject().
+ ***********************************************************/
+void LightmapBaker::BuildObjectEntries()
+{
+	m_objectEntries.clear();
+	for (int i = 0; i < (int)m_objects.size(); i++)
+	{
+		int objectIndex = m_objects[i].objectIndex;
+		if (objectIndex < 0)
+		{
+			continue;
+		}
+		if (objectIndex >= (int)m_objectEntries.size())
+		{
+			m_objectEntries.resize(objectIndex + 1, -1);
+		}
+		m_objectEntries[objectIndex] = i;
+	}
+}
+
+/***********************************************************
+ *  FindObject()
+ *
+ *  This method looks up an object's square in the atlas.
+ *  The object must still be the one baked: the same name
+ *  and mesh, in the same place, or its light would be
+ *  wrong and the scene needs baking again.
+ ***********************************************************/
+bool LightmapBaker::FindObject(
+	int objectIndex,
+	const std::string& name,
+	int mesh,
+	const glm::mat4& model,
+	glm::vec4& rect) const
+{
+	if ((objectIndex < 0) || (objectIndex >= (int)m_objectEntries.size()) ||
+		(m_objectEntries[objectIndex] < 0))
+	{
+		return(false);
+	}
+
+	const LIGHTMAP_OBJECT& entry = m_objects[m_objectEntries[objectIndex]];
+	if ((entry.mesh != mesh) || (name.compare(0, NAME_LENGTH - 1, entry.name) != 0))
+	{
+		return(false);
+	}
+	const float* matrix = glm::value_ptr(model);
+	for (int i = 0; i < 16; i++)
+	{
+		if (fabsf(matrix[i] - entry.model[i]) > 1e-4f)
+		{
+			return(false);
+		}
+	}
+
+	rect = glm::vec4(entry.rect[0], entry.rect[1], entry.rect[2], entry.rect[3]);
+	return(true);
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method writes the header, the lights, the objects
+ *  and the atlas texels to a file.
+ ***********************************************************/
+bool LightmapBaker::Save(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL)
+	{
+		std::cout << "ERROR: Could not create lightmap file " << path << std::endl;
+		return(false);
+	}
+
+	LIGHTMAP_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, g_LightmapMagic, sizeof(header.magic));
+	header.version = FORMAT_VERSION;
+	header.width = (uint32_t)m_width;
+	header.height = (uint32_t)m_height;
+	header.objectCount = (uint32_t)m_objects.size();
+	header.lightCount = (uint32_t)m_lights.size();
+	header.globalAmbient[0] = m_globalAmbient.x;
+	header.globalAmbient[1] = m_globalAmbient.y;
+	header.globalAmbient[2] = m_globalAmbient.z;
+
+	bool bWritten =
+		(fwrite(&header, sizeof(header), 1, file) == 1) &&
+		(m_lights.empty() || (fwrite(m_lights.data(), sizeof(BAKE_LIGHT), m_lights.size(), file) == m_lights.size())) &&
+		(m_objects.empty() || (fwrite(m_objects.data(), sizeof(LIGHTMAP_OBJECT), m_objects.size(), file) == m_objects.size())) &&
+		(m_texels.empty() || (fwrite(m_texels.data(), sizeof(uint16_t), m_texels.size(), file) == m_texels.size()));
+	bWritten = (fclose(file) == 0) && bWritten;
+	if (!bWritten)
+	{
+		std::cout << "ERROR: Could not write lightmap file " << path << std::endl;
+		return(false);
+	}
+
+	std::cout << "INFO: Saved lightmaps for " << m_objects.size() << " objects to " << path << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method reads a lightmap file written by Save(),
+ *  leaving the baker empty if it is not a valid file.
+ ***********************************************************/
+bool LightmapBaker::Load(const std::string& path)
+{
+	m_width = 0;
+	m_height = 0;
+	m_texels.clear();
+	m_objects.clear();
+	m_objectEntries.clear();
+	m_lights.clear();
+
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL)
+	{
+		std::cout << "ERROR: Could not open lightmap file " << path << std::endl;
+		return(false);
+	}
+
+	LIGHTMAP_HEADER header;
+	bool bRead = (fread(&header, sizeof(header), 1, file) == 1) &&
+		(memcmp(header.magic, g_LightmapMagic, sizeof(header.magic)) == 0);
+	if (bRead && (header.version != FORMAT_VERSION))
+	{
+		std::cout << "ERROR: Lightmap file " << path << " has version " << header.version
+			<< ", expected " << FORMAT_VERSION << std::endl;
+		fclose(file);
+		return(false);
+	}
+	bRead = bRead && (header.width <= (uint32_t)g_AtlasWidth) && (header.height <= (uint32_t)g_MaxAtlasHeight) &&
+		(header.lightCount <= (uint32_t)GPUDrivenRenderer::MAX_LIGHTS);
+
+	// the records must fill the rest of the file exactly, which
+	// also bounds the object count before anything is allocated
+	if (bRead)
+	{
+		long headerEnd = ftell(file);
+		bRead = (headerEnd >= 0) && (fseek(file, 0, SEEK_END) == 0);
+		long fileSize = bRead ? ftell(file) : -1;
+		uint64_t expected = (uint64_t)headerEnd +
+			(uint64_t)header.lightCount * sizeof(BAKE_LIGHT) +
+			(uint64_t)header.objectCount * sizeof(LIGHTMAP_OBJECT) +
+			(uint64_t)header.width * header.height * 4 * sizeof(uint16_t);
+		bRead = bRead && (fileSize >= 0) && ((uint64_t)fileSize == expected) &&
+			(fseek(file, headerEnd, SEEK_SET) == 0);
+	}
+
+	if (bRead)
+	{
+		m_lights.resize(header.lightCount);
+		m_objects.resize(header.objectCount);
+		m_texels.resize((size_t)header.width * header.height * 4);
+		bRead =
+			(m_lights.empty() || (fread(m_lights.data(), sizeof(BAKE_LIGHT), m_lights.size(), file) == m_lights.size())) &&
+			(m_objects.empty() || (fread(m_objects.data(), sizeof(LIGHTMAP_OBJECT), m_objects.size(), file) == m_objects.size())) &&
+			(m_texels.empty() || (fread(m_texels.data(), sizeof(uint16_t), m_texels.size(), file) == m_texels.size()));
+	}
+	fclose(file);
+
+	for (const LIGHTMAP_OBJECT& entry : m_objects)
+	{
+		bRead = bRead && (entry.objectIndex >= 0) && (entry.objectIndex <= g_MaxObjectIndex);
+	}
+	if (!bRead)
+	{
+		std::cout << "ERROR: " << path << " is not a valid lightmap file" << std::endl;
+		m_texels.clear();
+		m_objects.clear();
+		m_lights.clear();
+		return(false);
+	}
+
+	for (LIGHTMAP_OBJECT& entry : m_objects)
+	{
+		entry.name[NAME_LENGTH - 1] = '\0';
+	}
+	m_width = (int)header.width;
+	m_height = (int)header.height;
+	m_globalAmbient = glm::vec3(header.globalAmbient[0], header.globalAmbient[1], header.globalAmbient[2]);
+	BuildObjectEntries();
+
+	std::cout << "INFO: Loaded a " << m_width << "x" << m_height << " lightmap for "
+		<< m_objects.size() << " objects from " << path << std::endl;
+	return(true);
+}
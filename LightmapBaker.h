@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.h
+// ============
+// bake the light falling on the static objects into one lightmap atlas
+//
+//  Every static object gets a square of the atlas, sized by its surface
+//  area and addressed through the mesh pool's lightmap coordinates.  Each
+//  texel holds the ambient light, the shadowed diffuse light of every
+//  light source and one bounce of indirect light, traced against the
+//  scene on all cores.  The atlas is saved to a file once and loaded by
+//  later runs.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshPool.h"
+#include "ObjectStore.h"
+#include "SceneBVH.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+/***********************************************************
+ *  LightmapBaker
+ *
+ *  This class bakes, saves and loads the lightmap atlas.
+ *  The baked light follows the GPU-driven path's shading:
+ *  the global ambient, each light's ambient and diffuse
+ *  terms with no falloff, all times the object's material,
+ *  so an unshadowed texel matches what the shader computes.
+ *  Specular light depends on the view and is left to the
+ *  shader.
+ ***********************************************************/
+class LightmapBaker
+{
+public:
+	// constructor
+	LightmapBaker();
+
+	// bumped whenever the layout of the file changes
+	static const uint32_t FORMAT_VERSION = 2;
+	// object names are zero terminated within this length
+	static const int NAME_LENGTH = 32;
+
+	// what the bake needs to know about one object
+	struct BAKE_SURFACE
+	{
+		// only static objects are given a lightmap, though the
+		// others cast shadows and bounce light too, except an
+		// animated object, which will not stay where it was baked
+		bool bStatic;
+		bool bAnimated;
+		// material ambient color times its strength, and the
+		// material diffuse color
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		// the color the material lights, for the bounced light
+		glm::vec3 albedo;
+	};
+
+	struct BAKE_LIGHT
+	{
+		glm::vec3 position;
+		// zero for a light that shines all around
+		glm::vec3 direction;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+	};
+
+	// one lightmapped object, as stored in the file
+	struct LIGHTMAP_OBJECT
+	{
+		char name[NAME_LENGTH];
+		int32_t objectIndex;
+		int32_t mesh;
+		// the model matrix the object was baked with
+		float model[16];
+		// scale in xy and offset in zw from the mesh's lightmap
+		// coordinates into the atlas
+		float rect[4];
+	};
+
+	// bake every static object; the object transforms must be up
+	// to date, and the bake runs its own frame of jobs, so it
+	// must not be called while a frame is running
+	bool Bake(
+		const ObjectStore& objects,
+		MeshPool& meshPool,
+		const std::vector<BAKE_SURFACE>& surfaces,
+		const std::vector<BAKE_LIGHT>& lights,
+		glm::vec3 globalAmbient,
+		JobSystem& jobSystem);
+
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+
+	// the atlas as RGBA half floats, rows bottom up
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	const std::vector<uint16_t>& GetTexels() const { return m_texels; }
+	// the lights and ambient the atlas was baked with
+	const std::vector<BAKE_LIGHT>& GetLights() const { return m_lights; }
+	glm::vec3 GetGlobalAmbient() const { return m_globalAmbient; }
+	int GetObjectCount() const { return (int)m_objects.size(); }
+
+	// the atlas rect of an object, false unless it still has the
+	// name, mesh and placement it was baked with
+	bool FindObject(
+		int objectIndex,
+		const std::string& name,
+		int mesh,
+		const glm::mat4& model,
+		glm::vec4& rect) const;
+
+private:
+	struct LIGHTMAP_HEADER
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t objectCount;
+		uint32_t lightCount;
+		float globalAmbient[3];
+	};
+
+	// the texels of one object while it is baked
+	struct OBJECT_BAKE
+	{
+		int objectIndex;
+		// surface length per unit of the mesh's lightmap coordinates
+		float texelScale;
+		int resolution;
+		int atlasX;
+		int atlasY;
+		// world space position and normal of each covered texel
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<unsigned char> covered;
+		std::vector<glm::vec3> colors;
+	};
+
+	int m_width;
+	int m_height;
+	std::vector<uint16_t> m_texels;
+	std::vector<LIGHTMAP_OBJECT> m_objects;
+	// the entry of each object index, or -1
+	std::vector<int> m_objectEntries;
+	std::vector<BAKE_LIGHT> m_lights;
+	glm::vec3 m_globalAmbient;
+
+	// scene the rays are traced against during a bake, and the
+	// objects they pass through
+	SceneBVH m_bvh;
+	std::vector<unsigned char> m_skippedObjects;
+
+	// lay out the objects' squares in the atlas, false when they
+	// do not fit at the smallest texel density
+	bool PackAtlas(std::vector<OBJECT_BAKE>& bakes);
+	// find the texels each triangle of an object covers
+	void RasterizeObject(const ObjectStore& objects, const MeshPool& meshPool, OBJECT_BAKE& bake);
+	// the light arriving at one texel
+	glm::vec3 BakeTexel(
+		const ObjectStore& objects,
+		const MeshPool& meshPool,
+		const std::vector<BAKE_SURFACE>& surfaces,
+		const BAKE_SURFACE& surface,
+		glm::vec3 position,
+		glm::vec3 normal,
+		uint32_t& random);
+	// the shadowed diffuse light of every light at a point
+	glm::vec3 DirectLight(
+		const ObjectStore& objects,
+		const MeshPool& meshPool,
+		const BAKE_SURFACE& surface,
+		glm::vec3 position,
+		glm::vec3 normal,
+		int shadowSamples,
+		uint32_t& random);
+	// grow the covered texels outward, so filtering at the chart
+	// edges never reads an unlit texel
+	void DilateObject(OBJECT_BAKE& bake);
+	void BuildObjectEntries();
+};
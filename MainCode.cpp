@@ -1,5 +1,10 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <algorithm>        // std::max
+#include <thread>           // std::thread::hardware_concurrency
+#include <chrono>           // pick and frame timing
+#include <vector>           // the scene files to switch between
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +18,13 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "ResolutionScaler.h"
+#include "PostProcessor.h"
+#include "FrameCapture.h"
+#include "JobSystem.h"
+#include "PerformanceHUD.h"
+#include "ScenePreloader.h"
+#include "AllocationCounter.h"
 
 // Namespace for declaring global variables
 namespace
@@ -29,12 +41,67 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// resolution scaler object for the offscreen render target
+	ResolutionScaler* g_ResolutionScaler = nullptr;
+	// post processor object for the bloom, tone mapping and grading
+	PostProcessor* g_PostProcessor = nullptr;
+	// frame capture object for recording the displayed frames
+	FrameCapture* g_FrameCapture = nullptr;
+	// job system object for spreading the frame's CPU work
+	JobSystem* g_JobSystem = nullptr;
+	// performance overlay object, shown with the H key
+	PerformanceHUD* g_PerformanceHUD = nullptr;
+	// background loader of the next scene, when several are given
+	ScenePreloader* g_ScenePreloader = nullptr;
+
+	// command line options
+	bool g_bGPUDriven = false;
+	bool g_bDepthPrePass = false;
+	bool g_bCompactVertices = false;
+	bool g_bReflectionProbes = false;
+	bool g_bPostProcess = false;
+	bool g_bMultiView = false;
+	bool g_bAnimate = false;
+	int g_TextureBudget = 0;
+	int g_SceneCopies = 1;
+	float g_FrameBudget = 0.0f;
+	const char* g_CapturePath = nullptr;
+	int g_CaptureRate = 60;
+	bool g_bContinuous = false;
+	int g_WorkerThreads = -1;
+	const char* g_SceneFile = nullptr;
+	const char* g_AssetPack = nullptr;
+	bool g_bJobTimings = false;
+	const char* g_RecordInputPath = nullptr;
+	const char* g_ReplayInputPath = nullptr;
+	const char* g_LightmapPath = nullptr;
+	const char* g_BakeLightmapPath = nullptr;
+	// the scene files N cycles through, the first one being the
+	// --scene file or the built-in layout, and the one shown
+	std::vector<const char*> g_SceneFiles;
+	int g_SceneIndex = 0;
+
+	// longest wait for events while nothing on screen changes,
+	// in seconds
+	const double g_IdleTimeout = 0.5;
+	// shorter wait while a scene file is watched, so saved edits
+	// show up right away
+	const double g_SceneWatchTimeout = 0.25;
+	// seconds between printouts of the frame's job timings
+	const double g_JobTimingInterval = 2.0;
+	// how far past white the emissive objects glow when the frame
+	// is post-processed, keeping them above the bloom threshold
+	const float g_EmissiveScale = 4.0f;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void ParseCommandLine(int argc, char* argv[]);
+void PickObject(glm::vec3 origin, glm::vec3 direction);
+SceneManager* CreateSceneManager(const char* sceneFile);
+void UpdateSceneSwitch();
 
 
 /***********************************************************
@@ -45,6 +112,8 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	ParseCommandLine(argc, argv);
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -56,6 +125,26 @@ int main(int argc, char* argv[])
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
+	g_ViewManager->EnableMultiView(g_bMultiView);
+
+	// recorded input steps the camera once per loop, so every
+	// loop draws rather than waiting for events
+	if (NULL != g_ReplayInputPath)
+	{
+		if (!g_ViewManager->ReplayInput(g_ReplayInputPath))
+		{
+			return(EXIT_FAILURE);
+		}
+		g_bContinuous = true;
+	}
+	else if (NULL != g_RecordInputPath)
+	{
+		if (!g_ViewManager->RecordInput(g_RecordInputPath))
+		{
+			return(EXIT_FAILURE);
+		}
+		g_bContinuous = true;
+	}
 
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
@@ -72,14 +161,146 @@ int main(int argc, char* argv[])
 		"../../Utilities/shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
+	// one worker per core besides this thread, which joins in
+	// while it waits on the frame's jobs
+	if (g_WorkerThreads < 0)
+	{
+		g_WorkerThreads = (int)std::thread::hardware_concurrency() - 1;
+	}
+	g_JobSystem = new JobSystem(g_WorkerThreads);
+
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager = CreateSceneManager(g_SceneFile);
 	g_SceneManager->PrepareScene();
 
+	// further scenes are loaded in the background on request
+	if (!g_SceneFiles.empty())
+	{
+		g_SceneFiles.insert(g_SceneFiles.begin(), g_SceneFile);
+		g_ScenePreloader = new ScenePreloader();
+		if (!g_ScenePreloader->Initialize(g_Window))
+		{
+			delete g_ScenePreloader;
+			g_ScenePreloader = NULL;
+		}
+	}
+
+	// an offline bake writes the lightmap file and exits
+	if (NULL != g_BakeLightmapPath)
+	{
+		bool bBaked = g_SceneManager->BakeLightmaps(g_BakeLightmapPath);
+		glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+		if (!bBaked)
+		{
+			std::cout << "ERROR: Lightmap bake failed" << std::endl;
+		}
+	}
+
+	// the scene is drawn offscreen and upscaled to the window
+	g_ResolutionScaler = new ResolutionScaler();
+	if (g_FrameBudget > 0.0f)
+	{
+		g_ResolutionScaler->SetFrameBudget(g_FrameBudget);
+	}
+
+	// the frame goes through the bloom and final pass instead of
+	// a plain upscale
+	if (g_bPostProcess)
+	{
+		g_PostProcessor = new PostProcessor();
+		if (g_PostProcessor->Initialize())
+		{
+			g_ResolutionScaler->SetPostProcessor(g_PostProcessor);
+			g_SceneManager->SetEmissiveScale(g_EmissiveScale);
+		}
+		else
+		{
+			delete g_PostProcessor;
+			g_PostProcessor = NULL;
+		}
+	}
+
+	// start recording the displayed frames if requested
+	g_FrameCapture = new FrameCapture();
+	if (NULL != g_CapturePath)
+	{
+		g_FrameCapture->Start(
+			g_CapturePath,
+			g_ViewManager->GetFramebufferWidth(),
+			g_ViewManager->GetFramebufferHeight(),
+			g_CaptureRate);
+	}
+
+	g_PerformanceHUD = new PerformanceHUD();
+
+	double lastTimingReport = glfwGetTime();
+	// the scene's copy of the window's views, reused every frame
+	std::vector<SceneManager::SCENE_VIEW> sceneViews;
+
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		// convert from 3D object space to 2D view
+		g_ViewManager->PrepareSceneView();
+
+		// load the next scene on N, and swap it in once loaded
+		UpdateSceneSwitch();
+
+		// pick up any saved edits to the scene file
+		g_SceneManager->CheckSceneFile();
+
+		// report the object under a left click
+		glm::vec3 pickOrigin;
+		glm::vec3 pickDirection;
+		if (g_ViewManager->TakePickRay(pickOrigin, pickDirection))
+		{
+			PickObject(pickOrigin, pickDirection);
+		}
+
+		// move the keyframed objects along, which keeps the scene
+		// redrawing while any are playing; a replay moves them by
+		// the recorded frame times
+		g_SceneManager->UpdateAnimations(g_ViewManager->GetFrameDelta());
+
+		// when neither the view nor the scene has changed, show the
+		// last frame again and sleep until an event arrives - a
+		// recording always draws so its frame rate stays steady
+		bool bRedraw = g_bContinuous ||
+			g_FrameCapture->IsCapturing() ||
+			g_ViewManager->HasViewChanged() ||
+			g_SceneManager->IsSceneDirty();
+		if (!bRedraw)
+		{
+			g_ResolutionScaler->Present();
+			if (g_ViewManager->IsHudVisible())
+			{
+				g_PerformanceHUD->Draw(
+					g_ViewManager->GetFramebufferWidth(),
+					g_ViewManager->GetFramebufferHeight());
+			}
+			glfwSwapBuffers(g_Window);
+			glfwWaitEventsTimeout((NULL != g_SceneFile) ? g_SceneWatchTimeout : g_IdleTimeout);
+			continue;
+		}
+
+		// bind the offscreen target, skipping the frame while the
+		// window is minimized
+		if (!g_ResolutionScaler->BeginFrame(
+			g_ViewManager->GetFramebufferWidth(),
+			g_ViewManager->GetFramebufferHeight()))
+		{
+			glfwWaitEvents();
+			continue;
+		}
+
+		// time the CPU side of the frame for the overlay
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+		// and count the heap allocations of this thread and the
+		// job workers, none once the frame arena and the reused
+		// buffers have grown to fit
+		size_t frameAllocations = AllocationCounter::GetTrackedCount();
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -87,12 +308,62 @@ int main(int argc, char* argv[])
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		// every view of the window is drawn from one scene update
+		const std::vector<ViewManager::VIEW_PANE>& panes = g_ViewManager->GetViewPanes();
+		sceneViews.resize(panes.size());
+		for (size_t i = 0; i < panes.size(); i++)
+		{
+			sceneViews[i].view = panes[i].view;
+			sceneViews[i].projection = panes[i].projection;
+			sceneViews[i].position = panes[i].position;
+			sceneViews[i].viewportRect = panes[i].viewportRect;
+		}
+		g_SceneManager->SetViews(sceneViews);
 
 		// refresh the 3D scene
+		g_JobSystem->BeginFrame();
 		g_SceneManager->RenderScene();
+		g_JobSystem->EndFrame();
+
+		float cpuMilliseconds = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - frameStart).count();
+		g_PerformanceHUD->AddFrame(
+			cpuMilliseconds,
+			g_ResolutionScaler->GetGPUTime(),
+			g_SceneManager->GetFrameStats());
+		if (NULL != g_PostProcessor)
+		{
+			g_PerformanceHUD->SetPostProcessTimes(
+				g_PostProcessor->GetBloomTime(),
+				g_PostProcessor->GetFinalTime());
+		}
+
+		if (g_bJobTimings && (glfwGetTime() - lastTimingReport >= g_JobTimingInterval))
+		{
+			g_JobSystem->PrintFrameTimings();
+			lastTimingReport = glfwGetTime();
+		}
 
+		// upscale the offscreen frame to the window
+		g_ResolutionScaler->EndFrame();
+
+		// queue an asynchronous readback of the finished frame
+		g_FrameCapture->CaptureFrame(
+			g_ViewManager->GetFramebufferWidth(),
+			g_ViewManager->GetFramebufferHeight());
+
+		g_PerformanceHUD->SetFrameMemory(
+			AllocationCounter::GetTrackedCount() - frameAllocations,
+			g_JobSystem->GetFrameArena().GetFrameBytes());
+
+		// the overlay goes on after the capture so it never shows
+		// in a recording
+		if (g_ViewManager->IsHudVisible())
+		{
+			g_PerformanceHUD->Draw(
+				g_ViewManager->GetFramebufferWidth(),
+				g_ViewManager->GetFramebufferHeight());
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
@@ -102,11 +373,42 @@ int main(int argc, char* argv[])
 	}
 
 	// clear the allocated manager objects from memory
+	if (NULL != g_PerformanceHUD)
+	{
+		delete g_PerformanceHUD;
+		g_PerformanceHUD = NULL;
+	}
+	if (NULL != g_FrameCapture)
+	{
+		g_FrameCapture->Stop();
+		delete g_FrameCapture;
+		g_FrameCapture = NULL;
+	}
+	if (NULL != g_ResolutionScaler)
+	{
+		delete g_ResolutionScaler;
+		g_ResolutionScaler = NULL;
+	}
+	if (NULL != g_PostProcessor)
+	{
+		delete g_PostProcessor;
+		g_PostProcessor = NULL;
+	}
+	if (NULL != g_ScenePreloader)
+	{
+		delete g_ScenePreloader;
+		g_ScenePreloader = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
 		g_SceneManager = NULL;
 	}
+	if (NULL != g_JobSystem)
+	{
+		delete g_JobSystem;
+		g_JobSystem = NULL;
+	}
 	if (NULL != g_ViewManager)
 	{
 		delete g_ViewManager;
@@ -174,4 +476,231 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
+}
+
+/***********************************************************
+ *	PickObject()
+ *
+ *  This function selects the object along a ray and prints
+ *  what it is made of.
+ ***********************************************************/
+void PickObject(glm::vec3 origin, glm::vec3 direction)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	SceneManager::PICK_RESULT pick;
+	bool bHit = g_SceneManager->PickObject(origin, direction, pick);
+	double elapsed = std::chrono::duration<double, std::micro>(
+		std::chrono::steady_clock::now() - startTime).count();
+
+	if (!bHit)
+	{
+		std::cout << "INFO: Picked nothing (" << elapsed << " us)" << std::endl;
+		return;
+	}
+	std::cout << "INFO: Picked " << pick.name
+		<< ", material " << (pick.materialTag.empty() ? "none" : pick.materialTag)
+		<< ", texture " << (pick.textureTag.empty() ? "none" : pick.textureTag)
+		<< ", at " << pick.position.x << " " << pick.position.y << " " << pick.position.z
+		<< ", distance " << pick.distance << " (" << elapsed << " us)" << std::endl;
+}
+
+/***********************************************************
+ *	CreateSceneManager()
+ *
+ *  This function creates a scene manager with the command
+ *  line options, ready to be prepared.
+ ***********************************************************/
+SceneManager* CreateSceneManager(const char* sceneFile)
+{
+	SceneManager* pScene = new SceneManager(g_ShaderManager);
+	pScene->SetJobSystem(g_JobSystem);
+	pScene->SetSceneFile(sceneFile);
+	pScene->SetAssetPack(g_AssetPack);
+	pScene->EnableGPUDrivenRendering(g_bGPUDriven);
+	pScene->EnableDepthPrePass(g_bDepthPrePass);
+	pScene->EnableCompactVertices(g_bCompactVertices);
+	pScene->EnableReflectionProbes(g_bReflectionProbes);
+	pScene->EnableTextureStreaming(g_TextureBudget);
+	pScene->SetSceneCopies(g_SceneCopies);
+	pScene->EnableAnimation(g_bAnimate);
+	pScene->SetEmissiveScale((NULL != g_PostProcessor) ? g_EmissiveScale : 1.0f);
+	pScene->SetLightmapFile(g_LightmapPath);
+	return(pScene);
+}
+
+/***********************************************************
+ *	UpdateSceneSwitch()
+ *
+ *  This function starts preloading the next scene when N is
+ *  pressed.  Once it has loaded, it is prepared and replaces
+ *  the current scene before anything of the frame is drawn,
+ *  and the replaced scene is freed over the next frames.
+ ***********************************************************/
+void UpdateSceneSwitch()
+{
+	if (NULL == g_ScenePreloader)
+	{
+		return;
+	}
+
+	if (g_ViewManager->TakeSceneSwitch() && !g_ScenePreloader->IsLoading())
+	{
+		int nextIndex = (g_SceneIndex + 1) % (int)g_SceneFiles.size();
+		const char* sceneFile = g_SceneFiles[nextIndex];
+		std::cout << "INFO: Loading scene " << ((NULL != sceneFile) ? sceneFile : "built-in") << std::endl;
+		g_ScenePreloader->StartLoading(CreateSceneManager(sceneFile));
+		g_SceneIndex = nextIndex;
+	}
+
+	SceneManager* pLoadedScene = g_ScenePreloader->TakeLoadedScene();
+	if (NULL != pLoadedScene)
+	{
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		pLoadedScene->PrepareScene();
+		pLoadedScene->ReplaceLights(*g_SceneManager);
+		g_ScenePreloader->RetireScene(g_SceneManager);
+		g_SceneManager = pLoadedScene;
+		g_SceneFile = g_SceneFiles[g_SceneIndex];
+
+		double elapsed = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - startTime).count();
+		std::cout << "INFO: Switched scenes, finishing the preloaded scene took " << elapsed << " ms" << std::endl;
+	}
+
+	g_ScenePreloader->ReleaseRetiredScenes();
+}
+
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function reads the optional command line switches.
+ *    --gpu-driven         cull and build draws on the GPU
+ *    --depth-prepass      draw opaque depth before shading
+ *    --compact-vertices   halve the vertex size on the GPU-driven
+ *                         path with quantized attributes
+ *    --reflection-probes  reflect the scene in glossy materials on
+ *                         the GPU-driven path
+ *    --post-process       add bloom, tone mapping, grading and
+ *                         anti-aliasing in one final pass
+ *    --multi-view         draw top and front orthographic views
+ *                         beside the camera view
+ *    --animate            play the keyframed tracks of the layout
+ *    --copies <n>         tile the scene layout n times
+ *    --texture-budget <mb> stream texture mipmaps in this budget
+ *    --frame-budget <ms>  GPU time the resolution scales to hold
+ *    --capture <file>     record to a .y4m stream or PNG frames
+ *    --capture-fps <n>    frame rate written to the Y4M header
+ *    --continuous         redraw every frame even when idle
+ *    --worker-threads <n> job threads besides the main thread
+ *    --job-timings        print the frame's job timings
+ *    --scene <file>       read and watch the scene layout file
+ *    --next-scene <file>  another layout N switches to, loaded
+ *                         in the background; may be repeated
+ *    --pack <file>        load the meshes, textures and layout
+ *                         from a baked asset pack
+ *    --record-input <file> record the camera input of the run
+ *    --replay-input <file> replay recorded camera input frame for
+ *                         frame, then exit
+ *    --lightmaps <file>   light the static objects from a baked
+ *                         lightmap file on the GPU-driven path
+ *    --bake-lightmaps <file> bake the static objects' lightmaps
+ *                         on every core, save them, then exit
+ ***********************************************************/
+void ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--gpu-driven") == 0)
+		{
+			g_bGPUDriven = true;
+		}
+		else if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			g_bDepthPrePass = true;
+		}
+		else if (strcmp(argv[i], "--compact-vertices") == 0)
+		{
+			g_bCompactVertices = true;
+		}
+		else if (strcmp(argv[i], "--reflection-probes") == 0)
+		{
+			g_bReflectionProbes = true;
+		}
+		else if (strcmp(argv[i], "--post-process") == 0)
+		{
+			g_bPostProcess = true;
+		}
+		else if (strcmp(argv[i], "--multi-view") == 0)
+		{
+			g_bMultiView = true;
+		}
+		else if (strcmp(argv[i], "--animate") == 0)
+		{
+			g_bAnimate = true;
+		}
+		else if ((strcmp(argv[i], "--texture-budget") == 0) && (i + 1 < argc))
+		{
+			g_TextureBudget = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--copies") == 0) && (i + 1 < argc))
+		{
+			g_SceneCopies = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--frame-budget") == 0) && (i + 1 < argc))
+		{
+			g_FrameBudget = (float)atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--capture") == 0) && (i + 1 < argc))
+		{
+			g_CapturePath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--capture-fps") == 0) && (i + 1 < argc))
+		{
+			g_CaptureRate = std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--continuous") == 0)
+		{
+			g_bContinuous = true;
+		}
+		else if ((strcmp(argv[i], "--worker-threads") == 0) && (i + 1 < argc))
+		{
+			g_WorkerThreads = std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--job-timings") == 0)
+		{
+			g_bJobTimings = true;
+		}
+		else if ((strcmp(argv[i], "--scene") == 0) && (i + 1 < argc))
+		{
+			g_SceneFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--next-scene") == 0) && (i + 1 < argc))
+		{
+			g_SceneFiles.push_back(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--pack") == 0) && (i + 1 < argc))
+		{
+			g_AssetPack = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--record-input") == 0) && (i + 1 < argc))
+		{
+			g_RecordInputPath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--replay-input") == 0) && (i + 1 < argc))
+		{
+			g_ReplayInputPath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--lightmaps") == 0) && (i + 1 < argc))
+		{
+			g_LightmapPath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--bake-lightmaps") == 0) && (i + 1 < argc))
+		{
+			g_BakeLightmapPath = argv[++i];
+		}
+		else
+		{
+			std::cout << "Ignoring unknown option: " << argv[i] << std::endl;
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,1220 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.cpp
+// ============
+// import triangle meshes from OBJ and glTF 2.0 files
+//
+//  The file is mapped rather than read, and the text or the binary
+//  buffers are parsed where they lie.  The result is optimized the
+//  same way for either format before it goes into the mesh pool.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+/***********************************************************
+ *  JSON_VALUE
+ *
+ *  One value of a JSON document.  Only what glTF needs is
+ *  kept: numbers as doubles and strings without unicode
+ *  escapes resolved.
+ ***********************************************************/
+struct MeshImporter::JSON_VALUE
+{
+	enum JSON_TYPE
+	{
+		JSON_NULL = 0,
+		JSON_BOOLEAN,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	JSON_TYPE type = JSON_NULL;
+	double number = 0.0;
+	std::string text;
+	std::vector<JSON_VALUE> items;
+	std::vector<std::pair<std::string, JSON_VALUE>> members;
+
+	// member of an object by key, NULL when missing
+	const JSON_VALUE* Find(const char* key) const
+	{
+		for (const std::pair<std::string, JSON_VALUE>& member : members)
+		{
+			if (member.first == key)
+				return &member.second;
+		}
+		return NULL;
+	}
+	// numeric member, or the default when missing
+	double GetNumber(const char* key, double defaultValue) const
+	{
+		const JSON_VALUE* pValue = Find(key);
+		return ((NULL != pValue) && (pValue->type == JSON_NUMBER)) ? pValue->number : defaultValue;
+	}
+	// item of a member array, NULL when missing
+	const JSON_VALUE* FindItem(const char* key, int index) const
+	{
+		const JSON_VALUE* pArray = Find(key);
+		if ((NULL == pArray) || (pArray->type != JSON_ARRAY) || (index < 0) || (index >= (int)pArray->items.size()))
+			return NULL;
+		return &pArray->items[index];
+	}
+};
+
+// declaration of global variables
+namespace
+{
+	// deepest nesting accepted in a JSON document or node tree
+	const int g_MaxDepth = 64;
+
+	// glTF constants
+	const uint32_t g_GlbMagic = 0x46546C67;
+	const uint32_t g_GlbJsonChunk = 0x4E4F534A;
+	const uint32_t g_GlbBinaryChunk = 0x004E4942;
+	const int g_GltfTriangles = 4;
+	const int g_GltfByte = 5120;
+	const int g_GltfUnsignedByte = 5121;
+	const int g_GltfShort = 5122;
+	const int g_GltfUnsignedShort = 5123;
+	const int g_GltfUnsignedInt = 5125;
+	const int g_GltfFloat = 5126;
+
+	/***********************************************************
+	 *  JsonParser
+	 *
+	 *  A recursive descent parser over the mapped text.
+	 ***********************************************************/
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* text, size_t size) : m_pText(text), m_pEnd(text + size) {}
+
+		bool Parse(MeshImporter::JSON_VALUE& value)
+		{
+			return ParseValue(value, 0) && (SkipSpaces() == m_pEnd);
+		}
+
+	private:
+		const char* m_pText;
+		const char* m_pEnd;
+
+		const char* SkipSpaces()
+		{
+			while ((m_pText < m_pEnd) && isspace((unsigned char)*m_pText))
+				m_pText++;
+			return m_pText;
+		}
+
+		bool Expect(char character)
+		{
+			if ((SkipSpaces() < m_pEnd) && (*m_pText == character))
+			{
+				m_pText++;
+				return true;
+			}
+			return false;
+		}
+
+		bool ParseString(std::string& text)
+		{
+			if (!Expect('"'))
+				return false;
+			while ((m_pText < m_pEnd) && (*m_pText != '"'))
+			{
+				char character = *m_pText++;
+				if ((character == '\\') && (m_pText < m_pEnd))
+				{
+					character = *m_pText++;
+					switch (character)
+					{
+					case 'n': character = '\n'; break;
+					case 't': character = '\t'; break;
+					case 'r': character = '\r'; break;
+					case 'b': character = '\b'; break;
+					case 'f': character = '\f'; break;
+					case 'u':
+						// glTF keys and URIs are plain ASCII, so the
+						// code point is skipped rather than encoded
+						m_pText = std::min(m_pText + 4, m_pEnd);
+						character = '?';
+						break;
+					default: break;
+					}
+				}
+				text.push_back(character);
+			}
+			return Expect('"');
+		}
+
+		bool ParseValue(MeshImporter::JSON_VALUE& value, int depth)
+		{
+			if ((depth > g_MaxDepth) || (SkipSpaces() == m_pEnd))
+				return false;
+
+			char character = *m_pText;
+			if (character == '{')
+			{
+				m_pText++;
+				value.type = MeshImporter::JSON_VALUE::JSON_OBJECT;
+				if (Expect('}'))
+					return true;
+				do
+				{
+					std::pair<std::string, MeshImporter::JSON_VALUE> member;
+					if (!ParseString(member.first) || !Expect(':') || !ParseValue(member.second, depth + 1))
+						return false;
+					value.members.push_back(std::move(member));
+				} while (Expect(','));
+				return Expect('}');
+			}
+			if (character == '[')
+			{
+				m_pText++;
+				value.type = MeshImporter::JSON_VALUE::JSON_ARRAY;
+				if (Expect(']'))
+					return true;
+				do
+				{
+					value.items.emplace_back();
+					if (!ParseValue(value.items.back(), depth + 1))
+						return false;
+				} while (Expect(','));
+				return Expect(']');
+			}
+			if (character == '"')
+			{
+				value.type = MeshImporter::JSON_VALUE::JSON_STRING;
+				return ParseString(value.text);
+			}
+			if ((character == '-') || isdigit((unsigned char)character))
+			{
+				// copy the number so that strtod cannot read past
+				// the end of the mapping
+				char number[64];
+				int length = 0;
+				while ((m_pText < m_pEnd) && (length < 63) &&
+					(isdigit((unsigned char)*m_pText) || strchr("+-.eE", *m_pText)))
+				{
+					number[length++] = *m_pText++;
+				}
+				number[length] = 0;
+				value.type = MeshImporter::JSON_VALUE::JSON_NUMBER;
+				value.number = strtod(number, NULL);
+				return true;
+			}
+
+			const char* const keywords[3] = { "true", "false", "null" };
+			for (int i = 0; i < 3; i++)
+			{
+				size_t length = strlen(keywords[i]);
+				if (((size_t)(m_pEnd - m_pText) >= length) && (strncmp(m_pText, keywords[i], length) == 0))
+				{
+					m_pText += length;
+					value.type = (i < 2) ? MeshImporter::JSON_VALUE::JSON_BOOLEAN : MeshImporter::JSON_VALUE::JSON_NULL;
+					value.number = (i == 0) ? 1.0 : 0.0;
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+
+	/***********************************************************
+	 *  SkipSpaces()
+	 *
+	 *  Move past blanks on the current line of an OBJ file.
+	 ***********************************************************/
+	const char* SkipSpaces(const char* p, const char* end)
+	{
+		while ((p < end) && ((*p == ' ') || (*p == '\t')))
+			p++;
+		return(p);
+	}
+
+	/***********************************************************
+	 *  ParseFloat()
+	 *
+	 *  Read a decimal number in place; the mapped text is not
+	 *  zero terminated, so the C library cannot be used.
+	 ***********************************************************/
+	bool ParseFloat(const char*& p, const char* end, float& value)
+	{
+		p = SkipSpaces(p, end);
+		const char* start = p;
+
+		double sign = 1.0;
+		if ((p < end) && ((*p == '-') || (*p == '+')))
+		{
+			sign = (*p == '-') ? -1.0 : 1.0;
+			p++;
+		}
+
+		double result = 0.0;
+		while ((p < end) && isdigit((unsigned char)*p))
+		{
+			result = result * 10.0 + (*p++ - '0');
+		}
+		if ((p < end) && (*p == '.'))
+		{
+			p++;
+			double scale = 0.1;
+			while ((p < end) && isdigit((unsigned char)*p))
+			{
+				result += (*p++ - '0') * scale;
+				scale *= 0.1;
+			}
+		}
+		if ((p < end) && ((*p == 'e') || (*p == 'E')))
+		{
+			p++;
+			int exponentSign = 1;
+			if ((p < end) && ((*p == '-') || (*p == '+')))
+			{
+				exponentSign = (*p == '-') ? -1 : 1;
+				p++;
+			}
+			int exponent = 0;
+			while ((p < end) && isdigit((unsigned char)*p))
+			{
+				exponent = std::min(exponent * 10 + (*p++ - '0'), 400);
+			}
+			result *= pow(10.0, exponentSign * exponent);
+		}
+
+		value = (float)(sign * result);
+		return(p > start);
+	}
+
+	/***********************************************************
+	 *  ParseIndex()
+	 *
+	 *  Read a signed OBJ index in place.
+	 ***********************************************************/
+	bool ParseIndex(const char*& p, const char* end, int& value)
+	{
+		int sign = 1;
+		if ((p < end) && (*p == '-'))
+		{
+			sign = -1;
+			p++;
+		}
+		const char* start = p;
+		int result = 0;
+		while ((p < end) && isdigit((unsigned char)*p))
+		{
+			result = result * 10 + (*p++ - '0');
+		}
+		value = sign * result;
+		return(p > start);
+	}
+
+	/***********************************************************
+	 *  ResolveObjIndex()
+	 *
+	 *  Turn a 1-based or negative, relative OBJ index into a
+	 *  0-based one, -1 when it is out of range.
+	 ***********************************************************/
+	int ResolveObjIndex(int index, int count)
+	{
+		int resolved = (index < 0) ? count + index : index - 1;
+		return(((resolved >= 0) && (resolved < count)) ? resolved : -1);
+	}
+
+	/***********************************************************
+	 *  DecodeBase64()
+	 *
+	 *  Decode the payload of a base64 data URI.
+	 ***********************************************************/
+	bool DecodeBase64(const std::string& text, size_t start, std::vector<unsigned char>& bytes)
+	{
+		unsigned int bits = 0;
+		int bitCount = 0;
+		for (size_t i = start; i < text.size(); i++)
+		{
+			char character = text[i];
+			int value;
+			if ((character >= 'A') && (character <= 'Z')) value = character - 'A';
+			else if ((character >= 'a') && (character <= 'z')) value = character - 'a' + 26;
+			else if ((character >= '0') && (character <= '9')) value = character - '0' + 52;
+			else if (character == '+') value = 62;
+			else if (character == '/') value = 63;
+			else if (character == '=') break;
+			else return(false);
+
+			bits = (bits << 6) | value;
+			bitCount += 6;
+			if (bitCount >= 8)
+			{
+				bitCount -= 8;
+				bytes.push_back((unsigned char)((bits >> bitCount) & 0xFF));
+			}
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  GenerateNormals()
+	 *
+	 *  Give the flagged vertices the area-weighted average of
+	 *  the faces around their position key, so that corners
+	 *  split only by texture coordinates still shade smoothly.
+	 ***********************************************************/
+	void GenerateNormals(
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		const std::vector<GLuint>& indices,
+		const std::vector<int>& positionKeys,
+		int keyCount,
+		size_t firstVertex,
+		size_t firstIndex)
+	{
+		std::vector<glm::vec3> normals(keyCount, glm::vec3(0.0f, 0.0f, 0.0f));
+		for (size_t i = firstIndex; i + 2 < indices.size(); i += 3)
+		{
+			const glm::vec3& p0 = vertices[indices[i]].position;
+			const glm::vec3& p1 = vertices[indices[i + 1]].position;
+			const glm::vec3& p2 = vertices[indices[i + 2]].position;
+			glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+			for (int k = 0; k < 3; k++)
+			{
+				int key = positionKeys[indices[i + k] - firstVertex];
+				if (key >= 0)
+					normals[key] += faceNormal;
+			}
+		}
+		for (size_t v = firstVertex; v < vertices.size(); v++)
+		{
+			int key = positionKeys[v - firstVertex];
+			if (key >= 0)
+			{
+				float length = glm::length(normals[key]);
+				vertices[v].normal = (length > 0.0f) ? normals[key] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  MeshImporter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshImporter::MeshImporter()
+{
+}
+
+/***********************************************************
+ *  ~MeshImporter()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshImporter::~MeshImporter()
+{
+	m_buffers.clear();
+	m_bufferFiles.clear();
+	m_decodedBuffers.clear();
+}
+
+/***********************************************************
+ *  Import()
+ *
+ *  This method maps the file, parses it by its extension
+ *  and optimizes the resulting mesh.
+ ***********************************************************/
+bool MeshImporter::Import(
+	const std::string& filename,
+	std::vector<MeshPool::MESH_VERTEX>& vertices,
+	std::vector<GLuint>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	m_filename = filename;
+
+	MappedFile file;
+	if (!file.Open(filename))
+	{
+		std::cout << "ERROR: Could not open mesh file: " << filename << std::endl;
+		return(false);
+	}
+
+	std::string extension = filename.substr(filename.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(),
+		[](unsigned char character) { return (char)tolower(character); });
+
+	bool bImported = false;
+	if (extension == "obj")
+	{
+		bImported = ImportObj(file, vertices, indices);
+	}
+	else if (extension == "gltf")
+	{
+		bImported = ImportGltf((const char*)file.GetData(), file.GetSize(), NULL, 0, vertices, indices);
+	}
+	else if (extension == "glb")
+	{
+		// a 12 byte header, then the JSON chunk and an optional
+		// binary chunk, each with an 8 byte header
+		const unsigned char* pData = file.GetData();
+		const size_t size = file.GetSize();
+		uint32_t header[3] = { 0, 0, 0 };
+		uint32_t chunk[2] = { 0, 0 };
+		if (size >= 20)
+		{
+			memcpy(header, pData, sizeof(header));
+			memcpy(chunk, pData + 12, sizeof(chunk));
+		}
+
+		if ((header[0] != g_GlbMagic) || (header[1] != 2) || (header[2] > size) ||
+			(chunk[1] != g_GlbJsonChunk) || (chunk[0] > size - 20))
+		{
+			std::cout << "ERROR: " << filename << " is not a glTF 2.0 binary file" << std::endl;
+		}
+		else
+		{
+			const char* json = (const char*)pData + 20;
+			size_t jsonSize = chunk[0];
+			size_t binaryStart = 20 + ((jsonSize + 3) & ~(size_t)3);
+			const unsigned char* binaryChunk = NULL;
+			size_t binarySize = 0;
+			if (binaryStart + 8 <= size)
+			{
+				memcpy(chunk, pData + binaryStart, sizeof(chunk));
+				if ((chunk[1] == g_GlbBinaryChunk) && (chunk[0] <= size - binaryStart - 8))
+				{
+					binaryChunk = pData + binaryStart + 8;
+					binarySize = chunk[0];
+				}
+			}
+			bImported = ImportGltf(json, jsonSize, binaryChunk, binarySize, vertices, indices);
+		}
+	}
+	else
+	{
+		std::cout << "ERROR: " << filename << " is not an .obj, .gltf or .glb file" << std::endl;
+	}
+
+	m_buffers.clear();
+	m_bufferFiles.clear();
+	m_decodedBuffers.clear();
+
+	if (!bImported || indices.empty())
+	{
+		if (bImported)
+		{
+			std::cout << "ERROR: " << filename << " has no triangles" << std::endl;
+		}
+		vertices.clear();
+		indices.clear();
+		return(false);
+	}
+
+	const size_t cornerCount = vertices.size();
+	const float missesBefore = MeshOptimizer::AnalyzeVertexCache(indices, (int)vertices.size(), 16);
+	MeshOptimizer::Optimize(vertices, indices);
+	const float missesAfter = MeshOptimizer::AnalyzeVertexCache(indices, (int)vertices.size(), 16);
+
+	std::cout << "INFO: Imported " << filename << ", " << vertices.size() << " vertices (from "
+		<< cornerCount << "), " << indices.size() / 3 << " triangles, cache misses per triangle "
+		<< missesBefore << " -> " << missesAfter << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  ImportObj()
+ *
+ *  This method reads the v, vt, vn and f lines of an OBJ
+ *  file.  Polygons are split into fans, every face corner
+ *  becomes its own vertex for the optimizer to merge, and
+ *  corners without a normal get a smooth generated one.
+ ***********************************************************/
+bool MeshImporter::ImportObj(
+	const MappedFile& file,
+	std::vector<MeshPool::MESH_VERTEX>& vertices,
+	std::vector<GLuint>& indices)
+{
+	const char* p = (const char*)file.GetData();
+	const char* end = p + file.GetSize();
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::vec3> normals;
+	// position of each corner needing a generated normal, or -1
+	std::vector<int> positionKeys;
+	bool bMissingNormals = false;
+	int lineNumber = 0;
+
+	while (p < end)
+	{
+		lineNumber++;
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (NULL == lineEnd)
+		{
+			lineEnd = end;
+		}
+
+		p = SkipSpaces(p, lineEnd);
+		bool bValid = true;
+		if ((lineEnd - p >= 2) && (p[0] == 'v') && (p[1] == ' ' || p[1] == '\t'))
+		{
+			glm::vec3 position;
+			p += 2;
+			bValid = ParseFloat(p, lineEnd, position.x) && ParseFloat(p, lineEnd, position.y) && ParseFloat(p, lineEnd, position.z);
+			positions.push_back(position);
+		}
+		else if ((lineEnd - p >= 3) && (p[0] == 'v') && (p[1] == 't') && (p[2] == ' ' || p[2] == '\t'))
+		{
+			glm::vec2 texCoord;
+			p += 3;
+			bValid = ParseFloat(p, lineEnd, texCoord.x);
+			// the V coordinate is optional in 1D texture maps
+			if (!ParseFloat(p, lineEnd, texCoord.y))
+			{
+				texCoord.y = 0.0f;
+			}
+			texCoords.push_back(texCoord);
+		}
+		else if ((lineEnd - p >= 3) && (p[0] == 'v') && (p[1] == 'n') && (p[2] == ' ' || p[2] == '\t'))
+		{
+			glm::vec3 normal;
+			p += 3;
+			bValid = ParseFloat(p, lineEnd, normal.x) && ParseFloat(p, lineEnd, normal.y) && ParseFloat(p, lineEnd, normal.z);
+			float length = glm::length(normal);
+			normals.push_back((length > 0.0f) ? normal / length : normal);
+		}
+		else if ((lineEnd - p >= 2) && (p[0] == 'f') && (p[1] == ' ' || p[1] == '\t'))
+		{
+			p += 2;
+			GLuint firstCorner = (GLuint)vertices.size();
+			int cornerCount = 0;
+
+			while (bValid && (SkipSpaces(p, lineEnd) < lineEnd) && !isspace((unsigned char)*SkipSpaces(p, lineEnd)))
+			{
+				p = SkipSpaces(p, lineEnd);
+				int positionIndex = 0;
+				int texCoordIndex = 0;
+				int normalIndex = 0;
+				bValid = ParseIndex(p, lineEnd, positionIndex);
+				if (bValid && (p < lineEnd) && (*p == '/'))
+				{
+					p++;
+					if ((p < lineEnd) && (*p != '/'))
+						bValid = ParseIndex(p, lineEnd, texCoordIndex);
+					if (bValid && (p < lineEnd) && (*p == '/'))
+					{
+						p++;
+						bValid = ParseIndex(p, lineEnd, normalIndex);
+					}
+				}
+
+				int position = ResolveObjIndex(positionIndex, (int)positions.size());
+				int texCoord = (texCoordIndex != 0) ? ResolveObjIndex(texCoordIndex, (int)texCoords.size()) : -1;
+				int normal = (normalIndex != 0) ? ResolveObjIndex(normalIndex, (int)normals.size()) : -1;
+				if (!bValid || (position < 0) || ((texCoordIndex != 0) && (texCoord < 0)) || ((normalIndex != 0) && (normal < 0)))
+				{
+					bValid = false;
+					break;
+				}
+
+				MeshPool::MESH_VERTEX vertex;
+				vertex.position = positions[position];
+				vertex.texCoord = (texCoord >= 0) ? texCoords[texCoord] : glm::vec2(0.0f, 0.0f);
+				vertex.normal = (normal >= 0) ? normals[normal] : glm::vec3(0.0f, 0.0f, 0.0f);
+				vertices.push_back(vertex);
+				positionKeys.push_back((normal >= 0) ? -1 : position);
+				bMissingNormals = bMissingNormals || (normal < 0);
+
+				// fan out from the first corner
+				cornerCount++;
+				if (cornerCount >= 3)
+				{
+					GLuint corner = (GLuint)vertices.size() - 1;
+					indices.insert(indices.end(), { firstCorner, corner - 1, corner });
+				}
+			}
+			bValid = bValid && (cornerCount >= 3);
+		}
+		// groups, objects, materials and smoothing groups do not
+		// change the geometry and are skipped with comments
+
+		if (!bValid)
+		{
+			std::cout << "ERROR: " << m_filename << "(" << lineNumber << "): bad or missing value" << std::endl;
+			return(false);
+		}
+		p = lineEnd + ((lineEnd < end) ? 1 : 0);
+	}
+
+	if (bMissingNormals)
+	{
+		GenerateNormals(vertices, indices, positionKeys, (int)positions.size(), 0, 0);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  ImportGltf()
+ *
+ *  This method parses the glTF JSON, maps the buffers it
+ *  refers to, and appends every triangle primitive of the
+ *  default scene with its node transform applied.
+ ***********************************************************/
+bool MeshImporter::ImportGltf(
+	const char* json,
+	size_t jsonSize,
+	const unsigned char* binaryChunk,
+	size_t binarySize,
+	std::vector<MeshPool::MESH_VERTEX>& vertices,
+	std::vector<GLuint>& indices)
+{
+	JSON_VALUE document;
+	JsonParser parser(json, jsonSize);
+	if (!parser.Parse(document) || (document.type != JSON_VALUE::JSON_OBJECT))
+	{
+		std::cout << "ERROR: " << m_filename << " has malformed glTF JSON" << std::endl;
+		return(false);
+	}
+
+	const JSON_VALUE* pAsset = document.Find("asset");
+	const JSON_VALUE* pVersion = (NULL != pAsset) ? pAsset->Find("version") : NULL;
+	if ((NULL == pVersion) || (pVersion->text.compare(0, 2, "2.") != 0))
+	{
+		std::cout << "ERROR: " << m_filename << " is not glTF 2.0" << std::endl;
+		return(false);
+	}
+
+	if (!LoadGltfBuffers(document, binaryChunk, binarySize))
+	{
+		return(false);
+	}
+
+	// the meshes to draw, each with its world transform
+	std::vector<std::pair<int, glm::mat4>> meshInstances;
+	const JSON_VALUE* pNodes = document.Find("nodes");
+	const int nodeCount = (NULL != pNodes) ? (int)pNodes->items.size() : 0;
+	const JSON_VALUE* pScene = document.FindItem("scenes", (int)document.GetNumber("scene", 0.0));
+	if ((NULL != pScene) && (NULL != pScene->Find("nodes")))
+	{
+		for (const JSON_VALUE& root : pScene->Find("nodes")->items)
+		{
+			CollectGltfNode(document, (int)root.number, glm::mat4(1.0f), 0, meshInstances);
+		}
+	}
+	else if (nodeCount > 0)
+	{
+		// without a scene every node that is not a child is a root
+		std::vector<unsigned char> bChild(nodeCount, 0);
+		for (const JSON_VALUE& node : pNodes->items)
+		{
+			const JSON_VALUE* pChildren = node.Find("children");
+			for (size_t i = 0; (NULL != pChildren) && (i < pChildren->items.size()); i++)
+			{
+				int child = (int)pChildren->items[i].number;
+				if ((child >= 0) && (child < nodeCount))
+					bChild[child] = 1;
+			}
+		}
+		for (int i = 0; i < nodeCount; i++)
+		{
+			if (!bChild[i])
+				CollectGltfNode(document, i, glm::mat4(1.0f), 0, meshInstances);
+		}
+	}
+	else
+	{
+		const JSON_VALUE* pMeshes = document.Find("meshes");
+		for (size_t i = 0; (NULL != pMeshes) && (i < pMeshes->items.size()); i++)
+		{
+			meshInstances.push_back(std::make_pair((int)i, glm::mat4(1.0f)));
+		}
+	}
+
+	for (const std::pair<int, glm::mat4>& instance : meshInstances)
+	{
+		if (!AppendGltfMesh(document, instance.first, instance.second, vertices, indices))
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  LoadGltfBuffers()
+ *
+ *  This method finds the bytes of every buffer: the binary
+ *  chunk of a .glb, a file next to the model, which is
+ *  mapped as well, or a base64 data URI.
+ ***********************************************************/
+bool MeshImporter::LoadGltfBuffers(
+	const JSON_VALUE& document,
+	const unsigned char* binaryChunk,
+	size_t binarySize)
+{
+	const JSON_VALUE* pBuffers = document.Find("buffers");
+	if (NULL == pBuffers)
+	{
+		return(true);
+	}
+
+	const size_t slash = m_filename.find_last_of("/\\");
+	const std::string directory = (slash == std::string::npos) ? "" : m_filename.substr(0, slash + 1);
+
+	for (size_t i = 0; i < pBuffers->items.size(); i++)
+	{
+		const JSON_VALUE& buffer = pBuffers->items[i];
+		const JSON_VALUE* pUri = buffer.Find("uri");
+		const size_t byteLength = (size_t)buffer.GetNumber("byteLength", 0.0);
+		GLTF_BUFFER loaded = { NULL, 0 };
+
+		if (NULL == pUri)
+		{
+			loaded.pData = binaryChunk;
+			loaded.size = binarySize;
+		}
+		else if (pUri->text.compare(0, 5, "data:") == 0)
+		{
+			size_t payload = pUri->text.find(";base64,");
+			m_decodedBuffers.emplace_back();
+			if ((payload != std::string::npos) && DecodeBase64(pUri->text, payload + 8, m_decodedBuffers.back()))
+			{
+				loaded.pData = m_decodedBuffers.back().data();
+				loaded.size = m_decodedBuffers.back().size();
+			}
+		}
+		else
+		{
+			// undo the percent encoding of the relative path
+			std::string path = directory;
+			for (size_t c = 0; c < pUri->text.size(); c++)
+			{
+				if ((pUri->text[c] == '%') && (c + 2 < pUri->text.size()))
+				{
+					path.push_back((char)strtol(pUri->text.substr(c + 1, 2).c_str(), NULL, 16));
+					c += 2;
+				}
+				else
+				{
+					path.push_back(pUri->text[c]);
+				}
+			}
+
+			m_bufferFiles.emplace_back(new MappedFile());
+			if (m_bufferFiles.back()->Open(path))
+			{
+				loaded.pData = m_bufferFiles.back()->GetData();
+				loaded.size = m_bufferFiles.back()->GetSize();
+			}
+		}
+
+		if ((NULL == loaded.pData) || (loaded.size < byteLength))
+		{
+			std::cout << "ERROR: " << m_filename << " buffer " << i << " is missing or too short" << std::endl;
+			return(false);
+		}
+		loaded.size = byteLength;
+		m_buffers.push_back(loaded);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  CollectGltfNode()
+ *
+ *  This method walks a node and its children, combining
+ *  their transforms, and lists the meshes they place.
+ ***********************************************************/
+void MeshImporter::CollectGltfNode(
+	const JSON_VALUE& document,
+	int nodeIndex,
+	const glm::mat4& parentTransform,
+	int depth,
+	std::vector<std::pair<int, glm::mat4>>& meshInstances)
+{
+	const JSON_VALUE* pNode = document.FindItem("nodes", nodeIndex);
+	if ((NULL == pNode) || (depth > g_MaxDepth))
+	{
+		return;
+	}
+
+	glm::mat4 local(1.0f);
+	const JSON_VALUE* pMatrix = pNode->Find("matrix");
+	if ((NULL != pMatrix) && (pMatrix->items.size() == 16))
+	{
+		// stored column by column, as glm keeps it
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				local[column][row] = (float)pMatrix->items[column * 4 + row].number;
+			}
+		}
+	}
+	else
+	{
+		const JSON_VALUE* pTranslation = pNode->Find("translation");
+		const JSON_VALUE* pRotation = pNode->Find("rotation");
+		const JSON_VALUE* pScale = pNode->Find("scale");
+		glm::vec3 translation(0.0f, 0.0f, 0.0f);
+		glm::vec3 scale(1.0f, 1.0f, 1.0f);
+		float x = 0.0f, y = 0.0f, z = 0.0f, w = 1.0f;
+		if ((NULL != pTranslation) && (pTranslation->items.size() == 3))
+			translation = glm::vec3((float)pTranslation->items[0].number, (float)pTranslation->items[1].number, (float)pTranslation->items[2].number);
+		if ((NULL != pScale) && (pScale->items.size() == 3))
+			scale = glm::vec3((float)pScale->items[0].number, (float)pScale->items[1].number, (float)pScale->items[2].number);
+		if ((NULL != pRotation) && (pRotation->items.size() == 4))
+		{
+			x = (float)pRotation->items[0].number;
+			y = (float)pRotation->items[1].number;
+			z = (float)pRotation->items[2].number;
+			w = (float)pRotation->items[3].number;
+		}
+
+		// translation * rotation * scale, with the rotation
+		// matrix written out from the unit quaternion
+		glm::mat4 rotation(1.0f);
+		rotation[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f);
+		rotation[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f);
+		rotation[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f);
+		local = rotation;
+		local[0] *= scale.x;
+		local[1] *= scale.y;
+		local[2] *= scale.z;
+		local[3] = glm::vec4(translation, 1.0f);
+	}
+
+	glm::mat4 transform = parentTransform * local;
+	const JSON_VALUE* pMesh = pNode->Find("mesh");
+	if (NULL != pMesh)
+	{
+		meshInstances.push_back(std::make_pair((int)pMesh->number, transform));
+	}
+
+	const JSON_VALUE* pChildren = pNode->Find("children");
+	for (size_t i = 0; (NULL != pChildren) && (i < pChildren->items.size()); i++)
+	{
+		CollectGltfNode(document, (int)pChildren->items[i].number, transform, depth + 1, meshInstances);
+	}
+}
+
+/***********************************************************
+ *  AppendGltfMesh()
+ *
+ *  This method appends the triangle primitives of a mesh.
+ *  Positions and normals go to world space, a mirroring
+ *  transform has its triangles turned back around, and V
+ *  is flipped from glTF's top-left texture origin.
+ ***********************************************************/
+bool MeshImporter::AppendGltfMesh(
+	const JSON_VALUE& document,
+	int meshIndex,
+	const glm::mat4& transform,
+	std::vector<MeshPool::MESH_VERTEX>& vertices,
+	std::vector<GLuint>& indices)
+{
+	const JSON_VALUE* pMesh = document.FindItem("meshes", meshIndex);
+	const JSON_VALUE* pPrimitives = (NULL != pMesh) ? pMesh->Find("primitives") : NULL;
+	if (NULL == pPrimitives)
+	{
+		std::cout << "ERROR: " << m_filename << " refers to missing mesh " << meshIndex << std::endl;
+		return(false);
+	}
+
+	const glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+	const bool bMirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+
+	for (const JSON_VALUE& primitive : pPrimitives->items)
+	{
+		if ((int)primitive.GetNumber("mode", g_GltfTriangles) != g_GltfTriangles)
+		{
+			std::cout << "INFO: " << m_filename << " skipping a primitive that is not a triangle list" << std::endl;
+			continue;
+		}
+
+		const JSON_VALUE* pAttributes = primitive.Find("attributes");
+		const JSON_VALUE* pPosition = (NULL != pAttributes) ? pAttributes->Find("POSITION") : NULL;
+		const JSON_VALUE* pNormal = (NULL != pAttributes) ? pAttributes->Find("NORMAL") : NULL;
+		const JSON_VALUE* pTexCoord = (NULL != pAttributes) ? pAttributes->Find("TEXCOORD_0") : NULL;
+		if (NULL == pPosition)
+		{
+			continue;
+		}
+
+		std::vector<float> positions;
+		std::vector<float> normals;
+		std::vector<float> texCoords;
+		const int vertexCount = ReadGltfAccessor(document, (int)pPosition->number, 3, positions);
+		bool bValid = (vertexCount >= 0);
+		if (bValid && (NULL != pNormal))
+			bValid = (ReadGltfAccessor(document, (int)pNormal->number, 3, normals) == vertexCount);
+		if (bValid && (NULL != pTexCoord))
+			bValid = (ReadGltfAccessor(document, (int)pTexCoord->number, 2, texCoords) == vertexCount);
+
+		std::vector<GLuint> primitiveIndices;
+		const JSON_VALUE* pIndices = primitive.Find("indices");
+		if (bValid && (NULL != pIndices))
+		{
+			bValid = (ReadGltfIndices(document, (int)pIndices->number, primitiveIndices) >= 0);
+		}
+		else
+		{
+			for (int i = 0; i < vertexCount; i++)
+				primitiveIndices.push_back(i);
+		}
+		for (size_t i = 0; bValid && (i < primitiveIndices.size()); i++)
+		{
+			bValid = (primitiveIndices[i] < (GLuint)vertexCount);
+		}
+		if (!bValid)
+		{
+			std::cout << "ERROR: " << m_filename << " has an invalid accessor in mesh " << meshIndex << std::endl;
+			return(false);
+		}
+
+		const size_t firstVertex = vertices.size();
+		const size_t firstIndex = indices.size();
+		for (int i = 0; i < vertexCount; i++)
+		{
+			MeshPool::MESH_VERTEX vertex;
+			glm::vec4 position = transform * glm::vec4(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 1.0f);
+			vertex.position = glm::vec3(position);
+			vertex.normal = glm::vec3(0.0f, 0.0f, 0.0f);
+			if (!normals.empty())
+			{
+				glm::vec3 normal = normalTransform * glm::vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+				float length = glm::length(normal);
+				vertex.normal = (length > 0.0f) ? normal / length : normal;
+			}
+			vertex.texCoord = texCoords.empty() ? glm::vec2(0.0f, 0.0f) : glm::vec2(texCoords[i * 2], 1.0f - texCoords[i * 2 + 1]);
+			vertices.push_back(vertex);
+		}
+
+		for (size_t i = 0; i + 2 < primitiveIndices.size(); i += 3)
+		{
+			GLuint a = (GLuint)firstVertex + primitiveIndices[i];
+			GLuint b = (GLuint)firstVertex + primitiveIndices[i + 1];
+			GLuint c = (GLuint)firstVertex + primitiveIndices[i + 2];
+			if (bMirrored)
+				indices.insert(indices.end(), { a, c, b });
+			else
+				indices.insert(indices.end(), { a, b, c });
+		}
+
+		// without normals, the triangles sharing an index are
+		// smoothed together as in the OBJ path
+		if (normals.empty())
+		{
+			std::vector<int> positionKeys(vertexCount);
+			for (int i = 0; i < vertexCount; i++)
+				positionKeys[i] = i;
+			GenerateNormals(vertices, indices, positionKeys, vertexCount, firstVertex, firstIndex);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  FindGltfAccessorData()
+ *
+ *  This method resolves an accessor to its first element
+ *  in the buffer and checks that the last element fits in
+ *  the buffer view.  Sparse accessors are not supported.
+ ***********************************************************/
+bool MeshImporter::FindGltfAccessorData(
+	const JSON_VALUE& document,
+	int accessorIndex,
+	const unsigned char*& pData,
+	int& count,
+	int& componentType,
+	int& components,
+	bool& bNormalized,
+	size_t& stride)
+{
+	const JSON_VALUE* pAccessor = document.FindItem("accessors", accessorIndex);
+	if ((NULL == pAccessor) || (NULL != pAccessor->Find("sparse")))
+	{
+		return(false);
+	}
+
+	const JSON_VALUE* pType = pAccessor->Find("type");
+	const char* const typeNames[4] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+	components = 0;
+	for (int i = 0; (NULL != pType) && (i < 4); i++)
+	{
+		if (pType->text == typeNames[i])
+			components = i + 1;
+	}
+
+	count = (int)pAccessor->GetNumber("count", -1.0);
+	componentType = (int)pAccessor->GetNumber("componentType", 0.0);
+	const JSON_VALUE* pNormalized = pAccessor->Find("normalized");
+	bNormalized = (NULL != pNormalized) && (pNormalized->number != 0.0);
+
+	size_t componentSize = 0;
+	switch (componentType)
+	{
+	case g_GltfByte:
+	case g_GltfUnsignedByte:
+		componentSize = 1;
+		break;
+	case g_GltfShort:
+	case g_GltfUnsignedShort:
+		componentSize = 2;
+		break;
+	case g_GltfUnsignedInt:
+	case g_GltfFloat:
+		componentSize = 4;
+		break;
+	default:
+		break;
+	}
+
+	const JSON_VALUE* pView = document.FindItem("bufferViews", (int)pAccessor->GetNumber("bufferView", -1.0));
+	if ((components == 0) || (count < 0) || (componentSize == 0) || (NULL == pView))
+	{
+		return(false);
+	}
+
+	const int bufferIndex = (int)pView->GetNumber("buffer", -1.0);
+	const size_t viewOffset = (size_t)pView->GetNumber("byteOffset", 0.0);
+	const size_t viewLength = (size_t)pView->GetNumber("byteLength", 0.0);
+	const size_t elementSize = componentSize * components;
+	const size_t accessorOffset = (size_t)pAccessor->GetNumber("byteOffset", 0.0);
+	stride = (size_t)pView->GetNumber("byteStride", 0.0);
+	if (stride == 0)
+	{
+		stride = elementSize;
+	}
+
+	if ((bufferIndex < 0) || (bufferIndex >= (int)m_buffers.size()) ||
+		(viewOffset > m_buffers[bufferIndex].size) || (viewLength > m_buffers[bufferIndex].size - viewOffset) ||
+		((count > 0) && (accessorOffset + stride * (count - 1) + elementSize > viewLength)))
+	{
+		return(false);
+	}
+
+	pData = m_buffers[bufferIndex].pData + viewOffset + accessorOffset;
+	return(true);
+}
+
+/***********************************************************
+ *  ReadGltfAccessor()
+ *
+ *  This method reads an accessor with the passed in number
+ *  of components per element, straight from its buffer.
+ ***********************************************************/
+int MeshImporter::ReadGltfAccessor(
+	const JSON_VALUE& document,
+	int accessorIndex,
+	int components,
+	std::vector<float>& values)
+{
+	const unsigned char* pData = NULL;
+	int count = 0;
+	int componentType = 0;
+	int accessorComponents = 0;
+	bool bNormalized = false;
+	size_t stride = 0;
+	if (!FindGltfAccessorData(document, accessorIndex, pData, count, componentType, accessorComponents, bNormalized, stride) ||
+		(accessorComponents < components))
+	{
+		return(-1);
+	}
+
+	values.resize((size_t)count * components);
+	for (int i = 0; i < count; i++)
+	{
+		const unsigned char* pElement = pData + stride * i;
+		for (int c = 0; c < components; c++)
+		{
+			float value = 0.0f;
+			switch (componentType)
+			{
+			case g_GltfFloat:
+				memcpy(&value, pElement + c * 4, 4);
+				break;
+			case g_GltfUnsignedByte:
+				value = bNormalized ? pElement[c] / 255.0f : pElement[c];
+				break;
+			case g_GltfByte:
+				value = bNormalized ? std::max(((int8_t)pElement[c]) / 127.0f, -1.0f) : (int8_t)pElement[c];
+				break;
+			case g_GltfUnsignedShort:
+			{
+				uint16_t component;
+				memcpy(&component, pElement + c * 2, 2);
+				value = bNormalized ? component / 65535.0f : component;
+				break;
+			}
+			case g_GltfShort:
+			{
+				int16_t component;
+				memcpy(&component, pElement + c * 2, 2);
+				value = bNormalized ? std::max(component / 32767.0f, -1.0f) : component;
+				break;
+			}
+			default:
+				return(-1);
+			}
+			values[(size_t)i * components + c] = value;
+		}
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  ReadGltfIndices()
+ *
+ *  This method reads an index accessor of any unsigned
+ *  integer size.
+ ***********************************************************/
+int MeshImporter::ReadGltfIndices(
+	const JSON_VALUE& document,
+	int accessorIndex,
+	std::vector<GLuint>& values)
+{
+	const unsigned char* pData = NULL;
+	int count = 0;
+	int componentType = 0;
+	int components = 0;
+	bool bNormalized = false;
+	size_t stride = 0;
+	if (!FindGltfAccessorData(document, accessorIndex, pData, count, componentType, components, bNormalized, stride) ||
+		(components != 1))
+	{
+		return(-1);
+	}
+
+	values.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		const unsigned char* pElement = pData + stride * i;
+		if (componentType == g_GltfUnsignedByte)
+		{
+			values[i] = pElement[0];
+		}
+		else if (componentType == g_GltfUnsignedShort)
+		{
+			uint16_t index;
+			memcpy(&index, pElement, 2);
+			values[i] = index;
+		}
+		else if (componentType == g_GltfUnsignedInt)
+		{
+			uint32_t index;
+			memcpy(&index, pElement, 4);
+			values[i] = index;
+		}
+		else
+		{
+			return(-1);
+		}
+	}
+	return(count);
+}
@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.h
+// ============
+// import triangle meshes from OBJ and glTF 2.0 files
+//
+//  The file is mapped rather than read, and the text or the binary
+//  buffers are parsed where they lie.  The result is optimized the
+//  same way for either format before it goes into the mesh pool.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+#include "MeshPool.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  MeshImporter
+ *
+ *  This class turns one .obj, .gltf or .glb file into a
+ *  single indexed triangle mesh.  A glTF scene is flattened
+ *  with every node's transform applied.  Texture coordinates
+ *  follow the pool's convention of V pointing up, to match
+ *  the vertically flipped texture images.
+ ***********************************************************/
+class MeshImporter
+{
+public:
+	// constructor
+	MeshImporter();
+	// destructor
+	~MeshImporter();
+
+	// read the file into an optimized mesh, false on an error
+	bool Import(
+		const std::string& filename,
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices);
+
+	// parsed glTF JSON value, defined with the parser
+	struct JSON_VALUE;
+
+private:
+
+	// one glTF buffer, either inside a mapped file or decoded
+	// from a data URI
+	struct GLTF_BUFFER
+	{
+		const unsigned char* pData;
+		size_t size;
+	};
+
+	std::string m_filename;
+	std::vector<GLTF_BUFFER> m_buffers;
+	std::vector<std::unique_ptr<MappedFile>> m_bufferFiles;
+	std::vector<std::vector<unsigned char>> m_decodedBuffers;
+
+	bool ImportObj(
+		const MappedFile& file,
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices);
+	bool ImportGltf(
+		const char* json,
+		size_t jsonSize,
+		const unsigned char* binaryChunk,
+		size_t binarySize,
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices);
+
+	// glTF helpers
+	bool LoadGltfBuffers(
+		const JSON_VALUE& document,
+		const unsigned char* binaryChunk,
+		size_t binarySize);
+	void CollectGltfNode(
+		const JSON_VALUE& document,
+		int nodeIndex,
+		const glm::mat4& parentTransform,
+		int depth,
+		std::vector<std::pair<int, glm::mat4>>& meshInstances);
+	bool AppendGltfMesh(
+		const JSON_VALUE& document,
+		int meshIndex,
+		const glm::mat4& transform,
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices);
+	// read an accessor as floats, expanding or normalizing the
+	// components; returns the element count, or -1 on an error
+	int ReadGltfAccessor(
+		const JSON_VALUE& document,
+		int accessorIndex,
+		int components,
+		std::vector<float>& values);
+	int ReadGltfIndices(
+		const JSON_VALUE& document,
+		int accessorIndex,
+		std::vector<GLuint>& values);
+	// locate an accessor's data inside its buffer
+	bool FindGltfAccessorData(
+		const JSON_VALUE& document,
+		int accessorIndex,
+		const unsigned char*& pData,
+		int& count,
+		int& componentType,
+		int& components,
+		bool& bNormalized,
+		size_t& stride);
+};
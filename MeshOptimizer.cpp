@@ -0,0 +1,449 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.cpp
+// ============
+// reorder mesh triangles and vertices for faster drawing
+//
+//  Imported meshes come in whatever order the modeling tool wrote
+//  them.  These passes merge duplicate vertices, order the triangles
+//  for the post-transform vertex cache and for early depth rejection,
+//  and lay the vertices out in the order the triangles fetch them.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// declaration of global variables
+namespace
+{
+	// vertex cache modeled by the triangle ordering, and the
+	// scoring constants from Forsyth's paper
+	const int g_ModeledCacheSize = 32;
+	const float g_CacheDecayPower = 1.5f;
+	const float g_LastTriangleScore = 0.75f;
+	const float g_ValenceBoostScale = 2.0f;
+	const float g_ValenceBoostPower = 0.5f;
+
+	// FIFO cache size used to find where the overdraw pass may cut
+	// the triangle order without costing extra cache misses
+	const int g_ClusterCacheSize = 16;
+
+	/***********************************************************
+	 *  VertexScore()
+	 *
+	 *  Score a vertex by how recently it entered the cache and
+	 *  how many triangles still use it, so that triangles in
+	 *  the cache and lone remaining triangles go first.
+	 ***********************************************************/
+	float VertexScore(int cachePosition, int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			return(-1.0f);
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// the last triangle's vertices get a fixed score so
+				// the order does not favor reusing them over and over
+				score = g_LastTriangleScore;
+			}
+			else
+			{
+				float scale = 1.0f / (g_ModeledCacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scale, g_CacheDecayPower);
+			}
+		}
+
+		score += g_ValenceBoostScale * powf((float)remainingTriangles, -g_ValenceBoostPower);
+		return(score);
+	}
+
+	/***********************************************************
+	 *  VertexHash
+	 *
+	 *  Hash and compare mesh vertices bit for bit.
+	 ***********************************************************/
+	struct VertexHash
+	{
+		size_t operator()(const MeshPool::MESH_VERTEX& vertex) const
+		{
+			const unsigned char* bytes = (const unsigned char*)&vertex;
+			size_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(MeshPool::MESH_VERTEX); i++)
+			{
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return(hash);
+		}
+	};
+
+	struct VertexEqual
+	{
+		bool operator()(const MeshPool::MESH_VERTEX& a, const MeshPool::MESH_VERTEX& b) const
+		{
+			return(memcmp(&a, &b, sizeof(MeshPool::MESH_VERTEX)) == 0);
+		}
+	};
+}
+
+/***********************************************************
+ *  Optimize()
+ *
+ *  This method runs every pass.  The overdraw pass works on
+ *  the cache-friendly order, and the fetch pass comes last
+ *  since it follows whatever triangle order it is given.
+ ***********************************************************/
+void MeshOptimizer::Optimize(
+	std::vector<MeshPool::MESH_VERTEX>& vertices,
+	std::vector<GLuint>& indices)
+{
+	DeduplicateVertices(vertices, indices);
+	OptimizeVertexCache(indices, (int)vertices.size());
+	OptimizeOverdraw(vertices, indices);
+	OptimizeVertexFetch(vertices, indices);
+}
+
+/***********************************************************
+ *  DeduplicateVertices()
+ *
+ *  This method keeps the first of each set of identical
+ *  vertices and points the indices at it.
+ ***********************************************************/
+void MeshOptimizer::DeduplicateVertices(
+	std::vector<MeshPool::MESH_VERTEX>& vertices,
+	std::vector<GLuint>& indices)
+{
+	std::unordered_map<MeshPool::MESH_VERTEX, GLuint, VertexHash, VertexEqual> unique;
+	unique.reserve(vertices.size());
+
+	std::vector<GLuint> remap(vertices.size());
+	std::vector<MeshPool::MESH_VERTEX> merged;
+	merged.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		std::pair<std::unordered_map<MeshPool::MESH_VERTEX, GLuint, VertexHash, VertexEqual>::iterator, bool> inserted =
+			unique.insert(std::make_pair(vertices[i], (GLuint)merged.size()));
+		if (inserted.second)
+		{
+			merged.push_back(vertices[i]);
+		}
+		remap[i] = inserted.first->second;
+	}
+
+	for (GLuint& index : indices)
+	{
+		index = remap[index];
+	}
+	vertices.swap(merged);
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This method emits triangles greedily, always taking the
+ *  best scoring triangle among those touching the modeled
+ *  cache.  Only the scores of vertices whose cache position
+ *  changed are recomputed, which keeps it linear.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexCache(
+	std::vector<GLuint>& indices,
+	int vertexCount)
+{
+	const int triangleCount = (int)indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// the triangles using each vertex, packed per vertex
+	std::vector<int> remaining(vertexCount, 0);
+	for (GLuint index : indices)
+	{
+		remaining[index]++;
+	}
+	std::vector<int> firstTriangle(vertexCount + 1, 0);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+	}
+	std::vector<int> vertexTriangles(indices.size());
+	std::vector<int> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (int t = 0; t < triangleCount; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = indices[t * 3 + k];
+			vertexTriangles[filled[v]++] = t;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<unsigned char> emitted(triangleCount, 0);
+	int bestTriangle = 0;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triangleScore[t] > triangleScore[bestTriangle])
+		{
+			bestTriangle = t;
+		}
+	}
+
+	std::vector<GLuint> output;
+	output.reserve(indices.size());
+	std::vector<int> cache;
+	std::vector<int> newCache;
+	cache.reserve(g_ModeledCacheSize + 3);
+	newCache.reserve(g_ModeledCacheSize + 3);
+	int nextUnemitted = 0;
+
+	while ((int)output.size() < triangleCount * 3)
+	{
+		// at a dead end, with nothing in the cache left to draw,
+		// carry on with the next triangle in the original order
+		if (bestTriangle < 0)
+		{
+			while (emitted[nextUnemitted])
+			{
+				nextUnemitted++;
+			}
+			bestTriangle = nextUnemitted;
+		}
+
+		const int triangle = bestTriangle;
+		emitted[triangle] = 1;
+		newCache.clear();
+		for (int k = 0; k < 3; k++)
+		{
+			int v = indices[triangle * 3 + k];
+			output.push_back(v);
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+			{
+				newCache.push_back(v);
+			}
+
+			// drop the triangle from the vertex's remaining list
+			int* pBegin = &vertexTriangles[firstTriangle[v]];
+			int* pEnd = pBegin + remaining[v];
+			int* pFound = std::find(pBegin, pEnd, triangle);
+			*pFound = *(pEnd - 1);
+			remaining[v]--;
+		}
+
+		// the emitted triangle moves to the front of the cache
+		const int emittedCount = (int)newCache.size();
+		for (int v : cache)
+		{
+			if (std::find(newCache.begin(), newCache.begin() + emittedCount, v) == newCache.begin() + emittedCount)
+			{
+				newCache.push_back(v);
+			}
+		}
+		for (int i = 0; i < (int)newCache.size(); i++)
+		{
+			int v = newCache[i];
+			cachePosition[v] = (i < g_ModeledCacheSize) ? i : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		// rescore the triangles around every vertex that moved and
+		// pick the best of them
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (int v : newCache)
+		{
+			const int* triangles = &vertexTriangles[firstTriangle[v]];
+			for (int i = 0; i < remaining[v]; i++)
+			{
+				int t = triangles[i];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if ((int)newCache.size() > g_ModeledCacheSize)
+		{
+			newCache.resize(g_ModeledCacheSize);
+		}
+		cache.swap(newCache);
+	}
+
+	indices.swap(output);
+}
+
+/***********************************************************
+ *  OptimizeOverdraw()
+ *
+ *  This method cuts the triangle order where a triangle
+ *  misses the cache on all three vertices anyway, so the
+ *  runs between cuts can be moved without adding misses.
+ *  Runs are then sorted by how far out along their own
+ *  facing direction they sit from the center of the mesh;
+ *  the outer shell is drawn first and the depth test
+ *  rejects most of what lies behind it.
+ ***********************************************************/
+void MeshOptimizer::OptimizeOverdraw(
+	const std::vector<MeshPool::MESH_VERTEX>& vertices,
+	std::vector<GLuint>& indices)
+{
+	const int triangleCount = (int)indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// find the cuts with a FIFO cache simulation
+	std::vector<int> clusterStarts;
+	std::vector<unsigned int> cacheStamps(vertices.size(), 0);
+	unsigned int stamp = g_ClusterCacheSize + 1;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		int misses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = indices[t * 3 + k];
+			if (stamp - cacheStamps[v] > (unsigned int)g_ClusterCacheSize)
+			{
+				cacheStamps[v] = stamp++;
+				misses++;
+			}
+		}
+		if ((t == 0) || (misses == 3))
+		{
+			clusterStarts.push_back(t);
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	const int clusterCount = (int)clusterStarts.size() - 1;
+	if (clusterCount < 2)
+	{
+		return;
+	}
+
+	// area-weighted center and facing of each run and the mesh
+	std::vector<glm::vec3> clusterCenters(clusterCount);
+	std::vector<glm::vec3> clusterNormals(clusterCount);
+	glm::vec3 meshCenter(0.0f, 0.0f, 0.0f);
+	float meshArea = 0.0f;
+	for (int c = 0; c < clusterCount; c++)
+	{
+		glm::vec3 center(0.0f, 0.0f, 0.0f);
+		glm::vec3 normal(0.0f, 0.0f, 0.0f);
+		float area = 0.0f;
+		for (int t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			const glm::vec3& p0 = vertices[indices[t * 3]].position;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+			glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+			float faceArea = glm::length(faceNormal);
+			center += (p0 + p1 + p2) * (faceArea / 3.0f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+		meshCenter += center;
+		meshArea += area;
+		clusterCenters[c] = (area > 0.0f) ? center / area : vertices[indices[clusterStarts[c] * 3]].position;
+		clusterNormals[c] = normal;
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCenter /= meshArea;
+	}
+
+	std::vector<std::pair<float, int>> order(clusterCount);
+	for (int c = 0; c < clusterCount; c++)
+	{
+		float normalLength = glm::length(clusterNormals[c]);
+		float outward = (normalLength > 0.0f) ?
+			glm::dot(clusterCenters[c] - meshCenter, clusterNormals[c] / normalLength) : 0.0f;
+		order[c] = std::make_pair(-outward, c);
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first < b.first; });
+
+	std::vector<GLuint> output;
+	output.reserve(indices.size());
+	for (const std::pair<float, int>& entry : order)
+	{
+		int c = entry.second;
+		output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	}
+	indices.swap(output);
+}
+
+/***********************************************************
+ *  OptimizeVertexFetch()
+ *
+ *  This method renumbers the vertices so that the vertex
+ *  buffer is read front to back as the triangles are drawn.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexFetch(
+	std::vector<MeshPool::MESH_VERTEX>& vertices,
+	std::vector<GLuint>& indices)
+{
+	const GLuint unused = 0xFFFFFFFFu;
+	std::vector<GLuint> remap(vertices.size(), unused);
+	std::vector<MeshPool::MESH_VERTEX> ordered;
+	ordered.reserve(vertices.size());
+
+	for (GLuint& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (GLuint)ordered.size();
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(ordered);
+}
+
+/***********************************************************
+ *  AnalyzeVertexCache()
+ *
+ *  This method counts the cache misses of a FIFO cache over
+ *  the triangle order, as a measure of the passes above.
+ ***********************************************************/
+float MeshOptimizer::AnalyzeVertexCache(
+	const std::vector<GLuint>& indices,
+	int vertexCount,
+	int cacheSize)
+{
+	if (indices.size() < 3)
+	{
+		return(0.0f);
+	}
+
+	std::vector<unsigned int> cacheStamps(vertexCount, 0);
+	unsigned int stamp = cacheSize + 1;
+	int misses = 0;
+	for (GLuint index : indices)
+	{
+		if (stamp - cacheStamps[index] > (unsigned int)cacheSize)
+		{
+			cacheStamps[index] = stamp++;
+			misses++;
+		}
+	}
+	return((float)misses / (indices.size() / 3));
+}
@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.h
+// ============
+// reorder mesh triangles and vertices for faster drawing
+//
+//  Imported meshes come in whatever order the modeling tool wrote
+//  them.  These passes merge duplicate vertices, order the triangles
+//  for the post-transform vertex cache and for early depth rejection,
+//  and lay the vertices out in the order the triangles fetch them.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshPool.h"
+
+#include <vector>
+
+/***********************************************************
+ *  MeshOptimizer
+ *
+ *  This class holds the optimization passes for indexed
+ *  triangle lists.  Each pass keeps the mesh drawing the
+ *  same surface; only the order of the data changes.
+ ***********************************************************/
+class MeshOptimizer
+{
+public:
+	// run every pass in the order they work best in
+	static void Optimize(
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices);
+
+	// merge vertices whose every attribute is the same
+	static void DeduplicateVertices(
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices);
+	// reorder the triangles so each one reuses the vertices still
+	// in the post-transform cache, after Tom Forsyth's linear-speed
+	// vertex cache optimization
+	static void OptimizeVertexCache(
+		std::vector<GLuint>& indices,
+		int vertexCount);
+	// reorder runs of cache-friendly triangles so outward facing
+	// parts of the mesh are drawn first and hide the rest
+	static void OptimizeOverdraw(
+		const std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices);
+	// renumber the vertices in the order the triangles first use
+	// them, dropping any that no triangle uses
+	static void OptimizeVertexFetch(
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices);
+
+	// average cache misses per triangle with a FIFO cache of the
+	// passed in size, 0.5 at best and 3 at worst
+	static float AnalyzeVertexCache(
+		const std::vector<GLuint>& indices,
+		int vertexCount,
+		int cacheSize);
+};
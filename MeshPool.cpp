@@ -0,0 +1,731 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshpool.cpp
+// ============
+// generate the basic 3D shapes into one shared vertex and index buffer
+//
+//  The GPU-driven render path needs every mesh to live in a single
+//  buffer pair so that one indirect multi-draw can reach all of them.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshPool.h"
+#include "ShapeTessellator.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+static_assert(sizeof(MeshPool::COMPACT_VERTEX) == 16, "compact vertex layout changed");
+
+// declaration of global variables
+namespace
+{
+	// space left around each lightmap chart, as a fraction of the
+	// layout's width, so filtering never reaches a neighbor
+	const float g_ChartPadding = 0.03f;
+
+	// lightmap state of a pooled mesh
+	const unsigned char g_LightmapNone = 0;
+	const unsigned char g_LightmapLaidOut = 1;
+	const unsigned char g_LightmapPending = 2;
+
+	// one connected piece of a mesh in its texture coordinates
+	struct LIGHTMAP_CHART
+	{
+		glm::vec2 uvMin;
+		glm::vec2 uvMax;
+		// surface length per unit of u and v, weighted by area
+		glm::vec2 stretch;
+		float weight;
+		// size once laid out, and its place in the layout
+		glm::vec2 size;
+		glm::vec2 offset;
+	};
+
+	/***********************************************************
+	 *  FindRoot()
+	 *
+	 *  Find the representative of a vertex's chart, halving
+	 *  the path on the way.
+	 ***********************************************************/
+	int FindRoot(std::vector<int>& parents, int vertex)
+	{
+		while (parents[vertex] != vertex)
+		{
+			parents[vertex] = parents[parents[vertex]];
+			vertex = parents[vertex];
+		}
+		return(vertex);
+	}
+
+	/***********************************************************
+	 *  EncodeOctahedral()
+	 *
+	 *  Project a unit normal onto the octahedron and unfold the
+	 *  lower half over the upper one, giving two values in
+	 *  [-1, 1] that the vertex shader turns back into a normal.
+	 ***********************************************************/
+	glm::vec2 EncodeOctahedral(glm::vec3 normal)
+	{
+		float sum = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+		if (sum == 0.0f)
+		{
+			return(glm::vec2(0.0f, 0.0f));
+		}
+
+		glm::vec2 encoded(normal.x / sum, normal.y / sum);
+		if (normal.z < 0.0f)
+		{
+			encoded = glm::vec2(
+				(1.0f - fabsf(encoded.y)) * ((encoded.x >= 0.0f) ? 1.0f : -1.0f),
+				(1.0f - fabsf(encoded.x)) * ((encoded.y >= 0.0f) ? 1.0f : -1.0f));
+		}
+		return(encoded);
+	}
+
+	/***********************************************************
+	 *  BoundingSphere()
+	 *
+	 *  Bound a mesh by a sphere around the center of its box.
+	 ***********************************************************/
+	glm::vec4 BoundingSphere(const std::vector<MeshPool::MESH_VERTEX>& vertices)
+	{
+		glm::vec3 minCorner(1.0e30f);
+		glm::vec3 maxCorner(-1.0e30f);
+		for (const MeshPool::MESH_VERTEX& vertex : vertices)
+		{
+			minCorner = glm::min(minCorner, vertex.position);
+			maxCorner = glm::max(maxCorner, vertex.position);
+		}
+		glm::vec3 center = (minCorner + maxCorner) * 0.5f;
+		float radius = 0.0f;
+		for (const MeshPool::MESH_VERTEX& vertex : vertices)
+		{
+			radius = std::max(radius, glm::length(vertex.position - center));
+		}
+		return(glm::vec4(center, radius));
+	}
+}
+
+/***********************************************************
+ *  MeshPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshPool::MeshPool()
+{
+	m_pVertexData = NULL;
+	m_vertexCount = 0;
+	m_pIndexData = NULL;
+	m_indexCount = 0;
+	m_vertexBuffer = 0;
+	m_bufferBytes = 0;
+	m_indexBuffer = 0;
+	m_vertexArray = 0;
+	m_bCompactVertices = false;
+	m_bCompactUploaded = false;
+	m_bLightmapCoords = false;
+	m_lightmapBuffer = 0;
+}
+
+/***********************************************************
+ *  ~MeshPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshPool::~MeshPool()
+{
+	if (m_vertexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_vertexBuffer);
+		m_vertexBuffer = 0;
+	}
+	if (m_indexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+	if (m_lightmapBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_lightmapBuffer);
+		m_lightmapBuffer = 0;
+	}
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	m_vertices.clear();
+	m_indices.clear();
+	m_meshes.clear();
+}
+
+/***********************************************************
+ *  LoadBuiltinMeshes()
+ *
+ *  This method adds every built-in shape in MESH_TYPE order
+ *  so that the enum values can be used as mesh indices.  The
+ *  shapes come from the tessellation store, so only the
+ *  first pool to ask for them generates them.
+ ***********************************************************/
+void MeshPool::LoadBuiltinMeshes()
+{
+	for (int i = 0; i < MESH_BUILTIN_COUNT; i++)
+	{
+		const ShapeTessellator::SHAPE_MESH* pShape = ShapeTessellator::Tessellate(
+			ShapeTessellator::GetBuiltinParameters((MESH_TYPE)i));
+		AddMesh(pShape->vertices, pShape->indices);
+	}
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method appends the passed in geometry to the pool,
+ *  computes its bounding sphere, and returns the mesh index.
+ ***********************************************************/
+int MeshPool::AddMesh(
+	const std::vector<MESH_VERTEX>& vertices,
+	const std::vector<GLuint>& indices)
+{
+	CopyPackedGeometry();
+
+	MESH_RANGE range;
+	range.firstIndex = (GLuint)m_indices.size();
+	range.indexCount = (GLuint)indices.size();
+	range.baseVertex = (GLint)m_vertices.size();
+	range.boundingSphere = BoundingSphere(vertices);
+
+	m_vertices.insert(m_vertices.end(), vertices.begin(), vertices.end());
+	m_indices.insert(m_indices.end(), indices.begin(), indices.end());
+	m_meshes.push_back(range);
+	m_pVertexData = m_vertices.data();
+	m_vertexCount = (int)m_vertices.size();
+	m_pIndexData = m_indices.data();
+	m_indexCount = (int)m_indices.size();
+
+	return((int)m_meshes.size() - 1);
+}
+
+/***********************************************************
+ *  ReplaceMesh()
+ *
+ *  This method splices new geometry in where a mesh's was.
+ *  Meshes are appended one after another, so the mesh's
+ *  vertices run up to the base vertex of the next one, and
+ *  every later mesh moves by the difference in size.
+ ***********************************************************/
+void MeshPool::ReplaceMesh(
+	int meshIndex,
+	const std::vector<MESH_VERTEX>& vertices,
+	const std::vector<GLuint>& indices)
+{
+	CopyPackedGeometry();
+
+	MESH_RANGE& range = m_meshes[meshIndex];
+	const int firstVertex = range.baseVertex;
+	const int endVertex = (meshIndex + 1 < (int)m_meshes.size()) ? m_meshes[meshIndex + 1].baseVertex : m_vertexCount;
+	const int vertexShift = (int)vertices.size() - (endVertex - firstVertex);
+	const int indexShift = (int)indices.size() - (int)range.indexCount;
+
+	m_vertices.erase(m_vertices.begin() + firstVertex, m_vertices.begin() + endVertex);
+	m_vertices.insert(m_vertices.begin() + firstVertex, vertices.begin(), vertices.end());
+	m_indices.erase(m_indices.begin() + range.firstIndex, m_indices.begin() + range.firstIndex + range.indexCount);
+	m_indices.insert(m_indices.begin() + range.firstIndex, indices.begin(), indices.end());
+
+	// the mesh's lightmap coordinates are laid out again
+	if ((int)m_lightmapCoords.size() >= endVertex)
+	{
+		m_lightmapCoords.erase(m_lightmapCoords.begin() + firstVertex, m_lightmapCoords.begin() + endVertex);
+		m_lightmapCoords.insert(m_lightmapCoords.begin() + firstVertex, vertices.size(), glm::vec2(0.0f));
+	}
+	else
+	{
+		m_lightmapCoords.resize(std::min((int)m_lightmapCoords.size(), firstVertex));
+	}
+	if (meshIndex < (int)m_lightmapMeshes.size())
+	{
+		m_lightmapMeshes[meshIndex] = g_LightmapPending;
+	}
+
+	range.indexCount = (GLuint)indices.size();
+	range.boundingSphere = BoundingSphere(vertices);
+	for (int i = meshIndex + 1; i < (int)m_meshes.size(); i++)
+	{
+		m_meshes[i].firstIndex += indexShift;
+		m_meshes[i].baseVertex += vertexShift;
+	}
+
+	m_pVertexData = m_vertices.data();
+	m_vertexCount = (int)m_vertices.size();
+	m_pIndexData = m_indices.data();
+	m_indexCount = (int)m_indices.size();
+}
+
+/***********************************************************
+ *  CopyPackedGeometry()
+ *
+ *  This method copies packed geometry into the pool, since
+ *  the mapping it points at cannot be changed.
+ ***********************************************************/
+void MeshPool::CopyPackedGeometry()
+{
+	if ((m_pVertexData != m_vertices.data()) && (m_vertexCount > 0))
+	{
+		m_vertices.assign(m_pVertexData, m_pVertexData + m_vertexCount);
+		m_indices.assign(m_pIndexData, m_pIndexData + m_indexCount);
+	}
+}
+
+/***********************************************************
+ *  SetPackedGeometry()
+ *
+ *  This method replaces the pool's contents with geometry
+ *  that was generated ahead of time.  Only the mesh ranges
+ *  are copied; the vertices and indices are uploaded from
+ *  where they already are.
+ ***********************************************************/
+void MeshPool::SetPackedGeometry(
+	const MESH_VERTEX* vertices,
+	int vertexCount,
+	const GLuint* indices,
+	int indexCount,
+	const MESH_RANGE* meshes,
+	int meshCount)
+{
+	m_vertices.clear();
+	m_indices.clear();
+	m_lightmapCoords.clear();
+	m_lightmapMeshes.clear();
+	m_meshes.assign(meshes, meshes + meshCount);
+	m_pVertexData = vertices;
+	m_vertexCount = vertexCount;
+	m_pIndexData = indices;
+	m_indexCount = indexCount;
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method copies the pooled geometry into the OpenGL
+ *  vertex and index buffers.
+ ***********************************************************/
+void MeshPool::Upload()
+{
+	if (m_vertexBuffer == 0)
+	{
+		glGenBuffers(1, &m_vertexBuffer);
+	}
+	if (m_indexBuffer == 0)
+	{
+		glGenBuffers(1, &m_indexBuffer);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	if (m_bCompactVertices)
+	{
+		std::vector<COMPACT_VERTEX> compact;
+		BuildCompactVertices(compact);
+		glBufferData(GL_ARRAY_BUFFER, compact.size() * sizeof(COMPACT_VERTEX), compact.data(), GL_STATIC_DRAW);
+		m_bufferBytes = compact.size() * sizeof(COMPACT_VERTEX);
+	}
+	else
+	{
+		m_positionDecodes.clear();
+		glBufferData(GL_ARRAY_BUFFER, m_vertexCount * sizeof(MESH_VERTEX), m_pVertexData, GL_STATIC_DRAW);
+		m_bufferBytes = m_vertexCount * sizeof(MESH_VERTEX);
+	}
+	m_bCompactUploaded = m_bCompactVertices;
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexCount * sizeof(GLuint), m_pIndexData, GL_STATIC_DRAW);
+	m_bufferBytes += m_indexCount * sizeof(GLuint);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	if (m_bLightmapCoords)
+	{
+		UploadLightmapCoords();
+	}
+
+	// vertex layout for drawing single meshes, using the same
+	// attribute locations as the basic shape meshes; it is set
+	// again each time, since the layout can change
+	if (m_vertexArray == 0)
+	{
+		glGenVertexArrays(1, &m_vertexArray);
+	}
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	SetVertexAttributes();
+	glBindVertexArray(0);
+
+	std::cout << "INFO: Mesh pool uploaded " << m_meshes.size() << " meshes, "
+		<< m_vertexCount << " vertices, " << m_indexCount << " indices" << std::endl;
+}
+
+/***********************************************************
+ *  SetVertexAttributes()
+ *
+ *  This method describes the uploaded vertex layout to the
+ *  bound vertex array.  The compact layout is read through
+ *  normalized integer and half float formats, so positions
+ *  arrive in [0, 1] and normals as their two encoded values.
+ ***********************************************************/
+void MeshPool::SetVertexAttributes() const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	if (m_bCompactUploaded)
+	{
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(COMPACT_VERTEX), (void*)offsetof(COMPACT_VERTEX, position));
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(COMPACT_VERTEX), (void*)offsetof(COMPACT_VERTEX, normal));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(COMPACT_VERTEX), (void*)offsetof(COMPACT_VERTEX, texCoord));
+	}
+	else
+	{
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (void*)offsetof(MESH_VERTEX, position));
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (void*)offsetof(MESH_VERTEX, normal));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (void*)offsetof(MESH_VERTEX, texCoord));
+	}
+	if (m_bLightmapCoords && (m_lightmapBuffer != 0))
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_lightmapBuffer);
+		glEnableVertexAttribArray(LIGHTMAP_COORD_ATTRIBUTE);
+		glVertexAttribPointer(LIGHTMAP_COORD_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+	}
+	else
+	{
+		glDisableVertexAttribArray(LIGHTMAP_COORD_ATTRIBUTE);
+		glVertexAttrib2f(LIGHTMAP_COORD_ATTRIBUTE, 0.0f, 0.0f);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  EnableLightmapCoords()
+ *
+ *  This method starts streaming lightmap coordinates.  An
+ *  uploaded pool gets them right away, and its own vertex
+ *  array is pointed at them.
+ ***********************************************************/
+void MeshPool::EnableLightmapCoords()
+{
+	if (m_bLightmapCoords)
+	{
+		return;
+	}
+
+	m_bLightmapCoords = true;
+	if (m_vertexBuffer != 0)
+	{
+		UploadLightmapCoords();
+		glBindVertexArray(m_vertexArray);
+		SetVertexAttributes();
+		glBindVertexArray(0);
+	}
+}
+
+/***********************************************************
+ *  UploadLightmapCoords()
+ *
+ *  This method lays out the coordinates of the meshes that
+ *  need them and copies the whole stream into its buffer.
+ ***********************************************************/
+void MeshPool::UploadLightmapCoords()
+{
+	GenerateLightmapCoords();
+	if (m_lightmapBuffer == 0)
+	{
+		glGenBuffers(1, &m_lightmapBuffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, m_lightmapBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_lightmapCoords.size() * sizeof(glm::vec2), m_lightmapCoords.data(), GL_STATIC_DRAW);
+	m_bufferBytes += m_lightmapCoords.size() * sizeof(glm::vec2);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  GenerateLightmapCoords()
+ *
+ *  This method lays out the lightmap coordinates of every
+ *  mesh that does not have them yet, or was replaced.
+ ***********************************************************/
+void MeshPool::GenerateLightmapCoords()
+{
+	m_lightmapCoords.resize(m_vertexCount, glm::vec2(0.0f));
+
+	int skipped = 0;
+	m_lightmapMeshes.resize(m_meshes.size(), g_LightmapPending);
+	for (int i = 0; i < (int)m_meshes.size(); i++)
+	{
+		if (m_lightmapMeshes[i] != g_LightmapPending)
+			continue;
+		bool bLaidOut = BuildMeshLightmapCoords(i);
+		m_lightmapMeshes[i] = bLaidOut ? g_LightmapLaidOut : g_LightmapNone;
+		if (!bLaidOut)
+			skipped++;
+	}
+	if (skipped > 0)
+	{
+		std::cout << "INFO: " << skipped << " meshes have no texture coordinates to lay out a lightmap from" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  HasLightmapCoords()
+ *
+ *  This method returns whether a mesh was given lightmap
+ *  coordinates.
+ ***********************************************************/
+bool MeshPool::HasLightmapCoords(int meshIndex) const
+{
+	return((meshIndex >= 0) && (meshIndex < (int)m_lightmapMeshes.size()) && (m_lightmapMeshes[meshIndex] == g_LightmapLaidOut));
+}
+
+/***********************************************************
+ *  BuildMeshLightmapCoords()
+ *
+ *  This method splits a mesh into charts, the pieces whose
+ *  triangles share vertices, and keeps each chart's own
+ *  texture coordinates, which the shapes lay out without
+ *  overlap since every seam has its own vertices.  Each
+ *  chart is stretched to its surface size along u and v,
+ *  so texels cover the same area everywhere, and the charts
+ *  are packed onto shelves in one square.
+ ***********************************************************/
+bool MeshPool::BuildMeshLightmapCoords(int meshIndex)
+{
+	const MESH_RANGE& range = m_meshes[meshIndex];
+	const MESH_VERTEX* vertices = m_pVertexData + range.baseVertex;
+	const GLuint* indices = m_pIndexData + range.firstIndex;
+	const int triangleCount = (int)range.indexCount / 3;
+
+	int vertexCount = 0;
+	for (GLuint i = 0; i < range.indexCount; i++)
+	{
+		vertexCount = std::max(vertexCount, (int)indices[i] + 1);
+	}
+	if ((triangleCount == 0) || (range.baseVertex + vertexCount > m_vertexCount))
+	{
+		return(false);
+	}
+
+	std::vector<int> parents(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		parents[v] = v;
+	}
+	for (int t = 0; t < triangleCount; t++)
+	{
+		int root = FindRoot(parents, indices[t * 3]);
+		parents[FindRoot(parents, indices[t * 3 + 1])] = root;
+		parents[FindRoot(parents, indices[t * 3 + 2])] = root;
+	}
+
+	std::vector<int> vertexCharts(vertexCount, -1);
+	std::vector<LIGHTMAP_CHART> charts;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		int root = FindRoot(parents, indices[t * 3]);
+		if (vertexCharts[root] < 0)
+		{
+			vertexCharts[root] = (int)charts.size();
+			LIGHTMAP_CHART chart;
+			chart.uvMin = glm::vec2(1.0e30f);
+			chart.uvMax = glm::vec2(-1.0e30f);
+			chart.stretch = glm::vec2(0.0f);
+			chart.weight = 0.0f;
+			charts.push_back(chart);
+		}
+		LIGHTMAP_CHART& chart = charts[vertexCharts[root]];
+
+		const MESH_VERTEX& v0 = vertices[indices[t * 3]];
+		const MESH_VERTEX& v1 = vertices[indices[t * 3 + 1]];
+		const MESH_VERTEX& v2 = vertices[indices[t * 3 + 2]];
+		chart.uvMin = glm::min(chart.uvMin, glm::min(v0.texCoord, glm::min(v1.texCoord, v2.texCoord)));
+		chart.uvMax = glm::max(chart.uvMax, glm::max(v0.texCoord, glm::max(v1.texCoord, v2.texCoord)));
+
+		// the surface's rate of change along u and v
+		glm::vec3 edge1 = v1.position - v0.position;
+		glm::vec3 edge2 = v2.position - v0.position;
+		glm::vec2 delta1 = v1.texCoord - v0.texCoord;
+		glm::vec2 delta2 = v2.texCoord - v0.texCoord;
+		float determinant = delta1.x * delta2.y - delta2.x * delta1.y;
+		if (fabsf(determinant) > 1.0e-12f)
+		{
+			glm::vec3 alongU = (edge1 * delta2.y - edge2 * delta1.y) / determinant;
+			glm::vec3 alongV = (edge2 * delta1.x - edge1 * delta2.x) / determinant;
+			float weight = fabsf(determinant);
+			chart.stretch += glm::vec2(glm::length(alongU), glm::length(alongV)) * weight;
+			chart.weight += weight;
+		}
+	}
+
+	float area = 0.0f;
+	float widest = 0.0f;
+	for (LIGHTMAP_CHART& chart : charts)
+	{
+		if (chart.weight <= 0.0f)
+		{
+			return(false);
+		}
+		chart.size = (chart.uvMax - chart.uvMin) * (chart.stretch / chart.weight);
+		area += chart.size.x * chart.size.y;
+		widest = std::max(widest, chart.size.x);
+	}
+
+	// tallest charts first, left to right along each shelf
+	std::vector<int> order(charts.size());
+	for (int c = 0; c < (int)charts.size(); c++)
+	{
+		order[c] = c;
+	}
+	std::sort(order.begin(), order.end(),
+		[&charts](int a, int b) { return(charts[a].size.y > charts[b].size.y); });
+
+	float shelfWidth = std::max(widest, sqrtf(area) * 1.1f);
+	float padding = shelfWidth * g_ChartPadding;
+	shelfWidth += 2.0f * padding;
+	glm::vec2 cursor(padding, padding);
+	float shelfHeight = 0.0f;
+	float usedWidth = 0.0f;
+	for (int c : order)
+	{
+		LIGHTMAP_CHART& chart = charts[c];
+		if ((cursor.x > padding) && (cursor.x + chart.size.x + padding > shelfWidth))
+		{
+			cursor = glm::vec2(padding, cursor.y + shelfHeight + padding);
+			shelfHeight = 0.0f;
+		}
+		chart.offset = cursor;
+		cursor.x += chart.size.x + padding;
+		shelfHeight = std::max(shelfHeight, chart.size.y);
+		usedWidth = std::max(usedWidth, cursor.x);
+	}
+	float side = std::max(usedWidth, cursor.y + shelfHeight + padding);
+
+	glm::vec2* coords = m_lightmapCoords.data() + range.baseVertex;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		int chartIndex = vertexCharts[FindRoot(parents, v)];
+		if (chartIndex < 0)
+		{
+			continue;
+		}
+		const LIGHTMAP_CHART& chart = charts[chartIndex];
+		glm::vec2 scale = chart.size / glm::max(chart.uvMax - chart.uvMin, glm::vec2(1.0e-12f));
+		coords[v] = (chart.offset + (vertices[v].texCoord - chart.uvMin) * scale) / side;
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  GetPositionDecode()
+ *
+ *  This method returns the scale and offset that take a
+ *  mesh's normalized positions back to its bounding box.
+ ***********************************************************/
+glm::mat4 MeshPool::GetPositionDecode(int meshIndex) const
+{
+	if ((meshIndex < 0) || (meshIndex >= (int)m_positionDecodes.size()))
+	{
+		return(glm::mat4(1.0f));
+	}
+	return(m_positionDecodes[meshIndex]);
+}
+
+/***********************************************************
+ *  BuildCompactVertices()
+ *
+ *  This method quantizes the vertices of each mesh against
+ *  the mesh's own bounding box.  Meshes are appended one
+ *  after another, so a mesh's vertices run up to the base
+ *  vertex of the next one.
+ ***********************************************************/
+void MeshPool::BuildCompactVertices(std::vector<COMPACT_VERTEX>& compact)
+{
+	compact.assign(m_vertexCount, COMPACT_VERTEX());
+	m_positionDecodes.assign(m_meshes.size(), glm::mat4(1.0f));
+
+	for (int i = 0; i < (int)m_meshes.size(); i++)
+	{
+		int firstVertex = std::max(m_meshes[i].baseVertex, 0);
+		int endVertex = m_vertexCount;
+		for (const MESH_RANGE& other : m_meshes)
+		{
+			if ((other.baseVertex > firstVertex) && (other.baseVertex < endVertex))
+				endVertex = other.baseVertex;
+		}
+
+		glm::vec3 minCorner(1.0e30f);
+		glm::vec3 maxCorner(-1.0e30f);
+		for (int v = firstVertex; v < endVertex; v++)
+		{
+			minCorner = glm::min(minCorner, m_pVertexData[v].position);
+			maxCorner = glm::max(maxCorner, m_pVertexData[v].position);
+		}
+		glm::vec3 extent = glm::max(maxCorner - minCorner, glm::vec3(0.0f));
+
+		// decode = translate(minCorner) * scale(extent)
+		glm::mat4& decode = m_positionDecodes[i];
+		decode[0][0] = extent.x;
+		decode[1][1] = extent.y;
+		decode[2][2] = extent.z;
+		decode[3] = glm::vec4(minCorner, 1.0f);
+
+		float positionError = 0.0f;
+		for (int v = firstVertex; v < endVertex; v++)
+		{
+			const MESH_VERTEX& vertex = m_pVertexData[v];
+			COMPACT_VERTEX& packed = compact[v];
+			for (int c = 0; c < 3; c++)
+			{
+				float normalized = (extent[c] > 0.0f) ? (vertex.position[c] - minCorner[c]) / extent[c] : 0.0f;
+				packed.position[c] = glm::packUnorm1x16(normalized);
+				float decoded = minCorner[c] + (packed.position[c] / 65535.0f) * extent[c];
+				positionError = std::max(positionError, fabsf(decoded - vertex.position[c]));
+			}
+			packed.position[3] = 0;
+
+			glm::vec2 normal = EncodeOctahedral(vertex.normal);
+			packed.normal[0] = (GLshort)glm::packSnorm1x16(normal.x);
+			packed.normal[1] = (GLshort)glm::packSnorm1x16(normal.y);
+			packed.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+			packed.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+		}
+
+		// each vertex fetched costs half the bytes it did
+		int vertexCount = endVertex - firstVertex;
+		std::cout << "INFO: Mesh " << i << " compact vertices: " << vertexCount << " vertices, "
+			<< vertexCount * sizeof(MESH_VERTEX) << " -> " << vertexCount * sizeof(COMPACT_VERTEX)
+			<< " bytes, largest position error " << positionError << std::endl;
+	}
+
+	std::cout << "INFO: Compact vertex buffer " << m_vertexCount * sizeof(COMPACT_VERTEX) << " bytes instead of "
+		<< m_vertexCount * sizeof(MESH_VERTEX) << std::endl;
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method draws one mesh of the pool with the current
+ *  shader settings.
+ ***********************************************************/
+void MeshPool::Draw(int meshIndex)
+{
+	const MESH_RANGE& range = m_meshes[meshIndex];
+
+	glBindVertexArray(m_vertexArray);
+	glDrawElementsBaseVertex(
+		GL_TRIANGLES,
+		range.indexCount,
+		GL_UNSIGNED_INT,
+		(void*)(range.firstIndex * sizeof(GLuint)),
+		range.baseVertex);
+	glBindVertexArray(0);
+}
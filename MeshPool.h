@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshpool.h
+// ============
+// generate the basic 3D shapes into one shared vertex and index buffer
+//
+//  The GPU-driven render path needs every mesh to live in a single
+//  buffer pair so that one indirect multi-draw can reach all of them.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// identifiers for the built-in shapes, in the order they are
+// generated into the pool; meshes added after them continue the
+// numbering, so any pool index is a valid value
+enum MESH_TYPE : int
+{
+	MESH_BOX = 0,
+	MESH_PLANE,
+	MESH_CYLINDER,
+	MESH_CONE,
+	MESH_SPHERE,
+	MESH_PRISM,
+	MESH_TORUS,
+	MESH_BUILTIN_COUNT
+};
+
+/***********************************************************
+ *  MeshPool
+ *
+ *  This class generates the basic shapes on the CPU and
+ *  stores them in one vertex buffer and one index buffer.
+ *  Each mesh is addressed by its index range.
+ ***********************************************************/
+class MeshPool
+{
+public:
+	// constructor
+	MeshPool();
+	// destructor
+	~MeshPool();
+
+	struct MESH_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 texCoord;
+	};
+
+	struct MESH_RANGE
+	{
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+		// local space bounding sphere, xyz = center, w = radius
+		glm::vec4 boundingSphere;
+	};
+
+	// vertex attribute of the lightmap coordinates
+	static const GLuint LIGHTMAP_COORD_ATTRIBUTE = 4;
+
+	// half the size of MESH_VERTEX: the position normalized to
+	// 16 bits within the mesh's bounding box, the normal
+	// octahedral encoded into two signed 16-bit values, and the
+	// texture coordinates as half floats
+	struct COMPACT_VERTEX
+	{
+		GLushort position[4];
+		GLshort normal[2];
+		GLushort texCoord[2];
+	};
+
+	// generate all of the built-in shapes, in MESH_TYPE order
+	void LoadBuiltinMeshes();
+	// append a mesh to the pool and return its index
+	int AddMesh(
+		const std::vector<MESH_VERTEX>& vertices,
+		const std::vector<GLuint>& indices);
+	// put new geometry in place of a mesh's, keeping its index and
+	// moving the meshes after it, so a reloaded mesh does not grow
+	// the pool; takes effect at the next Upload()
+	void ReplaceMesh(
+		int meshIndex,
+		const std::vector<MESH_VERTEX>& vertices,
+		const std::vector<GLuint>& indices);
+	// use geometry kept elsewhere, such as in a mapped asset pack,
+	// instead of generating it; the memory must stay valid until
+	// the pool is uploaded
+	void SetPackedGeometry(
+		const MESH_VERTEX* vertices,
+		int vertexCount,
+		const GLuint* indices,
+		int indexCount,
+		const MESH_RANGE* meshes,
+		int meshCount);
+	// upload the compact vertex layout instead of full precision
+	// floats, taking effect at the next Upload(); the shader must
+	// decode the normals, and each mesh's position decode must be
+	// applied to its model matrix
+	void SetCompactVertices(bool bCompact) { m_bCompactVertices = bCompact; }
+	// copy the pooled geometry into OpenGL buffers
+	void Upload();
+	// point attributes 0 to 2 of the bound vertex array at the
+	// vertex buffer, in the layout that was uploaded, and the
+	// lightmap coordinates at LIGHTMAP_COORD_ATTRIBUTE, which is
+	// a constant (0, 0) until they are enabled
+	void SetVertexAttributes() const;
+	// upload lightmap coordinates as their own stream from now
+	// on, for a lightmap that was loaded or baked; without one
+	// they are neither laid out nor uploaded
+	void EnableLightmapCoords();
+	// lay out a second set of texture coordinates for the meshes
+	// added or replaced since the last call, unique over each
+	// mesh's surface within [0, 1], so the vertex layouts stay
+	// as they are
+	void GenerateLightmapCoords();
+	// one lightmap coordinate per pooled vertex
+	const glm::vec2* GetLightmapCoords() const { return m_lightmapCoords.data(); }
+	// false for a mesh whose texture coordinates cannot be laid
+	// out as a lightmap, such as one without any
+	bool HasLightmapCoords(int meshIndex) const;
+	// draw one mesh from the uploaded buffers
+	void Draw(int meshIndex);
+
+	int GetMeshCount() const { return (int)m_meshes.size(); }
+	const MESH_RANGE& GetMesh(int meshIndex) const { return m_meshes[meshIndex]; }
+	GLuint GetVertexBuffer() const { return m_vertexBuffer; }
+	GLuint GetIndexBuffer() const { return m_indexBuffer; }
+	const MESH_VERTEX* GetVertexData() const { return m_pVertexData; }
+	int GetVertexCount() const { return m_vertexCount; }
+	const GLuint* GetIndexData() const { return m_pIndexData; }
+	int GetIndexCount() const { return m_indexCount; }
+	// size of the vertex and index buffers last uploaded
+	size_t GetBufferBytes() const { return m_bufferBytes; }
+	// true when the vertex buffer holds COMPACT_VERTEX data
+	bool HasCompactVertices() const { return m_bCompactUploaded; }
+	// matrix taking a mesh's stored positions to its local space,
+	// the identity unless the compact layout was uploaded
+	glm::mat4 GetPositionDecode(int meshIndex) const;
+
+private:
+	// CPU copies of the pooled geometry
+	std::vector<MESH_VERTEX> m_vertices;
+	std::vector<GLuint> m_indices;
+	// the geometry in use, either the copies above or memory
+	// passed to SetPackedGeometry()
+	const MESH_VERTEX* m_pVertexData;
+	int m_vertexCount;
+	const GLuint* m_pIndexData;
+	int m_indexCount;
+	// index ranges for each mesh in the pool
+	std::vector<MESH_RANGE> m_meshes;
+	// compact vertex layout requested, and in the vertex buffer
+	bool m_bCompactVertices;
+	bool m_bCompactUploaded;
+	std::vector<glm::mat4> m_positionDecodes;
+	// lightmap coordinates per vertex, and whether each mesh got
+	// any; meshes past the end of the flags, and replaced ones,
+	// have none yet
+	std::vector<glm::vec2> m_lightmapCoords;
+	std::vector<unsigned char> m_lightmapMeshes;
+	bool m_bLightmapCoords;
+	GLuint m_lightmapBuffer;
+	// OpenGL buffer objects
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	GLuint m_vertexArray;
+	size_t m_bufferBytes;
+
+	// lay out the lightmap coordinates and upload their stream
+	void UploadLightmapCoords();
+	// copy geometry passed to SetPackedGeometry() into the pool's
+	// own vectors before it is changed
+	void CopyPackedGeometry();
+	// quantize the pooled vertices mesh by mesh, filling in the
+	// position decodes and reporting the savings
+	void BuildCompactVertices(std::vector<COMPACT_VERTEX>& compact);
+	// lay out the lightmap coordinates of one mesh, false when
+	// its texture coordinates have no area to lay out
+	bool BuildMeshLightmapCoords(int meshIndex);
+};
@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////
+// objectstore.cpp
+// ============
+// keep the scene objects as dense component arrays
+//
+//  Every component lives in its own tightly packed array, so the
+//  per-frame systems walk contiguous memory and touch only the data
+//  they need.  Objects are referred to by handles that stay valid
+//  while other objects come and go.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ObjectStore.h"
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  MoveLast()
+	 *
+	 *  This function moves the last item of an array over the
+	 *  item at index and drops the last item.
+	 ***********************************************************/
+	template <typename T>
+	void MoveLast(std::vector<T>& items, int index)
+	{
+		if (index != (int)items.size() - 1)
+		{
+			items[index] = items.back();
+		}
+		items.pop_back();
+	}
+}
+
+/***********************************************************
+ *  ObjectStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ObjectStore::ObjectStore()
+{
+}
+
+/***********************************************************
+ *  AllocateSlot()
+ *
+ *  This method reuses a free slot, or adds one, and points
+ *  it at the end of the arrays.
+ ***********************************************************/
+ObjectStore::OBJECT_HANDLE ObjectStore::AllocateSlot()
+{
+	OBJECT_HANDLE handle;
+
+	if (!m_freeSlots.empty())
+	{
+		handle.slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		handle.slot = (uint32_t)m_slots.size();
+		m_slots.push_back({ -1, 0 });
+	}
+
+	handle.generation = m_slots[handle.slot].generation;
+	m_slots[handle.slot].index = (int)m_indexSlots.size();
+	m_indexSlots.push_back(handle.slot);
+
+	return(handle);
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method adds an object at the origin with unit scale.
+ ***********************************************************/
+ObjectStore::OBJECT_HANDLE ObjectStore::Create(const std::string& name, MESH_TYPE mesh)
+{
+	OBJECT_HANDLE handle = AllocateSlot();
+
+	m_names.push_back(name);
+	m_positions.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+	m_rotations.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+	m_scales.push_back(glm::vec3(1.0f, 1.0f, 1.0f));
+	m_modelMatrices.push_back(glm::mat4(1.0f));
+	m_bounds.push_back(glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));
+	m_meshes.push_back(mesh);
+	m_materials.push_back(-1);
+	m_textures.push_back(-1);
+	m_colors.push_back(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+	m_flags.push_back(0);
+
+	return(handle);
+}
+
+/***********************************************************
+ *  Duplicate()
+ *
+ *  This method adds an object with every component copied
+ *  from the source object.
+ ***********************************************************/
+ObjectStore::OBJECT_HANDLE ObjectStore::Duplicate(OBJECT_HANDLE source)
+{
+	int sourceIndex = GetIndex(source);
+	if (sourceIndex < 0)
+	{
+		return(source);
+	}
+
+	OBJECT_HANDLE handle = AllocateSlot();
+
+	// copy through locals, since growing an array may move the
+	// item being copied
+	std::string name = m_names[sourceIndex];
+	m_names.push_back(name);
+	glm::vec3 position = m_positions[sourceIndex];
+	m_positions.push_back(position);
+	glm::vec3 rotation = m_rotations[sourceIndex];
+	m_rotations.push_back(rotation);
+	glm::vec3 scale = m_scales[sourceIndex];
+	m_scales.push_back(scale);
+	glm::mat4 model = m_modelMatrices[sourceIndex];
+	m_modelMatrices.push_back(model);
+	glm::vec4 bounds = m_bounds[sourceIndex];
+	m_bounds.push_back(bounds);
+	m_meshes.push_back(m_meshes[sourceIndex]);
+	m_materials.push_back(m_materials[sourceIndex]);
+	m_textures.push_back(m_textures[sourceIndex]);
+	glm::vec4 color = m_colors[sourceIndex];
+	m_colors.push_back(color);
+	m_flags.push_back(m_flags[sourceIndex]);
+
+	return(handle);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method removes an object by moving the last object
+ *  into its place, and retires the handle's generation.
+ ***********************************************************/
+void ObjectStore::Destroy(OBJECT_HANDLE handle)
+{
+	int index = GetIndex(handle);
+	if (index < 0)
+	{
+		return;
+	}
+
+	// the last object takes over the freed index
+	uint32_t lastSlot = m_indexSlots.back();
+	m_slots[lastSlot].index = index;
+	MoveLast(m_indexSlots, index);
+
+	MoveLast(m_names, index);
+	MoveLast(m_positions, index);
+	MoveLast(m_rotations, index);
+	MoveLast(m_scales, index);
+	MoveLast(m_modelMatrices, index);
+	MoveLast(m_bounds, index);
+	MoveLast(m_meshes, index);
+	MoveLast(m_materials, index);
+	MoveLast(m_textures, index);
+	MoveLast(m_colors, index);
+	MoveLast(m_flags, index);
+
+	m_slots[handle.slot].index = -1;
+	m_slots[handle.slot].generation++;
+	m_freeSlots.push_back(handle.slot);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method removes every object.  The slots are kept,
+ *  with new generations, so old handles stay invalid.
+ ***********************************************************/
+void ObjectStore::Clear()
+{
+	for (uint32_t slot : m_indexSlots)
+	{
+		m_slots[slot].index = -1;
+		m_slots[slot].generation++;
+		m_freeSlots.push_back(slot);
+	}
+	m_indexSlots.clear();
+
+	m_names.clear();
+	m_positions.clear();
+	m_rotations.clear();
+	m_scales.clear();
+	m_modelMatrices.clear();
+	m_bounds.clear();
+	m_meshes.clear();
+	m_materials.clear();
+	m_textures.clear();
+	m_colors.clear();
+	m_flags.clear();
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method makes room for count objects in every array.
+ ***********************************************************/
+void ObjectStore::Reserve(int count)
+{
+	m_indexSlots.reserve(count);
+	m_names.reserve(count);
+	m_positions.reserve(count);
+	m_rotations.reserve(count);
+	m_scales.reserve(count);
+	m_modelMatrices.reserve(count);
+	m_bounds.reserve(count);
+	m_meshes.reserve(count);
+	m_materials.reserve(count);
+	m_textures.reserve(count);
+	m_colors.reserve(count);
+	m_flags.reserve(count);
+}
+
+/***********************************************************
+ *  IsValid()
+ *
+ *  This method checks that the handle's object still exists.
+ ***********************************************************/
+bool ObjectStore::IsValid(OBJECT_HANDLE handle) const
+{
+	return(GetIndex(handle) >= 0);
+}
+
+/***********************************************************
+ *  GetIndex()
+ *
+ *  This method returns where the handle's object currently
+ *  sits in the arrays.
+ ***********************************************************/
+int ObjectStore::GetIndex(OBJECT_HANDLE handle) const
+{
+	if ((handle.slot >= m_slots.size()) ||
+		(m_slots[handle.slot].generation != handle.generation))
+	{
+		return(-1);
+	}
+	return(m_slots[handle.slot].index);
+}
+
+/***********************************************************
+ *  GetHandle()
+ *
+ *  This method returns the handle of the object at index.
+ ***********************************************************/
+ObjectStore::OBJECT_HANDLE ObjectStore::GetHandle(int index) const
+{
+	OBJECT_HANDLE handle;
+	handle.slot = m_indexSlots[index];
+	handle.generation = m_slots[handle.slot].generation;
+	return(handle);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method looks up an object by name.
+ ***********************************************************/
+bool ObjectStore::Find(const std::string& name, OBJECT_HANDLE& handle) const
+{
+	for (int i = 0; i < (int)m_names.size(); i++)
+	{
+		if (m_names[i].compare(name) == 0)
+		{
+			handle = GetHandle(i);
+			return(true);
+		}
+	}
+	return(false);
+}
@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// objectstore.h
+// ============
+// keep the scene objects as dense component arrays
+//
+//  Every component lives in its own tightly packed array, so the
+//  per-frame systems walk contiguous memory and touch only the data
+//  they need.  Objects are referred to by handles that stay valid
+//  while other objects come and go.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ObjectStore
+ *
+ *  This class stores the scene objects structure-of-arrays
+ *  style.  The arrays stay dense: removing an object moves
+ *  the last object into its place, and a slot table maps
+ *  each handle to wherever its object currently lives.
+ ***********************************************************/
+class ObjectStore
+{
+public:
+	// constructor
+	ObjectStore();
+
+	// identifies one object; a handle whose object was removed
+	// no longer matches the generation of its slot
+	struct OBJECT_HANDLE
+	{
+		uint32_t slot;
+		uint32_t generation;
+	};
+
+	enum OBJECT_FLAGS
+	{
+		// draw with the solid color instead of a texture
+		OBJECT_USE_COLOR = 1 << 0,
+		// drawn in the blended pass after all opaque objects
+		OBJECT_TRANSPARENT = 1 << 1,
+		// gives off light of its own, so its color is scaled past
+		// white when the frame is kept in HDR
+		OBJECT_EMISSIVE = 1 << 2
+	};
+
+	// add an object with an identity transform, no texture,
+	// no material and a white color
+	OBJECT_HANDLE Create(const std::string& name, MESH_TYPE mesh);
+	// add a copy of an existing object
+	OBJECT_HANDLE Duplicate(OBJECT_HANDLE source);
+	// remove an object, invalidating its handle
+	void Destroy(OBJECT_HANDLE handle);
+	// remove every object
+	void Clear();
+	void Reserve(int count);
+
+	bool IsValid(OBJECT_HANDLE handle) const;
+	// current array index of an object, or -1 for a stale handle
+	int GetIndex(OBJECT_HANDLE handle) const;
+	OBJECT_HANDLE GetHandle(int index) const;
+	// first object with the passed in name, if any
+	bool Find(const std::string& name, OBJECT_HANDLE& handle) const;
+
+	int GetCount() const { return (int)m_names.size(); }
+
+	// component arrays, indexed from 0 to GetCount() - 1; any
+	// create or destroy may move them
+	const std::string& GetName(int index) const { return m_names[index]; }
+	glm::vec3* GetPositions() { return m_positions.data(); }
+	const glm::vec3* GetPositions() const { return m_positions.data(); }
+	// rotation about the X, Y and Z axes in degrees
+	glm::vec3* GetRotations() { return m_rotations.data(); }
+	const glm::vec3* GetRotations() const { return m_rotations.data(); }
+	glm::vec3* GetScales() { return m_scales.data(); }
+	const glm::vec3* GetScales() const { return m_scales.data(); }
+	// derived from position, rotation and scale by the update
+	glm::mat4* GetModelMatrices() { return m_modelMatrices.data(); }
+	const glm::mat4* GetModelMatrices() const { return m_modelMatrices.data(); }
+	// world space bounding spheres, xyz = center, w = radius
+	glm::vec4* GetBounds() { return m_bounds.data(); }
+	const glm::vec4* GetBounds() const { return m_bounds.data(); }
+	MESH_TYPE* GetMeshes() { return m_meshes.data(); }
+	const MESH_TYPE* GetMeshes() const { return m_meshes.data(); }
+	// material index, or -1 to keep the current material
+	int* GetMaterials() { return m_materials.data(); }
+	const int* GetMaterials() const { return m_materials.data(); }
+	// texture slot, or -1 for an untextured object
+	int* GetTextures() { return m_textures.data(); }
+	const int* GetTextures() const { return m_textures.data(); }
+	glm::vec4* GetColors() { return m_colors.data(); }
+	const glm::vec4* GetColors() const { return m_colors.data(); }
+	// combination of OBJECT_FLAGS
+	uint8_t* GetFlags() { return m_flags.data(); }
+	const uint8_t* GetFlags() const { return m_flags.data(); }
+
+private:
+	// the array index of each slot's object, and the generation
+	// a handle needs to still refer to it
+	struct OBJECT_SLOT
+	{
+		int index;
+		uint32_t generation;
+	};
+
+	std::vector<OBJECT_SLOT> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+	// the slot owning each array index
+	std::vector<uint32_t> m_indexSlots;
+
+	// components
+	std::vector<std::string> m_names;
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_rotations;
+	std::vector<glm::vec3> m_scales;
+	std::vector<glm::mat4> m_modelMatrices;
+	std::vector<glm::vec4> m_bounds;
+	std::vector<MESH_TYPE> m_meshes;
+	std::vector<int> m_materials;
+	std::vector<int> m_textures;
+	std::vector<glm::vec4> m_colors;
+	std::vector<uint8_t> m_flags;
+
+	// claim a slot for the object at the end of the arrays
+	OBJECT_HANDLE AllocateSlot();
+};
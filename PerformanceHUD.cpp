@@ -0,0 +1,494 @@
+///////////////////////////////////////////////////////////////////////////////
+// performancehud.cpp
+// ============
+// draw the frame's render statistics and frame time graphs over the scene
+//
+//  The overlay is drawn straight into the window after the scene has
+//  been upscaled and captured, with its own small shader and a font
+//  built into the program, so it shows at full resolution and never
+//  ends up in a recording.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PerformanceHUD.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cctype>
+#include <cstdio>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the font covers the characters from ' ' to '_', with lower
+	// case letters drawn as upper case
+	const int g_FirstGlyph = 32;
+	const int g_GlyphCount = 64;
+	// each glyph is 5 by 7 pixels, in a cell with one pixel of
+	// spacing to the right and below
+	const int g_GlyphWidth = 5;
+	const int g_GlyphHeight = 7;
+	const int g_CellWidth = g_GlyphWidth + 1;
+	const int g_CellHeight = g_GlyphHeight + 1;
+	// screen pixels per font pixel
+	const float g_TextScale = 2.0f;
+	const float g_LineHeight = g_CellHeight * g_TextScale + 2.0f;
+	// the graph height stands for at least one 60 Hz frame
+	const float g_MinimumGraphTime = 1000.0f / 60.0f;
+
+	// one row of five bits per glyph line, the leftmost pixel
+	// in the highest bit
+	const unsigned char g_Glyphs[g_GlyphCount][g_GlyphHeight] = {
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+		{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, // '!'
+		{ 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+		{ 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A }, // '#'
+		{ 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 }, // '$'
+		{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // '%'
+		{ 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D }, // '&'
+		{ 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "'"
+		{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // '('
+		{ 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // ')'
+		{ 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 }, // '*'
+		{ 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 }, // '+'
+		{ 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, // ','
+		{ 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // '-'
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, // '.'
+		{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // '/'
+		{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, // '0'
+		{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // '1'
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, // '2'
+		{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // '3'
+		{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, // '4'
+		{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // '5'
+		{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, // '6'
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // '7'
+		{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, // '8'
+		{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // '9'
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 }, // ';'
+		{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // '<'
+		{ 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, // '='
+		{ 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // '>'
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '?'
+		{ 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E }, // '@'
+		{ 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // 'A'
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // 'B'
+		{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // 'C'
+		{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // 'D'
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // 'E'
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // 'F'
+		{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // 'G'
+		{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // 'H'
+		{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 'I'
+		{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, // 'J'
+		{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // 'K'
+		{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, // 'L'
+		{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // 'M'
+		{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // 'N'
+		{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // 'O'
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, // 'P'
+		{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // 'Q'
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, // 'R'
+		{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // 'S'
+		{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // 'T'
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // 'U'
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // 'V'
+		{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // 'W'
+		{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, // 'X'
+		{ 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, // 'Y'
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, // 'Z'
+		{ 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E }, // '['
+		{ 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 }, // '\\'
+		{ 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E }, // ']'
+		{ 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00 }, // '^'
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F }, // '_'
+	};
+
+	const char* g_VertexShaderSource = R"(
+#version 330 core
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) in vec4 color;
+
+uniform vec2 screenSize;
+
+out vec2 fragmentTexCoord;
+out vec4 fragmentColor;
+
+void main()
+{
+	vec2 clip = position / screenSize * 2.0 - 1.0;
+	gl_Position = vec4(clip.x, -clip.y, 0.0, 1.0);
+	fragmentTexCoord = texCoord;
+	fragmentColor = color;
+}
+)";
+
+	const char* g_FragmentShaderSource = R"(
+#version 330 core
+in vec2 fragmentTexCoord;
+in vec4 fragmentColor;
+
+uniform sampler2D fontTexture;
+
+out vec4 outFragmentColor;
+
+void main()
+{
+	float coverage = (fragmentTexCoord.x < 0.0) ? 1.0 : texture(fontTexture, fragmentTexCoord).r;
+	outFragmentColor = vec4(fragmentColor.rgb, fragmentColor.a * coverage);
+}
+)";
+
+	/***********************************************************
+	 *  FormatCount()
+	 *
+	 *  Writes a count, or "ON GPU" for one the GPU-driven path
+	 *  does not know.
+	 ***********************************************************/
+	void FormatCount(char* text, size_t size, long long count)
+	{
+		if (count < 0)
+			snprintf(text, size, "ON GPU");
+		else
+			snprintf(text, size, "%lld", count);
+	}
+}
+
+/***********************************************************
+ *  PerformanceHUD()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PerformanceHUD::PerformanceHUD()
+{
+	for (int i = 0; i < HISTORY_LENGTH; i++)
+	{
+		m_cpuTimes[i] = 0.0f;
+		m_gpuTimes[i] = 0.0f;
+	}
+	m_historyNext = 0;
+	m_historyCount = 0;
+	m_stats = SceneManager::FRAME_STATS();
+	m_bloomTime = -1.0f;
+	m_finalTime = -1.0f;
+	m_heapAllocations = 0;
+	m_arenaBytes = 0;
+	m_program = 0;
+	m_fontTexture = 0;
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_bInitialized = false;
+	m_bFailed = false;
+}
+
+/***********************************************************
+ *  ~PerformanceHUD()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PerformanceHUD::~PerformanceHUD()
+{
+	if (m_program != 0)
+		glDeleteProgram(m_program);
+	if (m_fontTexture != 0)
+		glDeleteTextures(1, &m_fontTexture);
+	if (m_vertexBuffer != 0)
+		glDeleteBuffers(1, &m_vertexBuffer);
+	if (m_vertexArray != 0)
+		glDeleteVertexArrays(1, &m_vertexArray);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method compiles the overlay shader and expands the
+ *  built-in font into a texture.
+ ***********************************************************/
+bool PerformanceHUD::Initialize()
+{
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const char* const sources[] = { g_VertexShaderSource, g_FragmentShaderSource };
+	GLint success = 0;
+	char infoLog[1024];
+
+	m_program = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		GLuint shader = glCreateShader(types[i]);
+		glShaderSource(shader, 1, &sources[i], NULL);
+		glCompileShader(shader);
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+			std::cout << "ERROR: Performance HUD shader compilation failed\n" << infoLog << std::endl;
+			glDeleteShader(shader);
+			return(false);
+		}
+		glAttachShader(m_program, shader);
+		// flagged for deletion once the program is deleted
+		glDeleteShader(shader);
+	}
+	glLinkProgram(m_program);
+	glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(m_program, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR: Performance HUD shader linking failed\n" << infoLog << std::endl;
+		return(false);
+	}
+
+	// every glyph in one row of cells
+	const int fontWidth = g_GlyphCount * g_CellWidth;
+	std::vector<unsigned char> pixels(fontWidth * g_CellHeight, 0);
+	for (int glyph = 0; glyph < g_GlyphCount; glyph++)
+	{
+		for (int y = 0; y < g_GlyphHeight; y++)
+		{
+			for (int x = 0; x < g_GlyphWidth; x++)
+			{
+				if (g_Glyphs[glyph][y] & (0x10 >> x))
+				{
+					pixels[y * fontWidth + glyph * g_CellWidth + x] = 255;
+				}
+			}
+		}
+	}
+
+	glGenTextures(1, &m_fontTexture);
+	glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, fontWidth, g_CellHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenVertexArrays(1, &m_vertexArray);
+	glGenBuffers(1, &m_vertexBuffer);
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HUD_VERTEX), (const void*)offsetof(HUD_VERTEX, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HUD_VERTEX), (const void*)offsetof(HUD_VERTEX, texCoord));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(HUD_VERTEX), (const void*)offsetof(HUD_VERTEX, color));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddFrame()
+ *
+ *  This method keeps the frame's times in the history and
+ *  its counters for the next draw.
+ ***********************************************************/
+void PerformanceHUD::AddFrame(float cpuMilliseconds, float gpuMilliseconds, const SceneManager::FRAME_STATS& stats)
+{
+	m_cpuTimes[m_historyNext] = cpuMilliseconds;
+	m_gpuTimes[m_historyNext] = gpuMilliseconds;
+	m_historyNext = (m_historyNext + 1) % HISTORY_LENGTH;
+	m_historyCount = std::min(m_historyCount + 1, (int)HISTORY_LENGTH);
+	m_stats = stats;
+}
+
+/***********************************************************
+ *  SetPostProcessTimes()
+ *
+ *  This method keeps the latest post-processing pass times.
+ ***********************************************************/
+void PerformanceHUD::SetPostProcessTimes(float bloomMilliseconds, float finalMilliseconds)
+{
+	m_bloomTime = bloomMilliseconds;
+	m_finalTime = finalMilliseconds;
+}
+
+/***********************************************************
+ *  SetFrameMemory()
+ *
+ *  This method keeps the latest frame's memory use.
+ ***********************************************************/
+void PerformanceHUD::SetFrameMemory(size_t heapAllocations, size_t arenaBytes)
+{
+	m_heapAllocations = heapAllocations;
+	m_arenaBytes = arenaBytes;
+}
+
+/***********************************************************
+ *  AddQuad()
+ *
+ *  This method adds a rectangle as two triangles.
+ ***********************************************************/
+void PerformanceHUD::AddQuad(glm::vec2 topLeft, glm::vec2 bottomRight, glm::vec2 uvTopLeft, glm::vec2 uvBottomRight, glm::vec4 color)
+{
+	HUD_VERTEX corners[4];
+	corners[0] = { topLeft, uvTopLeft, color };
+	corners[1] = { glm::vec2(bottomRight.x, topLeft.y), glm::vec2(uvBottomRight.x, uvTopLeft.y), color };
+	corners[2] = { bottomRight, uvBottomRight, color };
+	corners[3] = { glm::vec2(topLeft.x, bottomRight.y), glm::vec2(uvTopLeft.x, uvBottomRight.y), color };
+
+	m_vertices.insert(m_vertices.end(), { corners[0], corners[1], corners[2], corners[0], corners[2], corners[3] });
+}
+
+/***********************************************************
+ *  AddText()
+ *
+ *  This method adds one quad per character of a line.
+ ***********************************************************/
+void PerformanceHUD::AddText(glm::vec2 position, const char* text, glm::vec4 color)
+{
+	const float fontWidth = (float)(g_GlyphCount * g_CellWidth);
+	const glm::vec2 cellSize(g_CellWidth * g_TextScale, g_CellHeight * g_TextScale);
+
+	for (const char* character = text; *character != '\0'; character++)
+	{
+		int glyph = toupper((unsigned char)*character) - g_FirstGlyph;
+		if ((glyph > 0) && (glyph < g_GlyphCount))
+		{
+			float u = (float)(glyph * g_CellWidth) / fontWidth;
+			AddQuad(position, position + cellSize,
+				glm::vec2(u, 0.0f), glm::vec2(u + g_CellWidth / fontWidth, 1.0f), color);
+		}
+		position.x += cellSize.x;
+	}
+}
+
+/***********************************************************
+ *  AddGraph()
+ *
+ *  This method adds a bar per recorded frame, the newest on
+ *  the right, over a dark background.
+ ***********************************************************/
+void PerformanceHUD::AddGraph(glm::vec2 position, glm::vec2 size, const float* times, float maxTime, glm::vec4 color)
+{
+	const glm::vec2 solid(-1.0f, -1.0f);
+	AddQuad(position, position + size, solid, solid, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
+
+	const float barWidth = size.x / HISTORY_LENGTH;
+	const int first = (m_historyNext - m_historyCount + HISTORY_LENGTH) % HISTORY_LENGTH;
+	for (int i = 0; i < m_historyCount; i++)
+	{
+		float time = times[(first + i) % HISTORY_LENGTH];
+		float height = std::min(time / maxTime, 1.0f) * size.y;
+		float x = position.x + size.x - (m_historyCount - i) * barWidth;
+		AddQuad(glm::vec2(x, position.y + size.y - height), glm::vec2(x + barWidth, position.y + size.y),
+			solid, solid, color);
+	}
+
+	// a line at one 60 Hz frame
+	float lineY = position.y + size.y - std::min(g_MinimumGraphTime / maxTime, 1.0f) * size.y;
+	AddQuad(glm::vec2(position.x, lineY), glm::vec2(position.x + size.x, lineY + 1.0f),
+		solid, solid, glm::vec4(1.0f, 1.0f, 1.0f, 0.6f));
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method lays out the text and graphs and draws them
+ *  in one call, leaving the program, depth test and active
+ *  texture unit as it found them.
+ ***********************************************************/
+void PerformanceHUD::Draw(int windowWidth, int windowHeight)
+{
+	if ((windowWidth <= 0) || (windowHeight <= 0))
+	{
+		return;
+	}
+	if (!m_bInitialized && !m_bFailed)
+	{
+		m_bInitialized = Initialize();
+		m_bFailed = !m_bInitialized;
+	}
+	if (m_bFailed)
+	{
+		return;
+	}
+
+	const int newest = (m_historyNext + HISTORY_LENGTH - 1) % HISTORY_LENGTH;
+	char lines[8][96];
+	char triangles[24];
+	char visible[24];
+	char culled[24];
+	FormatCount(triangles, sizeof(triangles), m_stats.triangles);
+	FormatCount(visible, sizeof(visible), m_stats.visibleObjects);
+	FormatCount(culled, sizeof(culled), m_stats.culledObjects);
+	snprintf(lines[0], sizeof(lines[0]), "CPU %6.2f MS   GPU %6.2f MS",
+		m_cpuTimes[newest], m_gpuTimes[newest]);
+	snprintf(lines[1], sizeof(lines[1]), "DRAW CALLS %d   TRIANGLES %s", m_stats.drawCalls, triangles);
+	snprintf(lines[2], sizeof(lines[2]), "TEXTURE BINDS %d   UNIFORMS %d", m_stats.textureBinds, m_stats.uniformUploads);
+	snprintf(lines[3], sizeof(lines[3]), "OBJECTS %d   VISIBLE %s   CULLED %s", m_stats.objects, visible, culled);
+	snprintf(lines[4], sizeof(lines[4]), "TEXTURES %d  %.1f MB   MESHES %.1f MB", m_stats.textures,
+		m_stats.textureBytes / (1024.0 * 1024.0), m_stats.meshBytes / (1024.0 * 1024.0));
+	snprintf(lines[5], sizeof(lines[5]), "HEAP ALLOCS %zu   FRAME ARENA %.1f KB", m_heapAllocations,
+		m_arenaBytes / 1024.0);
+
+	float maxTime = g_MinimumGraphTime;
+	for (int i = 0; i < HISTORY_LENGTH; i++)
+	{
+		maxTime = std::max(maxTime, std::max(m_cpuTimes[i], m_gpuTimes[i]));
+	}
+	// the graphs' label stays on the line right above them
+	int lineCount = 6;
+	if (m_bloomTime >= 0.0f)
+	{
+		snprintf(lines[lineCount], sizeof(lines[lineCount]), "POST  BLOOM %5.2f MS   FINAL %5.2f MS",
+			m_bloomTime, m_finalTime);
+		lineCount++;
+	}
+	snprintf(lines[lineCount], sizeof(lines[lineCount]), "CPU / GPU  TOP %.1f MS", maxTime);
+	lineCount++;
+
+	// panel, text, then the two graphs side by side
+	const glm::vec2 origin(10.0f, 10.0f);
+	const glm::vec2 graphSize(240.0f, 48.0f);
+	const glm::vec2 solid(-1.0f, -1.0f);
+	const float panelHeight = lineCount * g_LineHeight + graphSize.y + 16.0f;
+
+	m_vertices.clear();
+	AddQuad(origin - glm::vec2(6.0f), origin + glm::vec2(graphSize.x * 2.0f + 16.0f, panelHeight),
+		solid, solid, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+	for (int i = 0; i < lineCount; i++)
+	{
+		AddText(origin + glm::vec2(0.0f, i * g_LineHeight), lines[i], glm::vec4(1.0f));
+	}
+	glm::vec2 graphPosition = origin + glm::vec2(0.0f, lineCount * g_LineHeight + 4.0f);
+	AddGraph(graphPosition, graphSize, m_cpuTimes, maxTime, glm::vec4(0.3f, 0.9f, 0.3f, 0.9f));
+	AddGraph(graphPosition + glm::vec2(graphSize.x + 10.0f, 0.0f), graphSize, m_gpuTimes, maxTime,
+		glm::vec4(1.0f, 0.6f, 0.2f, 0.9f));
+
+	GLint previousProgram = 0;
+	GLint activeTexture = GL_TEXTURE0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+
+	glViewport(0, 0, windowWidth, windowHeight);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// the font goes on the active unit, which the scene keeps
+	// free of its own textures
+	glUseProgram(m_program);
+	glUniform2f(glGetUniformLocation(m_program, "screenSize"), (float)windowWidth, (float)windowHeight);
+	glUniform1i(glGetUniformLocation(m_program, "fontTexture"), activeTexture - GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(HUD_VERTEX), m_vertices.data(), GL_STREAM_DRAW);
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)m_vertices.size());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(previousProgram);
+}
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// performancehud.h
+// ============
+// draw the frame's render statistics and frame time graphs over the scene
+//
+//  The overlay is drawn straight into the window after the scene has
+//  been upscaled and captured, with its own small shader and a font
+//  built into the program, so it shows at full resolution and never
+//  ends up in a recording.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  PerformanceHUD
+ *
+ *  This class keeps the counters of the last frame and the
+ *  CPU and GPU times of recent frames, and draws them as
+ *  text and bar graphs in the top left of the window.
+ *  Nothing is built or drawn while the overlay is hidden.
+ ***********************************************************/
+class PerformanceHUD
+{
+public:
+	// constructor
+	PerformanceHUD();
+	// destructor
+	~PerformanceHUD();
+
+	// record the times and counters of a drawn frame
+	void AddFrame(float cpuMilliseconds, float gpuMilliseconds, const SceneManager::FRAME_STATS& stats);
+	// record the GPU times of the post-processing passes, which
+	// adds a line for them
+	void SetPostProcessTimes(float bloomMilliseconds, float finalMilliseconds);
+	// record the heap allocations of a drawn frame and the
+	// frame arena memory its jobs used
+	void SetFrameMemory(size_t heapAllocations, size_t arenaBytes);
+	// draw the overlay into the bound framebuffer
+	void Draw(int windowWidth, int windowHeight);
+
+private:
+	// number of frames the graphs cover
+	static const int HISTORY_LENGTH = 120;
+
+	struct HUD_VERTEX
+	{
+		// pixels from the top left of the window
+		glm::vec2 position;
+		// font texture coordinates, negative for a solid fill
+		glm::vec2 texCoord;
+		glm::vec4 color;
+	};
+
+	// frame history, oldest first from m_historyNext
+	float m_cpuTimes[HISTORY_LENGTH];
+	float m_gpuTimes[HISTORY_LENGTH];
+	int m_historyNext;
+	int m_historyCount;
+	SceneManager::FRAME_STATS m_stats;
+	// post-processing pass times, negative until one is set
+	float m_bloomTime;
+	float m_finalTime;
+	size_t m_heapAllocations;
+	size_t m_arenaBytes;
+
+	// OpenGL objects, created on the first draw
+	GLuint m_program;
+	GLuint m_fontTexture;
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	bool m_bInitialized;
+	bool m_bFailed;
+
+	std::vector<HUD_VERTEX> m_vertices;
+
+	bool Initialize();
+	void AddQuad(glm::vec2 topLeft, glm::vec2 bottomRight, glm::vec2 uvTopLeft, glm::vec2 uvBottomRight, glm::vec4 color);
+	void AddText(glm::vec2 position, const char* text, glm::vec4 color);
+	// bars of one time history, scaled so the top is maxTime
+	void AddGraph(glm::vec2 position, glm::vec2 size, const float* times, float maxTime, glm::vec4 color);
+};
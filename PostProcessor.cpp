@@ -0,0 +1,613 @@
+///////////////////////////////////////////////////////////////////////////////
+// postprocessor.cpp
+// ============
+// add bloom to the HDR frame, then tone map, grade and anti-alias it
+//
+//  The bright parts of the frame are filtered down to half and
+//  quarter resolution and blurred by compute shaders.  One full
+//  screen pass then adds the bloom, tone maps, smooths the edges,
+//  grades the color and upscales to the window, so the frame is
+//  read and written at full resolution only once.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PostProcessor.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// work group size of the bloom compute shader, in each axis
+	const int g_BloomGroupSize = 8;
+
+	// the bloom steps the compute shader runs
+	const int g_PrefilterStep = 0;
+	const int g_DownsampleStep = 1;
+	const int g_BlurStep = 2;
+	const int g_CombineStep = 3;
+
+	// HDR brightness where the bloom starts, eased in over the
+	// knee below it
+	const float g_BloomThreshold = 1.0f;
+	const float g_BloomKnee = 0.5f;
+	const float g_BloomStrength = 0.6f;
+	const float g_Exposure = 1.0f;
+	// the tone curve is linear up to the shoulder and rolls off
+	// to white above it, so a frame without highlights keeps
+	// the colors the scene was lit for
+	const float g_ToneShoulder = 0.8f;
+	// a light warm grade
+	const float g_Saturation = 1.05f;
+	const float g_Contrast = 1.03f;
+	const glm::vec3 g_ColorBalance(1.0f, 0.99f, 0.96f);
+
+	const char* g_BloomShaderSource = R"(
+#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+
+#define PREFILTER_STEP 0
+#define BLUR_STEP 2
+#define COMBINE_STEP 3
+// caps single hot pixels so they do not flicker as large blobs
+#define MAX_BRIGHTNESS 64.0
+
+layout(rgba16f, binding = 0) uniform writeonly image2D outputImage;
+layout(rgba16f, binding = 1) uniform readonly image2D combineImage;
+uniform sampler2D sourceTexture;
+uniform int bloomStep;
+// the size of the source texture, and of the part of it that the
+// last frame filled
+uniform vec2 sourceSize;
+uniform vec2 sourceFilled;
+uniform ivec2 outputFilled;
+uniform vec2 blurDirection;
+uniform float threshold;
+uniform float knee;
+
+vec3 Source(vec2 pixel)
+{
+	// stay inside the filled pixels, so the unused part of a
+	// scaled down frame never bleeds in
+	pixel = clamp(pixel, vec2(0.5), sourceFilled - 0.5);
+	return textureLod(sourceTexture, pixel / sourceSize, 0.0).rgb;
+}
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(pixel, outputFilled)))
+		return;
+	vec2 center = vec2(pixel) + 0.5;
+
+	vec3 color;
+	if (bloomStep == BLUR_STEP)
+	{
+		// five bilinear reads cover the nine taps of a gaussian
+		color = Source(center) * 0.2270270270;
+		color += (Source(center + blurDirection * 1.3846153846) +
+			Source(center - blurDirection * 1.3846153846)) * 0.3162162162;
+		color += (Source(center + blurDirection * 3.2307692308) +
+			Source(center - blurDirection * 3.2307692308)) * 0.0702702703;
+	}
+	else if (bloomStep == COMBINE_STEP)
+	{
+		// the blurred quarter bloom stretched over a tent filter
+		// of the half bloom
+		color = Source(center * 0.5);
+		for (int y = -1; y <= 1; y++)
+		{
+			for (int x = -1; x <= 1; x++)
+			{
+				ivec2 tap = clamp(pixel + ivec2(x, y), ivec2(0), outputFilled - 1);
+				float weight = float((2 - abs(x)) * (2 - abs(y))) / 16.0;
+				color += imageLoad(combineImage, tap).rgb * weight;
+			}
+		}
+	}
+	else
+	{
+		// each bilinear read averages four source pixels, so the
+		// four reads cover the four by four around this pixel
+		vec2 sourceCenter = center * 2.0;
+		color = (Source(sourceCenter + vec2(-1.0, -1.0)) + Source(sourceCenter + vec2(1.0, -1.0)) +
+			Source(sourceCenter + vec2(-1.0, 1.0)) + Source(sourceCenter + vec2(1.0, 1.0))) * 0.25;
+		if (bloomStep == PREFILTER_STEP)
+		{
+			color = min(color, vec3(MAX_BRIGHTNESS));
+			float brightness = max(color.r, max(color.g, color.b));
+			float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+			soft = soft * soft / (4.0 * knee + 0.00001);
+			color *= max(soft, brightness - threshold) / max(brightness, 0.00001);
+		}
+	}
+	imageStore(outputImage, pixel, vec4(color, 1.0));
+}
+)";
+
+	const char* g_FinalVertexShaderSource = R"(
+#version 430
+void main()
+{
+	// one triangle covering the window
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+	const char* g_FinalFragmentShaderSource = R"(
+#version 430
+// edge detection and search limits of the anti-aliasing
+#define EDGE_THRESHOLD 0.125
+#define EDGE_THRESHOLD_MIN 0.0312
+#define REDUCE_MUL 0.125
+#define REDUCE_MIN 0.0078125
+#define SPAN_MAX 8.0
+
+out vec4 outFragmentColor;
+
+uniform sampler2D sceneTexture;
+uniform sampler2D bloomTexture;
+// the scene texture is the size of the window, and the frame
+// fills renderSize pixels of it
+uniform vec2 sceneSize;
+uniform vec2 renderSize;
+uniform vec2 bloomSize;
+uniform vec2 bloomFilled;
+uniform float exposure;
+uniform float bloomStrength;
+uniform float shoulder;
+uniform float saturation;
+uniform float contrast;
+uniform vec3 colorBalance;
+
+vec3 ToneMap(vec3 color)
+{
+	vec3 over = max(color - shoulder, 0.0);
+	return min(color, vec3(shoulder)) + (1.0 - shoulder) * (1.0 - exp(-over / (1.0 - shoulder)));
+}
+
+// the tone mapped color with bloom at a rendered pixel position
+vec3 Shade(vec2 pixel)
+{
+	pixel = clamp(pixel, vec2(0.5), renderSize - 0.5);
+	vec3 color = textureLod(sceneTexture, pixel / sceneSize, 0.0).rgb * exposure;
+	vec2 bloomPixel = min(pixel * 0.5, bloomFilled - 0.5);
+	color += textureLod(bloomTexture, bloomPixel / bloomSize, 0.0).rgb * bloomStrength;
+	return ToneMap(color);
+}
+
+float Luma(vec3 color)
+{
+	return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+void main()
+{
+	vec2 pixel = gl_FragCoord.xy * renderSize / sceneSize;
+
+	vec3 colorM = Shade(pixel);
+	float lumaM = Luma(colorM);
+	float lumaNW = Luma(Shade(pixel + vec2(-1.0, -1.0)));
+	float lumaNE = Luma(Shade(pixel + vec2(1.0, -1.0)));
+	float lumaSW = Luma(Shade(pixel + vec2(-1.0, 1.0)));
+	float lumaSE = Luma(Shade(pixel + vec2(1.0, 1.0)));
+	float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+	float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+	// blend along the edge where the contrast is high enough,
+	// keeping the wider blend unless it crossed into another edge
+	vec3 color = colorM;
+	if (lumaMax - lumaMin >= max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD))
+	{
+		vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+		float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+		float scale = 1.0 / (min(abs(direction.x), abs(direction.y)) + reduce);
+		direction = clamp(direction * scale, vec2(-SPAN_MAX), vec2(SPAN_MAX));
+
+		vec3 colorA = 0.5 * (Shade(pixel + direction * (1.0 / 3.0 - 0.5)) +
+			Shade(pixel + direction * (2.0 / 3.0 - 0.5)));
+		vec3 colorB = colorA * 0.5 + 0.25 * (Shade(pixel - direction * 0.5) +
+			Shade(pixel + direction * 0.5));
+		float lumaB = Luma(colorB);
+		color = ((lumaB < lumaMin) || (lumaB > lumaMax)) ? colorA : colorB;
+	}
+
+	color *= colorBalance;
+	color = mix(vec3(Luma(color)), color, saturation);
+	color = (color - 0.5) * contrast + 0.5;
+	outFragmentColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
+)";
+
+	/***********************************************************
+	 *  CompileProgram()
+	 *
+	 *  Compile and link the passed in shader stages into a
+	 *  program, returning 0 and logging on failure.
+	 ***********************************************************/
+	GLuint CompileProgram(const GLenum types[], const char* const sources[], int stageCount)
+	{
+		GLuint program = glCreateProgram();
+		GLint success = 0;
+		char infoLog[1024];
+
+		for (int i = 0; i < stageCount; i++)
+		{
+			GLuint shader = glCreateShader(types[i]);
+			glShaderSource(shader, 1, &sources[i], NULL);
+			glCompileShader(shader);
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+				std::cout << "ERROR: Post-processing shader compilation failed\n" << infoLog << std::endl;
+				glDeleteShader(shader);
+				glDeleteProgram(program);
+				return 0;
+			}
+			glAttachShader(program, shader);
+			glDeleteShader(shader);
+		}
+
+		glLinkProgram(program);
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+			std::cout << "ERROR: Post-processing shader linking failed\n" << infoLog << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+		return(program);
+	}
+}
+
+/***********************************************************
+ *  PostProcessor()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PostProcessor::PostProcessor()
+{
+	m_bloomProgram = 0;
+	m_finalProgram = 0;
+	m_emptyVertexArray = 0;
+	for (int i = 0; i < BLOOM_TEXTURE_COUNT; i++)
+	{
+		m_bloomTextures[i] = 0;
+	}
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	m_halfWidth = 0;
+	m_halfHeight = 0;
+	m_quarterWidth = 0;
+	m_quarterHeight = 0;
+
+	PASS_TIMER* timers[] = { &m_bloomTimer, &m_finalTimer };
+	for (PASS_TIMER* pTimer : timers)
+	{
+		for (int i = 0; i < TIMER_QUERY_COUNT; i++)
+		{
+			pTimer->queries[i][0] = 0;
+			pTimer->queries[i][1] = 0;
+			pTimer->bPending[i] = false;
+		}
+		pTimer->write = 0;
+		pTimer->read = 0;
+		pTimer->bTiming = false;
+		pTimer->milliseconds = 0.0f;
+	}
+}
+
+/***********************************************************
+ *  ~PostProcessor()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PostProcessor::~PostProcessor()
+{
+	DestroyTextures();
+	if (m_bloomProgram != 0)
+	{
+		glDeleteProgram(m_bloomProgram);
+	}
+	if (m_finalProgram != 0)
+	{
+		glDeleteProgram(m_finalProgram);
+	}
+	if (m_emptyVertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVertexArray);
+		glDeleteQueries(TIMER_QUERY_COUNT * 2, &m_bloomTimer.queries[0][0]);
+		glDeleteQueries(TIMER_QUERY_COUNT * 2, &m_finalTimer.queries[0][0]);
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method compiles the bloom and final programs and
+ *  creates the timer queries.  The bloom textures are made
+ *  on the first frame, once the window size is known.
+ ***********************************************************/
+bool PostProcessor::Initialize()
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "Post-processing needs OpenGL 4.3, showing the frame without it" << std::endl;
+		return(false);
+	}
+
+	const GLenum bloomTypes[] = { GL_COMPUTE_SHADER };
+	const char* const bloomSources[] = { g_BloomShaderSource };
+	const GLenum finalTypes[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const char* const finalSources[] = { g_FinalVertexShaderSource, g_FinalFragmentShaderSource };
+	m_bloomProgram = CompileProgram(bloomTypes, bloomSources, 1);
+	m_finalProgram = CompileProgram(finalTypes, finalSources, 2);
+	if ((m_bloomProgram == 0) || (m_finalProgram == 0))
+	{
+		return(false);
+	}
+
+	glGenVertexArrays(1, &m_emptyVertexArray);
+	glGenQueries(TIMER_QUERY_COUNT * 2, &m_bloomTimer.queries[0][0]);
+	glGenQueries(TIMER_QUERY_COUNT * 2, &m_finalTimer.queries[0][0]);
+
+	std::cout << "INFO: Post-processing enabled, half and quarter resolution bloom" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTextures()
+ *
+ *  This method allocates the bloom chain at half and quarter
+ *  of the scene texture size.  Like the scene texture, they
+ *  are only partly filled while the resolution is scaled
+ *  down, so a scale change never reallocates.
+ ***********************************************************/
+void PostProcessor::CreateTextures(int targetWidth, int targetHeight)
+{
+	DestroyTextures();
+
+	const int halfWidth = (targetWidth + 1) / 2;
+	const int halfHeight = (targetHeight + 1) / 2;
+	const int widths[BLOOM_TEXTURE_COUNT] = { halfWidth, halfWidth, (halfWidth + 1) / 2, (halfWidth + 1) / 2 };
+	const int heights[BLOOM_TEXTURE_COUNT] = { halfHeight, halfHeight, (halfHeight + 1) / 2, (halfHeight + 1) / 2 };
+
+	glGenTextures(BLOOM_TEXTURE_COUNT, m_bloomTextures);
+	for (int i = 0; i < BLOOM_TEXTURE_COUNT; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_bloomTextures[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, widths[i], heights[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_targetWidth = targetWidth;
+	m_targetHeight = targetHeight;
+}
+
+/***********************************************************
+ *  DestroyTextures()
+ *
+ *  This method frees the bloom textures.
+ ***********************************************************/
+void PostProcessor::DestroyTextures()
+{
+	if (m_bloomTextures[0] != 0)
+	{
+		glDeleteTextures(BLOOM_TEXTURE_COUNT, m_bloomTextures);
+		for (int i = 0; i < BLOOM_TEXTURE_COUNT; i++)
+		{
+			m_bloomTextures[i] = 0;
+		}
+	}
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	m_halfWidth = 0;
+	m_halfHeight = 0;
+}
+
+/***********************************************************
+ *  BuildBloom()
+ *
+ *  This method keeps the brightest parts of the frame at half
+ *  resolution, blurs a quarter resolution copy of them, and
+ *  combines the two for the final pass to add back.
+ ***********************************************************/
+void PostProcessor::BuildBloom(GLuint sceneTexture, int targetWidth, int targetHeight, int renderWidth, int renderHeight)
+{
+	if ((targetWidth != m_targetWidth) || (targetHeight != m_targetHeight))
+	{
+		CreateTextures(targetWidth, targetHeight);
+	}
+	CollectTimings(m_bloomTimer);
+	BeginTiming(m_bloomTimer);
+
+	m_halfWidth = (renderWidth + 1) / 2;
+	m_halfHeight = (renderHeight + 1) / 2;
+	m_quarterWidth = (m_halfWidth + 1) / 2;
+	m_quarterHeight = (m_halfHeight + 1) / 2;
+	const glm::vec2 targetSize((float)targetWidth, (float)targetHeight);
+	const glm::vec2 halfSize((float)((targetWidth + 1) / 2), (float)((targetHeight + 1) / 2));
+	const glm::vec2 quarterSize((float)(((targetWidth + 1) / 2 + 1) / 2), (float)(((targetHeight + 1) / 2 + 1) / 2));
+	const glm::vec2 halfFilled((float)m_halfWidth, (float)m_halfHeight);
+	const glm::vec2 quarterFilled((float)m_quarterWidth, (float)m_quarterHeight);
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	GLint activeUnit = GL_TEXTURE0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+
+	// the sources are read on the active unit, which the scene
+	// leaves free for this kind of work
+	glUseProgram(m_bloomProgram);
+	glUniform1i(glGetUniformLocation(m_bloomProgram, "sourceTexture"), activeUnit - GL_TEXTURE0);
+	glUniform1f(glGetUniformLocation(m_bloomProgram, "threshold"), g_BloomThreshold);
+	glUniform1f(glGetUniformLocation(m_bloomProgram, "knee"), g_BloomKnee);
+
+	DispatchStep(g_PrefilterStep, sceneTexture, targetSize, glm::vec2((float)renderWidth, (float)renderHeight),
+		m_bloomTextures[BLOOM_HALF], glm::ivec2(m_halfWidth, m_halfHeight), glm::vec2(0.0f));
+	DispatchStep(g_DownsampleStep, m_bloomTextures[BLOOM_HALF], halfSize, halfFilled,
+		m_bloomTextures[BLOOM_QUARTER], glm::ivec2(m_quarterWidth, m_quarterHeight), glm::vec2(0.0f));
+	DispatchStep(g_BlurStep, m_bloomTextures[BLOOM_QUARTER], quarterSize, quarterFilled,
+		m_bloomTextures[BLOOM_QUARTER_BLURRED], glm::ivec2(m_quarterWidth, m_quarterHeight), glm::vec2(1.0f, 0.0f));
+	DispatchStep(g_BlurStep, m_bloomTextures[BLOOM_QUARTER_BLURRED], quarterSize, quarterFilled,
+		m_bloomTextures[BLOOM_QUARTER], glm::ivec2(m_quarterWidth, m_quarterHeight), glm::vec2(0.0f, 1.0f));
+	glBindImageTexture(1, m_bloomTextures[BLOOM_HALF], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	DispatchStep(g_CombineStep, m_bloomTextures[BLOOM_QUARTER], quarterSize, quarterFilled,
+		m_bloomTextures[BLOOM_HALF_COMBINED], glm::ivec2(m_halfWidth, m_halfHeight), glm::vec2(0.0f));
+
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(previousProgram);
+
+	EndTiming(m_bloomTimer);
+}
+
+/***********************************************************
+ *  DispatchStep()
+ *
+ *  This method runs one step of the bloom chain, then waits
+ *  for its writes before the next step reads them.
+ ***********************************************************/
+void PostProcessor::DispatchStep(int step, GLuint source, glm::vec2 sourceSize, glm::vec2 sourceFilled,
+	GLuint output, glm::ivec2 outputFilled, glm::vec2 blurDirection)
+{
+	glUniform1i(glGetUniformLocation(m_bloomProgram, "bloomStep"), step);
+	glUniform2f(glGetUniformLocation(m_bloomProgram, "sourceSize"), sourceSize.x, sourceSize.y);
+	glUniform2f(glGetUniformLocation(m_bloomProgram, "sourceFilled"), sourceFilled.x, sourceFilled.y);
+	glUniform2i(glGetUniformLocation(m_bloomProgram, "outputFilled"), outputFilled.x, outputFilled.y);
+	glUniform2f(glGetUniformLocation(m_bloomProgram, "blurDirection"), blurDirection.x, blurDirection.y);
+
+	glBindTexture(GL_TEXTURE_2D, source);
+	glBindImageTexture(0, output, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glDispatchCompute(
+		(outputFilled.x + g_BloomGroupSize - 1) / g_BloomGroupSize,
+		(outputFilled.y + g_BloomGroupSize - 1) / g_BloomGroupSize,
+		1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+/***********************************************************
+ *  Present()
+ *
+ *  This method adds the bloom, tone maps, anti-aliases and
+ *  grades the frame in one pass while upscaling it to the
+ *  window.  The scene goes on the active unit and the bloom
+ *  on unit 0, whose texture is put back afterwards.
+ ***********************************************************/
+void PostProcessor::Present(GLuint sceneTexture, int targetWidth, int targetHeight, int renderWidth, int renderHeight)
+{
+	if ((m_bloomTextures[0] == 0) || (m_halfWidth == 0))
+	{
+		return;
+	}
+	CollectTimings(m_finalTimer);
+	BeginTiming(m_finalTimer);
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	GLint activeUnit = GL_TEXTURE0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+	GLint previousUnit0Texture = 0;
+	glActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousUnit0Texture);
+	glBindTexture(GL_TEXTURE_2D, m_bloomTextures[BLOOM_HALF_COMBINED]);
+	glActiveTexture(activeUnit);
+	glBindTexture(GL_TEXTURE_2D, sceneTexture);
+
+	glUseProgram(m_finalProgram);
+	glUniform1i(glGetUniformLocation(m_finalProgram, "sceneTexture"), activeUnit - GL_TEXTURE0);
+	glUniform1i(glGetUniformLocation(m_finalProgram, "bloomTexture"), 0);
+	glUniform2f(glGetUniformLocation(m_finalProgram, "sceneSize"), (float)targetWidth, (float)targetHeight);
+	glUniform2f(glGetUniformLocation(m_finalProgram, "renderSize"), (float)renderWidth, (float)renderHeight);
+	glUniform2f(glGetUniformLocation(m_finalProgram, "bloomSize"),
+		(float)((targetWidth + 1) / 2), (float)((targetHeight + 1) / 2));
+	glUniform2f(glGetUniformLocation(m_finalProgram, "bloomFilled"), (float)m_halfWidth, (float)m_halfHeight);
+	glUniform1f(glGetUniformLocation(m_finalProgram, "exposure"), g_Exposure);
+	glUniform1f(glGetUniformLocation(m_finalProgram, "bloomStrength"), g_BloomStrength);
+	glUniform1f(glGetUniformLocation(m_finalProgram, "shoulder"), g_ToneShoulder);
+	glUniform1f(glGetUniformLocation(m_finalProgram, "saturation"), g_Saturation);
+	glUniform1f(glGetUniformLocation(m_finalProgram, "contrast"), g_Contrast);
+	glUniform3f(glGetUniformLocation(m_finalProgram, "colorBalance"), g_ColorBalance.r, g_ColorBalance.g, g_ColorBalance.b);
+
+	glViewport(0, 0, targetWidth, targetHeight);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glBindVertexArray(m_emptyVertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, previousUnit0Texture);
+	glActiveTexture(activeUnit);
+	glUseProgram(previousProgram);
+
+	EndTiming(m_finalTimer);
+}
+
+/***********************************************************
+ *  BeginTiming()
+ *
+ *  This method stamps the start of a pass, skipping the pass
+ *  rather than waiting on a query still in flight.
+ ***********************************************************/
+void PostProcessor::BeginTiming(PASS_TIMER& timer)
+{
+	timer.bTiming = !timer.bPending[timer.write];
+	if (timer.bTiming)
+	{
+		glQueryCounter(timer.queries[timer.write][0], GL_TIMESTAMP);
+	}
+}
+
+/***********************************************************
+ *  EndTiming()
+ *
+ *  This method stamps the end of a pass.
+ ***********************************************************/
+void PostProcessor::EndTiming(PASS_TIMER& timer)
+{
+	if (timer.bTiming)
+	{
+		glQueryCounter(timer.queries[timer.write][1], GL_TIMESTAMP);
+		timer.bPending[timer.write] = true;
+		timer.write = (timer.write + 1) % TIMER_QUERY_COUNT;
+		timer.bTiming = false;
+	}
+}
+
+/***********************************************************
+ *  CollectTimings()
+ *
+ *  This method reads every pass timing that has finished,
+ *  oldest first, without waiting on the GPU.
+ ***********************************************************/
+void PostProcessor::CollectTimings(PASS_TIMER& timer)
+{
+	while (timer.bPending[timer.read])
+	{
+		GLint bAvailable = 0;
+		glGetQueryObjectiv(timer.queries[timer.read][1], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (!bAvailable)
+		{
+			break;
+		}
+
+		GLuint64 start = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(timer.queries[timer.read][0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(timer.queries[timer.read][1], GL_QUERY_RESULT, &end);
+		timer.bPending[timer.read] = false;
+		timer.read = (timer.read + 1) % TIMER_QUERY_COUNT;
+
+		timer.milliseconds = (end > start) ? (float)((end - start) / 1.0e6) : 0.0f;
+	}
+}
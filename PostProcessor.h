@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// postprocessor.h
+// ============
+// add bloom to the HDR frame, then tone map, grade and anti-alias it
+//
+//  The bright parts of the frame are filtered down to half and
+//  quarter resolution and blurred by compute shaders.  One full
+//  screen pass then adds the bloom, tone maps, smooths the edges,
+//  grades the color and upscales to the window, so the frame is
+//  read and written at full resolution only once.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  PostProcessor
+ *
+ *  This class owns the bloom textures and the post-processing
+ *  programs, and times each pass on the GPU.  It needs
+ *  OpenGL 4.3 for compute shaders and image stores.
+ ***********************************************************/
+class PostProcessor
+{
+public:
+	// constructor
+	PostProcessor();
+	// destructor
+	~PostProcessor();
+
+	// compile the programs, returns false when the OpenGL
+	// context cannot run them
+	bool Initialize();
+
+	// build the bloom of a newly rendered frame, which fills
+	// the bottom left renderWidth by renderHeight pixels of the
+	// HDR scene texture
+	void BuildBloom(GLuint sceneTexture, int targetWidth, int targetHeight, int renderWidth, int renderHeight);
+	// run the fused final pass into the bound framebuffer, which
+	// is the size of the scene texture
+	void Present(GLuint sceneTexture, int targetWidth, int targetHeight, int renderWidth, int renderHeight);
+
+	// GPU time of each pass, a few frames late
+	float GetBloomTime() const { return m_bloomTimer.milliseconds; }
+	float GetFinalTime() const { return m_finalTimer.milliseconds; }
+
+private:
+	// number of timer queries in flight per pass, so that
+	// results are read a few frames late instead of stalling
+	static const int TIMER_QUERY_COUNT = 4;
+
+	// the bloom chain, by texture
+	enum BLOOM_TEXTURE
+	{
+		BLOOM_HALF = 0,
+		BLOOM_HALF_COMBINED,
+		BLOOM_QUARTER,
+		BLOOM_QUARTER_BLURRED,
+		BLOOM_TEXTURE_COUNT
+	};
+
+	// timestamps taken around one pass; two timestamps are used
+	// rather than an elapsed time query, so a pass can run while
+	// the resolution scaler times the frame
+	struct PASS_TIMER
+	{
+		GLuint queries[TIMER_QUERY_COUNT][2];
+		bool bPending[TIMER_QUERY_COUNT];
+		int write;
+		int read;
+		bool bTiming;
+		float milliseconds;
+	};
+
+	// programs and the vertex array of the full screen pass
+	GLuint m_bloomProgram;
+	GLuint m_finalProgram;
+	GLuint m_emptyVertexArray;
+
+	// bloom textures, allocated for the scene texture size
+	GLuint m_bloomTextures[BLOOM_TEXTURE_COUNT];
+	int m_targetWidth;
+	int m_targetHeight;
+	// pixels of the half and quarter textures the last bloom
+	// filled
+	int m_halfWidth;
+	int m_halfHeight;
+	int m_quarterWidth;
+	int m_quarterHeight;
+
+	PASS_TIMER m_bloomTimer;
+	PASS_TIMER m_finalTimer;
+
+	// (re)create the bloom textures for a new scene size
+	void CreateTextures(int targetWidth, int targetHeight);
+	void DestroyTextures();
+	// run one bloom step over the output's filled pixels
+	void DispatchStep(int step, GLuint source, glm::vec2 sourceSize, glm::vec2 sourceFilled,
+		GLuint output, glm::ivec2 outputFilled, glm::vec2 blurDirection);
+
+	void BeginTiming(PASS_TIMER& timer);
+	void EndTiming(PASS_TIMER& timer);
+	// read back the finished queries without waiting
+	void CollectTimings(PASS_TIMER& timer);
+};
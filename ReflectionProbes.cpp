@@ -0,0 +1,606 @@
+///////////////////////////////////////////////////////////////////////////////
+// reflectionprobes.cpp
+// ============
+// capture the scene around the glossy objects into prefiltered cubemaps
+//
+//  Each probe is a cubemap rendered from the center of a glossy object,
+//  then blurred into one mip level per step of roughness, so a material
+//  samples the level matching its shininess.  Probes are rendered in
+//  full once, and afterwards only when an object near them changes, a
+//  single face per frame.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ReflectionProbes.h"
+#include "GPUDrivenRenderer.h"
+#include "UniformCounter.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// objects whose bounds reach this far from a probe are part of
+	// what it reflects, and moving them renders it again
+	const float g_ProbeReach = 15.0f;
+	// depth range of the captures
+	const float g_CaptureNear = 0.1f;
+	const float g_CaptureFar = 100.0f;
+	const int g_FaceCount = 6;
+	const uint8_t g_AllFaces = (1 << g_FaceCount) - 1;
+
+	// the direction and up vector of each cubemap face, in the
+	// order and orientation OpenGL lays out the faces
+	const glm::vec3 g_FaceDirections[g_FaceCount] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+	const glm::vec3 g_FaceUps[g_FaceCount] = {
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+
+	const char* g_FilterVertexShaderSource = R"(
+#version 430
+out vec2 faceCoordinate;
+
+void main()
+{
+	// one triangle covering the face
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	faceCoordinate = corner;
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+	const char* g_FilterFragmentShaderSource = R"(
+#version 430
+#define SAMPLE_COUNT 64
+#define PI 3.14159265
+
+in vec2 faceCoordinate;
+out vec4 outFragmentColor;
+
+uniform samplerCubeArray captureTexture;
+uniform float probeLayer;
+uniform int face;
+// Phong exponent of the blur, or negative for a plain copy
+uniform float exponent;
+uniform float faceSize;
+
+vec3 FaceDirection(vec2 st)
+{
+	if (face == 0) return vec3(1.0, -st.y, -st.x);
+	if (face == 1) return vec3(-1.0, -st.y, st.x);
+	if (face == 2) return vec3(st.x, 1.0, st.y);
+	if (face == 3) return vec3(st.x, -1.0, -st.y);
+	if (face == 4) return vec3(st.x, -st.y, 1.0);
+	return vec3(-st.x, -st.y, -1.0);
+}
+
+void main()
+{
+	vec3 normal = normalize(FaceDirection(faceCoordinate * 2.0 - 1.0));
+	if (exponent < 0.0)
+	{
+		outFragmentColor = vec4(textureLod(captureTexture, vec4(normal, probeLayer), 0.0).rgb, 1.0);
+		return;
+	}
+
+	vec3 up = (abs(normal.y) < 0.999) ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+	vec3 tangent = normalize(cross(up, normal));
+	vec3 bitangent = cross(normal, tangent);
+	float texelAngle = 4.0 * PI / (6.0 * faceSize * faceSize);
+
+	// directions spread like the Phong lobe, each read from the
+	// mip level whose texels cover about its share of the lobe
+	vec3 sum = vec3(0.0);
+	for (int i = 0; i < SAMPLE_COUNT; i++)
+	{
+		float u = (float(i) + 0.5) / float(SAMPLE_COUNT);
+		float v = float(bitfieldReverse(uint(i))) * 2.3283064365386963e-10;
+		float cosTheta = pow(u, 1.0 / (exponent + 1.0));
+		float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+		float phi = 2.0 * PI * v;
+		vec3 direction = tangent * (cos(phi) * sinTheta) + bitangent * (sin(phi) * sinTheta) + normal * cosTheta;
+
+		float density = (exponent + 1.0) / (2.0 * PI) * pow(cosTheta, exponent);
+		float sampleAngle = 1.0 / (float(SAMPLE_COUNT) * density);
+		float level = max(0.5 * log2(sampleAngle / texelAngle) + 1.0, 0.0);
+		sum += textureLod(captureTexture, vec4(direction, probeLayer), level).rgb;
+	}
+	outFragmentColor = vec4(sum / float(SAMPLE_COUNT), 1.0);
+}
+)";
+
+	/***********************************************************
+	 *  CompileFilterProgram()
+	 *
+	 *  Compile and link the prefiltering program, returning 0
+	 *  and logging on failure.
+	 ***********************************************************/
+	GLuint CompileFilterProgram()
+	{
+		const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+		const char* const sources[] = { g_FilterVertexShaderSource, g_FilterFragmentShaderSource };
+		GLuint program = glCreateProgram();
+		GLint success = 0;
+		char infoLog[1024];
+
+		for (int i = 0; i < 2; i++)
+		{
+			GLuint shader = glCreateShader(types[i]);
+			glShaderSource(shader, 1, &sources[i], NULL);
+			glCompileShader(shader);
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+				std::cout << "ERROR: Reflection probe shader compilation failed\n" << infoLog << std::endl;
+				glDeleteShader(shader);
+				glDeleteProgram(program);
+				return 0;
+			}
+			glAttachShader(program, shader);
+			glDeleteShader(shader);
+		}
+
+		glLinkProgram(program);
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+			std::cout << "ERROR: Reflection probe shader linking failed\n" << infoLog << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+		return(program);
+	}
+
+	/***********************************************************
+	 *  CreateCubemapArray()
+	 *
+	 *  Create room for every probe's faces and mip levels on
+	 *  the active texture unit.
+	 ***********************************************************/
+	GLuint CreateCubemapArray()
+	{
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, texture);
+		glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, ReflectionProbes::LEVEL_COUNT, GL_RGBA16F,
+			ReflectionProbes::FACE_SIZE, ReflectionProbes::FACE_SIZE, ReflectionProbes::MAX_PROBES * g_FaceCount);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		return(texture);
+	}
+
+	/***********************************************************
+	 *  HashBytes()
+	 *
+	 *  Fold a block of memory into an FNV-1a hash.
+	 ***********************************************************/
+	void HashBytes(uint64_t& hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	}
+}
+
+/***********************************************************
+ *  ReflectionProbes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ReflectionProbes::ReflectionProbes()
+{
+	m_nextProbe = 0;
+	m_captureTexture = 0;
+	m_filteredTexture = 0;
+	m_depthBuffer = 0;
+	m_framebuffer = 0;
+	m_emptyVertexArray = 0;
+	m_filterProgram = 0;
+}
+
+/***********************************************************
+ *  ~ReflectionProbes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ReflectionProbes::~ReflectionProbes()
+{
+	if (m_captureTexture != 0)
+	{
+		glDeleteTextures(1, &m_captureTexture);
+		glDeleteTextures(1, &m_filteredTexture);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteVertexArrays(1, &m_emptyVertexArray);
+	}
+	if (m_filterProgram != 0)
+	{
+		glDeleteProgram(m_filterProgram);
+	}
+	m_probes.clear();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method compiles the prefiltering program and makes
+ *  the cubemap arrays for the most probes there can be, so
+ *  placing probes never allocates.
+ ***********************************************************/
+bool ReflectionProbes::Initialize(int textureUnit)
+{
+	m_filterProgram = CompileFilterProgram();
+	if (m_filterProgram == 0)
+	{
+		return(false);
+	}
+
+	// the captures are made on the active unit, which the scene
+	// leaves free for this kind of work
+	m_captureTexture = CreateCubemapArray();
+
+	GLint activeUnit = GL_TEXTURE0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	m_filteredTexture = CreateCubemapArray();
+	glActiveTexture(activeUnit);
+
+	// blurred levels read across the face edges
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, FACE_SIZE, FACE_SIZE);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	glGenVertexArrays(1, &m_emptyVertexArray);
+
+	std::cout << "INFO: Reflection probes enabled, " << FACE_SIZE << " texel faces with "
+		<< LEVEL_COUNT << " roughness levels" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  PlaceProbes()
+ *
+ *  This method keeps the probes whose objects are still
+ *  glossy, so their captures stay valid, then adds probes
+ *  for new glossy objects while there is room.  A removed
+ *  probe shifts the ones after it down a layer, so those
+ *  are captured again.
+ ***********************************************************/
+void ReflectionProbes::PlaceProbes(
+	const ObjectStore& objects,
+	const std::vector<unsigned char>& glossy,
+	std::vector<int>& objectProbes)
+{
+	const int objectCount = objects.GetCount();
+	const glm::vec4* bounds = objects.GetBounds();
+	objectProbes.assign(objectCount, -1);
+
+	std::vector<PROBE> probes;
+	bool bShifted = false;
+	for (const PROBE& probe : m_probes)
+	{
+		int index = objects.GetIndex(probe.owner);
+		if ((index < 0) || (glossy[index] == 0))
+		{
+			bShifted = true;
+			continue;
+		}
+
+		PROBE kept = probe;
+		kept.ownerIndex = index;
+		kept.position = glm::vec3(bounds[index]);
+		if (bShifted)
+		{
+			kept.signature = 0;
+			kept.bRendered = false;
+		}
+		objectProbes[index] = (int)probes.size();
+		probes.push_back(kept);
+	}
+	for (int i = 0; (i < objectCount) && ((int)probes.size() < MAX_PROBES); i++)
+	{
+		if ((glossy[i] != 0) && (objectProbes[i] < 0))
+		{
+			PROBE probe;
+			probe.owner = objects.GetHandle(i);
+			probe.ownerIndex = i;
+			probe.position = glm::vec3(bounds[i]);
+			probe.signature = 0;
+			probe.dirtyFaces = g_AllFaces;
+			probe.bRendered = false;
+			objectProbes[i] = (int)probes.size();
+			probes.push_back(probe);
+		}
+	}
+	m_probes.swap(probes);
+	if (m_nextProbe >= (int)m_probes.size())
+	{
+		m_nextProbe = 0;
+	}
+
+	// the glossy objects left over reflect the nearest probe
+	for (int i = 0; i < objectCount; i++)
+	{
+		if ((glossy[i] == 0) || (objectProbes[i] >= 0))
+		{
+			continue;
+		}
+		float nearest = 0.0f;
+		for (int p = 0; p < (int)m_probes.size(); p++)
+		{
+			glm::vec3 offset = m_probes[p].position - glm::vec3(bounds[i]);
+			float distance = glm::dot(offset, offset);
+			if ((objectProbes[i] < 0) || (distance < nearest))
+			{
+				objectProbes[i] = p;
+				nearest = distance;
+			}
+		}
+	}
+
+	for (PROBE& probe : m_probes)
+	{
+		uint64_t signature = ComputeSignature(objects, probe.position);
+		if (signature != probe.signature)
+		{
+			probe.signature = signature;
+			probe.dirtyFaces = g_AllFaces;
+		}
+	}
+}
+
+/***********************************************************
+ *  ComputeSignature()
+ *
+ *  This method hashes the probe's position and everything
+ *  that changes how the objects within its reach look.
+ ***********************************************************/
+uint64_t ReflectionProbes::ComputeSignature(const ObjectStore& objects, glm::vec3 position) const
+{
+	const glm::vec4* bounds = objects.GetBounds();
+	const glm::mat4* models = objects.GetModelMatrices();
+	const glm::vec4* colors = objects.GetColors();
+	const MESH_TYPE* meshes = objects.GetMeshes();
+	const int* materials = objects.GetMaterials();
+	const int* textures = objects.GetTextures();
+	const uint8_t* flags = objects.GetFlags();
+
+	uint64_t hash = 14695981039346656037ull;
+	HashBytes(hash, &position, sizeof(position));
+	for (int i = 0; i < objects.GetCount(); i++)
+	{
+		float reach = g_ProbeReach + bounds[i].w;
+		glm::vec3 offset = glm::vec3(bounds[i]) - position;
+		if (glm::dot(offset, offset) > reach * reach)
+		{
+			continue;
+		}
+		HashBytes(hash, &i, sizeof(i));
+		HashBytes(hash, &models[i], sizeof(glm::mat4));
+		HashBytes(hash, &colors[i], sizeof(glm::vec4));
+		HashBytes(hash, &meshes[i], sizeof(MESH_TYPE));
+		HashBytes(hash, &materials[i], sizeof(int));
+		HashBytes(hash, &textures[i], sizeof(int));
+		HashBytes(hash, &flags[i], sizeof(uint8_t));
+	}
+	// never the zero that marks a probe as not yet hashed
+	return((hash != 0) ? hash : 1);
+}
+
+/***********************************************************
+ *  MarkAllDirty()
+ *
+ *  This method queues every face of every probe.
+ ***********************************************************/
+void ReflectionProbes::MarkAllDirty()
+{
+	for (PROBE& probe : m_probes)
+	{
+		probe.dirtyFaces = g_AllFaces;
+	}
+}
+
+/***********************************************************
+ *  HasDirtyFaces()
+ *
+ *  This method tells whether any probe is out of date.
+ ***********************************************************/
+bool ReflectionProbes::HasDirtyFaces() const
+{
+	for (const PROBE& probe : m_probes)
+	{
+		if (probe.dirtyFaces != 0)
+		{
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  GetTextureBytes()
+ *
+ *  This method adds up both cubemap arrays, each level a
+ *  quarter of the one before.
+ ***********************************************************/
+size_t ReflectionProbes::GetTextureBytes() const
+{
+	if (m_captureTexture == 0)
+	{
+		return(0);
+	}
+
+	size_t bytes = 0;
+	for (int level = 0; level < LEVEL_COUNT; level++)
+	{
+		size_t size = (size_t)(FACE_SIZE >> level);
+		// four half floats per texel
+		bytes += size * size * 8 * MAX_PROBES * g_FaceCount;
+	}
+	return(bytes * 2);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method renders the out of date probe faces, taking
+ *  the probes in turn.  A probe never rendered is done in
+ *  full at once, as its faces hold nothing yet; after that
+ *  at most faceBudget faces are rendered per call.  The
+ *  bound framebuffer and its state are put back after.
+ ***********************************************************/
+void ReflectionProbes::Update(GPUDrivenRenderer& renderer, int faceBudget, SceneManager::FRAME_STATS& stats)
+{
+	if (!HasDirtyFaces())
+	{
+		return;
+	}
+
+	GLint previousFramebuffer = 0;
+	GLint viewport[4];
+	GLfloat clearColor[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+	GLboolean bDepthTest = glIsEnabled(GL_DEPTH_TEST);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+	int faceCount = 0;
+	for (int visited = 0; (visited < (int)m_probes.size()) && (faceCount < faceBudget); visited++)
+	{
+		int p = m_nextProbe;
+		m_nextProbe = (m_nextProbe + 1) % (int)m_probes.size();
+		PROBE& probe = m_probes[p];
+		if (probe.dirtyFaces == 0)
+		{
+			continue;
+		}
+
+		uint8_t faces = 0;
+		for (int face = 0; face < g_FaceCount; face++)
+		{
+			if ((probe.dirtyFaces & (1 << face)) && (!probe.bRendered || (faceCount < faceBudget)))
+			{
+				glEnable(GL_DEPTH_TEST);
+				CaptureFace(renderer, p, face, stats);
+				faces |= (uint8_t)(1 << face);
+				if (probe.bRendered)
+				{
+					faceCount++;
+				}
+			}
+		}
+
+		// the blur reads the neighbouring faces through the mipmaps
+		// of the whole capture
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_captureTexture);
+		glGenerateMipmap(GL_TEXTURE_CUBE_MAP_ARRAY);
+		glDisable(GL_DEPTH_TEST);
+		for (int face = 0; face < g_FaceCount; face++)
+		{
+			if (faces & (1 << face))
+			{
+				FilterFace(p, face, stats);
+			}
+		}
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+		probe.dirtyFaces &= (uint8_t)~faces;
+		probe.bRendered = true;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+	if (bDepthTest)
+		glEnable(GL_DEPTH_TEST);
+	else
+		glDisable(GL_DEPTH_TEST);
+}
+
+/***********************************************************
+ *  CaptureFace()
+ *
+ *  This method draws the scene around a probe, less the
+ *  object it sits in, into one face of the capture.
+ ***********************************************************/
+void ReflectionProbes::CaptureFace(GPUDrivenRenderer& renderer, int probe, int face, SceneManager::FRAME_STATS& stats)
+{
+	const PROBE& target = m_probes[probe];
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_captureTexture, 0, probe * g_FaceCount + face);
+	glViewport(0, 0, FACE_SIZE, FACE_SIZE);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glm::mat4 view = glm::lookAt(target.position, target.position + g_FaceDirections[face], g_FaceUps[face]);
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, g_CaptureNear, g_CaptureFar);
+	renderer.Render(view, projection, target.position, false, stats, target.ownerIndex);
+}
+
+/***********************************************************
+ *  FilterFace()
+ *
+ *  This method fills each level of one filtered face with
+ *  the capture blurred by the Phong lobe of the shininess
+ *  that level stands for.  The level a material samples is
+ *  found the same way in the draw shader.
+ ***********************************************************/
+void ReflectionProbes::FilterFace(int probe, int face, SceneManager::FRAME_STATS& stats)
+{
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	GLint activeUnit = GL_TEXTURE0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+
+	UniformCounter uniforms(NULL, stats.uniformUploads);
+	glUseProgram(m_filterProgram);
+	uniforms.Uniform1i(glGetUniformLocation(m_filterProgram, "captureTexture"), activeUnit - GL_TEXTURE0);
+	uniforms.Uniform1f(glGetUniformLocation(m_filterProgram, "probeLayer"), (float)probe);
+	uniforms.Uniform1i(glGetUniformLocation(m_filterProgram, "face"), face);
+	uniforms.Uniform1f(glGetUniformLocation(m_filterProgram, "faceSize"), (float)FACE_SIZE);
+	GLint exponentLocation = glGetUniformLocation(m_filterProgram, "exponent");
+
+	glBindVertexArray(m_emptyVertexArray);
+	for (int level = 0; level < LEVEL_COUNT; level++)
+	{
+		// roughness rises evenly over the levels, and shininess
+		// s has a roughness of sqrt(2 / (s + 2))
+		float roughness = (float)level / (LEVEL_COUNT - 1);
+		float exponent = (level == 0) ? -1.0f : std::max(2.0f / (roughness * roughness) - 2.0f, 0.0f);
+		uniforms.Uniform1f(exponentLocation, exponent);
+
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_filteredTexture, level, probe * g_FaceCount + face);
+		glViewport(0, 0, FACE_SIZE >> level, FACE_SIZE >> level);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		stats.drawCalls++;
+	}
+	glBindVertexArray(0);
+
+	glUseProgram(previousProgram);
+}
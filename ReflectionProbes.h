@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// reflectionprobes.h
+// ============
+// capture the scene around the glossy objects into prefiltered cubemaps
+//
+//  Each probe is a cubemap rendered from the center of a glossy object,
+//  then blurred into one mip level per step of roughness, so a material
+//  samples the level matching its shininess.  Probes are rendered in
+//  full once, and afterwards only when an object near them changes, a
+//  single face per frame.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ObjectStore.h"
+#include "SceneManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class GPUDrivenRenderer;
+
+/***********************************************************
+ *  ReflectionProbes
+ *
+ *  This class owns the probe cubemaps, kept as one cubemap
+ *  array so the draw shader can index them per object, and
+ *  the program that prefilters them.  The probes are drawn
+ *  through the GPU-driven renderer, and need OpenGL 4.3
+ *  like it.
+ ***********************************************************/
+class ReflectionProbes
+{
+public:
+	// constructor
+	ReflectionProbes();
+	// destructor
+	~ReflectionProbes();
+
+	// probes placed at most; glossy objects past this many share
+	// the nearest probe
+	static const int MAX_PROBES = 8;
+	// size of a cubemap face, and its mip levels from sharp to
+	// the roughest blur
+	static const int FACE_SIZE = 64;
+	static const int LEVEL_COUNT = 5;
+
+	// create the cubemaps, with the filtered ones bound on the
+	// passed in texture unit, false when the program fails
+	bool Initialize(int textureUnit);
+
+	// place a probe at each glossy object and pick the probe each
+	// object reflects, -1 for an object that is not glossy; probes
+	// whose surroundings changed since they were rendered are
+	// marked for rendering again
+	void PlaceProbes(
+		const ObjectStore& objects,
+		const std::vector<unsigned char>& glossy,
+		std::vector<int>& objectProbes);
+	// render every probe again, after the lights or materials changed
+	void MarkAllDirty();
+	bool HasDirtyFaces() const;
+
+	// render and prefilter up to faceBudget probe faces that are
+	// out of date, counting the work into the frame's stats
+	void Update(GPUDrivenRenderer& renderer, int faceBudget, SceneManager::FRAME_STATS& stats);
+
+	int GetProbeCount() const { return (int)m_probes.size(); }
+	// GPU memory of the captured and filtered cubemaps
+	size_t GetTextureBytes() const;
+
+private:
+	struct PROBE
+	{
+		// the glossy object the probe sits in, hidden from its
+		// own capture so the probe sees past it
+		ObjectStore::OBJECT_HANDLE owner;
+		int ownerIndex;
+		glm::vec3 position;
+		// hash of everything near the probe, as last rendered
+		uint64_t signature;
+		// one bit per face still to render
+		uint8_t dirtyFaces;
+		// false until the first full capture
+		bool bRendered;
+	};
+
+	std::vector<PROBE> m_probes;
+	// probe rendered last, so the faces are spread over the probes
+	int m_nextProbe;
+
+	// the raw captures with plain mipmaps, and the prefiltered
+	// cubemaps the draw shader samples
+	GLuint m_captureTexture;
+	GLuint m_filteredTexture;
+	GLuint m_depthBuffer;
+	GLuint m_framebuffer;
+	GLuint m_emptyVertexArray;
+	GLuint m_filterProgram;
+
+	// hash of the objects within reach of a probe
+	uint64_t ComputeSignature(const ObjectStore& objects, glm::vec3 position) const;
+	// draw one face of a probe and blur it into every level
+	void CaptureFace(GPUDrivenRenderer& renderer, int probe, int face, SceneManager::FRAME_STATS& stats);
+	void FilterFace(int probe, int face, SceneManager::FRAME_STATS& stats);
+};
@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendercommands.cpp
+// ============
+// record draw work as plain data that any thread can build
+//
+//  A command list holds the state changes and draws for part of the
+//  scene without touching OpenGL, so lists can be filled by worker
+//  threads and replayed in order by the thread that owns the context.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderCommands.h"
+
+#include <climits>
+
+// declaration of global variables
+namespace
+{
+	// texture state values used by the redundancy filter, kept
+	// clear of every slot and material index, -1 included
+	const int g_StateUnknown = INT_MIN;
+	const int g_TextureOff = INT_MIN + 1;
+}
+
+/***********************************************************
+ *  RenderCommandList()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderCommandList::RenderCommandList()
+{
+	m_currentTexture = g_StateUnknown;
+	m_currentMaterial = g_StateUnknown;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method empties the list for the next frame.
+ ***********************************************************/
+void RenderCommandList::Clear()
+{
+	m_commands.clear();
+	m_matrices.clear();
+	m_colors.clear();
+	m_currentTexture = g_StateUnknown;
+	m_currentMaterial = g_StateUnknown;
+}
+
+/***********************************************************
+ *  Append()
+ *
+ *  This method adds one command to the end of the list.
+ ***********************************************************/
+void RenderCommandList::Append(COMMAND_TYPE type, int argument)
+{
+	RENDER_COMMAND command;
+	command.type = type;
+	command.argument = argument;
+	m_commands.push_back(command);
+}
+
+/***********************************************************
+ *  SetModel()
+ *
+ *  This method records the model matrix for the next draw.
+ ***********************************************************/
+void RenderCommandList::SetModel(const glm::mat4& model)
+{
+	Append(CMD_SET_MODEL, (int)m_matrices.size());
+	m_matrices.push_back(model);
+}
+
+/***********************************************************
+ *  SetColor()
+ *
+ *  This method records a solid color for the next draw.
+ ***********************************************************/
+void RenderCommandList::SetColor(const glm::vec4& color)
+{
+	Append(CMD_SET_COLOR, (int)m_colors.size());
+	m_colors.push_back(color);
+	m_currentTexture = g_TextureOff;
+}
+
+/***********************************************************
+ *  SetTexture()
+ *
+ *  This method records the texture slot for the next draw.
+ ***********************************************************/
+void RenderCommandList::SetTexture(int textureSlot)
+{
+	if (textureSlot != m_currentTexture)
+	{
+		Append(CMD_SET_TEXTURE, textureSlot);
+		m_currentTexture = textureSlot;
+	}
+}
+
+/***********************************************************
+ *  DisableTexture()
+ *
+ *  This method records that the next draw is untextured.
+ ***********************************************************/
+void RenderCommandList::DisableTexture()
+{
+	if (m_currentTexture != g_TextureOff)
+	{
+		Append(CMD_DISABLE_TEXTURE, 0);
+		m_currentTexture = g_TextureOff;
+	}
+}
+
+/***********************************************************
+ *  SetMaterial()
+ *
+ *  This method records the material for the next draw.
+ ***********************************************************/
+void RenderCommandList::SetMaterial(int materialIndex)
+{
+	if (materialIndex != m_currentMaterial)
+	{
+		Append(CMD_SET_MATERIAL, materialIndex);
+		m_currentMaterial = materialIndex;
+	}
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method records a draw of one basic shape mesh.
+ ***********************************************************/
+void RenderCommandList::DrawMesh(MESH_TYPE mesh)
+{
+	Append(CMD_DRAW_MESH, (int)mesh);
+}
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendercommands.h
+// ============
+// record draw work as plain data that any thread can build
+//
+//  A command list holds the state changes and draws for part of the
+//  scene without touching OpenGL, so lists can be filled by worker
+//  threads and replayed in order by the thread that owns the context.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshPool.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  RenderCommandList
+ *
+ *  This class stores a sequence of render commands.  The
+ *  matrix and color arguments live in their own arrays so
+ *  the command stream itself stays small.  Changes that
+ *  repeat the state already recorded in the list are
+ *  skipped.
+ ***********************************************************/
+class RenderCommandList
+{
+public:
+	// constructor
+	RenderCommandList();
+
+	enum COMMAND_TYPE
+	{
+		// argument indexes the matrix array
+		CMD_SET_MODEL = 0,
+		// argument indexes the color array, turns texturing off
+		CMD_SET_COLOR,
+		// argument is the texture slot, turns texturing on
+		CMD_SET_TEXTURE,
+		// turns texturing off and keeps the current color
+		CMD_DISABLE_TEXTURE,
+		// argument is the material index
+		CMD_SET_MATERIAL,
+		// argument is the MESH_TYPE to draw
+		CMD_DRAW_MESH
+	};
+
+	struct RENDER_COMMAND
+	{
+		COMMAND_TYPE type;
+		int argument;
+	};
+
+	// empty the list, keeping its memory for the next frame
+	void Clear();
+
+	void SetModel(const glm::mat4& model);
+	void SetColor(const glm::vec4& color);
+	void SetTexture(int textureSlot);
+	void DisableTexture();
+	void SetMaterial(int materialIndex);
+	void DrawMesh(MESH_TYPE mesh);
+
+	const std::vector<RENDER_COMMAND>& GetCommands() const { return m_commands; }
+	const glm::mat4& GetMatrix(int index) const { return m_matrices[index]; }
+	const glm::vec4& GetColor(int index) const { return m_colors[index]; }
+
+private:
+	std::vector<RENDER_COMMAND> m_commands;
+	std::vector<glm::mat4> m_matrices;
+	std::vector<glm::vec4> m_colors;
+
+	// state recorded so far in this list; -1 means unknown,
+	// since the list may be replayed after any other list
+	int m_currentTexture;
+	int m_currentMaterial;
+
+	void Append(COMMAND_TYPE type, int argument);
+};
@@ -0,0 +1,341 @@
+///////////////////////////////////////////////////////////////////////////////
+// resolutionscaler.cpp
+// ============
+// render the scene offscreen at a resolution that holds a frame budget
+//
+//  The scene is drawn into an offscreen framebuffer through a scaled
+//  viewport.  GPU timer queries measure each frame, and the scale is
+//  steered toward the frame budget before the final upscale to the
+//  window.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResolutionScaler.h"
+#include "PostProcessor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// default GPU budget, one frame at 60 Hz
+	const float g_DefaultFrameBudget = 16.6f;
+	// smoothing applied to the measured GPU time
+	const float g_TimeSmoothing = 0.1f;
+	// fraction of the scale error corrected per measurement
+	const float g_ScaleGain = 0.25f;
+	// the budget ratio band inside which the scale is held,
+	// which keeps the resolution from hunting every frame
+	const float g_HoldBandLow = 0.95f;
+	const float g_HoldBandHigh = 1.10f;
+	// samples above this are treated as invalid; some drivers,
+	// Mesa's llvmpipe among them, report one for the first query
+	const float g_MaxValidSample = 1000.0f;
+	// single hitches are clamped to this multiple of the budget
+	// so one stall cannot drag the scale down for many frames
+	const float g_MaxSampleOverBudget = 4.0f;
+}
+
+/***********************************************************
+ *  ResolutionScaler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ResolutionScaler::ResolutionScaler()
+{
+	m_pPostProcessor = NULL;
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_depthTexture = 0;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_scale = 1.0f;
+	m_minimumScale = 0.5f;
+	m_frameBudget = g_DefaultFrameBudget;
+	m_gpuTime = 0.0f;
+	for (int i = 0; i < TIMER_QUERY_COUNT; i++)
+	{
+		m_timerQueries[i] = 0;
+		m_bQueryPending[i] = false;
+	}
+	m_queryWrite = 0;
+	m_queryRead = 0;
+	m_bTiming = false;
+}
+
+/***********************************************************
+ *  ~ResolutionScaler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ResolutionScaler::~ResolutionScaler()
+{
+	DestroyTargets();
+	if (m_timerQueries[0] != 0)
+	{
+		glDeleteQueries(TIMER_QUERY_COUNT, m_timerQueries);
+	}
+}
+
+/***********************************************************
+ *  SetFrameBudget()
+ *
+ *  This method sets the GPU frame time to hold.
+ ***********************************************************/
+void ResolutionScaler::SetFrameBudget(float milliseconds)
+{
+	m_frameBudget = std::max(milliseconds, 0.1f);
+}
+
+/***********************************************************
+ *  SetMinimumScale()
+ *
+ *  This method sets the lowest resolution scale allowed.
+ ***********************************************************/
+void ResolutionScaler::SetMinimumScale(float scale)
+{
+	m_minimumScale = std::min(std::max(scale, 0.1f), 1.0f);
+	m_scale = std::max(m_scale, m_minimumScale);
+}
+
+/***********************************************************
+ *  SetPostProcessor()
+ *
+ *  This method sets the post processor the frames are shown
+ *  through.  The render target is made again on the next
+ *  frame, in the color format the post processor reads.
+ ***********************************************************/
+void ResolutionScaler::SetPostProcessor(PostProcessor* pPostProcessor)
+{
+	m_pPostProcessor = pPostProcessor;
+	DestroyTargets();
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method allocates the color and depth textures at
+ *  the full window size.  Scaling only shrinks the viewport
+ *  inside them, so a scale change never reallocates.  With
+ *  post-processing the color is half float, which keeps the
+ *  light above white for the bloom.
+ ***********************************************************/
+void ResolutionScaler::CreateTargets(int width, int height)
+{
+	DestroyTargets();
+
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	if (NULL != m_pPostProcessor)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+	else
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: Offscreen render target is incomplete" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_targetWidth = width;
+	m_targetHeight = height;
+}
+
+/***********************************************************
+ *  DestroyTargets()
+ *
+ *  This method frees the offscreen render target.
+ ***********************************************************/
+void ResolutionScaler::DestroyTargets()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteTextures(1, &m_colorTexture);
+		glDeleteTextures(1, &m_depthTexture);
+		m_framebuffer = 0;
+		m_colorTexture = 0;
+		m_depthTexture = 0;
+	}
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method follows window resizes, applies the current
+ *  scale to the viewport, binds the offscreen target and
+ *  starts timing the frame.
+ ***********************************************************/
+bool ResolutionScaler::BeginFrame(int windowWidth, int windowHeight)
+{
+	// nothing to draw into while the window is minimized
+	if ((windowWidth <= 0) || (windowHeight <= 0))
+	{
+		return(false);
+	}
+
+	if (m_timerQueries[0] == 0)
+	{
+		glGenQueries(TIMER_QUERY_COUNT, m_timerQueries);
+	}
+	if ((windowWidth != m_targetWidth) || (windowHeight != m_targetHeight))
+	{
+		CreateTargets(windowWidth, windowHeight);
+	}
+
+	CollectTimings();
+
+	m_renderWidth = std::max(1, (int)(windowWidth * m_scale + 0.5f));
+	m_renderHeight = std::max(1, (int)(windowHeight * m_scale + 0.5f));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+
+	// skip timing this frame rather than wait on a query the
+	// GPU has not finished with yet
+	m_bTiming = !m_bQueryPending[m_queryWrite];
+	if (m_bTiming)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, m_timerQueries[m_queryWrite]);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method stops timing the frame and upscales it to
+ *  the display window.  The bloom is built inside the timed
+ *  part, as its cost follows the scaled resolution.
+ ***********************************************************/
+void ResolutionScaler::EndFrame()
+{
+	if (NULL != m_pPostProcessor)
+	{
+		m_pPostProcessor->BuildBloom(m_colorTexture, m_targetWidth, m_targetHeight, m_renderWidth, m_renderHeight);
+	}
+
+	if (m_bTiming)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_bQueryPending[m_queryWrite] = true;
+		m_queryWrite = (m_queryWrite + 1) % TIMER_QUERY_COUNT;
+		m_bTiming = false;
+	}
+
+	Present();
+}
+
+/***********************************************************
+ *  Present()
+ *
+ *  This method stretches the rendered viewport over the
+ *  whole window with linear filtering, or through the post
+ *  processor's final pass, which upscales as it goes.
+ ***********************************************************/
+void ResolutionScaler::Present()
+{
+	if (m_framebuffer == 0)
+	{
+		return;
+	}
+
+	if (NULL != m_pPostProcessor)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		m_pPostProcessor->Present(m_colorTexture, m_targetWidth, m_targetHeight, m_renderWidth, m_renderHeight);
+		return;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_targetWidth, m_targetHeight);
+	glBlitFramebuffer(
+		0, 0, m_renderWidth, m_renderHeight,
+		0, 0, m_targetWidth, m_targetHeight,
+		GL_COLOR_BUFFER_BIT,
+		(m_renderWidth == m_targetWidth) ? GL_NEAREST : GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  CollectTimings()
+ *
+ *  This method reads every timer query that has finished,
+ *  oldest first, without waiting on the GPU.
+ ***********************************************************/
+void ResolutionScaler::CollectTimings()
+{
+	while (m_bQueryPending[m_queryRead])
+	{
+		GLint bAvailable = 0;
+		glGetQueryObjectiv(m_timerQueries[m_queryRead], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (!bAvailable)
+		{
+			break;
+		}
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(m_timerQueries[m_queryRead], GL_QUERY_RESULT, &elapsed);
+		m_bQueryPending[m_queryRead] = false;
+		m_queryRead = (m_queryRead + 1) % TIMER_QUERY_COUNT;
+
+		UpdateScale((float)(elapsed / 1.0e6));
+	}
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  This method steers the resolution scale toward the frame
+ *  budget.  Shading cost follows the pixel count, which is
+ *  the square of the scale, so the correction uses the
+ *  square root of the budget ratio.
+ ***********************************************************/
+void ResolutionScaler::UpdateScale(float gpuMilliseconds)
+{
+	if (gpuMilliseconds > g_MaxValidSample)
+	{
+		return;
+	}
+	gpuMilliseconds = std::min(gpuMilliseconds, m_frameBudget * g_MaxSampleOverBudget);
+
+	if (m_gpuTime <= 0.0f)
+		m_gpuTime = gpuMilliseconds;
+	else
+		m_gpuTime += (gpuMilliseconds - m_gpuTime) * g_TimeSmoothing;
+
+	if (m_gpuTime <= 0.0f)
+	{
+		return;
+	}
+
+	float ratio = m_frameBudget / m_gpuTime;
+	if ((ratio < g_HoldBandLow) || (ratio > g_HoldBandHigh))
+	{
+		float desiredScale = m_scale * sqrtf(ratio);
+		m_scale += (desiredScale - m_scale) * g_ScaleGain;
+		m_scale = std::min(std::max(m_scale, m_minimumScale), 1.0f);
+	}
+}
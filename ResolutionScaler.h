@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// resolutionscaler.h
+// ============
+// render the scene offscreen at a resolution that holds a frame budget
+//
+//  The scene is drawn into an offscreen framebuffer through a scaled
+//  viewport.  GPU timer queries measure each frame, and the scale is
+//  steered toward the frame budget before the final upscale to the
+//  window.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+class PostProcessor;
+
+/***********************************************************
+ *  ResolutionScaler
+ *
+ *  This class owns the offscreen render target, measures
+ *  the GPU time of each frame, and upscales the result to
+ *  the display window.
+ ***********************************************************/
+class ResolutionScaler
+{
+public:
+	// constructor
+	ResolutionScaler();
+	// destructor
+	~ResolutionScaler();
+
+	// set the GPU frame time to hold, in milliseconds
+	void SetFrameBudget(float milliseconds);
+	// set the lowest allowed fraction of the window resolution
+	void SetMinimumScale(float scale);
+	// render into an HDR target and show the frame through the
+	// post processor instead of a plain upscale, or NULL for none
+	void SetPostProcessor(PostProcessor* pPostProcessor);
+
+	// bind the offscreen target at the current scale and start
+	// timing, returns false when the window has no area
+	bool BeginFrame(int windowWidth, int windowHeight);
+	// stop timing and upscale the frame to the window
+	void EndFrame();
+	// upscale the last rendered frame to the window again
+	void Present();
+
+	float GetScale() const { return m_scale; }
+	float GetGPUTime() const { return m_gpuTime; }
+	int GetRenderWidth() const { return m_renderWidth; }
+	int GetRenderHeight() const { return m_renderHeight; }
+
+private:
+	// number of timer queries in flight, so that results are
+	// read a few frames late instead of stalling the pipeline
+	static const int TIMER_QUERY_COUNT = 4;
+
+	// post-processing of each frame, or NULL
+	PostProcessor* m_pPostProcessor;
+
+	// offscreen render target, allocated at the window size
+	GLuint m_framebuffer;
+	GLuint m_colorTexture;
+	GLuint m_depthTexture;
+	int m_targetWidth;
+	int m_targetHeight;
+
+	// the scaled viewport inside the render target
+	int m_renderWidth;
+	int m_renderHeight;
+
+	// controller state
+	float m_scale;
+	float m_minimumScale;
+	float m_frameBudget;
+	float m_gpuTime;
+
+	// GPU timer queries
+	GLuint m_timerQueries[TIMER_QUERY_COUNT];
+	bool m_bQueryPending[TIMER_QUERY_COUNT];
+	int m_queryWrite;
+	int m_queryRead;
+	bool m_bTiming;
+
+	// (re)create the render target for a new window size
+	void CreateTargets(int width, int height);
+	void DestroyTargets();
+	// read back finished timer queries and update the scale
+	void CollectTimings();
+	void UpdateScale(float gpuMilliseconds);
+};
@@ -0,0 +1,486 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// answer ray queries against the scene objects and their triangles
+//
+//  A bounding volume hierarchy over the objects' bounds finds the few
+//  objects a ray can touch, and a hierarchy over each mesh's triangles,
+//  built the first time the mesh is hit, finds the exact surface.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// most items a leaf holds before it is split
+	const int g_LeafSize = 4;
+	// deeper than any tree a median split builds from an int count
+	const int g_StackSize = 64;
+
+	// the item bounds and centers a tree is built from
+	struct BUILD_ITEMS
+	{
+		std::vector<glm::vec3> mins;
+		std::vector<glm::vec3> maxs;
+		std::vector<glm::vec3> centers;
+	};
+
+	/***********************************************************
+	 *  BuildNode()
+	 *
+	 *  This function builds the node over a range of items,
+	 *  splitting it at the median center along the longest
+	 *  axis of the centers, and returns the node's index.
+	 ***********************************************************/
+	int BuildNode(
+		std::vector<SceneBVH::BVH_NODE>& nodes,
+		std::vector<int>& items,
+		const BUILD_ITEMS& build,
+		int begin,
+		int end)
+	{
+		int nodeIndex = (int)nodes.size();
+		nodes.push_back(SceneBVH::BVH_NODE());
+
+		glm::vec3 boundsMin(FLT_MAX);
+		glm::vec3 boundsMax(-FLT_MAX);
+		glm::vec3 centerMin(FLT_MAX);
+		glm::vec3 centerMax(-FLT_MAX);
+		for (int i = begin; i < end; i++)
+		{
+			boundsMin = glm::min(boundsMin, build.mins[items[i]]);
+			boundsMax = glm::max(boundsMax, build.maxs[items[i]]);
+			centerMin = glm::min(centerMin, build.centers[items[i]]);
+			centerMax = glm::max(centerMax, build.centers[items[i]]);
+		}
+		nodes[nodeIndex].boundsMin = boundsMin;
+		nodes[nodeIndex].boundsMax = boundsMax;
+
+		if (end - begin <= g_LeafSize)
+		{
+			nodes[nodeIndex].start = begin;
+			nodes[nodeIndex].count = end - begin;
+			return(nodeIndex);
+		}
+
+		glm::vec3 extent = centerMax - centerMin;
+		int axis = 0;
+		if (extent.y > extent[axis])
+			axis = 1;
+		if (extent.z > extent[axis])
+			axis = 2;
+
+		int middle = (begin + end) / 2;
+		std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end,
+			[&build, axis](int a, int b) { return(build.centers[a][axis] < build.centers[b][axis]); });
+
+		BuildNode(nodes, items, build, begin, middle);
+		int second = BuildNode(nodes, items, build, middle, end);
+		nodes[nodeIndex].start = second;
+		nodes[nodeIndex].count = 0;
+		return(nodeIndex);
+	}
+
+	/***********************************************************
+	 *  InverseDirection()
+	 *
+	 *  This function returns the reciprocal of each component
+	 *  of a ray direction, keeping a zero component finite.
+	 ***********************************************************/
+	glm::vec3 InverseDirection(glm::vec3 direction)
+	{
+		glm::vec3 inverse;
+		for (int i = 0; i < 3; i++)
+		{
+			float component = direction[i];
+			if (fabs(component) < 1e-20f)
+			{
+				component = (component < 0.0f) ? -1e-20f : 1e-20f;
+			}
+			inverse[i] = 1.0f / component;
+		}
+		return(inverse);
+	}
+
+	/***********************************************************
+	 *  HitBox()
+	 *
+	 *  This function tests a ray against the box of a node
+	 *  and returns where the ray enters it.
+	 ***********************************************************/
+	bool HitBox(
+		const SceneBVH::BVH_NODE& node,
+		glm::vec3 origin,
+		glm::vec3 inverseDirection,
+		float nearest,
+		float& enter)
+	{
+		glm::vec3 t0 = (node.boundsMin - origin) * inverseDirection;
+		glm::vec3 t1 = (node.boundsMax - origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+
+		enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+		return((enter <= exit) && (enter < nearest));
+	}
+
+	/***********************************************************
+	 *  HitTriangle()
+	 *
+	 *  This function intersects a ray with a triangle from
+	 *  either side, Moller-Trumbore style.
+	 ***********************************************************/
+	bool HitTriangle(
+		glm::vec3 origin,
+		glm::vec3 direction,
+		glm::vec3 p0,
+		glm::vec3 p1,
+		glm::vec3 p2,
+		float& distance)
+	{
+		glm::vec3 edge1 = p1 - p0;
+		glm::vec3 edge2 = p2 - p0;
+		glm::vec3 p = glm::cross(direction, edge2);
+		float determinant = glm::dot(edge1, p);
+		if (determinant == 0.0f)
+		{
+			return(false);
+		}
+
+		float inverse = 1.0f / determinant;
+		glm::vec3 toOrigin = origin - p0;
+		float u = glm::dot(toOrigin, p) * inverse;
+		if ((u < 0.0f) || (u > 1.0f))
+		{
+			return(false);
+		}
+		glm::vec3 q = glm::cross(toOrigin, edge1);
+		float v = glm::dot(direction, q) * inverse;
+		if ((v < 0.0f) || (u + v > 1.0f))
+		{
+			return(false);
+		}
+
+		distance = glm::dot(edge2, q) * inverse;
+		return(distance > 0.0f);
+	}
+
+	/***********************************************************
+	 *  Traverse()
+	 *
+	 *  This function walks a tree front to back, handing the
+	 *  item ranges of the leaves the ray reaches to the test,
+	 *  which lowers nearest as it finds closer hits.
+	 ***********************************************************/
+	template <typename TEST_ITEMS>
+	void Traverse(
+		const std::vector<SceneBVH::BVH_NODE>& nodes,
+		glm::vec3 origin,
+		glm::vec3 direction,
+		float& nearest,
+		TEST_ITEMS testItems)
+	{
+		if (nodes.empty())
+		{
+			return;
+		}
+
+		glm::vec3 inverseDirection = InverseDirection(direction);
+		int stackNodes[g_StackSize];
+		float stackEnters[g_StackSize];
+		int depth = 0;
+
+		float enter;
+		if (!HitBox(nodes[0], origin, inverseDirection, nearest, enter))
+		{
+			return;
+		}
+		stackNodes[depth] = 0;
+		stackEnters[depth++] = enter;
+
+		while (depth > 0)
+		{
+			depth--;
+			if (stackEnters[depth] >= nearest)
+			{
+				continue;
+			}
+			int nodeIndex = stackNodes[depth];
+			const SceneBVH::BVH_NODE& node = nodes[nodeIndex];
+			if (node.count > 0)
+			{
+				testItems(node.start, node.count);
+				continue;
+			}
+
+			// the nearer child goes on top, so it is tested first
+			int first = nodeIndex + 1;
+			int second = node.start;
+			float firstEnter;
+			float secondEnter;
+			bool bFirst = HitBox(nodes[first], origin, inverseDirection, nearest, firstEnter);
+			bool bSecond = HitBox(nodes[second], origin, inverseDirection, nearest, secondEnter);
+			if (bFirst && bSecond)
+			{
+				if (secondEnter < firstEnter)
+				{
+					std::swap(first, second);
+					std::swap(firstEnter, secondEnter);
+				}
+				stackNodes[depth] = second;
+				stackEnters[depth++] = secondEnter;
+				stackNodes[depth] = first;
+				stackEnters[depth++] = firstEnter;
+			}
+			else if (bFirst)
+			{
+				stackNodes[depth] = first;
+				stackEnters[depth++] = firstEnter;
+			}
+			else if (bSecond)
+			{
+				stackNodes[depth] = second;
+				stackEnters[depth++] = secondEnter;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+	m_objectCount = 0;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method builds the object tree from the bounding
+ *  spheres, each taken as the box around it.
+ ***********************************************************/
+void SceneBVH::Build(const ObjectStore& objects)
+{
+	m_objectCount = objects.GetCount();
+	const glm::vec4* bounds = objects.GetBounds();
+
+	BUILD_ITEMS build;
+	build.mins.resize(m_objectCount);
+	build.maxs.resize(m_objectCount);
+	build.centers.resize(m_objectCount);
+	m_objectItems.resize(m_objectCount);
+	for (int i = 0; i < m_objectCount; i++)
+	{
+		build.centers[i] = glm::vec3(bounds[i]);
+		build.mins[i] = build.centers[i] - glm::vec3(bounds[i].w);
+		build.maxs[i] = build.centers[i] + glm::vec3(bounds[i].w);
+		m_objectItems[i] = i;
+	}
+
+	m_nodes.clear();
+	m_nodes.reserve(std::max(2 * m_objectCount / g_LeafSize, 1));
+	if (m_objectCount > 0)
+	{
+		BuildNode(m_nodes, m_objectItems, build, 0, m_objectCount);
+	}
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method updates the node boxes bottom up.  Children
+ *  always come after their parent, so a reverse walk sees
+ *  both children of a node before the node itself.
+ ***********************************************************/
+void SceneBVH::Refit(const ObjectStore& objects)
+{
+	const glm::vec4* bounds = objects.GetBounds();
+
+	for (int nodeIndex = (int)m_nodes.size() - 1; nodeIndex >= 0; nodeIndex--)
+	{
+		BVH_NODE& node = m_nodes[nodeIndex];
+		if (node.count > 0)
+		{
+			node.boundsMin = glm::vec3(FLT_MAX);
+			node.boundsMax = glm::vec3(-FLT_MAX);
+			for (int i = node.start; i < node.start + node.count; i++)
+			{
+				const glm::vec4& sphere = bounds[m_objectItems[i]];
+				node.boundsMin = glm::min(node.boundsMin, glm::vec3(sphere) - glm::vec3(sphere.w));
+				node.boundsMax = glm::max(node.boundsMax, glm::vec3(sphere) + glm::vec3(sphere.w));
+			}
+		}
+		else
+		{
+			const BVH_NODE& first = m_nodes[nodeIndex + 1];
+			const BVH_NODE& second = m_nodes[node.start];
+			node.boundsMin = glm::min(first.boundsMin, second.boundsMin);
+			node.boundsMax = glm::max(first.boundsMax, second.boundsMax);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetMeshTree()
+ *
+ *  This method returns the triangle tree of a pooled mesh,
+ *  building it the first time it is asked for.
+ ***********************************************************/
+const SceneBVH::MESH_TREE& SceneBVH::GetMeshTree(const MeshPool& meshPool, int meshIndex)
+{
+	if ((int)m_meshTrees.size() < meshPool.GetMeshCount())
+	{
+		MESH_TREE empty;
+		empty.bBuilt = false;
+		m_meshTrees.resize(meshPool.GetMeshCount(), empty);
+	}
+
+	MESH_TREE& tree = m_meshTrees[meshIndex];
+	if (tree.bBuilt)
+	{
+		return(tree);
+	}
+
+	const MeshPool::MESH_RANGE& range = meshPool.GetMesh(meshIndex);
+	const MeshPool::MESH_VERTEX* vertices = meshPool.GetVertexData() + range.baseVertex;
+	const GLuint* indices = meshPool.GetIndexData() + range.firstIndex;
+	const int triangleCount = (int)range.indexCount / 3;
+
+	BUILD_ITEMS build;
+	build.mins.resize(triangleCount);
+	build.maxs.resize(triangleCount);
+	build.centers.resize(triangleCount);
+	tree.triangles.resize(triangleCount);
+	for (int i = 0; i < triangleCount; i++)
+	{
+		glm::vec3 p0 = vertices[indices[i * 3 + 0]].position;
+		glm::vec3 p1 = vertices[indices[i * 3 + 1]].position;
+		glm::vec3 p2 = vertices[indices[i * 3 + 2]].position;
+		build.mins[i] = glm::min(p0, glm::min(p1, p2));
+		build.maxs[i] = glm::max(p0, glm::max(p1, p2));
+		build.centers[i] = (build.mins[i] + build.maxs[i]) * 0.5f;
+		tree.triangles[i] = i;
+	}
+
+	tree.nodes.clear();
+	if (triangleCount > 0)
+	{
+		BuildNode(tree.nodes, tree.triangles, build, 0, triangleCount);
+	}
+	tree.bBuilt = true;
+	return(tree);
+}
+
+/***********************************************************
+ *  BuildMeshTrees()
+ *
+ *  This method builds the triangle trees of every mesh in
+ *  the pool that does not have one yet.
+ ***********************************************************/
+void SceneBVH::BuildMeshTrees(const MeshPool& meshPool)
+{
+	for (int i = 0; i < meshPool.GetMeshCount(); i++)
+	{
+		GetMeshTree(meshPool, i);
+	}
+}
+
+/***********************************************************
+ *  InvalidateMeshTree()
+ *
+ *  This method marks a mesh's triangle tree as not built.
+ ***********************************************************/
+void SceneBVH::InvalidateMeshTree(int meshIndex)
+{
+	if ((meshIndex >= 0) && (meshIndex < (int)m_meshTrees.size()))
+	{
+		m_meshTrees[meshIndex].bBuilt = false;
+	}
+}
+
+/***********************************************************
+ *  Intersect()
+ *
+ *  This method finds the nearest hit of a ray.  Both trees
+ *  share the distance found so far, which stays comparable
+ *  in local space because the ray direction is transformed
+ *  without being normalized.
+ ***********************************************************/
+bool SceneBVH::Intersect(
+	glm::vec3 origin,
+	glm::vec3 direction,
+	const ObjectStore& objects,
+	const MeshPool& meshPool,
+	RAY_HIT& hit,
+	float maxDistance,
+	uint8_t skipFlags,
+	const unsigned char* skippedObjects)
+{
+	const glm::mat4* models = objects.GetModelMatrices();
+	const MESH_TYPE* meshes = objects.GetMeshes();
+	const uint8_t* flags = objects.GetFlags();
+	const int objectCount = std::min(objects.GetCount(), m_objectCount);
+	const MeshPool::MESH_VERTEX* poolVertices = meshPool.GetVertexData();
+	const GLuint* poolIndices = meshPool.GetIndexData();
+
+	float nearest = maxDistance;
+	hit.objectIndex = -1;
+
+	Traverse(m_nodes, origin, direction, nearest, [&](int start, int count)
+	{
+		for (int item = start; item < start + count; item++)
+		{
+			int object = m_objectItems[item];
+			if ((object >= objectCount) || (meshes[object] < 0) || (meshes[object] >= meshPool.GetMeshCount()) ||
+				((flags[object] & skipFlags) != 0) || ((NULL != skippedObjects) && (skippedObjects[object] != 0)))
+			{
+				continue;
+			}
+
+			glm::mat4 toLocal = glm::inverse(models[object]);
+			glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(origin, 1.0f));
+			glm::vec3 localDirection = glm::vec3(toLocal * glm::vec4(direction, 0.0f));
+
+			const MESH_TREE& tree = GetMeshTree(meshPool, meshes[object]);
+			const MeshPool::MESH_RANGE& range = meshPool.GetMesh(meshes[object]);
+			const MeshPool::MESH_VERTEX* vertices = poolVertices + range.baseVertex;
+			const GLuint* indices = poolIndices + range.firstIndex;
+
+			Traverse(tree.nodes, localOrigin, localDirection, nearest, [&](int first, int triangles)
+			{
+				for (int i = first; i < first + triangles; i++)
+				{
+					int triangle = tree.triangles[i];
+					float distance;
+					if (HitTriangle(localOrigin, localDirection,
+						vertices[indices[triangle * 3 + 0]].position,
+						vertices[indices[triangle * 3 + 1]].position,
+						vertices[indices[triangle * 3 + 2]].position,
+						distance) && (distance < nearest))
+					{
+						nearest = distance;
+						hit.objectIndex = object;
+						hit.triangle = triangle;
+					}
+				}
+			});
+		}
+	});
+
+	if (hit.objectIndex < 0)
+	{
+		return(false);
+	}
+	hit.distance = nearest;
+	hit.position = origin + direction * nearest;
+	return(true);
+}
@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// answer ray queries against the scene objects and their triangles
+//
+//  A bounding volume hierarchy over the objects' bounds finds the few
+//  objects a ray can touch, and a hierarchy over each mesh's triangles,
+//  built the first time the mesh is hit, finds the exact surface.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshPool.h"
+#include "ObjectStore.h"
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  This class casts rays into the scene.  The object tree
+ *  is built from the world space bounds the transform
+ *  update leaves in the object store; the triangle trees
+ *  work in each mesh's local space, and the ray is taken
+ *  into an object's local space before entering its mesh.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+	// constructor
+	SceneBVH();
+
+	struct RAY_HIT
+	{
+		// array index of the object in the object store
+		int objectIndex;
+		// triangle within the object's mesh
+		int triangle;
+		// distance along the ray, in units of its direction
+		float distance;
+		glm::vec3 position;
+	};
+
+	// build the object tree over the current bounds
+	void Build(const ObjectStore& objects);
+	// recompute the node bounds after objects moved, keeping the
+	// tree's shape; the object count must not have changed
+	void Refit(const ObjectStore& objects);
+	// number of objects the tree was built for
+	int GetObjectCount() const { return m_objectCount; }
+
+	// find the nearest triangle the ray hits closer than
+	// maxDistance, passing through objects with any of the
+	// skipFlags set, and through those with a non-zero entry
+	// in skippedObjects when it is given; false on a miss
+	bool Intersect(
+		glm::vec3 origin,
+		glm::vec3 direction,
+		const ObjectStore& objects,
+		const MeshPool& meshPool,
+		RAY_HIT& hit,
+		float maxDistance = FLT_MAX,
+		uint8_t skipFlags = 0,
+		const unsigned char* skippedObjects = NULL);
+	// build every mesh's triangle tree up front, after which
+	// Intersect() only reads and can run on several threads
+	void BuildMeshTrees(const MeshPool& meshPool);
+	// drop a mesh's triangle tree after its geometry was replaced,
+	// so the next ray into it builds the tree again
+	void InvalidateMeshTree(int meshIndex);
+
+	// one node of a tree; an inner node's first child follows it
+	// and its second child is at start, a leaf holds count items
+	// from start in its item list
+	struct BVH_NODE
+	{
+		glm::vec3 boundsMin;
+		int32_t start;
+		glm::vec3 boundsMax;
+		int32_t count;
+	};
+
+private:
+	struct MESH_TREE
+	{
+		bool bBuilt;
+		std::vector<BVH_NODE> nodes;
+		std::vector<int> triangles;
+	};
+
+	std::vector<BVH_NODE> m_nodes;
+	std::vector<int> m_objectItems;
+	int m_objectCount;
+	// triangle trees, by mesh pool index
+	std::vector<MESH_TREE> m_meshTrees;
+
+	// the triangle tree of a mesh, built on first use
+	const MESH_TREE& GetMeshTree(const MeshPool& meshPool, int meshIndex);
+};
@@ -0,0 +1,361 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// read the scene layout from a text file and watch it for changes
+//
+//  The file lists the textures, materials, lights and objects of the
+//  scene, one per line.  Editing it while the program runs re-applies
+//  just the entries that changed.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// shortest time between two checks of the file
+	const std::chrono::milliseconds g_CheckInterval(250);
+
+	// mesh names accepted by object lines, in MESH_TYPE order
+	const char* const g_MeshNames[MESH_BUILTIN_COUNT] =
+		{ "box", "plane", "cylinder", "cone", "sphere", "prism", "torus" };
+
+	/***********************************************************
+	 *  ReadVec3()
+	 *
+	 *  This function reads three numbers from the line.
+	 ***********************************************************/
+	bool ReadVec3(std::istringstream& line, glm::vec3& value)
+	{
+		return((bool)(line >> value.x >> value.y >> value.z));
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile(const std::string& filename)
+{
+	m_filename = filename;
+	m_path = filename;
+	m_loaded.globalAmbientLight = glm::vec3(0.0f, 0.0f, 0.0f);
+	m_applied.globalAmbientLight = glm::vec3(0.0f, 0.0f, 0.0f);
+	m_bApplied = false;
+	m_lastCheck = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method reads the file line by line.  A file with an
+ *  error is rejected as a whole, so a half-saved edit never
+ *  reaches the scene.
+ ***********************************************************/
+bool SceneFile::Load()
+{
+	std::error_code errorCode;
+	m_lastWriteTime = std::filesystem::last_write_time(m_path, errorCode);
+
+	std::ifstream file(m_filename);
+	if (!file)
+	{
+		std::cout << "ERROR: Could not open scene file: " << m_filename << std::endl;
+		return(false);
+	}
+
+	SCENE_DESCRIPTION loaded;
+	loaded.globalAmbientLight = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	std::string text;
+	int lineNumber = 0;
+	while (std::getline(file, text))
+	{
+		lineNumber++;
+		text = text.substr(0, text.find('#'));
+
+		std::istringstream line(text);
+		std::string error;
+		if (!ParseLine(line, loaded, error))
+		{
+			std::cout << "ERROR: " << m_filename << "(" << lineNumber << "): " << error << std::endl;
+			return(false);
+		}
+	}
+
+	m_loaded = loaded;
+	return(true);
+}
+
+/***********************************************************
+ *  HasChanged()
+ *
+ *  This method compares the file's modification time with
+ *  the one seen by the last load.
+ ***********************************************************/
+bool SceneFile::HasChanged()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - m_lastCheck < g_CheckInterval)
+	{
+		return(false);
+	}
+	m_lastCheck = now;
+
+	// the file can be missing for a moment while an editor
+	// replaces it
+	std::error_code errorCode;
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(m_path, errorCode);
+	return(!errorCode && (writeTime != m_lastWriteTime));
+}
+
+/***********************************************************
+ *  ParseLine()
+ *
+ *  This method parses one line of the file.  Blank lines
+ *  are skipped.
+ ***********************************************************/
+bool SceneFile::ParseLine(std::istringstream& line, SCENE_DESCRIPTION& description, std::string& error)
+{
+	std::string keyword;
+	if (!(line >> keyword))
+	{
+		return(true);
+	}
+
+	bool bValid = true;
+	std::string field;
+
+	if (keyword == "ambient")
+	{
+		bValid = ReadVec3(line, description.globalAmbientLight);
+	}
+	else if (keyword == "texture")
+	{
+		TEXTURE_ENTRY texture;
+		bValid = (bool)(line >> texture.tag >> texture.filename);
+		description.textures.push_back(texture);
+	}
+	else if (keyword == "mesh")
+	{
+		MESH_ENTRY mesh;
+		if (!(line >> mesh.name >> mesh.filename))
+		{
+			error = "mesh needs a name and a file";
+			return(false);
+		}
+		for (int i = 0; i < MESH_BUILTIN_COUNT; i++)
+		{
+			if (mesh.name == g_MeshNames[i])
+			{
+				error = "mesh name '" + mesh.name + "' is a built-in shape";
+				return(false);
+			}
+		}
+		for (const MESH_ENTRY& other : description.meshes)
+		{
+			if (other.name == mesh.name)
+			{
+				error = "mesh name '" + mesh.name + "' is used twice";
+				return(false);
+			}
+		}
+		description.meshes.push_back(mesh);
+	}
+	else if (keyword == "material")
+	{
+		SceneManager::OBJECT_MATERIAL material;
+		material.ambientStrength = 0.0f;
+		material.ambientColor = glm::vec3(0.0f, 0.0f, 0.0f);
+		material.diffuseColor = glm::vec3(0.0f, 0.0f, 0.0f);
+		material.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
+		material.shininess = 1.0f;
+		bValid = (bool)(line >> material.tag);
+
+		while (bValid && (line >> field))
+		{
+			if (field == "ambient")
+				bValid = ReadVec3(line, material.ambientColor);
+			else if (field == "strength")
+				bValid = (bool)(line >> material.ambientStrength);
+			else if (field == "diffuse")
+				bValid = ReadVec3(line, material.diffuseColor);
+			else if (field == "specular")
+				bValid = ReadVec3(line, material.specularColor);
+			else if (field == "shininess")
+				bValid = (bool)(line >> material.shininess);
+			else
+				bValid = false;
+		}
+		description.materials.push_back(material);
+	}
+	else if (keyword == "light")
+	{
+		SceneManager::LIGHT_SOURCE light;
+		light.position = glm::vec3(0.0f, 0.0f, 0.0f);
+		light.direction = glm::vec3(0.0f, 0.0f, 0.0f);
+		light.ambientColor = glm::vec3(0.0f, 0.0f, 0.0f);
+		light.diffuseColor = glm::vec3(0.0f, 0.0f, 0.0f);
+		light.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
+		light.focalStrength = 1.0f;
+		light.specularIntensity = 0.0f;
+
+		while (bValid && (line >> field))
+		{
+			if (field == "position")
+				bValid = ReadVec3(line, light.position);
+			else if (field == "direction")
+				bValid = ReadVec3(line, light.direction);
+			else if (field == "ambient")
+				bValid = ReadVec3(line, light.ambientColor);
+			else if (field == "diffuse")
+				bValid = ReadVec3(line, light.diffuseColor);
+			else if (field == "specular")
+				bValid = ReadVec3(line, light.specularColor);
+			else if (field == "focal")
+				bValid = (bool)(line >> light.focalStrength);
+			else if (field == "intensity")
+				bValid = (bool)(line >> light.specularIntensity);
+			else
+				bValid = false;
+		}
+
+		// a zero direction marks a light that shines every way
+		if (glm::length(light.direction) > 0.0f)
+		{
+			light.direction = glm::normalize(light.direction);
+		}
+		description.lights.push_back(light);
+	}
+	else if (keyword == "object")
+	{
+		OBJECT_ENTRY object;
+		object.scaleXYZ = glm::vec3(1.0f, 1.0f, 1.0f);
+		object.rotationXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
+		object.positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
+		object.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		object.bUseColor = false;
+		object.bTransparent = false;
+		object.bEmissive = false;
+
+		std::string meshName;
+		if (!(line >> object.name >> meshName))
+		{
+			error = "object needs a name and a mesh";
+			return(false);
+		}
+
+		int mesh = 0;
+		while ((mesh < MESH_BUILTIN_COUNT) && (meshName != g_MeshNames[mesh]))
+		{
+			mesh++;
+		}
+		if (mesh == MESH_BUILTIN_COUNT)
+		{
+			for (const MESH_ENTRY& imported : description.meshes)
+			{
+				if (imported.name == meshName)
+				{
+					object.meshName = meshName;
+					break;
+				}
+			}
+			if (object.meshName.empty())
+			{
+				error = "unknown mesh '" + meshName + "'";
+				return(false);
+			}
+		}
+		object.mesh = (MESH_TYPE)mesh;
+
+		for (const OBJECT_ENTRY& other : description.objects)
+		{
+			if (other.name == object.name)
+			{
+				error = "object name '" + object.name + "' is used twice";
+				return(false);
+			}
+		}
+
+		while (bValid && (line >> field))
+		{
+			if (field == "scale")
+				bValid = ReadVec3(line, object.scaleXYZ);
+			else if (field == "rotation")
+				bValid = ReadVec3(line, object.rotationXYZ);
+			else if (field == "position")
+				bValid = ReadVec3(line, object.positionXYZ);
+			else if (field == "texture")
+				bValid = (bool)(line >> object.textureTag);
+			else if (field == "material")
+				bValid = (bool)(line >> object.materialTag);
+			else if (field == "color")
+			{
+				bValid = (bool)(line >> object.color.r >> object.color.g >> object.color.b >> object.color.a);
+				object.bUseColor = true;
+			}
+			else if (field == "transparent")
+				object.bTransparent = true;
+			else if (field == "emissive")
+				object.bEmissive = true;
+			else
+				bValid = false;
+		}
+		description.objects.push_back(object);
+	}
+	else if (keyword == "key")
+	{
+		KEY_ENTRY key;
+		std::string channel;
+		if (!(line >> key.objectName >> channel))
+		{
+			error = "key needs an object and a channel";
+			return(false);
+		}
+
+		bool bKnown = false;
+		for (const OBJECT_ENTRY& object : description.objects)
+		{
+			bKnown = bKnown || (object.name == key.objectName);
+		}
+		if (!bKnown)
+		{
+			error = "key for unknown object '" + key.objectName + "'";
+			return(false);
+		}
+
+		if (channel == "position")
+			key.channel = AnimationSystem::CHANNEL_POSITION;
+		else if (channel == "rotation")
+			key.channel = AnimationSystem::CHANNEL_ROTATION;
+		else if (channel == "scale")
+			key.channel = AnimationSystem::CHANNEL_SCALE;
+		else
+		{
+			error = "unknown key channel '" + channel + "'";
+			return(false);
+		}
+
+		bValid = (bool)(line >> key.key.time) && (key.key.time >= 0.0f) && ReadVec3(line, key.key.value);
+		description.keys.push_back(key);
+	}
+	else
+	{
+		error = "unknown keyword '" + keyword + "'";
+		return(false);
+	}
+
+	if (!bValid)
+	{
+		error = "bad or missing value in '" + keyword + "' line";
+		if (!field.empty())
+		{
+			error += " near '" + field + "'";
+		}
+	}
+	return(bValid);
+}
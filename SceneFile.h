@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// read the scene layout from a text file and watch it for changes
+//
+//  The file lists the textures, materials, lights and objects of the
+//  scene, one per line.  Editing it while the program runs re-applies
+//  just the entries that changed.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class parses a scene description file.  Each line
+ *  starts with a keyword followed by its values, and any
+ *  text after a '#' is a comment:
+ *
+ *    ambient <r g b>
+ *    texture <tag> <filename>
+ *    mesh <name> <.obj, .gltf or .glb filename>
+ *    material <tag> [ambient <r g b>] [strength <s>]
+ *        [diffuse <r g b>] [specular <r g b>] [shininess <s>]
+ *    light [position <x y z>] [direction <x y z>]
+ *        [ambient <r g b>] [diffuse <r g b>]
+ *        [specular <r g b>] [focal <s>] [intensity <s>]
+ *    object <name> <box|plane|cylinder|cone|sphere|prism|torus|
+ *        imported mesh name>
+ *        [scale <x y z>] [rotation <x y z>] [position <x y z>]
+ *        [texture <tag>] [material <tag>] [color <r g b a>]
+ *        [transparent] [emissive]
+ *    key <object> <position|rotation|scale> <time> <x y z>
+ *
+ *  Object names must be unique, since an edited object is
+ *  matched to the one already in the scene by its name.  A
+ *  mesh must be listed before the objects that use it, and
+ *  an object before its keys.  The keys of one object and
+ *  channel form a track that loops over its last key time;
+ *  the tracks only play when animation is turned on.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile(const std::string& filename);
+
+	struct TEXTURE_ENTRY
+	{
+		std::string tag;
+		std::string filename;
+	};
+
+	struct MESH_ENTRY
+	{
+		std::string name;
+		std::string filename;
+	};
+
+	struct OBJECT_ENTRY
+	{
+		std::string name;
+		// a built-in shape, or MESH_BUILTIN_COUNT with the name of
+		// an imported mesh
+		MESH_TYPE mesh;
+		std::string meshName;
+		glm::vec3 scaleXYZ;
+		// rotation about the X, Y and Z axes in degrees
+		glm::vec3 rotationXYZ;
+		glm::vec3 positionXYZ;
+		std::string textureTag;
+		std::string materialTag;
+		glm::vec4 color;
+		bool bUseColor;
+		bool bTransparent;
+		// glows brighter than its color on an HDR frame
+		bool bEmissive;
+	};
+
+	struct KEY_ENTRY
+	{
+		std::string objectName;
+		AnimationSystem::CHANNEL channel;
+		AnimationSystem::KEYFRAME key;
+	};
+
+	struct SCENE_DESCRIPTION
+	{
+		glm::vec3 globalAmbientLight;
+		std::vector<TEXTURE_ENTRY> textures;
+		std::vector<MESH_ENTRY> meshes;
+		std::vector<SceneManager::OBJECT_MATERIAL> materials;
+		std::vector<SceneManager::LIGHT_SOURCE> lights;
+		std::vector<OBJECT_ENTRY> objects;
+		std::vector<KEY_ENTRY> keys;
+	};
+
+	const std::string& GetFilename() const { return m_filename; }
+
+	// read the whole file, keeping the last loaded description and
+	// returning false when any line is in error
+	bool Load();
+	// true when the file was written since the last load, checked
+	// at most a few times per second
+	bool HasChanged();
+
+	// the description read by the last successful load
+	const SCENE_DESCRIPTION& GetLoaded() const { return m_loaded; }
+	// the description the scene currently matches
+	const SCENE_DESCRIPTION& GetApplied() const { return m_applied; }
+	void MarkApplied() { m_applied = m_loaded; m_bApplied = true; }
+	// false until a description has been applied to the scene
+	bool IsApplied() const { return m_bApplied; }
+
+private:
+	std::string m_filename;
+	// the filename as a path, built once so checking the file
+	// does not allocate
+	std::filesystem::path m_path;
+	SCENE_DESCRIPTION m_loaded;
+	SCENE_DESCRIPTION m_applied;
+	bool m_bApplied;
+
+	// change detection
+	std::filesystem::file_time_type m_lastWriteTime;
+	std::chrono::steady_clock::time_point m_lastCheck;
+
+	// parse one line into the description, false on an error
+	bool ParseLine(std::istringstream& line, SCENE_DESCRIPTION& description, std::string& error);
+};
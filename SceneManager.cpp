@@ -8,6 +8,15 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "AssetPack.h"
+#include "GPUDrivenRenderer.h"
+#include "JobSystem.h"
+#include "LightmapBaker.h"
+#include "MeshImporter.h"
+#include "ReflectionProbes.h"
+#include "SceneFile.h"
+#include "ShapeTessellator.h"
+#include "TextureStreamer.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,14 +25,174 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
 // declaration of global variables
 namespace
 {
 	const char* g_ModelName = "model";
+	const char* g_ViewName = "view";
+	const char* g_ProjectionName = "projection";
+	const char* g_ViewPositionName = "viewPosition";
 	const char* g_ColorValueName = "objectColor";
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	// material names are too long to fit in a string without
+	// allocating, so they are built once up front
+	const std::string g_MaterialAmbientColorName = "material.ambientColor";
+	const std::string g_MaterialAmbientStrengthName = "material.ambientStrength";
+	const std::string g_MaterialDiffuseColorName = "material.diffuseColor";
+	const std::string g_MaterialSpecularColorName = "material.specularColor";
+	const std::string g_MaterialShininessName = "material.shininess";
+
+	// scene objects recorded per command list; small enough to
+	// keep every thread busy, large enough to amortize a list
+	const int g_RecordingChunkSize = 64;
+	// scene objects per transform and culling job
+	const int g_UpdateChunkSize = 256;
+
+	// number of texture slots, the unit after the last one is
+	// left active for any other texture work
+	const int g_TextureSlotCount = 16;
+	// texture unit holding the lightmap atlas, past the scratch unit
+	const int g_LightmapUnit = g_TextureSlotCount + 1;
+	// texture unit holding the reflection probe cubemaps
+	const int g_ProbeUnit = g_TextureSlotCount + 2;
+	// materials at least this shiny reflect a probe
+	const float g_ReflectiveShininess = 64.0f;
+	// probe faces rendered again per frame once the scene around
+	// a probe changes
+	const int g_ProbeFacesPerFrame = 1;
+
+	/***********************************************************
+	 *  SameMaterial()
+	 *
+	 *  This function compares every value of two materials.
+	 ***********************************************************/
+	bool SameMaterial(const SceneManager::OBJECT_MATERIAL& a, const SceneManager::OBJECT_MATERIAL& b)
+	{
+		return((a.tag == b.tag) &&
+			(a.ambientStrength == b.ambientStrength) &&
+			(a.ambientColor == b.ambientColor) &&
+			(a.diffuseColor == b.diffuseColor) &&
+			(a.specularColor == b.specularColor) &&
+			(a.shininess == b.shininess));
+	}
+
+	/***********************************************************
+	 *  SameLight()
+	 *
+	 *  This function compares every value of two lights.
+	 ***********************************************************/
+	bool SameLight(const SceneManager::LIGHT_SOURCE& a, const SceneManager::LIGHT_SOURCE& b)
+	{
+		return((a.position == b.position) &&
+			(a.direction == b.direction) &&
+			(a.ambientColor == b.ambientColor) &&
+			(a.diffuseColor == b.diffuseColor) &&
+			(a.specularColor == b.specularColor) &&
+			(a.focalStrength == b.focalStrength) &&
+			(a.specularIntensity == b.specularIntensity));
+	}
+
+	/***********************************************************
+	 *  SameObject()
+	 *
+	 *  This function compares every value of two object
+	 *  entries of a scene file.
+	 ***********************************************************/
+	bool SameObject(const SceneFile::OBJECT_ENTRY& a, const SceneFile::OBJECT_ENTRY& b)
+	{
+		return((a.name == b.name) &&
+			(a.mesh == b.mesh) &&
+			(a.meshName == b.meshName) &&
+			(a.scaleXYZ == b.scaleXYZ) &&
+			(a.rotationXYZ == b.rotationXYZ) &&
+			(a.positionXYZ == b.positionXYZ) &&
+			(a.textureTag == b.textureTag) &&
+			(a.materialTag == b.materialTag) &&
+			(a.color == b.color) &&
+			(a.bUseColor == b.bUseColor) &&
+			(a.bTransparent == b.bTransparent) &&
+			(a.bEmissive == b.bEmissive));
+	}
+
+	/***********************************************************
+	 *  SameKeys()
+	 *
+	 *  This function compares the keyframes of two scene file
+	 *  descriptions.
+	 ***********************************************************/
+	bool SameKeys(const std::vector<SceneFile::KEY_ENTRY>& a, const std::vector<SceneFile::KEY_ENTRY>& b)
+	{
+		if (a.size() != b.size())
+		{
+			return(false);
+		}
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if ((a[i].objectName != b[i].objectName) ||
+				(a[i].channel != b[i].channel) ||
+				(a[i].key.time != b[i].key.time) ||
+				(a[i].key.value != b[i].key.value))
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  GetShadedColor()
+	 *
+	 *  This function returns the color an object is drawn in,
+	 *  brightened by the emissive scale when it glows.
+	 ***********************************************************/
+	glm::vec4 GetShadedColor(const ObjectStore& objects, int index, float emissiveScale)
+	{
+		glm::vec4 color = objects.GetColors()[index];
+		if (objects.GetFlags()[index] & ObjectStore::OBJECT_EMISSIVE)
+		{
+			color = glm::vec4(glm::vec3(color) * emissiveScale, color.a);
+		}
+		return(color);
+	}
+
+	/***********************************************************
+	 *  BuildGPUInstance()
+	 *
+	 *  This function fills the GPU-driven renderer's instance
+	 *  of one object, whose transform is up to date.
+	 ***********************************************************/
+	void BuildGPUInstance(
+		const ObjectStore& objects,
+		const LightmapBaker* pLightmaps,
+		const std::vector<int>& objectProbes,
+		float emissiveScale,
+		int index,
+		GPUDrivenRenderer::OBJECT_INSTANCE& instance)
+	{
+		const MESH_TYPE mesh = objects.GetMeshes()[index];
+		instance.model = objects.GetModelMatrices()[index];
+		instance.color = GetShadedColor(objects, index, emissiveScale);
+		instance.uvScale = glm::vec2(1.0f, 1.0f);
+		instance.meshIndex = mesh;
+		instance.materialIndex = objects.GetMaterials()[index];
+		instance.textureSlot = objects.GetTextures()[index];
+		instance.bTransparent = (objects.GetFlags()[index] & ObjectStore::OBJECT_TRANSPARENT) != 0;
+		// objects that moved or changed mesh since the bake are
+		// lit dynamically, with a zero rect
+		instance.lightmapRect = glm::vec4(0.0f);
+		if (NULL != pLightmaps)
+		{
+			pLightmaps->FindObject(index, objects.GetName(index), mesh, instance.model, instance.lightmapRect);
+		}
+		instance.probeIndex = objectProbes[index];
+	}
 }
 
 /***********************************************************
@@ -32,9 +201,37 @@ namespace
  *  The constructor for the class
  ***********************************************************/
 SceneManager::SceneManager(ShaderManager* pShaderManager)
+	: m_uniforms(pShaderManager, m_frameStats.uniformUploads)
 {
 	m_pShaderManager = pShaderManager;
 	m_basicMeshes = new ShapeMeshes();
+	m_loadedTextures = 0;
+	m_pTextureStreamer = NULL;
+	m_globalAmbientLight = glm::vec3(0.0f, 0.0f, 0.0f);
+	m_sceneCopies = 1;
+	m_bAnimate = false;
+	m_emissiveScale = 1.0f;
+	m_bSceneDirty = true;
+	m_bObjectsChanged = true;
+	m_bPickingStale = true;
+	m_frameStats = FRAME_STATS();
+	m_shapeMeshBytes = 0;
+	m_bGPUDriven = false;
+	m_bDepthPrePass = false;
+	m_bCompactVertices = false;
+	m_pMeshPool = NULL;
+	m_pGPURenderer = NULL;
+	m_bReflectionProbes = false;
+	m_pReflectionProbes = NULL;
+	m_pJobSystem = NULL;
+	m_pSceneFile = NULL;
+	m_pAssetPack = NULL;
+	m_bPackedMeshes = false;
+	m_bSceneFilePreloaded = false;
+	m_pLightmaps = NULL;
+	m_lightmapTexture = 0;
+	m_bakedLightCount = -1;
+	SetViewParameters(glm::mat4(1.0f), glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
 }
 
 /***********************************************************
@@ -47,7 +244,50 @@ SceneManager::~SceneManager()
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	if (NULL != m_pReflectionProbes)
+	{
+		delete m_pReflectionProbes;
+		m_pReflectionProbes = NULL;
+	}
+	if (NULL != m_pGPURenderer)
+	{
+		delete m_pGPURenderer;
+		m_pGPURenderer = NULL;
+	}
+	if (NULL != m_pMeshPool)
+	{
+		delete m_pMeshPool;
+		m_pMeshPool = NULL;
+	}
+	m_pJobSystem = NULL;
+	if (NULL != m_pSceneFile)
+	{
+		delete m_pSceneFile;
+		m_pSceneFile = NULL;
+	}
+	if (NULL != m_pAssetPack)
+	{
+		delete m_pAssetPack;
+		m_pAssetPack = NULL;
+	}
+	if (NULL != m_pLightmaps)
+	{
+		delete m_pLightmaps;
+		m_pLightmaps = NULL;
+	}
+	if (0 != m_lightmapTexture)
+	{
+		glDeleteTextures(1, &m_lightmapTexture);
+		m_lightmapTexture = 0;
+	}
+	if (NULL != m_pTextureStreamer)
+	{
+		delete m_pTextureStreamer;
+		m_pTextureStreamer = NULL;
+	}
 	m_objectMaterials.clear();
+	m_lightSources.clear();
+	m_objects.Clear();
 }
 
 /***********************************************************
@@ -65,6 +305,20 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	int colorChannels = 0;
 	GLuint textureID = 0;
 
+	// a texture the preload made is already in its slot
+	if (m_preloadedTextures.erase(tag) > 0)
+	{
+		return true;
+	}
+
+	// a texture loaded again under the same tag keeps its slot
+	int textureSlot = FindTextureSlot(tag);
+	if ((textureSlot < 0) && (m_loadedTextures >= g_TextureSlotCount))
+	{
+		std::cout << "No free texture slot for image:" << filename << std::endl;
+		return false;
+	}
+
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
 
@@ -91,8 +345,12 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+		// a streamed texture starts with only its small mipmaps,
+		// the larger ones follow as the view needs them
+		if ((NULL != m_pTextureStreamer) && ((colorChannels == 3) || (colorChannels == 4)))
+			m_pTextureStreamer->AddTexture(textureID, width, height, colorChannels, image);
 		// if the loaded image is in RGB format
-		if (colorChannels == 3)
+		else if (colorChannels == 3)
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
 		// if the loaded image is in RGBA format - it supports transparency
 		else if (colorChannels == 4)
@@ -104,16 +362,17 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		}
 
 		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		if (NULL == m_pTextureStreamer)
+			glGenerateMipmap(GL_TEXTURE_2D);
 
 		// free the image data from local memory
 		stbi_image_free(image);
 		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+		// register the loaded texture and associate it with the special tag string,
+		// the mipmaps adding a third to its size
+		size_t bytes = (NULL == m_pTextureStreamer) ? (size_t)width * height * colorChannels * 4 / 3 : 0;
+		RegisterGLTexture(textureID, tag, bytes);
 
 		return true;
 	}
@@ -124,6 +383,134 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	return false;
 }
 
+/***********************************************************
+ *  CreatePackedTexture()
+ *
+ *  This method creates a texture from the asset pack.  The
+ *  image was decoded, flipped and mipmapped by the baker, so
+ *  every level is uploaded straight from the mapped file.
+ ***********************************************************/
+bool SceneManager::CreatePackedTexture(int packIndex)
+{
+	uint32_t textureCount = 0;
+	const AssetPack::PACK_TEXTURE* textures = m_pAssetPack->GetSection<AssetPack::PACK_TEXTURE>(
+		AssetPack::SECTION_TEXTURES, textureCount);
+	uint64_t dataSize = 0;
+	const unsigned char* data = m_pAssetPack->GetSectionData(AssetPack::SECTION_TEXTURE_DATA, dataSize);
+	if ((NULL == textures) || (packIndex < 0) || ((uint32_t)packIndex >= textureCount))
+	{
+		return false;
+	}
+
+	const AssetPack::PACK_TEXTURE& texture = textures[packIndex];
+	std::string tag(texture.tag, strnlen(texture.tag, AssetPack::NAME_LENGTH));
+
+	if (m_preloadedTextures.erase(tag) > 0)
+	{
+		return true;
+	}
+
+	if ((FindTextureSlot(tag) < 0) && (m_loadedTextures >= g_TextureSlotCount))
+	{
+		std::cout << "No free texture slot for packed image:" << tag << std::endl;
+		return false;
+	}
+	// the chain must have at least one level and no more than a
+	// full chain down to 1x1, and all of them must fit the data
+	bool bValid = (NULL != data) && (texture.dataOffset <= dataSize) &&
+		(texture.dataSize <= dataSize - texture.dataOffset) &&
+		((texture.channels == 3) || (texture.channels == 4)) &&
+		(texture.width > 0) && (texture.height > 0) && (texture.levelCount > 0);
+	uint64_t chainSize = 0;
+	uint32_t levelWidth = texture.width;
+	uint32_t levelHeight = texture.height;
+	for (uint32_t i = 0; bValid && (i < texture.levelCount); i++)
+	{
+		bValid = (i == 0) || (levelWidth > 1) || (levelHeight > 1);
+		if (i > 0)
+		{
+			levelWidth = std::max(levelWidth / 2, 1u);
+			levelHeight = std::max(levelHeight / 2, 1u);
+		}
+		chainSize += (uint64_t)levelWidth * levelHeight * texture.channels;
+		bValid = bValid && (chainSize <= texture.dataSize);
+	}
+	if (!bValid)
+	{
+		std::cout << "ERROR: Packed image " << tag << " is damaged" << std::endl;
+		return false;
+	}
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// same sampling as the textures loaded from image files
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// the baked chain is streamed straight from the mapping
+	if (NULL != m_pTextureStreamer)
+	{
+		m_pTextureStreamer->AddPackedTexture(textureID, texture.width, texture.height,
+			texture.channels, texture.levelCount, data + texture.dataOffset);
+		RegisterGLTexture(textureID, tag, 0);
+		return true;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.levelCount - 1);
+
+	// the baked rows are tightly packed
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	GLenum internalFormat = (texture.channels == 4) ? GL_RGBA8 : GL_RGB8;
+	GLenum format = (texture.channels == 4) ? GL_RGBA : GL_RGB;
+	const unsigned char* level = data + texture.dataOffset;
+	uint32_t width = texture.width;
+	uint32_t height = texture.height;
+	for (uint32_t i = 0; i < texture.levelCount; i++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, i, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, level);
+		level += (size_t)width * height * texture.channels;
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	RegisterGLTexture(textureID, tag, texture.dataSize);
+	return true;
+}
+
+/***********************************************************
+ *  RegisterGLTexture()
+ *
+ *  This method stores a created texture under its tag.  A
+ *  tag loaded again keeps its slot and frees the texture it
+ *  had; the caller has checked that a new tag has a slot.
+ ***********************************************************/
+void SceneManager::RegisterGLTexture(GLuint textureID, std::string tag, size_t bytes)
+{
+	int textureSlot = FindTextureSlot(tag);
+	if (textureSlot >= 0)
+	{
+		if (NULL != m_pTextureStreamer)
+		{
+			m_pTextureStreamer->RemoveTexture(m_textureIDs[textureSlot].ID);
+		}
+		glDeleteTextures(1, &m_textureIDs[textureSlot].ID);
+	}
+	else
+	{
+		textureSlot = m_loadedTextures++;
+	}
+	m_textureIDs[textureSlot].ID = textureID;
+	m_textureIDs[textureSlot].tag = tag;
+	m_textureIDs[textureSlot].bytes = bytes;
+}
+
 /***********************************************************
  *  BindGLTextures()
  *
@@ -138,6 +525,10 @@ void SceneManager::BindGLTextures()
 		glActiveTexture(GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
 	}
+
+	// later texture creation binds on the active unit, which
+	// must not be one of the slots
+	glActiveTexture(GL_TEXTURE0 + g_TextureSlotCount);
 }
 
 /***********************************************************
@@ -160,7 +551,7 @@ void SceneManager::DestroyGLTextures()
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(std::string_view tag)
 {
 	int textureID = -1;
 	int index = 0;
@@ -186,7 +577,7 @@ int SceneManager::FindTextureID(std::string tag)
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(std::string_view tag)
 {
 	int textureSlot = -1;
 	int index = 0;
@@ -212,7 +603,7 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(std::string_view tag, OBJECT_MATERIAL& material)
 {
 	if (m_objectMaterials.size() == 0)
 	{
@@ -242,12 +633,30 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  FindMaterialIndex()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method returns the index of the defined material
+ *  with the passed in tag, or -1 when there is none.
  ***********************************************************/
-void SceneManager::SetTransformations(
+int SceneManager::FindMaterialIndex(std::string_view tag)
+{
+	for (int i = 0; i < (int)m_objectMaterials.size(); i++)
+	{
+		if (m_objectMaterials[i].tag.compare(tag) == 0)
+		{
+			return(i);
+		}
+	}
+	return(-1);
+}
+
+/***********************************************************
+ *  ComputeModelMatrix()
+ *
+ *  This method is used for combining the passed in
+ *  transformation values into one model matrix.
+ ***********************************************************/
+glm::mat4 SceneManager::ComputeModelMatrix(
 	glm::vec3 scaleXYZ,
 	float XrotationDegrees,
 	float YrotationDegrees,
@@ -255,7 +664,6 @@ void SceneManager::SetTransformations(
 	glm::vec3 positionXYZ)
 {
 	// variables for this method
-	glm::mat4 modelView;
 	glm::mat4 scale;
 	glm::mat4 rotationX;
 	glm::mat4 rotationY;
@@ -271,7 +679,28 @@ void SceneManager::SetTransformations(
 	// set the translation value in the transform buffer
 	translation = glm::translate(positionXYZ);
 
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
+	return(translation * rotationX * rotationY * rotationZ * scale);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	glm::mat4 modelView = ComputeModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
 
 	if (NULL != m_pShaderManager)
 	{
@@ -313,7 +742,7 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	std::string_view textureTag)
 {
 	if (NULL != m_pShaderManager)
 	{
@@ -346,7 +775,7 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	std::string_view materialTag)
 {
 	if (m_objectMaterials.size() > 0)
 	{
@@ -356,15 +785,27 @@ void SceneManager::SetShaderMaterial(
 		bReturn = FindMaterial(materialTag, material);
 		if (bReturn == true)
 		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			ApplyShaderMaterial(material);
 		}
 	}
 }
 
+/***********************************************************
+ *  ApplyShaderMaterial()
+ *
+ *  This method is used for passing the values of an already
+ *  found material into the shader.
+ ***********************************************************/
+void SceneManager::ApplyShaderMaterial(
+	const OBJECT_MATERIAL& material)
+{
+	m_uniforms.setVec3Value(g_MaterialAmbientColorName, material.ambientColor);
+	m_uniforms.setFloatValue(g_MaterialAmbientStrengthName, material.ambientStrength);
+	m_uniforms.setVec3Value(g_MaterialDiffuseColorName, material.diffuseColor);
+	m_uniforms.setVec3Value(g_MaterialSpecularColorName, material.specularColor);
+	m_uniforms.setFloatValue(g_MaterialShininessName, material.shininess);
+}
+
 /***********************************************************
  *  DefineObjectMaterials()
  *  Sets up material properties for objects in the scene.
@@ -445,52 +886,79 @@ void SceneManager::DefineObjectMaterials() {
 
 void SceneManager::SetupSceneLights()
 {
+	LIGHT_SOURCE light;
+
 	// Enable lighting in the shaders
 	m_pShaderManager->setBoolValue("bUseLighting", true);
 
 	// Increase overall ambient light slightly to make scene feel more natural
-	glm::vec3 globalAmbientLight = glm::vec3(0.15f, 0.15f, 0.15f);
-	m_pShaderManager->setVec3Value("globalAmbient", globalAmbientLight);
-
-	// Left Desk Light - Positioned left, angled slightly outward
-	glm::vec3 lightPosition1 = glm::vec3(10.0f, 12.0f, -10.0f);
-	glm::vec3 lightDirection1 = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+	m_globalAmbientLight = glm::vec3(0.15f, 0.15f, 0.15f);
 
-	glm::vec3 ambientLight1 = glm::vec3(0.1f, 0.1f, 0.1f);
-	glm::vec3 diffuseLight1 = glm::vec3(0.85f, 0.85f, 0.85f);
-	glm::vec3 specularLight1 = glm::vec3(0.5f, 0.5f, 0.5f); // Lowered specular to reduce glare
+	m_lightSources.clear();
 
-	m_pShaderManager->setVec3Value("lightSources[0].position", lightPosition1);
-	m_pShaderManager->setVec3Value("lightSources[0].direction", lightDirection1);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", ambientLight1);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", diffuseLight1);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", specularLight1);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 40.0f); // Softer spread
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 30.0f);
+	// Left Desk Light - Positioned left, angled slightly outward
+	light.position = glm::vec3(10.0f, 12.0f, -10.0f);
+	light.direction = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+	light.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
+	light.diffuseColor = glm::vec3(0.85f, 0.85f, 0.85f);
+	light.specularColor = glm::vec3(0.5f, 0.5f, 0.5f); // Lowered specular to reduce glare
+	light.focalStrength = 40.0f; // Softer spread
+	light.specularIntensity = 30.0f;
+	m_lightSources.push_back(light);
 
 	// Right Desk Light - Positioned right, angled slightly outward
-	glm::vec3 lightPosition2 = glm::vec3(20.0f, 12.0f, -10.0f);
-	glm::vec3 lightDirection2 = glm::normalize(glm::vec3(-0.3f, -1.0f, 0.2f));
+	light.position = glm::vec3(20.0f, 12.0f, -10.0f);
+	light.direction = glm::normalize(glm::vec3(-0.3f, -1.0f, 0.2f));
+	light.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
+	light.diffuseColor = glm::vec3(0.85f, 0.85f, 0.85f);
+	light.specularColor = glm::vec3(0.5f, 0.5f, 0.5f); // Lowered specular to reduce glare
+	light.focalStrength = 40.0f;
+	light.specularIntensity = 30.0f;
+	m_lightSources.push_back(light);
 
-	glm::vec3 ambientLight2 = glm::vec3(0.1f, 0.1f, 0.1f);
-	glm::vec3 diffuseLight2 = glm::vec3(0.85f, 0.85f, 0.85f);
-	glm::vec3 specularLight2 = glm::vec3(0.5f, 0.5f, 0.5f); // Lowered specular to reduce glare
+	// Optional: Soft Overhead Light (acts as indirect room light)
+	light.position = glm::vec3(15.0f, 18.0f, -15.0f);
+	light.direction = glm::vec3(0.0f, 0.0f, 0.0f);
+	light.ambientColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	light.diffuseColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	light.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	light.focalStrength = 50.0f; // Very soft room fill
+	light.specularIntensity = 0.0f;
+	m_lightSources.push_back(light);
+
+	UploadSceneLights(0);
+}
 
-	m_pShaderManager->setVec3Value("lightSources[1].position", lightPosition2);
-	m_pShaderManager->setVec3Value("lightSources[1].direction", lightDirection2);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", ambientLight2);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", diffuseLight2);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", specularLight2);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 40.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 30.0f);
+/***********************************************************
+ *  UploadSceneLights()
+ *
+ *  This method sets the global ambient light and the light
+ *  sources into the shader.  Lights that no longer exist
+ *  are turned off by zeroing their colors.
+ ***********************************************************/
+void SceneManager::UploadSceneLights(int previousCount)
+{
+	m_pShaderManager->setVec3Value("globalAmbient", m_globalAmbientLight);
 
-	// Optional: Soft Overhead Light (acts as indirect room light)
-	glm::vec3 overheadLightPos = glm::vec3(15.0f, 18.0f, -15.0f);
-	glm::vec3 overheadLightColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	for (int i = 0; i < (int)m_lightSources.size(); i++)
+	{
+		std::string prefix = "lightSources[" + std::to_string(i) + "].";
+		m_pShaderManager->setVec3Value(prefix + "position", m_lightSources[i].position);
+		m_pShaderManager->setVec3Value(prefix + "direction", m_lightSources[i].direction);
+		m_pShaderManager->setVec3Value(prefix + "ambientColor", m_lightSources[i].ambientColor);
+		m_pShaderManager->setVec3Value(prefix + "diffuseColor", m_lightSources[i].diffuseColor);
+		m_pShaderManager->setVec3Value(prefix + "specularColor", m_lightSources[i].specularColor);
+		m_pShaderManager->setFloatValue(prefix + "focalStrength", m_lightSources[i].focalStrength);
+		m_pShaderManager->setFloatValue(prefix + "specularIntensity", m_lightSources[i].specularIntensity);
+	}
 
-	m_pShaderManager->setVec3Value("lightSources[2].position", overheadLightPos);
-	m_pShaderManager->setVec3Value("lightSources[2].ambientColor", overheadLightColor);
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 50.0f); // Very soft room fill
+	for (int i = (int)m_lightSources.size(); i < previousCount; i++)
+	{
+		std::string prefix = "lightSources[" + std::to_string(i) + "].";
+		m_pShaderManager->setVec3Value(prefix + "ambientColor", glm::vec3(0.0f, 0.0f, 0.0f));
+		m_pShaderManager->setVec3Value(prefix + "diffuseColor", glm::vec3(0.0f, 0.0f, 0.0f));
+		m_pShaderManager->setVec3Value(prefix + "specularColor", glm::vec3(0.0f, 0.0f, 0.0f));
+	}
 }
 
 void SceneManager::LoadSceneTextures() {
@@ -511,238 +979,2320 @@ void SceneManager::LoadSceneTextures() {
 
 }
 
-void SceneManager::PrepareScene()
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method adds an untextured object to the scene and
+ *  returns its handle so the caller can set its appearance.
+ ***********************************************************/
+ObjectStore::OBJECT_HANDLE SceneManager::AddSceneObject(
+	std::string tag,
+	MESH_TYPE mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
 {
-	DefineObjectMaterials(); // Define material properties
-	SetupSceneLights();      // Configure lighting
-	LoadSceneTextures(); // Load the scene texture
+	ObjectStore::OBJECT_HANDLE object = m_objects.Create(tag, mesh);
+	int index = m_objects.GetIndex(object);
 
-	// Load necessary meshes
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadPrismMesh();
-	m_basicMeshes->LoadTorusMesh();
+	m_objects.GetScales()[index] = scaleXYZ;
+	m_objects.GetRotations()[index] = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	m_objects.GetPositions()[index] = positionXYZ;
+
+	m_bObjectsChanged = true;
+	m_bSceneDirty = true;
+
+	return(object);
 }
 
 /***********************************************************
- *  RenderScene()
+ *  RemoveSceneObject()
  *
- *  This method is used for rendering the 3D scene by
- *  transforming and drawing the basic 3D shapes
+ *  This method removes an object from the scene.
  ***********************************************************/
-void SceneManager::RenderScene() {
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f, YrotationDegrees = 0.0f, ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+void SceneManager::RemoveSceneObject(ObjectStore::OBJECT_HANDLE object)
+{
+	if (m_objects.IsValid(object))
+	{
+		m_objects.Destroy(object);
+		m_bObjectsChanged = true;
+		m_bSceneDirty = true;
+	}
+}
 
-	// Enable texture usage
-	m_pShaderManager->setIntValue("bUseTexture", true);
-	m_pShaderManager->setIntValue("bUseLighting", true);
+/***********************************************************
+ *  SetObjectTexture()
+ *
+ *  This method textures an object with a loaded texture.
+ ***********************************************************/
+void SceneManager::SetObjectTexture(ObjectStore::OBJECT_HANDLE object, std::string_view textureTag)
+{
+	int index = m_objects.GetIndex(object);
+	if (index >= 0)
+	{
+		m_objects.GetTextures()[index] = FindTextureSlot(textureTag);
+		m_bObjectsChanged = true;
+		m_bSceneDirty = true;
+	}
+}
 
-	/*** Floor Plane (Wooden Desk) ***/
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 6.0f); // Desk surface size
-	positionXYZ = glm::vec3(0.0f, -5.0f, 0.0f); // Under the lamp
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("woodTexture");
+/***********************************************************
+ *  SetObjectMaterial()
+ *
+ *  This method lights an object with a defined material.
+ ***********************************************************/
+void SceneManager::SetObjectMaterial(ObjectStore::OBJECT_HANDLE object, std::string_view materialTag)
+{
+	int index = m_objects.GetIndex(object);
+	if (index >= 0)
+	{
+		m_objects.GetMaterials()[index] = FindMaterialIndex(materialTag);
+		m_bObjectsChanged = true;
+		m_bSceneDirty = true;
+	}
+}
 
-	// Explicitly bind the texture before drawing (important fix)
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("woodTexture"));
+/***********************************************************
+ *  SetObjectColor()
+ *
+ *  This method gives an object a solid color.  An object
+ *  whose color is not fully opaque is always blended.
+ ***********************************************************/
+void SceneManager::SetObjectColor(ObjectStore::OBJECT_HANDLE object, glm::vec4 color, bool bTransparent)
+{
+	int index = m_objects.GetIndex(object);
+	if (index >= 0)
+	{
+		uint8_t& flags = m_objects.GetFlags()[index];
+		flags |= ObjectStore::OBJECT_USE_COLOR;
+		if (bTransparent || (color.a < 1.0f))
+			flags |= ObjectStore::OBJECT_TRANSPARENT;
+		else
+			flags &= ~ObjectStore::OBJECT_TRANSPARENT;
 
-	// Draw the plane mesh
-	m_basicMeshes->DrawPlaneMesh();
+		m_objects.GetColors()[index] = color;
+		m_bObjectsChanged = true;
+		m_bSceneDirty = true;
+	}
+}
 
-	/*** Book (Red Cover) ***/
-	scaleXYZ = glm::vec3(6.0f, 1.0f, 5.0f); // Book size
-	positionXYZ = glm::vec3(12.0f, -4.5f, -0.5f); // To the right of the keyboard
-	YrotationDegrees = -30.0f;
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("backDrop");
+/***********************************************************
+ *  DefineSceneObjects()
+ *
+ *  This method lays out the objects of the 3D scene.
+ ***********************************************************/
+void SceneManager::DefineSceneObjects()
+{
+	ObjectStore::OBJECT_HANDLE object;
 
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("backDrop"));
+	m_objects.Clear();
 
-	m_basicMeshes->DrawBoxMesh();
+	/*** Floor Plane (Wooden Desk) ***/
+	object = AddSceneObject("desk", MESH_PLANE,
+		glm::vec3(20.0f, 1.0f, 6.0f), // Desk surface size
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, -5.0f, 0.0f)  // Under the lamp
+		);
+	SetObjectTexture(object, "woodTexture");
 
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	/*** Book (Red Cover) ***/
+	object = AddSceneObject("book", MESH_BOX,
+		glm::vec3(6.0f, 1.0f, 5.0f),    // Book size
+		0.0f, -30.0f, 0.0f,
+		glm::vec3(12.0f, -4.5f, -0.5f)  // To the right of the keyboard
+		);
+	SetObjectTexture(object, "backDrop");
 
 	/*** Monitor Screen (Black) ***/
-	scaleXYZ = glm::vec3(12.0f, 8.0f, 0.4f);
-	positionXYZ = glm::vec3(0.0f, 2.0f, -1.5f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("monscreen");
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("monScreen"));
-
-	m_basicMeshes->DrawBoxMesh();
+	object = AddSceneObject("monitorScreen", MESH_BOX,
+		glm::vec3(12.0f, 8.0f, 0.4f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 2.0f, -1.5f)
+		);
+	SetObjectTexture(object, "monScreen");
 
 	/*** Keyboard ***/
-	scaleXYZ = glm::vec3(8.0f, 0.5f, 3.0f); // Keyboard size
-	positionXYZ = glm::vec3(0.0f, -4.8f, 3.0f); // Position in front of monitor
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("pckey");
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("pcKey"));
-
-	m_basicMeshes->DrawBoxMesh();
+	object = AddSceneObject("keyboard", MESH_BOX,
+		glm::vec3(8.0f, 0.5f, 3.0f),  // Keyboard size
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, -4.8f, 3.0f)  // Position in front of monitor
+		);
+	SetObjectTexture(object, "pcKey");
 
 	/*** Cup ***/
-	scaleXYZ = glm::vec3(1.5f, 3.0f, 1.5f);  // Cup size
-	positionXYZ = glm::vec3(-16.0f, -5.0f, 4.0f); // Back left of desk
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("pencup");  // Apply cup material (Dark Green)
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("penCup"));
-
-	m_basicMeshes->DrawCylinderMesh();
+	object = AddSceneObject("cup", MESH_CYLINDER,
+		glm::vec3(1.5f, 3.0f, 1.5f),    // Cup size
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(-16.0f, -5.0f, 4.0f)  // Back left of desk
+		);
+	SetObjectTexture(object, "penCup");
+	// the cup and lamp take their shiny materials only when there
+	// are probes to reflect, so they otherwise look as they did
+	if (m_bReflectionProbes)
+	{
+		SetObjectMaterial(object, "cup");
+	}
 
 	/*** Lamp Base (Grey) ***/
-	scaleXYZ = glm::vec3(3.0f, 1.0f, 3.0f);
-	positionXYZ = glm::vec3(-15.0f, -5.0f, -2.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("lampgold");  // Use material, NOT texture
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("lampGold"));
-
-	m_basicMeshes->DrawCylinderMesh();
+	object = AddSceneObject("lampBase", MESH_CYLINDER,
+		glm::vec3(3.0f, 1.0f, 3.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(-15.0f, -5.0f, -2.0f)
+		);
+	SetObjectTexture(object, "lampGold");
+	if (m_bReflectionProbes)
+	{
+		SetObjectMaterial(object, "lampBody");
+	}
 
 	/*** Upper Base (Brass/Gold) ***/
-	scaleXYZ = glm::vec3(-2.0f, 0.5f, 2.0f);
-	positionXYZ = glm::vec3(-15.0f, -4.0, -2.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("pencup");
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("penCup"));
-
-	m_basicMeshes->DrawSphereMesh();
+	object = AddSceneObject("lampUpperBase", MESH_SPHERE,
+		glm::vec3(-2.0f, 0.5f, 2.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(-15.0f, -4.0, -2.0f)
+		);
+	SetObjectTexture(object, "penCup");
 
 	/*** Lamp Pole***/
-	scaleXYZ = glm::vec3(0.3f, 7.0f, 0.3f);
-	positionXYZ = glm::vec3(-15.0f, -4.0f, -2.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("lampgold");
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("lampGold"));
-
-	m_basicMeshes->DrawCylinderMesh();
+	object = AddSceneObject("lampPole", MESH_CYLINDER,
+		glm::vec3(0.3f, 7.0f, 0.3f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(-15.0f, -4.0f, -2.0f)
+		);
+	SetObjectTexture(object, "lampGold");
+	if (m_bReflectionProbes)
+	{
+		SetObjectMaterial(object, "lampBody");
+	}
 
 	/*** Lamp Head ***/
-	scaleXYZ = glm::vec3(1.5f, 4.0f, 1.5f);
-	positionXYZ = glm::vec3(-14.0f, 2.0f, 0.5f);
-	XrotationDegrees = -45.0f;
-	YrotationDegrees = 360.0f;
-	ZrotationDegrees = 25.0f;
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("lampgold");
-
-	glActiveTexture(GL_TEXTURE);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("lampGold"));
-
-	m_basicMeshes->DrawCylinderMesh();
-
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	object = AddSceneObject("lampHead", MESH_CYLINDER,
+		glm::vec3(1.5f, 4.0f, 1.5f),
+		-45.0f, 360.0f, 25.0f,
+		glm::vec3(-14.0f, 2.0f, 0.5f)
+		);
+	SetObjectTexture(object, "lampGold");
+	if (m_bReflectionProbes)
+	{
+		SetObjectMaterial(object, "lampBody");
+	}
 
 	/*** A Delicious Donut ***/
-	scaleXYZ = glm::vec3(1.0f, 1.0f, 2.0f);
-	positionXYZ = glm::vec3(-8.0f, -4.5f, -1.0f);
-	XrotationDegrees = 90.0f;
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderTexture("donuttex");
-
-	glActiveTexture(GL_TEXTURE);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("donutTex"));
-
-	m_basicMeshes->DrawTorusMesh();
-
-	// Reset to non-textured mode for other objects
-	m_pShaderManager->setIntValue("bUseTexture", false);
+	object = AddSceneObject("donut", MESH_TORUS,
+		glm::vec3(1.0f, 1.0f, 2.0f),
+		90.0f, 0.0f, 0.0f,
+		glm::vec3(-8.0f, -4.5f, -1.0f)
+		);
+	SetObjectTexture(object, "donutTex");
 
 	/*** Decorative Top Section (Brass/Gold) ***/
-	scaleXYZ = glm::vec3(0.5f, 1.0f, 0.5f);
-	positionXYZ = glm::vec3(-15.8f, 5.5f, -2.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("lampKnob");
-	m_basicMeshes->DrawSphereMesh();
+	object = AddSceneObject("lampTop", MESH_SPHERE,
+		glm::vec3(0.5f, 1.0f, 0.5f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(-15.8f, 5.5f, -2.0f)
+		);
+	SetObjectMaterial(object, "lampKnob");
 
 	/*** Lamp Bulb (Glowing White) ***/
-	scaleXYZ = glm::vec3(0.8f, 0.8f, 0.8f);
-	positionXYZ = glm::vec3(-14.0f, 2.0f, 0.5f);
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 0.9f, 1.0f); // Soft white glow
-	m_basicMeshes->DrawSphereMesh();
+	object = AddSceneObject("lampBulb", MESH_SPHERE,
+		glm::vec3(0.8f, 0.8f, 0.8f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(-14.0f, 2.0f, 0.5f));
+	// Soft white glow, opaque so it is drawn into the depth
+	// pre-pass, and brightened past white on an HDR frame
+	SetObjectColor(object, glm::vec4(1.0f, 1.0f, 0.9f, 1.0f), false);
+	m_objects.GetFlags()[m_objects.GetIndex(object)] |= ObjectStore::OBJECT_EMISSIVE;
 
 	float pencilHeight = 3.5f;
 
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 50.0f;
-	ZrotationDegrees = 10.0f;
-
 	/*** Pencil 1 (Yellow) ***/
-	scaleXYZ = glm::vec3(0.2f, pencilHeight, 0.2f);
-	positionXYZ = glm::vec3(-16.0f, -3.5f, 4.0f); // Inside cup, slightly left
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("pencil");
-	m_basicMeshes->DrawCylinderMesh();
-
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 80.0f;
-	ZrotationDegrees = 10.0f;
+	object = AddSceneObject("pencil1", MESH_CYLINDER,
+		glm::vec3(0.2f, pencilHeight, 0.2f),
+		0.0f, 50.0f, 10.0f,
+		glm::vec3(-16.0f, -3.5f, 4.0f)  // Inside cup, slightly left
+		);
+	SetObjectMaterial(object, "pencil");
 
 	/*** Pencil 2 (Yellow, Slightly Tilted) ***/
-	scaleXYZ = glm::vec3(0.2f, pencilHeight, 0.2f);
-	positionXYZ = glm::vec3(-16.0f, -3.5f, 4.0f); // Inside cup, slightly right
-	XrotationDegrees = -15.0f; // Small tilt
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("pencil");
-	m_basicMeshes->DrawCylinderMesh();
-
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	object = AddSceneObject("pencil2", MESH_CYLINDER,
+		glm::vec3(0.2f, pencilHeight, 0.2f),
+		-15.0f, 80.0f, 10.0f,           // Small tilt
+		glm::vec3(-16.0f, -3.5f, 4.0f)  // Inside cup, slightly right
+		);
+	SetObjectMaterial(object, "pencil");
 
 	/*** Pencil 3 (Yellow, Slightly Tilted) ***/
-	scaleXYZ = glm::vec3(0.2f, pencilHeight, 0.2f);
-	positionXYZ = glm::vec3(16.0f, -4.8f, 4.0f); // Inside cup, slightly right
-	XrotationDegrees = -90.0f; // Small tilt
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("pencil");
-	m_basicMeshes->DrawCylinderMesh();
-
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	object = AddSceneObject("pencil3", MESH_CYLINDER,
+		glm::vec3(0.2f, pencilHeight, 0.2f),
+		-90.0f, 0.0f, 0.0f,            // Small tilt
+		glm::vec3(16.0f, -4.8f, 4.0f)  // Inside cup, slightly right
+		);
+	SetObjectMaterial(object, "pencil");
 
 	/*** Monitor Stand Base ***/
-	scaleXYZ = glm::vec3(6.0f, 1.0f, 4.0f);
-	positionXYZ = glm::vec3(0.0f, -4.5f, -2.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("monitorStand");
-	m_basicMeshes->DrawBoxMesh();
+	object = AddSceneObject("monitorStandBase", MESH_BOX,
+		glm::vec3(6.0f, 1.0f, 4.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, -4.5f, -2.0f)
+		);
+	SetObjectMaterial(object, "monitorStand");
 
 	/*** Monitor Stand Adjust ***/
-	scaleXYZ = glm::vec3(1.0f, 6.0f, 1.0f);
-	positionXYZ = glm::vec3(0.0f, -2.5f, -2.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("monitor");
-	m_basicMeshes->DrawBoxMesh();
+	object = AddSceneObject("monitorStandAdjust", MESH_BOX,
+		glm::vec3(1.0f, 6.0f, 1.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, -2.5f, -2.0f)
+		);
+	SetObjectMaterial(object, "monitor");
 
 	/*** Mouse ***/
-	scaleXYZ = glm::vec3(1.0f, 0.5f, 1.0f); // Mouse size
-	positionXYZ = glm::vec3(6.0f, -4.8f, 3.2f); // To the right of the keyboard
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("monitor");
-	m_basicMeshes->DrawBoxMesh();
-}
\ No newline at end of file
+	object = AddSceneObject("mouse", MESH_BOX,
+		glm::vec3(1.0f, 0.5f, 1.0f),  // Mouse size
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(6.0f, -4.8f, 3.2f)  // To the right of the keyboard
+		);
+	SetObjectMaterial(object, "monitor");
+
+	// tile extra copies of the desk layout in a grid when stress
+	// testing with large object counts
+	if (m_sceneCopies > 1)
+	{
+		const int layoutSize = m_objects.GetCount();
+
+		m_objects.Reserve(layoutSize * m_sceneCopies);
+		for (int copy = 1; copy < m_sceneCopies; copy++)
+		{
+			glm::vec3 offset = GetCopyOffset(copy);
+			for (int i = 0; i < layoutSize; i++)
+			{
+				object = m_objects.Duplicate(m_objects.GetHandle(i));
+				m_objects.GetPositions()[m_objects.GetIndex(object)] += offset;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  DefineSceneAnimations()
+ *
+ *  This method adds the keyframed tracks of the built-in
+ *  layout, in every copy of it.
+ ***********************************************************/
+void SceneManager::DefineSceneAnimations()
+{
+	// the lamp head slowly nods and swings back
+	std::vector<AnimationSystem::KEYFRAME> lampHeadKeys = {
+		{ 0.0f, glm::vec3(-45.0f, 360.0f, 25.0f) },
+		{ 2.0f, glm::vec3(-35.0f, 360.0f, 30.0f) },
+		{ 4.0f, glm::vec3(-45.0f, 360.0f, 25.0f) } };
+
+	m_animations.Clear();
+	for (int i = 0; i < m_objects.GetCount(); i++)
+	{
+		if (m_objects.GetName(i) == "lampHead")
+		{
+			m_animations.AddTrack(m_objects.GetHandle(i), AnimationSystem::CHANNEL_ROTATION, lampHeadKeys);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetCopyOffset()
+ *
+ *  This method returns where a copy of the layout sits in
+ *  the grid of copies, with the original at the origin.
+ ***********************************************************/
+glm::vec3 SceneManager::GetCopyOffset(int copy) const
+{
+	const int columns = (int)ceil(sqrt((double)m_sceneCopies));
+	const glm::vec3 spacing(45.0f, 0.0f, 20.0f);
+
+	return(spacing * glm::vec3((float)(copy % columns), 0.0f, (float)-(copy / columns)));
+}
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures, materials and lights.
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// the pool comes first, so meshes imported by the layout
+	// are added after the shapes
+	if (NULL == m_pMeshPool)
+	{
+		LoadMeshPool(m_pJobSystem);
+	}
+	if (m_bPackedMeshes)
+	{
+		// the shapes were tessellated by the baker, and the CPU
+		// path draws them straight from the pool's buffers
+		m_pMeshPool->Upload();
+	}
+	else
+	{
+		// Load necessary meshes
+		m_basicMeshes->LoadBoxMesh();
+		m_basicMeshes->LoadPlaneMesh();
+		m_basicMeshes->LoadCylinderMesh();
+		m_basicMeshes->LoadConeMesh();
+		m_basicMeshes->LoadSphereMesh();
+		m_basicMeshes->LoadPrismMesh();
+		m_basicMeshes->LoadTorusMesh();
+	}
+
+	// the scene file replaces the built-in layout, which is
+	// still used when the file cannot be read
+	if ((NULL != m_pSceneFile) && (m_bSceneFilePreloaded || m_pSceneFile->Load()))
+	{
+		m_pShaderManager->setBoolValue("bUseLighting", true);
+		ApplySceneFile();
+	}
+	else if ((NULL != m_pAssetPack) && LoadPackedLayout())
+	{
+		std::cout << "INFO: Scene layout loaded from the asset pack" << std::endl;
+	}
+	else
+	{
+		DefineObjectMaterials(); // Define material properties
+		SetupSceneLights();      // Configure lighting
+		LoadSceneTextures(); // Load the scene texture
+		DefineSceneObjects();    // Lay out the scene
+		DefineSceneAnimations(); // Animate the lamp head
+	}
+
+	// every texture keeps the texture unit matching its slot
+	BindGLTextures();
+
+	// the lightmaps must be loaded before the objects are
+	// handed to the GPU-driven renderer, which looks up their
+	// places in the atlas
+	if (NULL == m_pLightmaps)
+	{
+		ReadLightmapFile();
+	}
+
+	if (m_bGPUDriven)
+	{
+		m_bGPUDriven = PrepareGPUDrivenRendering();
+	}
+	else if (m_bCompactVertices)
+	{
+		std::cout << "INFO: Compact vertices need the GPU-driven path, keeping full precision" << std::endl;
+	}
+	if (m_bReflectionProbes && !m_bGPUDriven)
+	{
+		std::cout << "INFO: Reflection probes need the GPU-driven path, keeping analytic highlights only" << std::endl;
+	}
+	if ((NULL != m_pLightmaps) && !m_bGPUDriven)
+	{
+		std::cout << "INFO: Lightmaps need the GPU-driven path, lighting every object dynamically" << std::endl;
+	}
+
+	m_bSceneDirty = true;
+}
+
+/***********************************************************
+ *  PreloadScene()
+ *
+ *  This method reads the layout, creates the textures and
+ *  fills the mesh pool ahead of PrepareScene().  It touches
+ *  no shader uniforms, texture units or vertex arrays, which
+ *  belong to the drawing context or the scene drawn now, and
+ *  finishes its uploads before returning, so the drawing
+ *  context can use them right away.
+ ***********************************************************/
+void SceneManager::PreloadScene()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	// the job system runs the frames of the scene drawn now, so
+	// the shapes are tessellated on this thread
+	LoadMeshPool(NULL);
+	ReadLightmapFile();
+
+	// the same textures and meshes the layout asks for once it
+	// is applied, created in the same order so they get the
+	// same slots and pool indices
+	if ((NULL != m_pSceneFile) && m_pSceneFile->Load())
+	{
+		m_bSceneFilePreloaded = true;
+		for (const SceneFile::TEXTURE_ENTRY& texture : m_pSceneFile->GetLoaded().textures)
+		{
+			CreateGLTexture(texture.filename.c_str(), texture.tag);
+		}
+		for (const SceneFile::MESH_ENTRY& mesh : m_pSceneFile->GetLoaded().meshes)
+		{
+			if (m_preloadedMeshes.find(mesh.filename) != m_preloadedMeshes.end())
+			{
+				continue;
+			}
+			std::vector<MeshPool::MESH_VERTEX> vertices;
+			std::vector<GLuint> indices;
+			MeshImporter importer;
+			if (importer.Import(mesh.filename, vertices, indices))
+			{
+				m_preloadedMeshes[mesh.filename] = m_pMeshPool->AddMesh(vertices, indices);
+			}
+		}
+	}
+	else if (NULL != m_pAssetPack)
+	{
+		uint32_t textureCount = 0;
+		m_pAssetPack->GetSection<AssetPack::PACK_TEXTURE>(AssetPack::SECTION_TEXTURES, textureCount);
+		for (uint32_t i = 0; i < textureCount; i++)
+		{
+			CreatePackedTexture(i);
+		}
+	}
+	else
+	{
+		LoadSceneTextures();
+	}
+
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		m_preloadedTextures.insert(m_textureIDs[i].tag);
+	}
+
+	// the drawing context may only read the textures once the
+	// uploads are done
+	glFinish();
+
+	double elapsed = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	std::cout << "INFO: Preloaded " << m_loadedTextures << " textures and "
+		<< m_pMeshPool->GetMeshCount() << " meshes in " << elapsed << " ms" << std::endl;
+}
+
+/***********************************************************
+ *  ReplaceLights()
+ *
+ *  This method sets this scene's lights again, turning off
+ *  the ones the replaced scene had beyond them.
+ ***********************************************************/
+void SceneManager::ReplaceLights(const SceneManager& replaced)
+{
+	UploadSceneLights((int)replaced.m_lightSources.size());
+}
+
+/***********************************************************
+ *  ReleaseResources()
+ *
+ *  This method frees the scene's textures one at a time,
+ *  then its larger GPU objects, one per call.  Whatever is
+ *  left is freed by the destructor.
+ ***********************************************************/
+bool SceneManager::ReleaseResources()
+{
+	if (m_loadedTextures > 0)
+	{
+		TEXTURE_INFO& texture = m_textureIDs[--m_loadedTextures];
+		if (NULL != m_pTextureStreamer)
+		{
+			m_pTextureStreamer->RemoveTexture(texture.ID);
+		}
+		glDeleteTextures(1, &texture.ID);
+		texture.ID = 0;
+		texture.tag.clear();
+		return(false);
+	}
+	if (0 != m_lightmapTexture)
+	{
+		glDeleteTextures(1, &m_lightmapTexture);
+		m_lightmapTexture = 0;
+		return(false);
+	}
+	if (NULL != m_pReflectionProbes)
+	{
+		delete m_pReflectionProbes;
+		m_pReflectionProbes = NULL;
+		return(false);
+	}
+	if (NULL != m_pGPURenderer)
+	{
+		delete m_pGPURenderer;
+		m_pGPURenderer = NULL;
+		return(false);
+	}
+	if (NULL != m_pMeshPool)
+	{
+		delete m_pMeshPool;
+		m_pMeshPool = NULL;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  PrepareGPUDrivenRendering()
+ *
+ *  This method uploads the pooled meshes, scene objects,
+ *  materials and lights for the GPU-driven render path.
+ ***********************************************************/
+bool SceneManager::PrepareGPUDrivenRendering()
+{
+	// packed or imported meshes have been uploaded already, but
+	// in the full precision layout the CPU path can draw
+	if ((m_pMeshPool->GetVertexBuffer() == 0) || m_bCompactVertices)
+	{
+		m_pMeshPool->SetCompactVertices(m_bCompactVertices);
+		m_pMeshPool->Upload();
+	}
+
+	m_pGPURenderer = new GPUDrivenRenderer(m_pMeshPool);
+	if (m_pGPURenderer->Initialize() == false)
+	{
+		delete m_pGPURenderer;
+		m_pGPURenderer = NULL;
+
+		// the CPU path draws pooled meshes through a shader that
+		// only reads full precision vertices
+		if (m_pMeshPool->HasCompactVertices())
+		{
+			m_pMeshPool->SetCompactVertices(false);
+			m_pMeshPool->Upload();
+		}
+		return(false);
+	}
+
+	m_pGPURenderer->SetMaterials(m_objectMaterials);
+	m_pGPURenderer->SetLights(m_lightSources, m_globalAmbientLight);
+	if (NULL != m_pLightmaps)
+	{
+		ApplyLightmaps();
+	}
+
+	// the probes are captured by the first frame drawn
+	if (m_bReflectionProbes)
+	{
+		m_pReflectionProbes = new ReflectionProbes();
+		if (!m_pReflectionProbes->Initialize(g_ProbeUnit))
+		{
+			delete m_pReflectionProbes;
+			m_pReflectionProbes = NULL;
+		}
+	}
+	m_pGPURenderer->SetReflectionProbes(g_ProbeUnit,
+		(NULL != m_pReflectionProbes) ? ReflectionProbes::LEVEL_COUNT : 0);
+	UploadGPUObjects();
+
+	return(true);
+}
+
+/***********************************************************
+ *  UploadGPUObjects()
+ *
+ *  This method brings the transforms up to date and hands
+ *  every scene object to the GPU-driven renderer.
+ ***********************************************************/
+void SceneManager::UploadGPUObjects()
+{
+	const int objectCount = m_objects.GetCount();
+	UpdateTransforms(0, objectCount);
+	PlaceReflectionProbes(m_objectProbes);
+
+	std::vector<GPUDrivenRenderer::OBJECT_INSTANCE> instances(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		BuildGPUInstance(m_objects, m_pLightmaps, m_objectProbes, m_emissiveScale, i, instances[i]);
+	}
+
+	m_pGPURenderer->SetObjects(instances);
+	m_bObjectsChanged = false;
+	m_movedObjects.clear();
+}
+
+/***********************************************************
+ *  UploadMovedObjects()
+ *
+ *  This method brings the transforms of the objects the
+ *  animations moved up to date and rewrites only their
+ *  slots.  A move that hands any object another probe needs
+ *  the whole upload.
+ ***********************************************************/
+void SceneManager::UploadMovedObjects()
+{
+	// an object with several tracks is listed once per track
+	std::sort(m_movedObjects.begin(), m_movedObjects.end());
+	m_movedObjects.erase(std::unique(m_movedObjects.begin(), m_movedObjects.end()), m_movedObjects.end());
+	for (int index : m_movedObjects)
+	{
+		UpdateTransforms(index, index + 1);
+	}
+
+	if (NULL != m_pReflectionProbes)
+	{
+		std::vector<int> objectProbes;
+		PlaceReflectionProbes(objectProbes);
+		if (objectProbes != m_objectProbes)
+		{
+			UploadGPUObjects();
+			return;
+		}
+	}
+
+	const int movedCount = (int)m_movedObjects.size();
+	GPUDrivenRenderer::OBJECT_INSTANCE* instances =
+		m_pJobSystem->GetFrameArena().AllocateArray<GPUDrivenRenderer::OBJECT_INSTANCE>(movedCount);
+	for (int i = 0; i < movedCount; i++)
+	{
+		BuildGPUInstance(m_objects, m_pLightmaps, m_objectProbes, m_emissiveScale, m_movedObjects[i], instances[i]);
+	}
+	m_pGPURenderer->UpdateObjects(m_movedObjects.data(), instances, movedCount);
+	m_movedObjects.clear();
+}
+
+/***********************************************************
+ *  PlaceReflectionProbes()
+ *
+ *  This method puts a probe at each object shiny enough to
+ *  reflect one and returns the probe each object samples,
+ *  all -1 without probes.  Probes whose surroundings changed
+ *  are marked to be rendered again.
+ ***********************************************************/
+void SceneManager::PlaceReflectionProbes(std::vector<int>& objectProbes)
+{
+	const int objectCount = m_objects.GetCount();
+	objectProbes.assign(objectCount, -1);
+	if (NULL == m_pReflectionProbes)
+	{
+		return;
+	}
+
+	const int* materials = m_objects.GetMaterials();
+	std::vector<unsigned char> glossy(objectCount, 0);
+	for (int i = 0; i < objectCount; i++)
+	{
+		glossy[i] = ((materials[i] >= 0) && (materials[i] < (int)m_objectMaterials.size()) &&
+			(m_objectMaterials[materials[i]].shininess >= g_ReflectiveShininess)) ? 1 : 0;
+	}
+	m_pReflectionProbes->PlaceProbes(m_objects, glossy, objectProbes);
+}
+
+/***********************************************************
+ *  EnableGPUDrivenRendering()
+ *
+ *  This method selects the GPU-driven render path.  It falls
+ *  back to CPU submission when the context is too old.
+ ***********************************************************/
+void SceneManager::EnableGPUDrivenRendering(bool bEnable)
+{
+	m_bGPUDriven = bEnable;
+}
+
+/***********************************************************
+ *  EnableDepthPrePass()
+ *
+ *  This method turns the depth-only pass over the opaque
+ *  objects on or off.
+ ***********************************************************/
+void SceneManager::EnableDepthPrePass(bool bEnable)
+{
+	m_bDepthPrePass = bEnable;
+	m_bSceneDirty = true;
+}
+
+/***********************************************************
+ *  EnableCompactVertices()
+ *
+ *  This method selects the compact vertex layout for the
+ *  mesh pool.  The basic shape meshes drawn by the CPU path
+ *  keep their own full precision buffers.
+ ***********************************************************/
+void SceneManager::EnableCompactVertices(bool bEnable)
+{
+	m_bCompactVertices = bEnable;
+}
+
+/***********************************************************
+ *  EnableReflectionProbes()
+ *
+ *  This method turns on the reflection probes, which are
+ *  placed when the GPU-driven renderer receives the objects.
+ ***********************************************************/
+void SceneManager::EnableReflectionProbes(bool bEnable)
+{
+	m_bReflectionProbes = bEnable;
+}
+
+/***********************************************************
+ *  EnableTextureStreaming()
+ *
+ *  This method creates the texture streamer with its memory
+ *  budget.  A budget of zero keeps every texture resident.
+ ***********************************************************/
+void SceneManager::EnableTextureStreaming(int budgetMegabytes)
+{
+	if (NULL != m_pTextureStreamer)
+	{
+		delete m_pTextureStreamer;
+		m_pTextureStreamer = NULL;
+	}
+	if (budgetMegabytes > 0)
+	{
+		m_pTextureStreamer = new TextureStreamer((size_t)budgetMegabytes * 1024 * 1024);
+	}
+}
+
+/***********************************************************
+ *  SetSceneCopies()
+ *
+ *  This method sets how many times the scene layout is
+ *  tiled when the scene objects are defined.
+ ***********************************************************/
+void SceneManager::SetSceneCopies(int copies)
+{
+	m_sceneCopies = std::max(copies, 1);
+}
+
+/***********************************************************
+ *  SetJobSystem()
+ *
+ *  This method sets the job system for the per-frame work.
+ ***********************************************************/
+void SceneManager::SetJobSystem(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+}
+
+/***********************************************************
+ *  SetSceneFile()
+ *
+ *  This method sets the scene file to read the layout from
+ *  and to watch for changes.
+ ***********************************************************/
+void SceneManager::SetSceneFile(const char* filename)
+{
+	if (NULL != m_pSceneFile)
+	{
+		delete m_pSceneFile;
+		m_pSceneFile = NULL;
+	}
+	if (NULL != filename)
+	{
+		m_pSceneFile = new SceneFile(filename);
+	}
+}
+
+/***********************************************************
+ *  CheckSceneFile()
+ *
+ *  This method reloads the scene file once it has been
+ *  saved.  A file that fails to parse leaves the scene as
+ *  it is until the next save.
+ ***********************************************************/
+bool SceneManager::CheckSceneFile()
+{
+	if ((NULL == m_pSceneFile) || !m_pSceneFile->HasChanged())
+	{
+		return(false);
+	}
+
+	if (!m_pSceneFile->Load())
+	{
+		return(false);
+	}
+
+	ApplySceneFile();
+	return(true);
+}
+
+/***********************************************************
+ *  SetAssetPack()
+ *
+ *  This method maps the baked asset pack.  A pack that does
+ *  not open is reported and the scene loads as without one.
+ ***********************************************************/
+void SceneManager::SetAssetPack(const char* filename)
+{
+	if (NULL != m_pAssetPack)
+	{
+		delete m_pAssetPack;
+		m_pAssetPack = NULL;
+	}
+	if (NULL != filename)
+	{
+		m_pAssetPack = new AssetPack();
+		if (!m_pAssetPack->Open(filename))
+		{
+			delete m_pAssetPack;
+			m_pAssetPack = NULL;
+		}
+	}
+}
+
+/***********************************************************
+ *  SetLightmapFile()
+ *
+ *  This method names the lightmap file to light the static
+ *  objects from.  It is read when the scene is prepared.
+ ***********************************************************/
+void SceneManager::SetLightmapFile(const char* filename)
+{
+	m_lightmapFile = (NULL != filename) ? filename : "";
+}
+
+/***********************************************************
+ *  BakeLightmaps()
+ *
+ *  This method describes every object's surface to the
+ *  lightmap baker.  Transparent objects still cast shadows
+ *  but are not baked, since their lighting would be wrong
+ *  as soon as they show through.  Animated objects are left
+ *  out of the rays as well, as they move off the shadows
+ *  they would have cast.
+ ***********************************************************/
+bool SceneManager::BakeLightmaps(const char* filename)
+{
+	if ((NULL == m_pMeshPool) || (NULL == m_pJobSystem) || (NULL == filename))
+	{
+		std::cout << "ERROR: Lightmaps can only be baked for a prepared scene" << std::endl;
+		return(false);
+	}
+
+	const int objectCount = m_objects.GetCount();
+	UpdateTransforms(0, objectCount);
+
+	const int* materials = m_objects.GetMaterials();
+	const int* textures = m_objects.GetTextures();
+	const glm::vec4* colors = m_objects.GetColors();
+	const uint8_t* flags = m_objects.GetFlags();
+
+	std::vector<LightmapBaker::BAKE_SURFACE> surfaces(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		LightmapBaker::BAKE_SURFACE& surface = surfaces[i];
+		surface.bAnimated = m_animations.IsAnimated(m_objects.GetHandle(i));
+		surface.bStatic = ((flags[i] & ObjectStore::OBJECT_TRANSPARENT) == 0) && !surface.bAnimated;
+
+		// the GPU-driven path's default material for objects
+		// without one
+		surface.ambient = glm::vec3(0.2f);
+		surface.diffuse = glm::vec3(1.0f);
+		if ((materials[i] >= 0) && (materials[i] < (int)m_objectMaterials.size()))
+		{
+			const OBJECT_MATERIAL& material = m_objectMaterials[materials[i]];
+			surface.ambient = material.ambientColor * material.ambientStrength;
+			surface.diffuse = material.diffuseColor;
+		}
+
+		// texture images only live on the GPU, so a textured
+		// object bounces a middle grey
+		surface.albedo = (textures[i] < 0) ? glm::vec3(colors[i]) : glm::vec3(0.5f);
+	}
+
+	// only the lights the GPU-driven path shades with
+	std::vector<LightmapBaker::BAKE_LIGHT> lights;
+	for (int i = 0; i < std::min((int)m_lightSources.size(), GPUDrivenRenderer::MAX_LIGHTS); i++)
+	{
+		LightmapBaker::BAKE_LIGHT light;
+		light.position = m_lightSources[i].position;
+		light.direction = m_lightSources[i].direction;
+		light.ambientColor = m_lightSources[i].ambientColor;
+		light.diffuseColor = m_lightSources[i].diffuseColor;
+		lights.push_back(light);
+	}
+
+	LightmapBaker* pLightmaps = new LightmapBaker();
+	if (!pLightmaps->Bake(m_objects, *m_pMeshPool, surfaces, lights, m_globalAmbientLight, *m_pJobSystem) ||
+		!pLightmaps->Save(filename))
+	{
+		delete pLightmaps;
+		return(false);
+	}
+
+	if (NULL != m_pLightmaps)
+	{
+		delete m_pLightmaps;
+	}
+	m_pLightmaps = pLightmaps;
+	m_pMeshPool->EnableLightmapCoords();
+	if (NULL != m_pGPURenderer)
+	{
+		ApplyLightmaps();
+		m_bObjectsChanged = true;
+		m_bSceneDirty = true;
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  ApplyLightmaps()
+ *
+ *  This method uploads the lightmap atlas to its own texture
+ *  unit, filtered but without mipmaps, since the charts sit
+ *  only a couple of texels apart.
+ ***********************************************************/
+void SceneManager::ApplyLightmaps()
+{
+	if (0 == m_lightmapTexture)
+	{
+		glGenTextures(1, &m_lightmapTexture);
+	}
+	glActiveTexture(GL_TEXTURE0 + g_LightmapUnit);
+	glBindTexture(GL_TEXTURE_2D, m_lightmapTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_pLightmaps->GetWidth(), m_pLightmaps->GetHeight(), 0,
+		GL_RGBA, GL_HALF_FLOAT, m_pLightmaps->GetTexels().data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glActiveTexture(GL_TEXTURE0 + g_TextureSlotCount);
+
+	UpdateLightmapLights();
+}
+
+/***********************************************************
+ *  UpdateLightmapLights()
+ *
+ *  This method checks the lights the lightmaps were baked
+ *  with are still the first of the scene's lights.  Lights
+ *  added after the bake are shaded dynamically on top, but
+ *  a changed or removed light leaves the baked light wrong,
+ *  so every object is then lit dynamically.
+ ***********************************************************/
+void SceneManager::UpdateLightmapLights()
+{
+	if ((NULL == m_pGPURenderer) || (NULL == m_pLightmaps))
+	{
+		return;
+	}
+
+	const std::vector<LightmapBaker::BAKE_LIGHT>& baked = m_pLightmaps->GetLights();
+	bool bMatch = (m_pLightmaps->GetGlobalAmbient() == m_globalAmbientLight) &&
+		((int)baked.size() <= std::min((int)m_lightSources.size(), GPUDrivenRenderer::MAX_LIGHTS));
+	for (int i = 0; bMatch && (i < (int)baked.size()); i++)
+	{
+		bMatch = (baked[i].position == m_lightSources[i].position) &&
+			(baked[i].direction == m_lightSources[i].direction) &&
+			(baked[i].ambientColor == m_lightSources[i].ambientColor) &&
+			(baked[i].diffuseColor == m_lightSources[i].diffuseColor);
+	}
+
+	m_bakedLightCount = bMatch ? (int)baked.size() : -1;
+	if (!bMatch)
+	{
+		std::cout << "INFO: The lights changed since the lightmaps were baked, lighting every object dynamically" << std::endl;
+	}
+	m_pGPURenderer->SetLightmap(g_LightmapUnit, m_bakedLightCount);
+}
+
+/***********************************************************
+ *  ImportMesh()
+ *
+ *  This method imports a mesh file into the mesh pool and
+ *  uploads the pool again, since the CPU path draws every
+ *  imported mesh from the pool's buffers.
+ ***********************************************************/
+int SceneManager::ImportMesh(const std::string& filename)
+{
+	if (NULL == m_pMeshPool)
+	{
+		std::cout << "ERROR: Meshes can only be imported into a prepared scene" << std::endl;
+		return(-1);
+	}
+
+	int meshIndex = AddMeshFile(filename, -1);
+	if (meshIndex >= 0)
+	{
+		m_pMeshPool->Upload();
+		m_bObjectsChanged = true;
+		m_bSceneDirty = true;
+	}
+	return(meshIndex);
+}
+
+/***********************************************************
+ *  AddMeshFile()
+ *
+ *  This method reads a mesh file into the pool.  A replaced
+ *  mesh keeps its index, so the objects using it draw the
+ *  new geometry, and its triangle tree is built again.
+ ***********************************************************/
+int SceneManager::AddMeshFile(const std::string& filename, int replacedMesh)
+{
+	// a mesh the preload imported is in the pool already
+	int meshIndex = -1;
+	std::map<std::string, int>::iterator preloaded = m_preloadedMeshes.find(filename);
+	if (preloaded != m_preloadedMeshes.end())
+	{
+		meshIndex = preloaded->second;
+		m_preloadedMeshes.erase(preloaded);
+	}
+	else
+	{
+		std::vector<MeshPool::MESH_VERTEX> vertices;
+		std::vector<GLuint> indices;
+		MeshImporter importer;
+		if (!importer.Import(filename, vertices, indices))
+		{
+			return(-1);
+		}
+		if (replacedMesh >= 0)
+		{
+			m_pMeshPool->ReplaceMesh(replacedMesh, vertices, indices);
+			m_sceneBVH.InvalidateMeshTree(replacedMesh);
+			meshIndex = replacedMesh;
+		}
+		else
+		{
+			meshIndex = m_pMeshPool->AddMesh(vertices, indices);
+		}
+	}
+	return(meshIndex);
+}
+
+/***********************************************************
+ *  LoadPackedMeshes()
+ *
+ *  This method points the mesh pool at the pack's vertices
+ *  and indices, which are uploaded from the mapping without
+ *  being copied first.
+ ***********************************************************/
+bool SceneManager::LoadPackedMeshes()
+{
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	uint32_t meshCount = 0;
+	const MeshPool::MESH_VERTEX* vertices = m_pAssetPack->GetSection<MeshPool::MESH_VERTEX>(
+		AssetPack::SECTION_VERTICES, vertexCount);
+	const GLuint* indices = m_pAssetPack->GetSection<GLuint>(AssetPack::SECTION_INDICES, indexCount);
+	const MeshPool::MESH_RANGE* meshes = m_pAssetPack->GetSection<MeshPool::MESH_RANGE>(
+		AssetPack::SECTION_MESHES, meshCount);
+
+	// every object mesh must be there, and inside the buffers
+	bool bValid = (NULL != vertices) && (NULL != indices) && (meshCount >= MESH_BUILTIN_COUNT);
+	for (uint32_t i = 0; bValid && (i < meshCount); i++)
+	{
+		bValid = ((uint64_t)meshes[i].firstIndex + meshes[i].indexCount <= indexCount) &&
+			(meshes[i].baseVertex >= 0) && ((uint32_t)meshes[i].baseVertex < vertexCount);
+
+		// the indices are relative to the mesh's base vertex
+		uint32_t meshVertices = vertexCount - (uint32_t)meshes[i].baseVertex;
+		for (uint32_t j = 0; bValid && (j < meshes[i].indexCount); j++)
+		{
+			bValid = indices[meshes[i].firstIndex + j] < meshVertices;
+		}
+	}
+	if (!bValid)
+	{
+		std::cout << "ERROR: Asset pack has no usable meshes, tessellating the shapes instead" << std::endl;
+		return(false);
+	}
+
+	m_pMeshPool->SetPackedGeometry(vertices, vertexCount, indices, indexCount, meshes, meshCount);
+	return(true);
+}
+
+/***********************************************************
+ *  LoadMeshPool()
+ *
+ *  This method creates the mesh pool with the pack's meshes,
+ *  or else with the built-in shapes, which also provide the
+ *  bounding spheres for culling.  With a job system, each
+ *  shape is tessellated into the shared store by a job of
+ *  its own first, and the pool then copies them from there.
+ ***********************************************************/
+void SceneManager::LoadMeshPool(JobSystem* pJobSystem)
+{
+	m_pMeshPool = new MeshPool();
+	if ((NULL != m_pAssetPack) && LoadPackedMeshes())
+	{
+		m_bPackedMeshes = true;
+		return;
+	}
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->BeginFrame();
+		JobSystem::JOB* job = pJobSystem->ParallelFor("tessellate shapes", MESH_BUILTIN_COUNT, 1,
+			[](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				ShapeTessellator::Tessellate(ShapeTessellator::GetBuiltinParameters((MESH_TYPE)i));
+			}
+		});
+		pJobSystem->Submit(job);
+		pJobSystem->Wait(job);
+		pJobSystem->EndFrame();
+	}
+	m_pMeshPool->LoadBuiltinMeshes();
+	m_shapeMeshBytes = m_pMeshPool->GetVertexCount() * sizeof(MeshPool::MESH_VERTEX) +
+		m_pMeshPool->GetIndexCount() * sizeof(GLuint);
+}
+
+/***********************************************************
+ *  ReadLightmapFile()
+ *
+ *  This method loads the named lightmap file, leaving the
+ *  scene lit dynamically when it cannot be read.
+ ***********************************************************/
+void SceneManager::ReadLightmapFile()
+{
+	if (m_lightmapFile.empty())
+	{
+		return;
+	}
+
+	m_pLightmaps = new LightmapBaker();
+	if (!m_pLightmaps->Load(m_lightmapFile))
+	{
+		delete m_pLightmaps;
+		m_pLightmaps = NULL;
+		return;
+	}
+	m_pMeshPool->EnableLightmapCoords();
+}
+
+/***********************************************************
+ *  LoadPackedLayout()
+ *
+ *  This method takes the materials, lights, textures and
+ *  objects from the asset pack.  The records are used in
+ *  place; only the tags are turned back into strings.
+ ***********************************************************/
+bool SceneManager::LoadPackedLayout()
+{
+	uint32_t sceneCount = 0;
+	uint32_t materialCount = 0;
+	uint32_t lightCount = 0;
+	uint32_t textureCount = 0;
+	uint32_t objectCount = 0;
+	const AssetPack::PACK_SCENE* scene = m_pAssetPack->GetSection<AssetPack::PACK_SCENE>(
+		AssetPack::SECTION_SCENE, sceneCount);
+	const AssetPack::PACK_MATERIAL* materials = m_pAssetPack->GetSection<AssetPack::PACK_MATERIAL>(
+		AssetPack::SECTION_MATERIALS, materialCount);
+	const AssetPack::PACK_LIGHT* lights = m_pAssetPack->GetSection<AssetPack::PACK_LIGHT>(
+		AssetPack::SECTION_LIGHTS, lightCount);
+	const AssetPack::PACK_TEXTURE* textures = m_pAssetPack->GetSection<AssetPack::PACK_TEXTURE>(
+		AssetPack::SECTION_TEXTURES, textureCount);
+	const AssetPack::PACK_OBJECT* objects = m_pAssetPack->GetSection<AssetPack::PACK_OBJECT>(
+		AssetPack::SECTION_OBJECTS, objectCount);
+
+	if ((NULL == scene) || (NULL == objects))
+	{
+		return(false);
+	}
+
+	m_objectMaterials.clear();
+	for (uint32_t i = 0; i < materialCount; i++)
+	{
+		OBJECT_MATERIAL material;
+		material.tag.assign(materials[i].tag, strnlen(materials[i].tag, AssetPack::NAME_LENGTH));
+		material.ambientColor = glm::vec3(materials[i].ambientColor[0], materials[i].ambientColor[1], materials[i].ambientColor[2]);
+		material.ambientStrength = materials[i].ambientStrength;
+		material.diffuseColor = glm::vec3(materials[i].diffuseColor[0], materials[i].diffuseColor[1], materials[i].diffuseColor[2]);
+		material.specularColor = glm::vec3(materials[i].specularColor[0], materials[i].specularColor[1], materials[i].specularColor[2]);
+		material.shininess = materials[i].shininess;
+		m_objectMaterials.push_back(material);
+	}
+
+	m_globalAmbientLight = glm::vec3(scene->globalAmbientLight[0], scene->globalAmbientLight[1], scene->globalAmbientLight[2]);
+	m_lightSources.clear();
+	for (uint32_t i = 0; i < lightCount; i++)
+	{
+		LIGHT_SOURCE light;
+		light.position = glm::vec3(lights[i].position[0], lights[i].position[1], lights[i].position[2]);
+		light.direction = glm::vec3(lights[i].direction[0], lights[i].direction[1], lights[i].direction[2]);
+		light.ambientColor = glm::vec3(lights[i].ambientColor[0], lights[i].ambientColor[1], lights[i].ambientColor[2]);
+		light.diffuseColor = glm::vec3(lights[i].diffuseColor[0], lights[i].diffuseColor[1], lights[i].diffuseColor[2]);
+		light.specularColor = glm::vec3(lights[i].specularColor[0], lights[i].specularColor[1], lights[i].specularColor[2]);
+		light.focalStrength = lights[i].focalStrength;
+		light.specularIntensity = lights[i].specularIntensity;
+		m_lightSources.push_back(light);
+	}
+	m_pShaderManager->setBoolValue("bUseLighting", true);
+	UploadSceneLights(0);
+
+	// pack texture index to texture slot, -1 for any that failed
+	std::vector<int> textureSlots(textureCount, -1);
+	for (uint32_t i = 0; i < textureCount; i++)
+	{
+		if (CreatePackedTexture(i))
+		{
+			textureSlots[i] = FindTextureSlot(std::string(textures[i].tag, strnlen(textures[i].tag, AssetPack::NAME_LENGTH)));
+		}
+	}
+
+	m_objects.Clear();
+	m_objects.Reserve(objectCount * m_sceneCopies);
+	for (int copy = 0; copy < m_sceneCopies; copy++)
+	{
+		glm::vec3 offset = GetCopyOffset(copy);
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			const AssetPack::PACK_OBJECT& packed = objects[i];
+			if (packed.mesh >= (uint32_t)m_pMeshPool->GetMeshCount())
+			{
+				continue;
+			}
+
+			ObjectStore::OBJECT_HANDLE object = m_objects.Create(
+				std::string(packed.name, strnlen(packed.name, AssetPack::NAME_LENGTH)), (MESH_TYPE)packed.mesh);
+			int index = m_objects.GetIndex(object);
+			m_objects.GetPositions()[index] = glm::vec3(packed.positionXYZ[0], packed.positionXYZ[1], packed.positionXYZ[2]) + offset;
+			m_objects.GetRotations()[index] = glm::vec3(packed.rotationXYZ[0], packed.rotationXYZ[1], packed.rotationXYZ[2]);
+			m_objects.GetScales()[index] = glm::vec3(packed.scaleXYZ[0], packed.scaleXYZ[1], packed.scaleXYZ[2]);
+			m_objects.GetTextures()[index] = ((packed.textureIndex >= 0) && ((uint32_t)packed.textureIndex < textureCount)) ?
+				textureSlots[packed.textureIndex] : -1;
+			m_objects.GetMaterials()[index] = ((packed.materialIndex >= 0) && ((uint32_t)packed.materialIndex < materialCount)) ?
+				packed.materialIndex : -1;
+			m_objects.GetColors()[index] = glm::vec4(packed.color[0], packed.color[1], packed.color[2], packed.color[3]);
+			m_objects.GetFlags()[index] = (uint8_t)packed.flags;
+		}
+	}
+	m_bObjectsChanged = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ApplySceneFile()
+ *
+ *  This method brings the scene in line with the loaded
+ *  scene file, touching only what changed since the file
+ *  was last applied.
+ ***********************************************************/
+void SceneManager::ApplySceneFile()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	// the first file applied replaces the built-in objects
+	if (!m_pSceneFile->IsApplied())
+	{
+		m_objects.Clear();
+		m_fileObjects.clear();
+		m_bObjectsChanged = true;
+	}
+
+	bool bTexturesAdded = ApplyFileTextures();
+	bool bMaterialsMoved = ApplyFileMaterials();
+	bool bMeshesImported = ApplyFileMeshes();
+	ApplyFileLights();
+	// edited keys put every object back at its file transform,
+	// so no object is left where a removed track stopped it
+	bool bKeysChanged = !SameKeys(m_pSceneFile->GetApplied().keys, m_pSceneFile->GetLoaded().keys);
+	int changedObjects = ApplyFileObjects(bTexturesAdded || bMaterialsMoved || bMeshesImported || bKeysChanged);
+	ApplyFileAnimations();
+
+	m_pSceneFile->MarkApplied();
+	m_bSceneDirty = true;
+
+	double elapsed = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	std::cout << "INFO: Applied scene file " << m_pSceneFile->GetFilename() << ", "
+		<< changedObjects << " object entries changed in " << elapsed << " ms" << std::endl;
+}
+
+/***********************************************************
+ *  ApplyFileTextures()
+ *
+ *  This method loads the textures that are new or whose
+ *  image file changed, and returns true when a texture got
+ *  a new slot.
+ ***********************************************************/
+bool SceneManager::ApplyFileTextures()
+{
+	const std::vector<SceneFile::TEXTURE_ENTRY>& applied = m_pSceneFile->GetApplied().textures;
+	bool bAdded = false;
+	bool bLoaded = false;
+
+	for (const SceneFile::TEXTURE_ENTRY& texture : m_pSceneFile->GetLoaded().textures)
+	{
+		bool bUnchanged = false;
+		for (const SceneFile::TEXTURE_ENTRY& previous : applied)
+		{
+			if ((previous.tag == texture.tag) && (previous.filename == texture.filename))
+			{
+				bUnchanged = true;
+				break;
+			}
+		}
+		if (bUnchanged)
+		{
+			continue;
+		}
+
+		bool bNewSlot = (FindTextureSlot(texture.tag) < 0);
+		if (CreateGLTexture(texture.filename.c_str(), texture.tag))
+		{
+			bLoaded = true;
+			bAdded = bAdded || bNewSlot;
+		}
+	}
+
+	if (bLoaded)
+	{
+		BindGLTextures();
+	}
+	return(bAdded);
+}
+
+/***********************************************************
+ *  ApplyFileMaterials()
+ *
+ *  This method takes over the file's materials when any of
+ *  them changed, and returns true when the material indices
+ *  moved.
+ ***********************************************************/
+bool SceneManager::ApplyFileMaterials()
+{
+	const std::vector<OBJECT_MATERIAL>& materials = m_pSceneFile->GetLoaded().materials;
+
+	// the same tags in the same order keep every index
+	bool bSameTags = (materials.size() == m_objectMaterials.size());
+	bool bChanged = !bSameTags;
+	for (int i = 0; bSameTags && (i < (int)materials.size()); i++)
+	{
+		bSameTags = (materials[i].tag == m_objectMaterials[i].tag);
+		bChanged = bChanged || !bSameTags || !SameMaterial(materials[i], m_objectMaterials[i]);
+	}
+
+	if (!bChanged)
+	{
+		return(false);
+	}
+
+	m_objectMaterials = materials;
+	if (NULL != m_pGPURenderer)
+	{
+		m_pGPURenderer->SetMaterials(m_objectMaterials);
+	}
+	if (NULL != m_pReflectionProbes)
+	{
+		m_pReflectionProbes->MarkAllDirty();
+	}
+	return(!bSameTags);
+}
+
+/***********************************************************
+ *  ApplyFileMeshes()
+ *
+ *  This method imports the meshes that are new or whose
+ *  file changed, and returns true when any was imported.
+ *  A changed mesh takes the place of its old geometry in
+ *  the pool, and the pool is uploaded once for all of them.
+ ***********************************************************/
+bool SceneManager::ApplyFileMeshes()
+{
+	const std::vector<SceneFile::MESH_ENTRY>& applied = m_pSceneFile->GetApplied().meshes;
+	bool bImported = false;
+	// preloaded meshes went up with the pool if it was uploaded
+	bool bUploadNeeded = (m_pMeshPool->GetVertexBuffer() == 0);
+
+	for (const SceneFile::MESH_ENTRY& mesh : m_pSceneFile->GetLoaded().meshes)
+	{
+		bool bUnchanged = false;
+		for (const SceneFile::MESH_ENTRY& previous : applied)
+		{
+			if ((previous.name == mesh.name) && (previous.filename == mesh.filename))
+			{
+				bUnchanged = true;
+				break;
+			}
+		}
+		if (bUnchanged && (m_fileMeshes.find(mesh.name) != m_fileMeshes.end()))
+		{
+			continue;
+		}
+
+		std::map<std::string, int>::const_iterator replaced = m_fileMeshes.find(mesh.name);
+		bool bPreloaded = (m_preloadedMeshes.find(mesh.filename) != m_preloadedMeshes.end());
+		int meshIndex = AddMeshFile(mesh.filename, (replaced != m_fileMeshes.end()) ? replaced->second : -1);
+		if (meshIndex >= 0)
+		{
+			m_fileMeshes[mesh.name] = meshIndex;
+			bImported = true;
+			bUploadNeeded = bUploadNeeded || !bPreloaded;
+		}
+	}
+
+	if (bImported && bUploadNeeded)
+	{
+		m_pMeshPool->Upload();
+		m_bObjectsChanged = true;
+	}
+	return(bImported);
+}
+
+/***********************************************************
+ *  ApplyFileLights()
+ *
+ *  This method takes over the file's lights when any of
+ *  them changed.
+ ***********************************************************/
+void SceneManager::ApplyFileLights()
+{
+	const SceneFile::SCENE_DESCRIPTION& loaded = m_pSceneFile->GetLoaded();
+
+	bool bChanged = (loaded.globalAmbientLight != m_globalAmbientLight) ||
+		(loaded.lights.size() != m_lightSources.size());
+	for (int i = 0; !bChanged && (i < (int)loaded.lights.size()); i++)
+	{
+		bChanged = !SameLight(loaded.lights[i], m_lightSources[i]);
+	}
+
+	if (!bChanged)
+	{
+		return;
+	}
+
+	int previousCount = (int)m_lightSources.size();
+	m_globalAmbientLight = loaded.globalAmbientLight;
+	m_lightSources = loaded.lights;
+	UploadSceneLights(previousCount);
+	if (NULL != m_pGPURenderer)
+	{
+		m_pGPURenderer->SetLights(m_lightSources, m_globalAmbientLight);
+		UpdateLightmapLights();
+	}
+	if (NULL != m_pReflectionProbes)
+	{
+		m_pReflectionProbes->MarkAllDirty();
+	}
+}
+
+/***********************************************************
+ *  ApplyFileObjects()
+ *
+ *  This method creates, updates and removes objects so each
+ *  object entry of the file has one object per scene copy.
+ *  Entries equal to the applied ones are skipped unless
+ *  their tags must be looked up again.  It returns the
+ *  number of entries that changed.
+ ***********************************************************/
+int SceneManager::ApplyFileObjects(bool bResolveTags)
+{
+	std::map<std::string, const SceneFile::OBJECT_ENTRY*> appliedEntries;
+	for (const SceneFile::OBJECT_ENTRY& entry : m_pSceneFile->GetApplied().objects)
+	{
+		appliedEntries[entry.name] = &entry;
+	}
+
+	std::map<std::string, std::vector<ObjectStore::OBJECT_HANDLE>> fileObjects;
+	int changedEntries = 0;
+
+	for (const SceneFile::OBJECT_ENTRY& entry : m_pSceneFile->GetLoaded().objects)
+	{
+		// take over the objects already made for this entry, so
+		// the ones left behind belong to removed entries
+		std::vector<ObjectStore::OBJECT_HANDLE>& handles = fileObjects[entry.name];
+		std::map<std::string, std::vector<ObjectStore::OBJECT_HANDLE>>::iterator existing = m_fileObjects.find(entry.name);
+		if (existing != m_fileObjects.end())
+		{
+			handles.swap(existing->second);
+			m_fileObjects.erase(existing);
+		}
+
+		std::map<std::string, const SceneFile::OBJECT_ENTRY*>::iterator applied = appliedEntries.find(entry.name);
+		if (!handles.empty() && !bResolveTags &&
+			(applied != appliedEntries.end()) && SameObject(*applied->second, entry))
+		{
+			continue;
+		}
+
+		// an imported mesh that failed to load shows as a box
+		MESH_TYPE mesh = entry.mesh;
+		if (!entry.meshName.empty())
+		{
+			std::map<std::string, int>::iterator imported = m_fileMeshes.find(entry.meshName);
+			mesh = (imported != m_fileMeshes.end()) ? (MESH_TYPE)imported->second : MESH_BOX;
+		}
+
+		if (handles.empty())
+		{
+			for (int copy = 0; copy < m_sceneCopies; copy++)
+			{
+				handles.push_back(m_objects.Create(entry.name, mesh));
+			}
+		}
+
+		int textureSlot = entry.textureTag.empty() ? -1 : FindTextureSlot(entry.textureTag);
+		int materialIndex = entry.materialTag.empty() ? -1 : FindMaterialIndex(entry.materialTag);
+		uint8_t flags = 0;
+		if (entry.bUseColor)
+			flags |= ObjectStore::OBJECT_USE_COLOR;
+		if (entry.bTransparent || (entry.bUseColor && (entry.color.a < 1.0f)))
+			flags |= ObjectStore::OBJECT_TRANSPARENT;
+		if (entry.bEmissive)
+			flags |= ObjectStore::OBJECT_EMISSIVE;
+
+		for (int copy = 0; copy < (int)handles.size(); copy++)
+		{
+			int index = m_objects.GetIndex(handles[copy]);
+			m_objects.GetPositions()[index] = entry.positionXYZ + GetCopyOffset(copy);
+			m_objects.GetRotations()[index] = entry.rotationXYZ;
+			m_objects.GetScales()[index] = entry.scaleXYZ;
+			m_objects.GetMeshes()[index] = mesh;
+			m_objects.GetTextures()[index] = textureSlot;
+			m_objects.GetMaterials()[index] = materialIndex;
+			m_objects.GetColors()[index] = entry.color;
+			m_objects.GetFlags()[index] = flags;
+		}
+		changedEntries++;
+	}
+
+	// whatever was not taken over is no longer in the file
+	for (const std::pair<const std::string, std::vector<ObjectStore::OBJECT_HANDLE>>& removed : m_fileObjects)
+	{
+		for (ObjectStore::OBJECT_HANDLE handle : removed.second)
+		{
+			m_objects.Destroy(handle);
+		}
+		changedEntries++;
+	}
+	m_fileObjects.swap(fileObjects);
+
+	if (changedEntries > 0)
+	{
+		m_bObjectsChanged = true;
+	}
+	return(changedEntries);
+}
+
+/***********************************************************
+ *  ApplyFileAnimations()
+ *
+ *  This method gathers the file's keys into one track per
+ *  object and channel, for every copy of the object, and
+ *  starts them all from the beginning.
+ ***********************************************************/
+void SceneManager::ApplyFileAnimations()
+{
+	std::map<std::pair<std::string, int>, std::vector<AnimationSystem::KEYFRAME>> tracks;
+	for (const SceneFile::KEY_ENTRY& entry : m_pSceneFile->GetLoaded().keys)
+	{
+		tracks[std::make_pair(entry.objectName, (int)entry.channel)].push_back(entry.key);
+	}
+
+	m_animations.Clear();
+	for (const std::pair<const std::pair<std::string, int>, std::vector<AnimationSystem::KEYFRAME>>& track : tracks)
+	{
+		std::map<std::string, std::vector<ObjectStore::OBJECT_HANDLE>>::iterator handles = m_fileObjects.find(track.first.first);
+		if (handles == m_fileObjects.end())
+		{
+			continue;
+		}
+
+		AnimationSystem::CHANNEL channel = (AnimationSystem::CHANNEL)track.first.second;
+		for (int copy = 0; copy < (int)handles->second.size(); copy++)
+		{
+			// positions keep each copy in its own place in the grid
+			glm::vec3 offset = (channel == AnimationSystem::CHANNEL_POSITION) ? GetCopyOffset(copy) : glm::vec3(0.0f);
+			if (!m_animations.AddTrack(handles->second[copy], channel, track.second, offset))
+			{
+				std::cout << "ERROR: Keys of " << track.first.first << " need a time past 0" << std::endl;
+				break;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  PickObject()
+ *
+ *  This method casts a ray through the scene's bounding
+ *  volume hierarchy.  The tree is refitted when objects
+ *  only moved, and rebuilt when their number changed.
+ ***********************************************************/
+bool SceneManager::PickObject(glm::vec3 origin, glm::vec3 direction, PICK_RESULT& result)
+{
+	const int objectCount = m_objects.GetCount();
+
+	// the bounds are left by the last frame drawn, unless the
+	// objects changed or moved after it
+	bool bObjectsMoved = m_bObjectsChanged || !m_movedObjects.empty();
+	if (bObjectsMoved)
+	{
+		UpdateTransforms(0, objectCount);
+	}
+	if (bObjectsMoved || m_bPickingStale)
+	{
+		if (m_sceneBVH.GetObjectCount() == objectCount)
+			m_sceneBVH.Refit(m_objects);
+		else
+			m_sceneBVH.Build(m_objects);
+		m_bPickingStale = false;
+	}
+
+	SceneBVH::RAY_HIT hit;
+	if (!m_sceneBVH.Intersect(origin, direction, m_objects, *m_pMeshPool, hit))
+	{
+		return(false);
+	}
+
+	int material = m_objects.GetMaterials()[hit.objectIndex];
+	int texture = m_objects.GetTextures()[hit.objectIndex];
+
+	result.object = m_objects.GetHandle(hit.objectIndex);
+	result.name = m_objects.GetName(hit.objectIndex);
+	result.materialTag = ((material >= 0) && (material < (int)m_objectMaterials.size())) ?
+		m_objectMaterials[material].tag : std::string();
+	result.textureTag = ((texture >= 0) && (texture < m_loadedTextures)) ?
+		m_textureIDs[texture].tag : std::string();
+	result.position = hit.position;
+	result.distance = hit.distance;
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateAnimations()
+ *
+ *  This method plays the keyframed tracks, and has the
+ *  moved objects transformed and drawn again.
+ ***********************************************************/
+void SceneManager::UpdateAnimations(float deltaSeconds)
+{
+	if (!m_bAnimate)
+	{
+		return;
+	}
+	if (m_animations.Update(deltaSeconds, m_objects, m_movedObjects))
+	{
+		m_bSceneDirty = true;
+	}
+}
+
+/***********************************************************
+ *  EnableAnimation()
+ *
+ *  This method turns the playing of the keyframed tracks on
+ *  or off.
+ ***********************************************************/
+void SceneManager::EnableAnimation(bool bEnable)
+{
+	m_bAnimate = bEnable;
+}
+
+/***********************************************************
+ *  SetEmissiveScale()
+ *
+ *  This method sets how much brighter than their color the
+ *  emissive objects are drawn, which takes effect with the
+ *  next frame on either path.
+ ***********************************************************/
+void SceneManager::SetEmissiveScale(float scale)
+{
+	if (scale != m_emissiveScale)
+	{
+		m_emissiveScale = scale;
+		m_bObjectsChanged = true;
+		m_bSceneDirty = true;
+	}
+}
+
+/***********************************************************
+ *  SetViewParameters()
+ *
+ *  This method stores the camera matrices for the frame as
+ *  its only view, filling the whole viewport.
+ ***********************************************************/
+void SceneManager::SetViewParameters(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	glm::vec3 viewPosition)
+{
+	SCENE_VIEW sceneView;
+	sceneView.view = view;
+	sceneView.projection = projection;
+	sceneView.position = viewPosition;
+	sceneView.viewportRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	m_views.assign(1, sceneView);
+}
+
+/***********************************************************
+ *  SetViews()
+ *
+ *  This method stores the views drawn in the frame, keeping
+ *  the previous ones when the list is empty.
+ ***********************************************************/
+void SceneManager::SetViews(const std::vector<SCENE_VIEW>& views)
+{
+	if (!views.empty())
+	{
+		m_views = views;
+	}
+}
+
+/***********************************************************
+ *  ApplyView()
+ *
+ *  This method points the viewport at the part of the frame
+ *  one view fills.  The CPU path's shader holds one camera,
+ *  so with several views it is loaded before each one.
+ ***********************************************************/
+void SceneManager::ApplyView(int viewIndex, const GLint frameViewport[4])
+{
+	if (m_views.size() == 1)
+	{
+		return;
+	}
+
+	// edges are rounded on their own so neighboring views meet
+	// without a gap
+	const glm::vec4& rect = m_views[viewIndex].viewportRect;
+	GLint left = (GLint)(rect.x * frameViewport[2] + 0.5f);
+	GLint bottom = (GLint)(rect.y * frameViewport[3] + 0.5f);
+	GLint right = (GLint)((rect.x + rect.z) * frameViewport[2] + 0.5f);
+	GLint top = (GLint)((rect.y + rect.w) * frameViewport[3] + 0.5f);
+	glViewport(frameViewport[0] + left, frameViewport[1] + bottom,
+		std::max(right - left, 1), std::max(top - bottom, 1));
+
+	if (!m_bGPUDriven)
+	{
+		m_uniforms.setMat4Value(g_ViewName, m_views[viewIndex].view);
+		m_uniforms.setMat4Value(g_ProjectionName, m_views[viewIndex].projection);
+		m_uniforms.setVec3Value(g_ViewPositionName, m_views[viewIndex].position);
+	}
+}
+
+/***********************************************************
+ *  RecordSceneObject()
+ *
+ *  This method records the transformation, appearance and
+ *  draw of one scene object.  It runs on the recording
+ *  threads, so it must not call OpenGL.
+ ***********************************************************/
+void SceneManager::RecordSceneObject(
+	RenderCommandList& commandList,
+	int objectIndex,
+	bool bDepthOnly)
+{
+	commandList.SetModel(m_objects.GetModelMatrices()[objectIndex]);
+
+	if (!bDepthOnly)
+	{
+		int textureSlot = m_objects.GetTextures()[objectIndex];
+		int materialIndex = m_objects.GetMaterials()[objectIndex];
+
+		if (textureSlot >= 0)
+		{
+			commandList.SetTexture(textureSlot);
+		}
+		else if (m_objects.GetFlags()[objectIndex] & ObjectStore::OBJECT_USE_COLOR)
+		{
+			commandList.SetColor(GetShadedColor(m_objects, objectIndex, m_emissiveScale));
+		}
+		else
+		{
+			commandList.DisableTexture();
+		}
+
+		// an object without a material keeps the current one
+		if (materialIndex >= 0)
+		{
+			commandList.SetMaterial(materialIndex);
+		}
+	}
+
+	commandList.DrawMesh(m_objects.GetMeshes()[objectIndex]);
+}
+
+/***********************************************************
+ *  RecordCommandLists()
+ *
+ *  This method cuts a view's sorted draw orders of every
+ *  pass into chunks and records each chunk into its own
+ *  command list.  It runs as a job, and the chunks become
+ *  its children so the other threads can take them.
+ ***********************************************************/
+void SceneManager::RecordCommandLists(int viewIndex)
+{
+	VIEW_WORK& work = m_viewWork[viewIndex];
+	work.recordingChunks.clear();
+	for (int pass = PASS_DEPTH; pass <= PASS_TRANSPARENT; pass++)
+	{
+		if ((pass == PASS_DEPTH) && !m_bDepthPrePass)
+		{
+			continue;
+		}
+
+		int count = (pass == PASS_TRANSPARENT) ?
+			(int)work.transparentDrawOrder.size() : (int)work.opaqueDrawOrder.size();
+		for (int begin = 0; begin < count; begin += g_RecordingChunkSize)
+		{
+			RECORDING_CHUNK chunk;
+			chunk.pass = (RENDER_PASS)pass;
+			chunk.begin = begin;
+			chunk.end = std::min(begin + g_RecordingChunkSize, count);
+			work.recordingChunks.push_back(chunk);
+		}
+	}
+
+	// lists are only ever added, so their memory is reused
+	if (work.commandLists.size() < work.recordingChunks.size())
+	{
+		work.commandLists.resize(work.recordingChunks.size());
+	}
+
+	m_pJobSystem->Submit(m_pJobSystem->ParallelFor("record lists", (int)work.recordingChunks.size(), 1,
+		[this, &work](int begin, int end)
+	{
+		for (int chunkIndex = begin; chunkIndex < end; chunkIndex++)
+		{
+			const RECORDING_CHUNK& chunk = work.recordingChunks[chunkIndex];
+			const std::vector<std::pair<float, int>>& drawOrder = (chunk.pass == PASS_TRANSPARENT) ?
+				work.transparentDrawOrder : work.opaqueDrawOrder;
+
+			RenderCommandList& commandList = work.commandLists[chunkIndex];
+			commandList.Clear();
+			for (int i = chunk.begin; i < chunk.end; i++)
+			{
+				RecordSceneObject(commandList, drawOrder[i].second, chunk.pass == PASS_DEPTH);
+			}
+		}
+	}, m_pJobSystem->GetCurrentJob()));
+}
+
+/***********************************************************
+ *  ExecuteCommandLists()
+ *
+ *  This method replays a view's command lists of one pass,
+ *  in the order they were cut, through the shader manager.
+ ***********************************************************/
+void SceneManager::ExecuteCommandLists(int viewIndex, RENDER_PASS pass)
+{
+	const VIEW_WORK& work = m_viewWork[viewIndex];
+	for (int chunkIndex = 0; chunkIndex < (int)work.recordingChunks.size(); chunkIndex++)
+	{
+		if (work.recordingChunks[chunkIndex].pass != pass)
+		{
+			continue;
+		}
+
+		const RenderCommandList& commandList = work.commandLists[chunkIndex];
+		for (const RenderCommandList::RENDER_COMMAND& command : commandList.GetCommands())
+		{
+			switch (command.type)
+			{
+			case RenderCommandList::CMD_SET_MODEL:
+				m_uniforms.setMat4Value(g_ModelName, commandList.GetMatrix(command.argument));
+				break;
+			case RenderCommandList::CMD_SET_COLOR:
+				m_uniforms.setIntValue(g_UseTextureName, false);
+				m_uniforms.setVec4Value(g_ColorValueName, commandList.GetColor(command.argument));
+				break;
+			case RenderCommandList::CMD_SET_TEXTURE:
+				// each texture stays bound to its own unit, so a
+				// texture change is a switch of the sampler's unit
+				m_uniforms.setIntValue(g_UseTextureName, true);
+				m_uniforms.setSampler2DValue(g_TextureValueName, command.argument);
+				m_frameStats.textureBinds++;
+				break;
+			case RenderCommandList::CMD_DISABLE_TEXTURE:
+				m_uniforms.setIntValue(g_UseTextureName, false);
+				break;
+			case RenderCommandList::CMD_SET_MATERIAL:
+				ApplyShaderMaterial(m_objectMaterials[command.argument]);
+				break;
+			case RenderCommandList::CMD_DRAW_MESH:
+				DrawShapeMesh((MESH_TYPE)command.argument);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  DrawShapeMesh()
+ *
+ *  This method draws the basic shape mesh of the passed in
+ *  type with the current shader settings.
+ ***********************************************************/
+void SceneManager::DrawShapeMesh(MESH_TYPE mesh)
+{
+	m_frameStats.drawCalls++;
+	m_frameStats.triangles += m_pMeshPool->GetMesh(mesh).indexCount / 3;
+
+	if (m_bPackedMeshes || (mesh >= MESH_BUILTIN_COUNT))
+	{
+		m_pMeshPool->Draw(mesh);
+		return;
+	}
+
+	switch (mesh)
+	{
+	case MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case MESH_CONE:
+		m_basicMeshes->DrawConeMesh();
+		break;
+	case MESH_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case MESH_PRISM:
+		m_basicMeshes->DrawPrismMesh();
+		break;
+	case MESH_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method computes the model matrices and world space
+ *  bounds of a range of scene objects.
+ ***********************************************************/
+void SceneManager::UpdateTransforms(int begin, int end)
+{
+	const glm::vec3* positions = m_objects.GetPositions();
+	const glm::vec3* rotations = m_objects.GetRotations();
+	const glm::vec3* scales = m_objects.GetScales();
+	const MESH_TYPE* meshes = m_objects.GetMeshes();
+	glm::mat4* models = m_objects.GetModelMatrices();
+	glm::vec4* bounds = m_objects.GetBounds();
+
+	for (int i = begin; i < end; i++)
+	{
+		models[i] = ComputeModelMatrix(
+			scales[i],
+			rotations[i].x,
+			rotations[i].y,
+			rotations[i].z,
+			positions[i]);
+		bounds[i] = Frustum::TransformSphere(models[i], m_pMeshPool->GetMesh(meshes[i]).boundingSphere);
+	}
+}
+
+/***********************************************************
+ *  CullSceneObjects()
+ *
+ *  This method tests the bounds of a range of scene objects
+ *  against one view's frustum and keeps the view depth of
+ *  the visible ones for sorting.
+ ***********************************************************/
+void SceneManager::CullSceneObjects(int viewIndex, const Frustum& frustum, int begin, int end)
+{
+	const glm::mat4* models = m_objects.GetModelMatrices();
+	const glm::vec4* bounds = m_objects.GetBounds();
+	const glm::mat4& view = m_views[viewIndex].view;
+	VIEW_WORK& work = m_viewWork[viewIndex];
+
+	for (int i = begin; i < end; i++)
+	{
+		work.objectVisible[i] = frustum.IsSphereVisible(bounds[i]) ? 1 : 0;
+		// distance along the view direction to the object origin
+		work.viewDepths[i] = -(view * models[i][3]).z;
+	}
+}
+
+/***********************************************************
+ *  StreamTextures()
+ *
+ *  This method estimates how many pixels each visible
+ *  textured object spans from its bounding sphere, and asks
+ *  for its texture at the largest size any view shows it.
+ *  The GPU-driven path culls on the GPU, so its objects are
+ *  tested here instead.
+ ***********************************************************/
+void SceneManager::StreamTextures()
+{
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	const int objectCount = m_objects.GetCount();
+	const glm::vec4* bounds = m_objects.GetBounds();
+	const int* textures = m_objects.GetTextures();
+
+	m_pTextureStreamer->BeginFrame();
+	for (int viewIndex = 0; viewIndex < (int)m_views.size(); viewIndex++)
+	{
+		const SCENE_VIEW& sceneView = m_views[viewIndex];
+		Frustum frustum(sceneView.projection * sceneView.view);
+		// pixels spanned by one unit of size at a depth of one,
+		// or at any depth in an orthographic view
+		const float pixelScale = sceneView.projection[1][1] * viewport[3] * sceneView.viewportRect.w * 0.5f;
+		const bool bOrthographic = (sceneView.projection[3][3] == 1.0f);
+
+		for (int i = 0; i < objectCount; i++)
+		{
+			if ((textures[i] < 0) || (textures[i] >= m_loadedTextures))
+			{
+				continue;
+			}
+			bool bVisible = m_bGPUDriven ?
+				frustum.IsSphereVisible(bounds[i]) : (m_viewWork[viewIndex].objectVisible[i] != 0);
+			if (!bVisible)
+			{
+				continue;
+			}
+
+			// the nearest point of the sphere gives the largest size
+			float depth = bOrthographic ? 1.0f :
+				-(sceneView.view * glm::vec4(glm::vec3(bounds[i]), 1.0f)).z - bounds[i].w;
+			float screenPixels = 2.0f * bounds[i].w * pixelScale / std::max(depth, 0.1f);
+			m_pTextureStreamer->RequestTexture(m_textureIDs[textures[i]].ID, screenPixels);
+		}
+	}
+
+	// keep drawing until the levels asked for are all in
+	if (m_pTextureStreamer->Update())
+	{
+		m_bSceneDirty = true;
+	}
+}
+
+/***********************************************************
+ *  SortDrawOrder()
+ *
+ *  This method sorts a view's visible opaque objects front
+ *  to back, so the depth test rejects hidden fragments
+ *  early, or its visible transparent objects back to front,
+ *  so they blend in the right order.
+ ***********************************************************/
+void SceneManager::SortDrawOrder(int viewIndex, bool bTransparent)
+{
+	VIEW_WORK& work = m_viewWork[viewIndex];
+	std::vector<std::pair<float, int>>& drawOrder = bTransparent ?
+		work.transparentDrawOrder : work.opaqueDrawOrder;
+	drawOrder.clear();
+
+	const uint8_t* flags = m_objects.GetFlags();
+	const uint8_t wanted = bTransparent ? ObjectStore::OBJECT_TRANSPARENT : 0;
+
+	for (int i = 0; i < m_objects.GetCount(); i++)
+	{
+		if ((work.objectVisible[i] == 0) || ((flags[i] & ObjectStore::OBJECT_TRANSPARENT) != wanted))
+		{
+			continue;
+		}
+
+		drawOrder.push_back(std::make_pair(bTransparent ? -work.viewDepths[i] : work.viewDepths[i], i));
+	}
+
+	std::sort(drawOrder.begin(), drawOrder.end());
+}
+
+/***********************************************************
+ *  ResetFrameStats()
+ *
+ *  This method clears the frame's counters and takes stock
+ *  of the GPU memory in use.
+ ***********************************************************/
+void SceneManager::ResetFrameStats()
+{
+	m_frameStats.drawCalls = 0;
+	m_frameStats.textureBinds = 0;
+	m_frameStats.uniformUploads = 0;
+	m_frameStats.triangles = 0;
+	m_frameStats.objects = m_objects.GetCount();
+	m_frameStats.visibleObjects = -1;
+	m_frameStats.culledObjects = -1;
+
+	m_frameStats.textures = m_loadedTextures;
+	m_frameStats.textureBytes = (NULL != m_pTextureStreamer) ? m_pTextureStreamer->GetResidentBytes() : 0;
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		m_frameStats.textureBytes += m_textureIDs[i].bytes;
+	}
+	if (NULL != m_pReflectionProbes)
+	{
+		m_frameStats.textureBytes += m_pReflectionProbes->GetTextureBytes();
+	}
+	m_frameStats.meshBytes = m_pMeshPool->GetBufferBytes() + (m_bPackedMeshes ? 0 : m_shapeMeshBytes);
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by
+ *  transforming and drawing the basic 3D shapes
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	m_bSceneDirty = false;
+	if (m_bObjectsChanged || !m_movedObjects.empty())
+	{
+		m_bPickingStale = true;
+	}
+
+	ResetFrameStats();
+
+	if (m_bGPUDriven)
+	{
+		if (m_bObjectsChanged)
+		{
+			UploadGPUObjects();
+		}
+		else if (!m_movedObjects.empty())
+		{
+			UploadMovedObjects();
+		}
+		if (NULL != m_pTextureStreamer)
+		{
+			StreamTextures();
+		}
+		// bring the out of date probe faces up to date a little at
+		// a time, drawing again until they all are
+		if (NULL != m_pReflectionProbes)
+		{
+			m_pReflectionProbes->Update(*m_pGPURenderer, g_ProbeFacesPerFrame, m_frameStats);
+			if (m_pReflectionProbes->HasDirtyFaces())
+			{
+				m_bSceneDirty = true;
+			}
+		}
+		// the visible set and its triangles stay on the GPU; the
+		// objects are uploaded once and shared by every view, which
+		// only runs its own culling dispatch and draws
+		m_frameStats.triangles = -1;
+		GLint frameViewport[4] = { 0, 0, 0, 0 };
+		if (m_views.size() > 1)
+		{
+			glGetIntegerv(GL_VIEWPORT, frameViewport);
+		}
+		for (int viewIndex = 0; viewIndex < (int)m_views.size(); viewIndex++)
+		{
+			const SCENE_VIEW& sceneView = m_views[viewIndex];
+			ApplyView(viewIndex, frameViewport);
+			m_pGPURenderer->Render(sceneView.view, sceneView.projection, sceneView.position, m_bDepthPrePass, m_frameStats);
+		}
+		if (m_views.size() > 1)
+		{
+			glViewport(frameViewport[0], frameViewport[1], frameViewport[2], frameViewport[3]);
+		}
+		return;
+	}
+
+	const int objectCount = m_objects.GetCount();
+	const int viewCount = (int)m_views.size();
+	if ((int)m_viewWork.size() < viewCount)
+	{
+		m_viewWork.resize(viewCount);
+	}
+
+	// the frame's CPU work as a job graph: transforms once, then
+	// for each view culling, both sorts side by side, and the
+	// recording of every pass, leaving only the uniform uploads
+	// and draws for this thread; the views run side by side too
+	JobSystem::JOB* transforms = m_pJobSystem->ParallelFor("transforms", objectCount, g_UpdateChunkSize,
+		[this](int begin, int end) { UpdateTransforms(begin, end); });
+	JobSystem::JOB** recordJobs = m_pJobSystem->GetFrameArena().AllocateArray<JobSystem::JOB*>(viewCount);
+	for (int viewIndex = 0; viewIndex < viewCount; viewIndex++)
+	{
+		m_viewWork[viewIndex].viewDepths.resize(objectCount);
+		m_viewWork[viewIndex].objectVisible.resize(objectCount);
+		Frustum frustum(m_views[viewIndex].projection * m_views[viewIndex].view);
+
+		JobSystem::JOB* culling = m_pJobSystem->ParallelFor("culling", objectCount, g_UpdateChunkSize,
+			[this, viewIndex, frustum](int begin, int end) { CullSceneObjects(viewIndex, frustum, begin, end); });
+		JobSystem::JOB* sortOpaque = m_pJobSystem->CreateJob("sort opaque",
+			[this, viewIndex]() { SortDrawOrder(viewIndex, false); });
+		JobSystem::JOB* sortTransparent = m_pJobSystem->CreateJob("sort transparent",
+			[this, viewIndex]() { SortDrawOrder(viewIndex, true); });
+		JobSystem::JOB* record = m_pJobSystem->CreateJob("record",
+			[this, viewIndex]() { RecordCommandLists(viewIndex); });
+
+		m_pJobSystem->AddDependency(culling, transforms);
+		m_pJobSystem->AddDependency(sortOpaque, culling);
+		m_pJobSystem->AddDependency(sortTransparent, culling);
+		m_pJobSystem->AddDependency(record, sortOpaque);
+		m_pJobSystem->AddDependency(record, sortTransparent);
+
+		m_pJobSystem->Submit(record);
+		m_pJobSystem->Submit(sortTransparent);
+		m_pJobSystem->Submit(sortOpaque);
+		m_pJobSystem->Submit(culling);
+		recordJobs[viewIndex] = record;
+	}
+	m_pJobSystem->Submit(transforms);
+	for (int viewIndex = 0; viewIndex < viewCount; viewIndex++)
+	{
+		m_pJobSystem->Wait(recordJobs[viewIndex]);
+	}
+	m_bObjectsChanged = false;
+	m_movedObjects.clear();
+
+	// a view counts its own visible objects, so with several
+	// views these are totals over all of them
+	m_frameStats.visibleObjects = 0;
+	for (int viewIndex = 0; viewIndex < viewCount; viewIndex++)
+	{
+		m_frameStats.visibleObjects += (int)(m_viewWork[viewIndex].opaqueDrawOrder.size() +
+			m_viewWork[viewIndex].transparentDrawOrder.size());
+	}
+	m_frameStats.culledObjects = objectCount * viewCount - m_frameStats.visibleObjects;
+
+	if (NULL != m_pTextureStreamer)
+	{
+		StreamTextures();
+	}
+
+	// Enable texture usage
+	m_uniforms.setIntValue("bUseTexture", true);
+	m_uniforms.setIntValue("bUseLighting", true);
+
+	GLint frameViewport[4] = { 0, 0, 0, 0 };
+	if (viewCount > 1)
+	{
+		glGetIntegerv(GL_VIEWPORT, frameViewport);
+	}
+	for (int viewIndex = 0; viewIndex < viewCount; viewIndex++)
+	{
+		ApplyView(viewIndex, frameViewport);
+		DrawView(viewIndex);
+	}
+	if (viewCount > 1)
+	{
+		glViewport(frameViewport[0], frameViewport[1], frameViewport[2], frameViewport[3]);
+	}
+}
+
+/***********************************************************
+ *  DrawView()
+ *
+ *  This method replays the recorded passes of one view: the
+ *  optional depth pass, the opaque objects, and then the
+ *  transparent objects.
+ ***********************************************************/
+void SceneManager::DrawView(int viewIndex)
+{
+	if (m_bDepthPrePass)
+	{
+		// lay down the opaque depth with color writes off, then
+		// shade only the fragments that match it
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		ExecuteCommandLists(viewIndex, PASS_DEPTH);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_FALSE);
+		glDepthFunc(GL_LEQUAL);
+	}
+
+	ExecuteCommandLists(viewIndex, PASS_OPAQUE);
+
+	if (m_bDepthPrePass)
+	{
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+	}
+
+	// blending is only enabled for the transparent pass, which
+	// tests against the opaque depth without writing to it
+	if (!m_viewWork[viewIndex].transparentDrawOrder.empty())
+	{
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDepthMask(GL_FALSE);
+		ExecuteCommandLists(viewIndex, PASS_TRANSPARENT);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+	}
+}
@@ -11,10 +11,28 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "MeshPool.h"
+#include "RenderCommands.h"
+#include "Frustum.h"
+#include "ObjectStore.h"
+#include "AnimationSystem.h"
+#include "SceneBVH.h"
+#include "UniformCounter.h"
 
+#include <map>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
+class AssetPack;
+class GPUDrivenRenderer;
+class JobSystem;
+class LightmapBaker;
+class ReflectionProbes;
+class SceneFile;
+class TextureStreamer;
+
 /***********************************************************
  *  SceneManager
  *
@@ -33,6 +51,26 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		// size of the texture and its mipmaps, or 0 when the
+		// texture streamer accounts for it
+		size_t bytes;
+	};
+
+	// what the last RenderScene() asked of OpenGL, and the GPU
+	// memory the scene holds; a count the GPU-driven path cannot
+	// know without reading the GPU back is -1
+	struct FRAME_STATS
+	{
+		int drawCalls;
+		int textureBinds;
+		int uniformUploads;
+		long long triangles;
+		int objects;
+		int visibleObjects;
+		int culledObjects;
+		int textures;
+		size_t textureBytes;
+		size_t meshBytes;
 	};
 
 	struct OBJECT_MATERIAL
@@ -45,6 +83,153 @@ public:
 		std::string tag;
 	};
 
+	// what a ray picked, for selecting and inspecting objects
+	struct PICK_RESULT
+	{
+		ObjectStore::OBJECT_HANDLE object;
+		std::string name;
+		// tags of the object's material and texture, empty when
+		// it has none
+		std::string materialTag;
+		std::string textureTag;
+		glm::vec3 position;
+		float distance;
+	};
+
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 direction;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+	};
+
+	// draw the scene through GPU culling and indirect draws,
+	// must be called before PrepareScene()
+	void EnableGPUDrivenRendering(bool bEnable);
+	// lay down opaque depth before shading, so each pixel is
+	// shaded once no matter how much geometry overlaps it
+	void EnableDepthPrePass(bool bEnable);
+	// store the pooled vertices in the compact 16 byte layout,
+	// which only the GPU-driven path can decode, must be called
+	// before PrepareScene()
+	void EnableCompactVertices(bool bEnable);
+	// reflect the scene in the glossy materials through cached
+	// cubemap probes on the GPU-driven path, must be called
+	// before PrepareScene()
+	void EnableReflectionProbes(bool bEnable);
+	// stream the texture mip levels by their size on screen and
+	// keep them within this many megabytes, must be called before
+	// PrepareScene()
+	void EnableTextureStreaming(int budgetMegabytes);
+	// tile the scene layout this many times for stress testing,
+	// must be called before PrepareScene()
+	void SetSceneCopies(int copies);
+	// play the keyframed tracks of the layout; while off, the
+	// animated objects hold their placed pose
+	void EnableAnimation(bool bEnable);
+	// scale the color of the emissive objects by this much, above
+	// white for a frame that is post-processed in HDR; 1 leaves
+	// them at their own color
+	void SetEmissiveScale(float scale);
+	// one view of the scene and the part of the viewport it is
+	// drawn into
+	struct SCENE_VIEW
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 position;
+		// x, y, width and height as fractions of the viewport
+		glm::vec4 viewportRect;
+	};
+
+	// set the camera matrices used for culling and drawing
+	void SetViewParameters(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		glm::vec3 viewPosition);
+	// set several views drawn side by side in each frame; the
+	// objects are updated once, then each view culls and draws
+	// them on its own, the first view standing in for the camera
+	void SetViews(const std::vector<SCENE_VIEW>& views);
+	// set the job system that spreads the per-frame work over
+	// the cores, must be called before RenderScene()
+	void SetJobSystem(JobSystem* pJobSystem);
+	// read the textures, materials, lights and objects from a
+	// scene file instead of the built-in layout, must be called
+	// before PrepareScene()
+	void SetSceneFile(const char* filename);
+	// re-apply the scene file when it was saved since it was
+	// last read, returning true when the scene changed
+	bool CheckSceneFile();
+	// take the pre-tessellated meshes, pre-mipped textures and
+	// the layout from a baked asset pack, which stays mapped for
+	// the life of the scene, must be called before PrepareScene();
+	// a scene file still takes precedence for the layout
+	void SetAssetPack(const char* filename);
+	// light the static objects from a baked lightmap file on the
+	// GPU-driven path, must be called before PrepareScene()
+	void SetLightmapFile(const char* filename);
+	// bake the lightmaps of the prepared scene over the job
+	// system's threads and save them to a file, after which the
+	// scene is lit from them; false when nothing could be baked
+	bool BakeLightmaps(const char* filename);
+	// do the part of PrepareScene() that needs neither the shader
+	// nor vertex arrays - reading the layout, decoding and
+	// uploading the textures and building the mesh geometry - on
+	// a thread whose context shares objects with the drawing one,
+	// while another scene keeps drawing
+	void PreloadScene();
+	// turn off the lights a replaced scene left in the shader
+	// beyond this scene's, once this one is prepared
+	void ReplaceLights(const SceneManager& replaced);
+	// free one texture or GPU object of the scene per call, so a
+	// replaced scene is let go over several frames; true once
+	// nothing is left to free
+	bool ReleaseResources();
+	// import an OBJ or glTF mesh into the mesh pool once the scene
+	// is prepared, returning its index for use as a MESH_TYPE, or
+	// -1 when the file cannot be imported
+	int ImportMesh(const std::string& filename);
+
+	// find the nearest object surface along a world space ray,
+	// false when the ray hits nothing
+	bool PickObject(glm::vec3 origin, glm::vec3 direction, PICK_RESULT& result);
+
+	// move the keyframed objects along by the time since the
+	// last call, which keeps the scene dirty while they play
+	void UpdateAnimations(float deltaSeconds);
+
+	const FRAME_STATS& GetFrameStats() const { return m_frameStats; }
+
+	// the scene content changed since the last RenderScene(),
+	// so the displayed frame is out of date
+	bool IsSceneDirty() const { return m_bSceneDirty; }
+	void MarkSceneDirty() { m_bSceneDirty = true; }
+
+	// add an untextured object to the scene, which can happen at
+	// any time once the textures and materials are loaded
+	ObjectStore::OBJECT_HANDLE AddSceneObject(
+		std::string tag,
+		MESH_TYPE mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+	void RemoveSceneObject(ObjectStore::OBJECT_HANDLE object);
+	// set the appearance of an object by texture or material tag
+	void SetObjectTexture(ObjectStore::OBJECT_HANDLE object, std::string_view textureTag);
+	void SetObjectMaterial(ObjectStore::OBJECT_HANDLE object, std::string_view materialTag);
+	// draw the object in a solid color, blended when transparent
+	// or when the color is not fully opaque
+	void SetObjectColor(ObjectStore::OBJECT_HANDLE object, glm::vec4 color, bool bTransparent);
+	ObjectStore& GetObjectStore() { return m_objects; }
+	AnimationSystem& GetAnimationSystem() { return m_animations; }
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
@@ -52,22 +237,159 @@ private:
 	ShapeMeshes* m_basicMeshes;
 	// total number of loaded textures
 	int m_loadedTextures;
+	// texture residency manager, when the textures are streamed
+	TextureStreamer* m_pTextureStreamer;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// defined light sources
+	std::vector<LIGHT_SOURCE> m_lightSources;
+	glm::vec3 m_globalAmbientLight;
+	// objects making up the 3D scene
+	ObjectStore m_objects;
+	// keyframed tracks on the objects, played only when enabled
+	AnimationSystem m_animations;
+	bool m_bAnimate;
+	float m_emissiveScale;
+	int m_sceneCopies;
+	// set whenever the scene content changes, cleared once drawn
+	bool m_bSceneDirty;
+	// objects were added, removed or changed since the GPU-driven
+	// renderer last received them, or on the CPU path since the
+	// last frame was drawn
+	bool m_bObjectsChanged;
+	// indices of the objects the animations moved since then,
+	// which the GPU-driven renderer takes on their own
+	std::vector<int> m_movedObjects;
+	// ray queries over the object bounds and mesh triangles, and
+	// whether objects changed since its tree was last fitted
+	SceneBVH m_sceneBVH;
+	bool m_bPickingStale;
+	// counters of the last frame drawn, and the per-frame uniform
+	// setters, which count into them
+	FRAME_STATS m_frameStats;
+	UniformCounter m_uniforms;
+	// the basic shape meshes hold the same geometry as the pool's
+	// built-in copies, so this is their size on the GPU
+	size_t m_shapeMeshBytes;
+
+	// scene file the layout comes from, if any, and the objects
+	// made for each of its object entries, one per scene copy
+	SceneFile* m_pSceneFile;
+	std::map<std::string, std::vector<ObjectStore::OBJECT_HANDLE>> m_fileObjects;
+	// mesh pool index of each mesh the scene file imported
+	std::map<std::string, int> m_fileMeshes;
+
+	// baked asset pack, if any; once its meshes are loaded the
+	// CPU path draws from the mesh pool instead of the basic
+	// shape meshes, which are then never tessellated
+	AssetPack* m_pAssetPack;
+	bool m_bPackedMeshes;
+
+	// tags of the textures and the files of the meshes that
+	// PreloadScene() made, which PrepareScene() takes as they
+	// are, and whether it read the scene file
+	std::set<std::string> m_preloadedTextures;
+	std::map<std::string, int> m_preloadedMeshes;
+	bool m_bSceneFilePreloaded;
+
+	// baked lighting of the static objects, if any, the texture
+	// holding its atlas, and how many of the current lights it
+	// holds, or -1 when the lights changed since the bake
+	std::string m_lightmapFile;
+	LightmapBaker* m_pLightmaps;
+	GLuint m_lightmapTexture;
+	int m_bakedLightCount;
+
+	// GPU-driven render path; the mesh pool is also kept for
+	// the local bounds of the CPU path's culling
+	bool m_bGPUDriven;
+	bool m_bDepthPrePass;
+	bool m_bCompactVertices;
+	MeshPool* m_pMeshPool;
+	GPUDrivenRenderer* m_pGPURenderer;
+	// cubemaps reflected by the glossy objects on that path
+	bool m_bReflectionProbes;
+	ReflectionProbes* m_pReflectionProbes;
+	// probe each object last received, or -1
+	std::vector<int> m_objectProbes;
+
+	// the views of the current frame, at least one
+	std::vector<SCENE_VIEW> m_views;
+
+	// passes of the CPU render path, in the order they run
+	enum RENDER_PASS
+	{
+		PASS_DEPTH = 0,
+		PASS_OPAQUE,
+		PASS_TRANSPARENT
+	};
+
+	// a run of draw order entries recorded into one command list
+	struct RECORDING_CHUNK
+	{
+		RENDER_PASS pass;
+		int begin;
+		int end;
+	};
+
+	// the CPU path's per-frame work for one view; the sort order
+	// and the state changes it saves differ between views, so
+	// each view records its own command lists
+	struct VIEW_WORK
+	{
+		// results of the culling jobs, one per object
+		std::vector<float> viewDepths;
+		std::vector<unsigned char> objectVisible;
+		// draw order as (view depth, object index) pairs, opaque
+		// front to back and transparent back to front
+		std::vector<std::pair<float, int>> opaqueDrawOrder;
+		std::vector<std::pair<float, int>> transparentDrawOrder;
+		// command lists recorded in parallel, one per chunk, and
+		// replayed in chunk order on the GL thread
+		std::vector<RECORDING_CHUNK> recordingChunks;
+		std::vector<RenderCommandList> commandLists;
+	};
+
+	JobSystem* m_pJobSystem;
+	// one per view, only ever added so their memory is reused
+	std::vector<VIEW_WORK> m_viewWork;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// create a texture from mip levels baked into the asset pack
+	bool CreatePackedTexture(int packIndex);
+	// store a created texture in the slot of its tag, or the next
+	// free slot, replacing any texture already there
+	void RegisterGLTexture(GLuint textureID, std::string tag, size_t bytes);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(std::string_view tag);
+	int FindTextureSlot(std::string_view tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(std::string_view tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(std::string_view tag);
+	// set the light sources into the shader, turning off the
+	// ones past the end of the list up to previousCount
+	void UploadSceneLights(int previousCount);
+	// upload the lightmap atlas and hand it to the GPU-driven
+	// renderer along with the lights baked into it
+	void ApplyLightmaps();
+	void UpdateLightmapLights();
+	// offset of one copy of the layout when tiling the scene
+	glm::vec3 GetCopyOffset(int copy) const;
+
+	// combine the transformation values into a model matrix
+	glm::mat4 ComputeModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -87,7 +409,7 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		std::string_view textureTag);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -95,7 +417,76 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		std::string_view materialTag);
+	void ApplyShaderMaterial(
+		const OBJECT_MATERIAL& material);
+
+	// record the commands that draw one scene object, leaving
+	// out its appearance for the depth-only pass
+	void RecordSceneObject(
+		RenderCommandList& commandList,
+		int objectIndex,
+		bool bDepthOnly);
+	// split a view's draw orders into chunks and record them in
+	// parallel, run as a job
+	void RecordCommandLists(int viewIndex);
+	// replay a view's recorded commands of one pass through OpenGL
+	void ExecuteCommandLists(int viewIndex, RENDER_PASS pass);
+	// draw the recorded passes of one view
+	void DrawView(int viewIndex);
+	// draw one of the basic shape meshes
+	void DrawShapeMesh(MESH_TYPE mesh);
+	// per-frame update jobs over a range of scene objects; the
+	// transforms also move the bounds into world space
+	void UpdateTransforms(int begin, int end);
+	void CullSceneObjects(int viewIndex, const Frustum& frustum, int begin, int end);
+	// clear the frame counters before drawing
+	void ResetFrameStats();
+	// ask for the texture levels the objects visible in any view
+	// need and let the streamer upload or evict them
+	void StreamTextures();
+	// collect the visible opaque or transparent objects into
+	// their sorted draw order for one view
+	void SortDrawOrder(int viewIndex, bool bTransparent);
+	// set the viewport of one view inside the frame's viewport,
+	// and its camera when the CPU path draws several views
+	void ApplyView(int viewIndex, const GLint frameViewport[4]);
+	// build the GPU-driven renderer from the scene objects
+	bool PrepareGPUDrivenRendering();
+	// hand the current objects to the GPU-driven renderer
+	void UploadGPUObjects();
+	// hand it only the objects the animations moved, unless that
+	// changed which probe any object reflects
+	void UploadMovedObjects();
+	// place the reflection probes over the current bounds and
+	// find the probe of each object
+	void PlaceReflectionProbes(std::vector<int>& objectProbes);
+	// apply the entries of the loaded scene file that differ from
+	// the applied ones; a texture or material added or removed
+	// means every object has to look its tags up again
+	void ApplySceneFile();
+	bool ApplyFileTextures();
+	bool ApplyFileMaterials();
+	bool ApplyFileMeshes();
+	void ApplyFileLights();
+	int ApplyFileObjects(bool bResolveTags);
+	// rebuild the tracks from the file's keys
+	void ApplyFileAnimations();
+	// take the materials, lights, textures and objects from the
+	// asset pack, false when it has no layout
+	bool LoadPackedLayout();
+	// hand the pack's pooled meshes to the mesh pool
+	bool LoadPackedMeshes();
+	// put a mesh file into the pool without uploading it, in place
+	// of replacedMesh when that is not -1; returns the mesh's pool
+	// index, or -1 when the file cannot be imported
+	int AddMeshFile(const std::string& filename, int replacedMesh);
+	// fill the mesh pool from the pack or with the tessellated
+	// shapes, without uploading it; the shapes are tessellated
+	// side by side when a job system is passed in
+	void LoadMeshPool(JobSystem* pJobSystem);
+	// read the lightmap file named for the scene, if any
+	void ReadLightmapFile();
 
 public:
 
@@ -106,6 +497,10 @@ public:
 
 	// pre-set light sources for 3D scene
 	void SetupSceneLights();
+	// lay out the objects of the 3D scene
+	void DefineSceneObjects();
+	// set the built-in objects in motion
+	void DefineSceneAnimations();
 	// pre-define the object materials for lighting
 	void DefineObjectMaterials();
 	void LoadSceneTextures();
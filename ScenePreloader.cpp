@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenepreloader.cpp
+// ============
+// load the next scene in the background and swap it in between frames
+//
+//  A hidden window provides an OpenGL context that shares objects with
+//  the main window.  A loader thread makes it current and preloads the
+//  next scene's layout, textures and meshes while the current scene
+//  keeps drawing.  The main thread finishes the scene and swaps it in
+//  at the start of a frame, then frees the replaced scene's GPU
+//  resources a few per frame.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ScenePreloader.h"
+#include "SceneManager.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// GPU resources freed per frame while a scene is retired;
+	// small enough that freeing never shows as a hitch
+	const int g_ReleasesPerFrame = 2;
+}
+
+/***********************************************************
+ *  ScenePreloader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ScenePreloader::ScenePreloader()
+{
+	m_pLoaderWindow = NULL;
+	m_pLoadingScene = NULL;
+	m_bLoaded = false;
+}
+
+/***********************************************************
+ *  ~ScenePreloader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ScenePreloader::~ScenePreloader()
+{
+	if (m_loader.joinable())
+	{
+		m_loader.join();
+	}
+	if (NULL != m_pLoadingScene)
+	{
+		delete m_pLoadingScene;
+		m_pLoadingScene = NULL;
+	}
+	for (SceneManager* pScene : m_retiredScenes)
+	{
+		delete pScene;
+	}
+	m_retiredScenes.clear();
+	if (NULL != m_pLoaderWindow)
+	{
+		glfwDestroyWindow(m_pLoaderWindow);
+		m_pLoaderWindow = NULL;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method creates the hidden window, with the same
+ *  context hints as the main window so the two contexts can
+ *  share objects.
+ ***********************************************************/
+bool ScenePreloader::Initialize(GLFWwindow* pMainWindow)
+{
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_pLoaderWindow = glfwCreateWindow(1, 1, "", NULL, pMainWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (NULL == m_pLoaderWindow)
+	{
+		std::cout << "ERROR: Could not create the scene loader context" << std::endl;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  StartLoading()
+ *
+ *  This method hands the scene to the loader thread.
+ ***********************************************************/
+bool ScenePreloader::StartLoading(SceneManager* pScene)
+{
+	if ((NULL == m_pLoaderWindow) || (NULL != m_pLoadingScene))
+	{
+		return(false);
+	}
+
+	m_pLoadingScene = pScene;
+	m_bLoaded = false;
+	m_loader = std::thread(&ScenePreloader::LoadScene, this);
+	return(true);
+}
+
+/***********************************************************
+ *  TakeLoadedScene()
+ *
+ *  This method returns the scene once the loader thread has
+ *  finished with it, without waiting.
+ ***********************************************************/
+SceneManager* ScenePreloader::TakeLoadedScene()
+{
+	if ((NULL == m_pLoadingScene) || !m_bLoaded)
+	{
+		return(NULL);
+	}
+
+	m_loader.join();
+	SceneManager* pScene = m_pLoadingScene;
+	m_pLoadingScene = NULL;
+	return(pScene);
+}
+
+/***********************************************************
+ *  RetireScene()
+ *
+ *  This method queues a replaced scene to be freed.
+ ***********************************************************/
+void ScenePreloader::RetireScene(SceneManager* pScene)
+{
+	if (NULL != pScene)
+	{
+		m_retiredScenes.push_back(pScene);
+	}
+}
+
+/***********************************************************
+ *  ReleaseRetiredScenes()
+ *
+ *  This method frees a few of the oldest retired scene's
+ *  GPU resources, and the scene itself once they are gone.
+ ***********************************************************/
+void ScenePreloader::ReleaseRetiredScenes()
+{
+	for (int i = 0; (i < g_ReleasesPerFrame) && !m_retiredScenes.empty(); i++)
+	{
+		SceneManager* pScene = m_retiredScenes.front();
+		if (pScene->ReleaseResources())
+		{
+			delete pScene;
+			m_retiredScenes.erase(m_retiredScenes.begin());
+		}
+	}
+}
+
+/***********************************************************
+ *  LoadScene()
+ *
+ *  This method runs on the loader thread with the loader
+ *  context current.
+ ***********************************************************/
+void ScenePreloader::LoadScene()
+{
+	glfwMakeContextCurrent(m_pLoaderWindow);
+	m_pLoadingScene->PreloadScene();
+	glfwMakeContextCurrent(NULL);
+
+	// wake the main thread in case it is idle
+	m_bLoaded = true;
+	glfwPostEmptyEvent();
+}
@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenepreloader.h
+// ============
+// load the next scene in the background and swap it in between frames
+//
+//  A hidden window provides an OpenGL context that shares objects with
+//  the main window.  A loader thread makes it current and preloads the
+//  next scene's layout, textures and meshes while the current scene
+//  keeps drawing.  The main thread finishes the scene and swaps it in
+//  at the start of a frame, then frees the replaced scene's GPU
+//  resources a few per frame.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class SceneManager;
+
+/***********************************************************
+ *  ScenePreloader
+ *
+ *  This class owns the loader context and thread, the scene
+ *  being loaded, and the replaced scenes still being freed.
+ *  Every method is called on the main thread.
+ ***********************************************************/
+class ScenePreloader
+{
+public:
+	// constructor
+	ScenePreloader();
+	// destructor, waits for a load in progress
+	~ScenePreloader();
+
+	// create the hidden window sharing the main window's
+	// objects, false when it cannot be created
+	bool Initialize(GLFWwindow* pMainWindow);
+
+	// start preloading a configured scene on the loader thread;
+	// the scene is not touched elsewhere until it is taken back,
+	// false while another scene is still loading
+	bool StartLoading(SceneManager* pScene);
+	bool IsLoading() const { return NULL != m_pLoadingScene; }
+	// the preloaded scene once the thread is done, or NULL
+	SceneManager* TakeLoadedScene();
+
+	// hand over a replaced scene, which is freed over the
+	// following calls to ReleaseRetiredScenes()
+	void RetireScene(SceneManager* pScene);
+	// free a share of the retired scenes' GPU resources, call
+	// once per frame
+	void ReleaseRetiredScenes();
+
+private:
+	// the hidden window holding the loader context
+	GLFWwindow* m_pLoaderWindow;
+
+	// the scene on the loader thread and whether it is done
+	std::thread m_loader;
+	SceneManager* m_pLoadingScene;
+	std::atomic<bool> m_bLoaded;
+
+	// replaced scenes, oldest first
+	std::vector<SceneManager*> m_retiredScenes;
+
+	// loader thread body
+	void LoadScene();
+};
@@ -0,0 +1,560 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapetessellator.cpp
+// ============
+// tessellate the basic 3D shapes once per set of parameters
+//
+//  The angles around a shape are looked up in sine and cosine tables
+//  built once per tessellation and shared by every ring, and the
+//  rings are evaluated four vertices at a time.  Each finished mesh is
+//  kept in a store keyed by its shape and tessellation, so asking for
+//  the same mesh again, from any thread, only looks it up.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShapeTessellator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define TESSELLATOR_USE_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	const float g_PI = 3.14159265358979f;
+
+	// tessellation of the built-in round shapes
+	const int g_RoundSlices = 36;
+	const int g_SphereStacks = 18;
+	const int g_TorusSides = 16;
+	const float g_TorusMainRadius = 1.0f;
+	const float g_TorusTubeRadius = 0.25f;
+
+	// every mesh tessellated so far; a map never moves its items,
+	// so returned meshes stay where they are as others are added
+	std::mutex g_StoreMutex;
+	std::map<ShapeTessellator::SHAPE_PARAMETERS, ShapeTessellator::SHAPE_MESH> g_Store;
+
+	// the sine and cosine of each division of a circle, including
+	// the one closing it, padded with zeros to whole groups of four
+	struct SINCOS_TABLE
+	{
+		int count;
+		std::vector<float> cosines;
+		std::vector<float> sines;
+	};
+
+	// points around one ring, one array per axis, padded like the
+	// table they were evaluated from
+	struct RING_POINTS
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+	};
+
+	/***********************************************************
+	 *  BuildSincosTable()
+	 *
+	 *  Fill in the angles span * i / divisions + phase for i
+	 *  from 0 to divisions.
+	 ***********************************************************/
+	void BuildSincosTable(int divisions, float span, float phase, SINCOS_TABLE& table)
+	{
+		table.count = divisions + 1;
+		size_t padded = ((size_t)table.count + 3) & ~(size_t)3;
+		table.cosines.assign(padded, 0.0f);
+		table.sines.assign(padded, 0.0f);
+		for (int i = 0; i < table.count; i++)
+		{
+			float u = (float)i / divisions;
+			float angle = span * u + phase;
+			table.cosines[i] = cosf(angle);
+			table.sines[i] = sinf(angle);
+		}
+	}
+
+	/***********************************************************
+	 *  EvaluateAxis()
+	 *
+	 *  Compute cosWeight * cos + sinWeight * sin + offset over
+	 *  a padded table, four entries at a time.
+	 ***********************************************************/
+	void EvaluateAxis(
+		const SINCOS_TABLE& table,
+		float cosWeight,
+		float sinWeight,
+		float offset,
+		std::vector<float>& output)
+	{
+		const size_t padded = table.cosines.size();
+		output.resize(padded);
+		const float* cosines = table.cosines.data();
+		const float* sines = table.sines.data();
+		float* values = output.data();
+
+#ifdef TESSELLATOR_USE_SSE
+		const __m128 cosWeights = _mm_set1_ps(cosWeight);
+		const __m128 sinWeights = _mm_set1_ps(sinWeight);
+		const __m128 offsets = _mm_set1_ps(offset);
+		for (size_t i = 0; i < padded; i += 4)
+		{
+			__m128 c = _mm_mul_ps(_mm_loadu_ps(cosines + i), cosWeights);
+			__m128 s = _mm_mul_ps(_mm_loadu_ps(sines + i), sinWeights);
+			_mm_storeu_ps(values + i, _mm_add_ps(_mm_add_ps(c, s), offsets));
+		}
+#else
+		for (size_t i = 0; i < padded; i++)
+		{
+			values[i] = (cosines[i] * cosWeight + sines[i] * sinWeight) + offset;
+		}
+#endif
+	}
+
+	/***********************************************************
+	 *  EvaluateRing()
+	 *
+	 *  Compute the points of one ring, each axis weighting the
+	 *  table's cosines and sines and adding an offset.
+	 ***********************************************************/
+	void EvaluateRing(
+		const SINCOS_TABLE& table,
+		glm::vec3 cosWeight,
+		glm::vec3 sinWeight,
+		glm::vec3 offset,
+		RING_POINTS& points)
+	{
+		EvaluateAxis(table, cosWeight.x, sinWeight.x, offset.x, points.x);
+		EvaluateAxis(table, cosWeight.y, sinWeight.y, offset.y, points.y);
+		EvaluateAxis(table, cosWeight.z, sinWeight.z, offset.z, points.z);
+	}
+
+	/***********************************************************
+	 *  AddQuad()
+	 *
+	 *  Append four corners sharing one normal as two triangles.
+	 *  The corners must be counter-clockwise when viewed from
+	 *  the side the normal points to.
+	 ***********************************************************/
+	void AddQuad(
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices,
+		const glm::vec3 corners[4],
+		glm::vec3 normal)
+	{
+		const glm::vec2 texCoords[4] = {
+			glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f),
+			glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) };
+
+		GLuint first = (GLuint)vertices.size();
+		for (int i = 0; i < 4; i++)
+		{
+			vertices.push_back({ corners[i], normal, texCoords[i] });
+		}
+		indices.insert(indices.end(), {
+			first, first + 1, first + 2,
+			first, first + 2, first + 3 });
+	}
+
+	/***********************************************************
+	 *  AddCap()
+	 *
+	 *  Append a flat disc of radius 1 at the passed in height,
+	 *  facing up or down, around the table's circle.
+	 ***********************************************************/
+	void AddCap(
+		std::vector<MeshPool::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices,
+		const SINCOS_TABLE& circle,
+		float height,
+		bool bFacingUp)
+	{
+		glm::vec3 normal(0.0f, bFacingUp ? 1.0f : -1.0f, 0.0f);
+		GLuint center = (GLuint)vertices.size();
+
+		vertices.push_back({ glm::vec3(0.0f, height, 0.0f), normal, glm::vec2(0.5f, 0.5f) });
+		for (int i = 0; i < circle.count; i++)
+		{
+			float x = circle.cosines[i];
+			float z = circle.sines[i];
+			vertices.push_back({ glm::vec3(x, height, z), normal, glm::vec2(0.5f + 0.5f * x, 0.5f + 0.5f * z) });
+		}
+		for (int i = 0; i < circle.count - 1; i++)
+		{
+			GLuint ring = center + 1 + i;
+			if (bFacingUp)
+				indices.insert(indices.end(), { center, ring + 1, ring });
+			else
+				indices.insert(indices.end(), { center, ring, ring + 1 });
+		}
+	}
+
+	/***********************************************************
+	 *  GenerateBox()
+	 *
+	 *  A unit cube centered on the origin.
+	 ***********************************************************/
+	void GenerateBox(ShapeTessellator::SHAPE_MESH& mesh)
+	{
+		const glm::vec3 normals[6] = {
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+
+		for (int face = 0; face < 6; face++)
+		{
+			glm::vec3 normal = normals[face];
+			// pick an up axis on the face, then the right axis so that
+			// right x up == normal keeps the corners counter-clockwise
+			glm::vec3 up = (face < 2 || face > 3) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, -normal.y);
+			glm::vec3 right = glm::cross(up, normal);
+			glm::vec3 center = normal * 0.5f;
+
+			glm::vec3 corners[4] = {
+				center - right * 0.5f - up * 0.5f,
+				center + right * 0.5f - up * 0.5f,
+				center + right * 0.5f + up * 0.5f,
+				center - right * 0.5f + up * 0.5f };
+			AddQuad(mesh.vertices, mesh.indices, corners, normal);
+		}
+	}
+
+	/***********************************************************
+	 *  GeneratePlane()
+	 *
+	 *  A 2x2 plane in the XZ plane facing up.
+	 ***********************************************************/
+	void GeneratePlane(ShapeTessellator::SHAPE_MESH& mesh)
+	{
+		glm::vec3 corners[4] = {
+			glm::vec3(-1.0f, 0.0f, 1.0f),
+			glm::vec3(1.0f, 0.0f, 1.0f),
+			glm::vec3(1.0f, 0.0f, -1.0f),
+			glm::vec3(-1.0f, 0.0f, -1.0f) };
+		AddQuad(mesh.vertices, mesh.indices, corners, glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	/***********************************************************
+	 *  GenerateCylinder()
+	 *
+	 *  A cylinder of radius 1 standing from y = 0 to y = 1.
+	 *  The caps and the side share one table.
+	 ***********************************************************/
+	void GenerateCylinder(ShapeTessellator::SHAPE_MESH& mesh, int slices)
+	{
+		SINCOS_TABLE circle;
+		BuildSincosTable(slices, 2.0f * g_PI, 0.0f, circle);
+
+		AddCap(mesh.vertices, mesh.indices, circle, 0.0f, false);
+		AddCap(mesh.vertices, mesh.indices, circle, 1.0f, true);
+
+		GLuint first = (GLuint)mesh.vertices.size();
+		for (int i = 0; i <= slices; i++)
+		{
+			float u = (float)i / slices;
+			glm::vec3 normal(circle.cosines[i], 0.0f, circle.sines[i]);
+			mesh.vertices.push_back({ glm::vec3(normal.x, 0.0f, normal.z), normal, glm::vec2(u, 0.0f) });
+			mesh.vertices.push_back({ glm::vec3(normal.x, 1.0f, normal.z), normal, glm::vec2(u, 1.0f) });
+		}
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint bottom0 = first + 2 * i;
+			GLuint top0 = bottom0 + 1;
+			GLuint bottom1 = bottom0 + 2;
+			GLuint top1 = bottom0 + 3;
+			mesh.indices.insert(mesh.indices.end(), { bottom0, top0, top1, bottom0, top1, bottom1 });
+		}
+	}
+
+	/***********************************************************
+	 *  GenerateCone()
+	 *
+	 *  A cone of radius 1 at y = 0 with its tip at y = 1.
+	 ***********************************************************/
+	void GenerateCone(ShapeTessellator::SHAPE_MESH& mesh, int slices)
+	{
+		// the tip gets the normal of the middle of its slice, so
+		// it has a table of its own half a slice along
+		SINCOS_TABLE circle;
+		SINCOS_TABLE tipCircle;
+		BuildSincosTable(slices, 2.0f * g_PI, 0.0f, circle);
+		BuildSincosTable(slices, 2.0f * g_PI, g_PI / slices, tipCircle);
+
+		AddCap(mesh.vertices, mesh.indices, circle, 0.0f, false);
+
+		GLuint first = (GLuint)mesh.vertices.size();
+		for (int i = 0; i <= slices; i++)
+		{
+			float u = (float)i / slices;
+			glm::vec3 normal = glm::normalize(glm::vec3(circle.cosines[i], 1.0f, circle.sines[i]));
+			glm::vec3 tipNormal = glm::normalize(glm::vec3(tipCircle.cosines[i], 1.0f, tipCircle.sines[i]));
+			mesh.vertices.push_back({ glm::vec3(circle.cosines[i], 0.0f, circle.sines[i]), normal, glm::vec2(u, 0.0f) });
+			mesh.vertices.push_back({ glm::vec3(0.0f, 1.0f, 0.0f), tipNormal, glm::vec2(u, 1.0f) });
+		}
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint base0 = first + 2 * i;
+			GLuint tip = base0 + 1;
+			GLuint base1 = base0 + 2;
+			mesh.indices.insert(mesh.indices.end(), { base0, tip, base1 });
+		}
+	}
+
+	/***********************************************************
+	 *  GenerateSphere()
+	 *
+	 *  A sphere of radius 1 centered on the origin.  Each stack
+	 *  is the slice table scaled to the stack's radius.
+	 ***********************************************************/
+	void GenerateSphere(ShapeTessellator::SHAPE_MESH& mesh, int slices, int stacks)
+	{
+		SINCOS_TABLE circle;
+		SINCOS_TABLE arc;
+		BuildSincosTable(slices, 2.0f * g_PI, 0.0f, circle);
+		BuildSincosTable(stacks, g_PI, 0.0f, arc);
+
+		mesh.vertices.reserve((size_t)(stacks + 1) * (slices + 1));
+		RING_POINTS ring;
+		for (int stack = 0; stack <= stacks; stack++)
+		{
+			float v = (float)stack / stacks;
+			float ringRadius = arc.sines[stack];
+			EvaluateRing(circle,
+				glm::vec3(ringRadius, 0.0f, 0.0f),
+				glm::vec3(0.0f, 0.0f, ringRadius),
+				glm::vec3(0.0f, arc.cosines[stack], 0.0f),
+				ring);
+			for (int slice = 0; slice <= slices; slice++)
+			{
+				float u = (float)slice / slices;
+				glm::vec3 normal(ring.x[slice], ring.y[slice], ring.z[slice]);
+				mesh.vertices.push_back({ normal, normal, glm::vec2(u, 1.0f - v) });
+			}
+		}
+
+		const GLuint rowLength = slices + 1;
+		mesh.indices.reserve((size_t)stacks * slices * 6);
+		for (int stack = 0; stack < stacks; stack++)
+		{
+			for (int slice = 0; slice < slices; slice++)
+			{
+				GLuint upper0 = stack * rowLength + slice;
+				GLuint upper1 = upper0 + 1;
+				GLuint lower0 = upper0 + rowLength;
+				GLuint lower1 = lower0 + 1;
+				mesh.indices.insert(mesh.indices.end(), { upper0, upper1, lower1, upper0, lower1, lower0 });
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  GeneratePrism()
+	 *
+	 *  A triangular prism with a unit cross-section in XY,
+	 *  extruded from z = -0.5 to z = 0.5.
+	 ***********************************************************/
+	void GeneratePrism(ShapeTessellator::SHAPE_MESH& mesh)
+	{
+		const glm::vec3 front[3] = {
+			glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(0.0f, 0.5f, 0.5f) };
+		const glm::vec3 depth(0.0f, 0.0f, -1.0f);
+
+		// the two triangular ends
+		GLuint first = (GLuint)mesh.vertices.size();
+		for (int i = 0; i < 3; i++)
+		{
+			glm::vec2 texCoord(front[i].x + 0.5f, front[i].y + 0.5f);
+			mesh.vertices.push_back({ front[i], glm::vec3(0.0f, 0.0f, 1.0f), texCoord });
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			glm::vec2 texCoord(front[i].x + 0.5f, front[i].y + 0.5f);
+			mesh.vertices.push_back({ front[i] + depth, glm::vec3(0.0f, 0.0f, -1.0f), texCoord });
+		}
+		mesh.indices.insert(mesh.indices.end(), { first, first + 1, first + 2, first + 3, first + 5, first + 4 });
+
+		// the three rectangular sides
+		for (int i = 0; i < 3; i++)
+		{
+			glm::vec3 edgeStart = front[i];
+			glm::vec3 edgeEnd = front[(i + 1) % 3];
+			glm::vec3 normal = glm::normalize(glm::cross(depth, edgeEnd - edgeStart));
+			glm::vec3 corners[4] = { edgeStart + depth, edgeEnd + depth, edgeEnd, edgeStart };
+			AddQuad(mesh.vertices, mesh.indices, corners, normal);
+		}
+	}
+
+	/***********************************************************
+	 *  GenerateTorus()
+	 *
+	 *  A torus lying in the XY plane around the Z axis.  Each
+	 *  ring of the tube is the side table turned to the ring's
+	 *  angle.
+	 ***********************************************************/
+	void GenerateTorus(ShapeTessellator::SHAPE_MESH& mesh, int rings, int sides)
+	{
+		SINCOS_TABLE circle;
+		SINCOS_TABLE tube;
+		BuildSincosTable(rings, 2.0f * g_PI, 0.0f, circle);
+		BuildSincosTable(sides, 2.0f * g_PI, 0.0f, tube);
+
+		mesh.vertices.reserve((size_t)(rings + 1) * (sides + 1));
+		RING_POINTS normals;
+		for (int ring = 0; ring <= rings; ring++)
+		{
+			float u = (float)ring / rings;
+			float cosTheta = circle.cosines[ring];
+			float sinTheta = circle.sines[ring];
+			EvaluateRing(tube,
+				glm::vec3(cosTheta, sinTheta, 0.0f),
+				glm::vec3(0.0f, 0.0f, 1.0f),
+				glm::vec3(0.0f),
+				normals);
+			glm::vec3 center(g_TorusMainRadius * cosTheta, g_TorusMainRadius * sinTheta, 0.0f);
+			for (int side = 0; side <= sides; side++)
+			{
+				float v = (float)side / sides;
+				glm::vec3 normal(normals.x[side], normals.y[side], normals.z[side]);
+				mesh.vertices.push_back({ center + normal * g_TorusTubeRadius, normal, glm::vec2(u, v) });
+			}
+		}
+
+		const GLuint rowLength = sides + 1;
+		mesh.indices.reserve((size_t)rings * sides * 6);
+		for (int ring = 0; ring < rings; ring++)
+		{
+			for (int side = 0; side < sides; side++)
+			{
+				GLuint a = ring * rowLength + side;
+				GLuint b = a + rowLength;
+				GLuint c = b + 1;
+				GLuint d = a + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, b, c, a, c, d });
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  NormalizeParameters()
+	 *
+	 *  Clamp the divisions to ones that make a closed shape and
+	 *  clear those the shape does not use, so equal meshes
+	 *  share one key.
+	 ***********************************************************/
+	ShapeTessellator::SHAPE_PARAMETERS NormalizeParameters(ShapeTessellator::SHAPE_PARAMETERS parameters)
+	{
+		switch (parameters.shape)
+		{
+		case MESH_CYLINDER:
+		case MESH_CONE:
+			parameters.slices = std::max(parameters.slices, 3);
+			parameters.stacks = 0;
+			break;
+		case MESH_SPHERE:
+			parameters.slices = std::max(parameters.slices, 3);
+			parameters.stacks = std::max(parameters.stacks, 2);
+			break;
+		case MESH_TORUS:
+			parameters.slices = std::max(parameters.slices, 3);
+			parameters.stacks = std::max(parameters.stacks, 3);
+			break;
+		default:
+			parameters.slices = 0;
+			parameters.stacks = 0;
+			break;
+		}
+		return(parameters);
+	}
+}
+
+/***********************************************************
+ *  operator<()
+ *
+ *  This method orders parameters for the store's map.
+ ***********************************************************/
+bool ShapeTessellator::SHAPE_PARAMETERS::operator<(const SHAPE_PARAMETERS& other) const
+{
+	if (shape != other.shape)
+		return(shape < other.shape);
+	if (slices != other.slices)
+		return(slices < other.slices);
+	return(stacks < other.stacks);
+}
+
+/***********************************************************
+ *  GetBuiltinParameters()
+ *
+ *  This method returns the tessellation of the shapes the
+ *  pool generates.
+ ***********************************************************/
+ShapeTessellator::SHAPE_PARAMETERS ShapeTessellator::GetBuiltinParameters(MESH_TYPE shape)
+{
+	SHAPE_PARAMETERS parameters;
+	parameters.shape = shape;
+	parameters.slices = g_RoundSlices;
+	parameters.stacks = (shape == MESH_TORUS) ? g_TorusSides : g_SphereStacks;
+	return(NormalizeParameters(parameters));
+}
+
+/***********************************************************
+ *  Tessellate()
+ *
+ *  This method looks the mesh up in the store and generates
+ *  it when it is not there.  The lock is not held while the
+ *  mesh is generated, so different shapes can be generated
+ *  side by side; when two threads generate the same one, the
+ *  first to finish is kept.
+ ***********************************************************/
+const ShapeTessellator::SHAPE_MESH* ShapeTessellator::Tessellate(const SHAPE_PARAMETERS& parameters)
+{
+	if ((parameters.shape < 0) || (parameters.shape >= MESH_BUILTIN_COUNT))
+	{
+		return(NULL);
+	}
+
+	SHAPE_PARAMETERS key = NormalizeParameters(parameters);
+	{
+		std::lock_guard<std::mutex> lock(g_StoreMutex);
+		std::map<SHAPE_PARAMETERS, SHAPE_MESH>::const_iterator found = g_Store.find(key);
+		if (found != g_Store.end())
+		{
+			return(&found->second);
+		}
+	}
+
+	SHAPE_MESH mesh;
+	switch (key.shape)
+	{
+	case MESH_BOX:
+		GenerateBox(mesh);
+		break;
+	case MESH_PLANE:
+		GeneratePlane(mesh);
+		break;
+	case MESH_CYLINDER:
+		GenerateCylinder(mesh, key.slices);
+		break;
+	case MESH_CONE:
+		GenerateCone(mesh, key.slices);
+		break;
+	case MESH_SPHERE:
+		GenerateSphere(mesh, key.slices, key.stacks);
+		break;
+	case MESH_PRISM:
+		GeneratePrism(mesh);
+		break;
+	case MESH_TORUS:
+		GenerateTorus(mesh, key.slices, key.stacks);
+		break;
+	default:
+		break;
+	}
+
+	std::lock_guard<std::mutex> lock(g_StoreMutex);
+	return(&g_Store.emplace(key, std::move(mesh)).first->second);
+}
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapetessellator.h
+// ============
+// tessellate the basic 3D shapes once per set of parameters
+//
+//  The angles around a shape are looked up in sine and cosine tables
+//  built once per tessellation and shared by every ring, and the
+//  rings are evaluated four vertices at a time.  Each finished mesh is
+//  kept in a store keyed by its shape and tessellation, so asking for
+//  the same mesh again, from any thread, only looks it up.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshPool.h"
+
+#include <vector>
+
+/***********************************************************
+ *  ShapeTessellator
+ *
+ *  This class generates the built-in shapes into the shared
+ *  store.  The store lives as long as the program, so the
+ *  meshes it returns stay valid and can be used without any
+ *  locking once returned.
+ ***********************************************************/
+class ShapeTessellator
+{
+public:
+	struct SHAPE_PARAMETERS
+	{
+		MESH_TYPE shape;
+		// divisions around the shape, and along it for a sphere's
+		// stacks or a torus's sides; unused by the flat shapes
+		int slices;
+		int stacks;
+
+		bool operator<(const SHAPE_PARAMETERS& other) const;
+	};
+
+	struct SHAPE_MESH
+	{
+		std::vector<MeshPool::MESH_VERTEX> vertices;
+		std::vector<GLuint> indices;
+	};
+
+	// the tessellation the pool uses for a built-in shape
+	static SHAPE_PARAMETERS GetBuiltinParameters(MESH_TYPE shape);
+	// the mesh for the parameters, generated on the first request;
+	// safe to call from any thread, NULL for a shape that is not
+	// built in
+	static const SHAPE_MESH* Tessellate(const SHAPE_PARAMETERS& parameters);
+};
@@ -0,0 +1,431 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.cpp
+// ============
+// keep only the texture mip levels the view needs within a memory budget
+//
+//  Textures start with just their small mip levels uploaded.  Each
+//  frame the visible objects ask for the level that matches their size
+//  on screen, and the larger levels are uploaded as they are needed,
+//  pushing out the ones used least recently when memory runs short.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// levels no larger than this are uploaded up front and never
+	// evicted, so every texture can always be drawn
+	const int g_TailSize = 64;
+	// most bytes uploaded in one frame, to spread the cost of a
+	// sudden change of view over several frames
+	const size_t g_UploadBytesPerFrame = 4 * 1024 * 1024;
+	// shortest time between two residency reports
+	const std::chrono::seconds g_ReportInterval(1);
+
+	/***********************************************************
+	 *  LevelSize()
+	 *
+	 *  Width or height of a mip level.
+	 ***********************************************************/
+	int LevelSize(int size, int level)
+	{
+		return(std::max(size >> level, 1));
+	}
+}
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer(size_t budgetBytes)
+{
+	m_budget = budgetBytes;
+	m_residentBytes = 0;
+	m_frame = 0;
+	m_evictedLevels = 0;
+	m_lastReport = std::chrono::steady_clock::now();
+	m_bReportPending = false;
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method builds the mip chain of an image with a box
+ *  filter, the same way the asset baker does.
+ ***********************************************************/
+void TextureStreamer::AddTexture(
+	GLuint textureID,
+	int width,
+	int height,
+	int channels,
+	const unsigned char* image)
+{
+	STREAMED_TEXTURE texture;
+	texture.width = width;
+	texture.height = height;
+	texture.channels = channels;
+	texture.levelCount = 1;
+	while ((LevelSize(width, texture.levelCount - 1) > 1) || (LevelSize(height, texture.levelCount - 1) > 1))
+	{
+		texture.levelCount++;
+	}
+
+	size_t chainBytes = 0;
+	for (int level = 0; level < texture.levelCount; level++)
+	{
+		chainBytes += GetLevelBytes(texture, level);
+	}
+	texture.ownedLevels.resize(chainBytes);
+	memcpy(texture.ownedLevels.data(), image, GetLevelBytes(texture, 0));
+
+	size_t offset = 0;
+	for (int level = 0; level < texture.levelCount; level++)
+	{
+		texture.levels.push_back(texture.ownedLevels.data() + offset);
+		offset += GetLevelBytes(texture, level);
+	}
+
+	// each texel averages the 2x2 block above it, clamped at the
+	// edges of odd sized levels
+	size_t sourceOffset = 0;
+	for (int level = 1; level < texture.levelCount; level++)
+	{
+		const unsigned char* source = texture.ownedLevels.data() + sourceOffset;
+		sourceOffset += GetLevelBytes(texture, level - 1);
+		unsigned char* target = texture.ownedLevels.data() + sourceOffset;
+		int sourceWidth = LevelSize(width, level - 1);
+		int sourceHeight = LevelSize(height, level - 1);
+		int targetWidth = LevelSize(width, level);
+		int targetHeight = LevelSize(height, level);
+
+		for (int y = 0; y < targetHeight; y++)
+		{
+			int y0 = std::min(y * 2, sourceHeight - 1);
+			int y1 = std::min(y * 2 + 1, sourceHeight - 1);
+			for (int x = 0; x < targetWidth; x++)
+			{
+				int x0 = std::min(x * 2, sourceWidth - 1);
+				int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+				for (int c = 0; c < channels; c++)
+				{
+					int sum = source[(y0 * sourceWidth + x0) * channels + c] +
+						source[(y0 * sourceWidth + x1) * channels + c] +
+						source[(y1 * sourceWidth + x0) * channels + c] +
+						source[(y1 * sourceWidth + x1) * channels + c];
+					target[(y * targetWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	StartTexture(textureID, texture);
+}
+
+/***********************************************************
+ *  AddPackedTexture()
+ *
+ *  This method points the levels into the baked chain.
+ ***********************************************************/
+void TextureStreamer::AddPackedTexture(
+	GLuint textureID,
+	int width,
+	int height,
+	int channels,
+	int levelCount,
+	const unsigned char* levels)
+{
+	STREAMED_TEXTURE texture;
+	texture.width = width;
+	texture.height = height;
+	texture.channels = channels;
+	texture.levelCount = levelCount;
+
+	for (int level = 0; level < levelCount; level++)
+	{
+		texture.levels.push_back(levels);
+		levels += GetLevelBytes(texture, level);
+	}
+
+	StartTexture(textureID, texture);
+}
+
+/***********************************************************
+ *  StartTexture()
+ *
+ *  This method uploads the tail of the chain, which stays
+ *  resident whatever the budget.
+ ***********************************************************/
+void TextureStreamer::StartTexture(GLuint textureID, STREAMED_TEXTURE& texture)
+{
+	RemoveTexture(textureID);
+
+	texture.tailLevel = 0;
+	while ((texture.tailLevel < texture.levelCount - 1) &&
+		((LevelSize(texture.width, texture.tailLevel) > g_TailSize) || (LevelSize(texture.height, texture.tailLevel) > g_TailSize)))
+	{
+		texture.tailLevel++;
+	}
+	texture.residentLevel = texture.tailLevel;
+	texture.requestedLevel = texture.tailLevel;
+	texture.specifiedLevel = texture.levelCount;
+	texture.lastUsed.assign(texture.levelCount, 0);
+
+	for (int level = texture.residentLevel; level < texture.levelCount; level++)
+	{
+		m_residentBytes += GetLevelBytes(texture, level);
+	}
+
+	STREAMED_TEXTURE& added = m_textures[textureID];
+	added = std::move(texture);
+	SpecifyLevels(textureID, added);
+	m_bReportPending = true;
+}
+
+/***********************************************************
+ *  RemoveTexture()
+ *
+ *  This method drops a texture and its resident bytes.
+ ***********************************************************/
+void TextureStreamer::RemoveTexture(GLuint textureID)
+{
+	std::map<GLuint, STREAMED_TEXTURE>::iterator found = m_textures.find(textureID);
+	if (found == m_textures.end())
+	{
+		return;
+	}
+
+	for (int level = found->second.residentLevel; level < found->second.levelCount; level++)
+	{
+		m_residentBytes -= GetLevelBytes(found->second, level);
+	}
+	m_textures.erase(found);
+	m_bReportPending = true;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method clears the requests of the last frame.
+ ***********************************************************/
+void TextureStreamer::BeginFrame()
+{
+	m_frame++;
+	for (std::pair<const GLuint, STREAMED_TEXTURE>& entry : m_textures)
+	{
+		entry.second.requestedLevel = entry.second.tailLevel;
+	}
+}
+
+/***********************************************************
+ *  RequestTexture()
+ *
+ *  This method picks the smallest level that still has a
+ *  texel for every pixel the object covers, and marks it
+ *  and the levels below it as used.
+ ***********************************************************/
+void TextureStreamer::RequestTexture(GLuint textureID, float screenPixels)
+{
+	std::map<GLuint, STREAMED_TEXTURE>::iterator found = m_textures.find(textureID);
+	if (found == m_textures.end())
+	{
+		return;
+	}
+
+	STREAMED_TEXTURE& texture = found->second;
+	int level = 0;
+	while ((level < texture.tailLevel) &&
+		(std::max(LevelSize(texture.width, level + 1), LevelSize(texture.height, level + 1)) >= screenPixels))
+	{
+		level++;
+	}
+
+	texture.requestedLevel = std::min(texture.requestedLevel, level);
+	for (int i = level; i < texture.levelCount; i++)
+	{
+		texture.lastUsed[i] = m_frame;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method first evicts down to the budget, in case it
+ *  was exceeded, then moves every texture that is short of
+ *  its request one level closer, the furthest off first.
+ ***********************************************************/
+bool TextureStreamer::Update()
+{
+	std::vector<GLuint> changed;
+	MakeRoom(0, changed);
+
+	std::vector<std::pair<int, GLuint>> requests;
+	for (const std::pair<const GLuint, STREAMED_TEXTURE>& entry : m_textures)
+	{
+		int shortfall = entry.second.residentLevel - entry.second.requestedLevel;
+		if (shortfall > 0)
+		{
+			requests.push_back(std::make_pair(-shortfall, entry.first));
+		}
+	}
+	std::sort(requests.begin(), requests.end());
+
+	// only the newly resident level of a texture is uploaded, so
+	// its size is what counts against the cap
+	size_t uploadedBytes = 0;
+	for (const std::pair<int, GLuint>& request : requests)
+	{
+		STREAMED_TEXTURE& texture = m_textures[request.second];
+		size_t levelBytes = GetLevelBytes(texture, texture.residentLevel - 1);
+		if (!MakeRoom(levelBytes, changed))
+		{
+			continue;
+		}
+
+		texture.residentLevel--;
+		m_residentBytes += levelBytes;
+		changed.push_back(request.second);
+
+		uploadedBytes += SpecifyLevels(request.second, texture);
+		if (uploadedBytes >= g_UploadBytesPerFrame)
+		{
+			break;
+		}
+	}
+
+	// the textures that only lost levels free them
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+	for (GLuint textureID : changed)
+	{
+		SpecifyLevels(textureID, m_textures[textureID]);
+	}
+
+	m_bReportPending = m_bReportPending || !changed.empty();
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (m_bReportPending && (now - m_lastReport >= g_ReportInterval))
+	{
+		size_t fullBytes = 0;
+		for (const std::pair<const GLuint, STREAMED_TEXTURE>& entry : m_textures)
+		{
+			for (int level = 0; level < entry.second.levelCount; level++)
+			{
+				fullBytes += GetLevelBytes(entry.second, level);
+			}
+		}
+
+		const double megabyte = 1024.0 * 1024.0;
+		std::cout << "INFO: Textures resident " << m_residentBytes / megabyte << " MB of "
+			<< fullBytes / megabyte << " MB, budget " << m_budget / megabyte << " MB, "
+			<< m_evictedLevels << " levels evicted" << std::endl;
+		m_lastReport = now;
+		m_bReportPending = false;
+	}
+
+	return(!changed.empty());
+}
+
+/***********************************************************
+ *  MakeRoom()
+ *
+ *  This method evicts the largest resident level whose last
+ *  use is the oldest, until the passed in bytes fit.  It
+ *  returns false when only levels in use are left.
+ ***********************************************************/
+bool TextureStreamer::MakeRoom(size_t bytes, std::vector<GLuint>& changed)
+{
+	while (m_residentBytes + bytes > m_budget)
+	{
+		GLuint victimID = 0;
+		STREAMED_TEXTURE* pVictim = NULL;
+		for (std::pair<const GLuint, STREAMED_TEXTURE>& entry : m_textures)
+		{
+			STREAMED_TEXTURE& texture = entry.second;
+			if ((texture.residentLevel >= texture.tailLevel) ||
+				(texture.lastUsed[texture.residentLevel] == m_frame))
+			{
+				continue;
+			}
+
+			if ((NULL == pVictim) ||
+				(texture.lastUsed[texture.residentLevel] < pVictim->lastUsed[pVictim->residentLevel]) ||
+				((texture.lastUsed[texture.residentLevel] == pVictim->lastUsed[pVictim->residentLevel]) &&
+					(GetLevelBytes(texture, texture.residentLevel) > GetLevelBytes(*pVictim, pVictim->residentLevel))))
+			{
+				victimID = entry.first;
+				pVictim = &texture;
+			}
+		}
+
+		if (NULL == pVictim)
+		{
+			return(false);
+		}
+
+		m_residentBytes -= GetLevelBytes(*pVictim, pVictim->residentLevel);
+		pVictim->residentLevel++;
+		m_evictedLevels++;
+		changed.push_back(victimID);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  SpecifyLevels()
+ *
+ *  This method uploads the resident levels that are not in
+ *  the texture yet, each at its own index, and gives evicted
+ *  levels a size of zero, which frees their storage.  The
+ *  levels already in place are left alone, and sampling
+ *  starts at the base level.  The storage stays mutable, as
+ *  immutable storage would hold the whole chain and the
+ *  budget could free nothing.
+ ***********************************************************/
+size_t TextureStreamer::SpecifyLevels(GLuint textureID, STREAMED_TEXTURE& texture)
+{
+	if (texture.specifiedLevel == texture.residentLevel)
+	{
+		return(0);
+	}
+
+	GLenum internalFormat = (texture.channels == 4) ? GL_RGBA8 : GL_RGB8;
+	GLenum format = (texture.channels == 4) ? GL_RGBA : GL_RGB;
+	size_t uploadedBytes = 0;
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (int level = texture.residentLevel; level < texture.specifiedLevel; level++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat,
+			LevelSize(texture.width, level), LevelSize(texture.height, level),
+			0, format, GL_UNSIGNED_BYTE, texture.levels[level]);
+		uploadedBytes += GetLevelBytes(texture, level);
+	}
+	for (int level = texture.specifiedLevel; level < texture.residentLevel; level++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0, 0, format, GL_UNSIGNED_BYTE, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.residentLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levelCount - 1);
+	texture.specifiedLevel = texture.residentLevel;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return(uploadedBytes);
+}
+
+/***********************************************************
+ *  GetLevelBytes()
+ *
+ *  This method returns the size of one level of the chain.
+ ***********************************************************/
+size_t TextureStreamer::GetLevelBytes(const STREAMED_TEXTURE& texture, int level) const
+{
+	return((size_t)LevelSize(texture.width, level) * LevelSize(texture.height, level) * texture.channels);
+}
@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ============
+// keep only the texture mip levels the view needs within a memory budget
+//
+//  Textures start with just their small mip levels uploaded.  Each
+//  frame the visible objects ask for the level that matches their size
+//  on screen, and the larger levels are uploaded as they are needed,
+//  pushing out the ones used least recently when memory runs short.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  This class keeps the full mip chain of every texture it
+ *  is handed in CPU memory and decides which levels are in
+ *  the OpenGL texture.  The texture name never changes and
+ *  every level keeps its own index; a level is uploaded when
+ *  it becomes resident, freed when it is evicted, and the
+ *  base level points at the largest resident one.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	// constructor
+	TextureStreamer(size_t budgetBytes);
+
+	// take over an image of 3 or 4 channels, generating its mip
+	// chain, and upload the small levels
+	void AddTexture(
+		GLuint textureID,
+		int width,
+		int height,
+		int channels,
+		const unsigned char* image);
+	// take over a ready mip chain, tightly packed level after
+	// level, which must stay valid while the texture is in use
+	void AddPackedTexture(
+		GLuint textureID,
+		int width,
+		int height,
+		int channels,
+		int levelCount,
+		const unsigned char* levels);
+	// forget a texture before it is deleted
+	void RemoveTexture(GLuint textureID);
+
+	// start the requests of a new frame
+	void BeginFrame();
+	// a visible object shows the texture across this many pixels
+	void RequestTexture(GLuint textureID, float screenPixels);
+	// upload and evict levels to serve the frame's requests,
+	// returning true when any texture changed
+	bool Update();
+
+	size_t GetResidentBytes() const { return m_residentBytes; }
+	size_t GetBudget() const { return m_budget; }
+
+private:
+	struct STREAMED_TEXTURE
+	{
+		int width;
+		int height;
+		int channels;
+		int levelCount;
+		// mip chain generated from an image file, or empty when
+		// the levels point into an asset pack
+		std::vector<unsigned char> ownedLevels;
+		std::vector<const unsigned char*> levels;
+		// largest level in the texture, the level the small tail
+		// of the chain starts at, which always stays, and the
+		// largest level asked for this frame
+		int residentLevel;
+		int tailLevel;
+		int requestedLevel;
+		// largest level currently specified in OpenGL, or the
+		// level count when none is
+		int specifiedLevel;
+		// frame each level was last asked for
+		std::vector<uint64_t> lastUsed;
+	};
+
+	std::map<GLuint, STREAMED_TEXTURE> m_textures;
+	size_t m_budget;
+	size_t m_residentBytes;
+	uint64_t m_frame;
+	int m_evictedLevels;
+
+	// residency report, printed when it changes
+	std::chrono::steady_clock::time_point m_lastReport;
+	bool m_bReportPending;
+
+	// add a texture whose levels are filled in, uploading its tail
+	void StartTexture(GLuint textureID, STREAMED_TEXTURE& texture);
+	// evict least recently used levels until the bytes fit, never
+	// touching a level asked for this frame
+	bool MakeRoom(size_t bytes, std::vector<GLuint>& changed);
+	// bring the levels specified in OpenGL in line with the
+	// resident ones, returning the bytes uploaded
+	size_t SpecifyLevels(GLuint textureID, STREAMED_TEXTURE& texture);
+	size_t GetLevelBytes(const STREAMED_TEXTURE& texture, int level) const;
+};
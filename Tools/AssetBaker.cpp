@@ -0,0 +1,382 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetbaker.cpp
+// ============
+// bake a scene file and everything it uses into one asset pack
+//
+//  usage: AssetBaker <scene file> <pack file>
+//
+//  Run from the same directory as the program, so the texture paths
+//  in the scene file resolve the same way.  The pooled shapes are
+//  tessellated, imported meshes optimized, the textures decoded,
+//  flipped and mipmapped, and the result written in the layout
+//  AssetPack reads in place.  Link with SceneFile.cpp, MeshPool.cpp,
+//  ShapeTessellator.cpp, AssetPack.cpp, MappedFile.cpp,
+//  MeshImporter.cpp and MeshOptimizer.cpp.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "../AssetPack.h"
+#include "../MeshImporter.h"
+#include "../MeshPool.h"
+#include "../SceneFile.h"
+
+#ifndef STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// one section waiting to be written
+	struct PENDING_SECTION
+	{
+		AssetPack::SECTION_TYPE type;
+		uint32_t count;
+		std::vector<unsigned char> bytes;
+	};
+
+	/***********************************************************
+	 *  AddSection()
+	 *
+	 *  Append an array of records as a section of the pack.
+	 ***********************************************************/
+	template <typename T>
+	void AddSection(
+		std::vector<PENDING_SECTION>& sections,
+		AssetPack::SECTION_TYPE type,
+		const T* records,
+		size_t count)
+	{
+		PENDING_SECTION section;
+		section.type = type;
+		section.count = (uint32_t)count;
+		section.bytes.assign((const unsigned char*)records, (const unsigned char*)(records + count));
+		sections.push_back(section);
+	}
+
+	/***********************************************************
+	 *  CopyName()
+	 *
+	 *  Copy a tag into a fixed size name, which is rejected
+	 *  when it does not fit.
+	 ***********************************************************/
+	bool CopyName(char name[AssetPack::NAME_LENGTH], const std::string& text)
+	{
+		memset(name, 0, AssetPack::NAME_LENGTH);
+		if (text.size() >= AssetPack::NAME_LENGTH)
+		{
+			std::cout << "ERROR: Name '" << text << "' is longer than "
+				<< AssetPack::NAME_LENGTH - 1 << " characters" << std::endl;
+			return(false);
+		}
+		memcpy(name, text.c_str(), text.size());
+		return(true);
+	}
+
+	/***********************************************************
+	 *  CopyVec3()
+	 *
+	 *  Copy a vector into a float array of the pack.
+	 ***********************************************************/
+	void CopyVec3(float values[3], glm::vec3 vector)
+	{
+		values[0] = vector.x;
+		values[1] = vector.y;
+		values[2] = vector.z;
+	}
+
+	/***********************************************************
+	 *  BakeTexture()
+	 *
+	 *  Decode an image the way the program loads it, then add
+	 *  every mip level down to 1x1, each averaged 2x2 from the
+	 *  level above.
+	 ***********************************************************/
+	bool BakeTexture(
+		const SceneFile::TEXTURE_ENTRY& entry,
+		AssetPack::PACK_TEXTURE& texture,
+		std::vector<unsigned char>& data)
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+
+		stbi_set_flip_vertically_on_load(true);
+		unsigned char* image = stbi_load(entry.filename.c_str(), &width, &height, &channels, 0);
+		if (NULL == image)
+		{
+			std::cout << "ERROR: Could not load image: " << entry.filename << std::endl;
+			return(false);
+		}
+		if ((channels != 3) && (channels != 4))
+		{
+			std::cout << "ERROR: " << entry.filename << " has " << channels << " channels" << std::endl;
+			stbi_image_free(image);
+			return(false);
+		}
+
+		if (!CopyName(texture.tag, entry.tag))
+		{
+			stbi_image_free(image);
+			return(false);
+		}
+		texture.width = width;
+		texture.height = height;
+		texture.channels = channels;
+		texture.levelCount = 1;
+		texture.dataOffset = data.size();
+
+		std::vector<unsigned char> level(image, image + (size_t)width * height * channels);
+		stbi_image_free(image);
+		data.insert(data.end(), level.begin(), level.end());
+
+		while ((width > 1) || (height > 1))
+		{
+			int nextWidth = std::max(width / 2, 1);
+			int nextHeight = std::max(height / 2, 1);
+			std::vector<unsigned char> next((size_t)nextWidth * nextHeight * channels);
+
+			for (int y = 0; y < nextHeight; y++)
+			{
+				// an odd last row or column is averaged with itself
+				int y0 = std::min(y * 2, height - 1);
+				int y1 = std::min(y * 2 + 1, height - 1);
+				for (int x = 0; x < nextWidth; x++)
+				{
+					int x0 = std::min(x * 2, width - 1);
+					int x1 = std::min(x * 2 + 1, width - 1);
+					for (int c = 0; c < channels; c++)
+					{
+						int sum =
+							level[((size_t)y0 * width + x0) * channels + c] +
+							level[((size_t)y0 * width + x1) * channels + c] +
+							level[((size_t)y1 * width + x0) * channels + c] +
+							level[((size_t)y1 * width + x1) * channels + c];
+						next[((size_t)y * nextWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+
+			data.insert(data.end(), next.begin(), next.end());
+			level.swap(next);
+			width = nextWidth;
+			height = nextHeight;
+			texture.levelCount++;
+		}
+
+		texture.dataSize = data.size() - texture.dataOffset;
+		std::cout << "INFO: Baked " << entry.tag << " " << texture.width << "x" << texture.height
+			<< ", " << texture.levelCount << " levels" << std::endl;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  WritePack()
+	 *
+	 *  Write the header, the section table and the sections,
+	 *  each section starting on the pack's alignment.
+	 ***********************************************************/
+	bool WritePack(const char* filename, const std::vector<PENDING_SECTION>& sections)
+	{
+		const uint64_t alignment = AssetPack::SECTION_ALIGNMENT;
+
+		std::vector<AssetPack::PACK_SECTION> table(sections.size());
+		uint64_t offset = sizeof(AssetPack::PACK_HEADER) + table.size() * sizeof(AssetPack::PACK_SECTION);
+		for (size_t i = 0; i < sections.size(); i++)
+		{
+			offset = (offset + alignment - 1) / alignment * alignment;
+			table[i].type = sections[i].type;
+			table[i].count = sections[i].count;
+			table[i].offset = offset;
+			table[i].size = sections[i].bytes.size();
+			offset += table[i].size;
+		}
+
+		AssetPack::PACK_HEADER header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "CS330PAK", sizeof(header.magic));
+		header.version = AssetPack::FORMAT_VERSION;
+		header.sectionCount = (uint32_t)table.size();
+		header.fileSize = offset;
+
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "ERROR: Could not create " << filename << std::endl;
+			return(false);
+		}
+
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)table.data(), table.size() * sizeof(AssetPack::PACK_SECTION));
+		const char padding[AssetPack::SECTION_ALIGNMENT] = { 0 };
+		for (size_t i = 0; i < sections.size(); i++)
+		{
+			file.write(padding, table[i].offset - (uint64_t)file.tellp());
+			file.write((const char*)sections[i].bytes.data(), sections[i].bytes.size());
+		}
+
+		if (!file)
+		{
+			std::cout << "ERROR: Could not write " << filename << std::endl;
+			return(false);
+		}
+		std::cout << "INFO: Wrote " << filename << ", " << header.fileSize << " bytes" << std::endl;
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function reads the scene file and writes the pack.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		std::cout << "usage: AssetBaker <scene file> <pack file>" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	SceneFile sceneFile(argv[1]);
+	if (!sceneFile.Load())
+	{
+		return(EXIT_FAILURE);
+	}
+	const SceneFile::SCENE_DESCRIPTION& scene = sceneFile.GetLoaded();
+	std::vector<PENDING_SECTION> sections;
+
+	// the shapes, in MESH_TYPE order, then the imported meshes
+	// in the order the file lists them
+	MeshPool meshPool;
+	meshPool.LoadBuiltinMeshes();
+	for (const SceneFile::MESH_ENTRY& entry : scene.meshes)
+	{
+		std::vector<MeshPool::MESH_VERTEX> vertices;
+		std::vector<GLuint> indices;
+		MeshImporter importer;
+		if (!importer.Import(entry.filename, vertices, indices))
+		{
+			return(EXIT_FAILURE);
+		}
+		meshPool.AddMesh(vertices, indices);
+	}
+	std::vector<MeshPool::MESH_RANGE> meshes;
+	for (int i = 0; i < meshPool.GetMeshCount(); i++)
+	{
+		meshes.push_back(meshPool.GetMesh(i));
+	}
+	AddSection(sections, AssetPack::SECTION_VERTICES, meshPool.GetVertexData(), meshPool.GetVertexCount());
+	AddSection(sections, AssetPack::SECTION_INDICES, meshPool.GetIndexData(), meshPool.GetIndexCount());
+	AddSection(sections, AssetPack::SECTION_MESHES, meshes.data(), meshes.size());
+
+	// textures, with their levels gathered into one section
+	std::vector<AssetPack::PACK_TEXTURE> textures;
+	std::vector<unsigned char> textureData;
+	for (const SceneFile::TEXTURE_ENTRY& entry : scene.textures)
+	{
+		AssetPack::PACK_TEXTURE texture;
+		memset(&texture, 0, sizeof(texture));
+		if (!BakeTexture(entry, texture, textureData))
+		{
+			return(EXIT_FAILURE);
+		}
+		textures.push_back(texture);
+	}
+	AddSection(sections, AssetPack::SECTION_TEXTURES, textures.data(), textures.size());
+	AddSection(sections, AssetPack::SECTION_TEXTURE_DATA, textureData.data(), textureData.size());
+
+	std::vector<AssetPack::PACK_MATERIAL> materials;
+	for (const SceneManager::OBJECT_MATERIAL& entry : scene.materials)
+	{
+		AssetPack::PACK_MATERIAL material;
+		memset(&material, 0, sizeof(material));
+		if (!CopyName(material.tag, entry.tag))
+		{
+			return(EXIT_FAILURE);
+		}
+		CopyVec3(material.ambientColor, entry.ambientColor);
+		material.ambientStrength = entry.ambientStrength;
+		CopyVec3(material.diffuseColor, entry.diffuseColor);
+		material.shininess = entry.shininess;
+		CopyVec3(material.specularColor, entry.specularColor);
+		materials.push_back(material);
+	}
+	AddSection(sections, AssetPack::SECTION_MATERIALS, materials.data(), materials.size());
+
+	std::vector<AssetPack::PACK_LIGHT> lights;
+	for (const SceneManager::LIGHT_SOURCE& entry : scene.lights)
+	{
+		AssetPack::PACK_LIGHT light;
+		memset(&light, 0, sizeof(light));
+		CopyVec3(light.position, entry.position);
+		light.focalStrength = entry.focalStrength;
+		CopyVec3(light.direction, entry.direction);
+		light.specularIntensity = entry.specularIntensity;
+		CopyVec3(light.ambientColor, entry.ambientColor);
+		CopyVec3(light.diffuseColor, entry.diffuseColor);
+		CopyVec3(light.specularColor, entry.specularColor);
+		lights.push_back(light);
+	}
+	AddSection(sections, AssetPack::SECTION_LIGHTS, lights.data(), lights.size());
+
+	// objects refer to textures and materials by index, so the
+	// program never has to look a tag up
+	std::vector<AssetPack::PACK_OBJECT> objects;
+	for (const SceneFile::OBJECT_ENTRY& entry : scene.objects)
+	{
+		AssetPack::PACK_OBJECT object;
+		memset(&object, 0, sizeof(object));
+		if (!CopyName(object.name, entry.name))
+		{
+			return(EXIT_FAILURE);
+		}
+		object.mesh = entry.mesh;
+		for (size_t i = 0; i < scene.meshes.size(); i++)
+		{
+			if (scene.meshes[i].name == entry.meshName)
+				object.mesh = MESH_BUILTIN_COUNT + (uint32_t)i;
+		}
+		object.textureIndex = -1;
+		for (size_t i = 0; i < scene.textures.size(); i++)
+		{
+			if (scene.textures[i].tag == entry.textureTag)
+				object.textureIndex = (int32_t)i;
+		}
+		object.materialIndex = -1;
+		for (size_t i = 0; i < scene.materials.size(); i++)
+		{
+			if ((object.materialIndex < 0) && (scene.materials[i].tag == entry.materialTag))
+				object.materialIndex = (int32_t)i;
+		}
+		if (entry.bUseColor)
+			object.flags |= ObjectStore::OBJECT_USE_COLOR;
+		if (entry.bTransparent || (entry.bUseColor && (entry.color.a < 1.0f)))
+			object.flags |= ObjectStore::OBJECT_TRANSPARENT;
+		if (entry.bEmissive)
+			object.flags |= ObjectStore::OBJECT_EMISSIVE;
+		CopyVec3(object.scaleXYZ, entry.scaleXYZ);
+		CopyVec3(object.rotationXYZ, entry.rotationXYZ);
+		CopyVec3(object.positionXYZ, entry.positionXYZ);
+		object.color[0] = entry.color.r;
+		object.color[1] = entry.color.g;
+		object.color[2] = entry.color.b;
+		object.color[3] = entry.color.a;
+		objects.push_back(object);
+	}
+	AddSection(sections, AssetPack::SECTION_OBJECTS, objects.data(), objects.size());
+
+	AssetPack::PACK_SCENE packScene;
+	memset(&packScene, 0, sizeof(packScene));
+	CopyVec3(packScene.globalAmbientLight, scene.globalAmbientLight);
+	AddSection(sections, AssetPack::SECTION_SCENE, &packScene, 1);
+
+	return(WritePack(argv[2], sections) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
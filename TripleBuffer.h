@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// hand the latest value from one thread to another without locking
+//
+//  The writer fills its own slot and swaps it with the shared middle
+//  slot, and the reader swaps the middle slot with its own whenever a
+//  fresh value is waiting.  Neither side ever waits on the other, and
+//  the reader always sees the most recently published value.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  A single producer, single consumer mailbox that always
+ *  holds the newest value.  Older values that the reader
+ *  never picked up are overwritten.
+ ***********************************************************/
+template <typename T>
+class TripleBuffer
+{
+public:
+	// constructor
+	TripleBuffer()
+	{
+		m_writeIndex = 0;
+		m_middle = 1;
+		m_readIndex = 2;
+	}
+
+	// slot owned by the writer, fill it then call Publish()
+	T& GetWriteBuffer() { return m_buffers[m_writeIndex]; }
+
+	// make the write slot the newest value and take the old
+	// middle slot for the next write
+	void Publish()
+	{
+		unsigned int previous = m_middle.exchange(m_writeIndex | FRESH_BIT, std::memory_order_acq_rel);
+		m_writeIndex = previous & INDEX_MASK;
+	}
+
+	// take the newest value if one was published since the last
+	// call, returns false when the read slot is still current
+	bool Update()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+		{
+			return(false);
+		}
+		unsigned int previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+		m_readIndex = previous & INDEX_MASK;
+		return(true);
+	}
+
+	// slot owned by the reader
+	const T& GetReadBuffer() const { return m_buffers[m_readIndex]; }
+
+private:
+	// the middle slot index carries a flag marking whether the
+	// reader has already taken it
+	static const unsigned int INDEX_MASK = 3;
+	static const unsigned int FRESH_BIT = 4;
+
+	T m_buffers[3];
+	unsigned int m_writeIndex;
+	std::atomic<unsigned int> m_middle;
+	unsigned int m_readIndex;
+};
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcounter.cpp
+// ============
+// set shader uniforms and count each one set
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformCounter.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+/***********************************************************
+ *  UniformCounter()
+ *
+ *  The constructor keeps the shader manager and the count
+ *  that the uniforms are added to.
+ ***********************************************************/
+UniformCounter::UniformCounter(ShaderManager* pShaderManager, int& uploadCount)
+{
+	m_pShaderManager = pShaderManager;
+	m_pUploadCount = &uploadCount;
+}
+
+/***********************************************************
+ *  setIntValue()
+ *
+ *  This method sets an integer uniform of the shader
+ *  manager's program.
+ ***********************************************************/
+void UniformCounter::setIntValue(const std::string& name, int value)
+{
+	m_pShaderManager->setIntValue(name, value);
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  setSampler2DValue()
+ *
+ *  This method points a sampler of the shader manager's
+ *  program at a texture unit.
+ ***********************************************************/
+void UniformCounter::setSampler2DValue(const std::string& name, int value)
+{
+	m_pShaderManager->setSampler2DValue(name, value);
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  setFloatValue()
+ *
+ *  This method sets a float uniform of the shader manager's
+ *  program.
+ ***********************************************************/
+void UniformCounter::setFloatValue(const std::string& name, float value)
+{
+	m_pShaderManager->setFloatValue(name, value);
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  setVec3Value()
+ *
+ *  This method sets a vec3 uniform of the shader manager's
+ *  program.
+ ***********************************************************/
+void UniformCounter::setVec3Value(const std::string& name, const glm::vec3& value)
+{
+	m_pShaderManager->setVec3Value(name, value);
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  setVec4Value()
+ *
+ *  This method sets a vec4 uniform of the shader manager's
+ *  program.
+ ***********************************************************/
+void UniformCounter::setVec4Value(const std::string& name, const glm::vec4& value)
+{
+	m_pShaderManager->setVec4Value(name, value);
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  setMat4Value()
+ *
+ *  This method sets a mat4 uniform of the shader manager's
+ *  program.
+ ***********************************************************/
+void UniformCounter::setMat4Value(const std::string& name, const glm::mat4& value)
+{
+	m_pShaderManager->setMat4Value(name, value);
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  Uniform1i()
+ *
+ *  This method sets an integer or sampler uniform of the
+ *  program in use.
+ ***********************************************************/
+void UniformCounter::Uniform1i(GLint location, GLint value)
+{
+	glUniform1i(location, value);
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  Uniform1ui()
+ *
+ *  This method sets an unsigned integer uniform of the
+ *  program in use.
+ ***********************************************************/
+void UniformCounter::Uniform1ui(GLint location, GLuint value)
+{
+	glUniform1ui(location, value);
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  Uniform1f()
+ *
+ *  This method sets a float uniform of the program in use.
+ ***********************************************************/
+void UniformCounter::Uniform1f(GLint location, GLfloat value)
+{
+	glUniform1f(location, value);
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  Uniform3fv()
+ *
+ *  This method sets a vec3 uniform of the program in use.
+ ***********************************************************/
+void UniformCounter::Uniform3fv(GLint location, const glm::vec3& value)
+{
+	glUniform3fv(location, 1, glm::value_ptr(value));
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  Uniform4fv()
+ *
+ *  This method sets a vec4 array uniform of the program in
+ *  use, which is one upload however long the array is.
+ ***********************************************************/
+void UniformCounter::Uniform4fv(GLint location, GLsizei count, const glm::vec4* values)
+{
+	glUniform4fv(location, count, glm::value_ptr(values[0]));
+	(*m_pUploadCount)++;
+}
+
+/***********************************************************
+ *  UniformMatrix4fv()
+ *
+ *  This method sets a mat4 uniform of the program in use.
+ ***********************************************************/
+void UniformCounter::UniformMatrix4fv(GLint location, const glm::mat4& value)
+{
+	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	(*m_pUploadCount)++;
+}
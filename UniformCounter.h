@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcounter.h
+// ============
+// set shader uniforms and count each one set
+//
+//  The frame statistics report how many uniforms a frame set.  Every
+//  per-frame uniform goes through this class, so the count is taken
+//  where the upload happens instead of being tallied by hand beside it.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+
+/***********************************************************
+ *  UniformCounter
+ *
+ *  This class forwards to the shader manager's setters, or
+ *  to the OpenGL uniform calls for a program the manager
+ *  does not own, and adds one to the given count for each
+ *  uniform set.
+ ***********************************************************/
+class UniformCounter
+{
+public:
+	// the shader manager may be NULL when only the location
+	// based calls are used
+	UniformCounter(ShaderManager* pShaderManager, int& uploadCount);
+
+	// the uniforms of the shader manager's program
+	void setIntValue(const std::string& name, int value);
+	void setSampler2DValue(const std::string& name, int value);
+	void setFloatValue(const std::string& name, float value);
+	void setVec3Value(const std::string& name, const glm::vec3& value);
+	void setVec4Value(const std::string& name, const glm::vec4& value);
+	void setMat4Value(const std::string& name, const glm::mat4& value);
+
+	// the uniforms of the program currently in use
+	void Uniform1i(GLint location, GLint value);
+	void Uniform1ui(GLint location, GLuint value);
+	void Uniform1f(GLint location, GLfloat value);
+	void Uniform3fv(GLint location, const glm::vec3& value);
+	void Uniform4fv(GLint location, GLsizei count, const glm::vec4* values);
+	void UniformMatrix4fv(GLint location, const glm::mat4& value);
+
+private:
+	ShaderManager* m_pShaderManager;
+	int* m_pUploadCount;
+};
@@ -14,6 +14,10 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
 // declaration of the global variables and defines
 namespace
 {
@@ -23,8 +27,26 @@ namespace
 	const char* g_ViewName = "view";
 	const char* g_ProjectionName = "projection";
 
+	// half the height of the scene an orthographic view shows
+	const float g_OrthoHalfHeight = 10.0f;
+	// share of the window width the camera view keeps when the
+	// orthographic views are drawn beside it
+	const float g_CameraPaneWidth = 2.0f / 3.0f;
+	// the orthographic views center on the point this far in
+	// front of the camera, seen from this far away
+	const float g_OrthoFocusDistance = 12.0f;
+	const float g_OrthoEyeDistance = 50.0f;
+
+	// current framebuffer size, which follows window resizes
+	int gFramebufferWidth = WINDOW_WIDTH;
+	int gFramebufferHeight = WINDOW_HEIGHT;
+	// set by a resize, since the window size is not part of the
+	// camera matrices when the aspect ratio stays the same
+	bool gWindowChanged = true;
+
 	// camera object used for viewing and interacting with
-	// the 3D scene
+	// the 3D scene, only touched by the simulation thread once
+	// the window is open
 	Camera* g_pCamera = nullptr;
 
 	// these variables are used for mouse movement processing
@@ -32,13 +54,163 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f;
-	float gLastFrame = 0.0f;
+	// input gathered by the GLFW callbacks on the main thread and
+	// consumed by the simulation thread - mouse and scroll motion
+	// is summed so any number of raw events costs one camera update
+	std::atomic<float> gMouseDeltaX(0.0f);
+	std::atomic<float> gMouseDeltaY(0.0f);
+	std::atomic<float> gScrollDelta(0.0f);
+	// one bit per movement key that is held down
+	std::atomic<unsigned int> gHeldKeys(0);
+	// single presses waiting to be handled
+	std::atomic<int> gResetRequests(0);
+	std::atomic<int> gProjectionToggles(0);
+	// wakes the simulation thread while it waits out idle input
+	std::mutex gInputMutex;
+	std::condition_variable gInputSignal;
+	// cursor position of a click waiting to be picked, in window
+	// coordinates; set and taken on the main thread
+	bool gPickPending = false;
+	double gPickX = 0.0;
+	double gPickY = 0.0;
+	// whether the performance overlay is shown, toggled with H on
+	// the main thread
+	bool gHudVisible = false;
+	// the N key asked for the next scene, set and taken on the
+	// main thread
+	bool gSceneSwitchPending = false;
+
+	// movement keys in the order of their bits in gHeldKeys
+	const int g_MovementKeys[] = {
+		GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E };
+	enum MOVEMENT_BIT
+	{
+		MOVE_FORWARD = 0,
+		MOVE_BACKWARD,
+		MOVE_LEFT,
+		MOVE_RIGHT,
+		MOVE_UP,
+		MOVE_DOWN
+	};
+
+	// the camera is simulated at a fixed rate regardless of how
+	// fast frames are drawn
+	const float g_SimulationStep = 1.0f / 120.0f;
+	// steps run at most per wake-up, so a stalled thread does not
+	// try to catch up on seconds of simulation at once
+	const int g_MaxStepsPerWake = 5;
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	/***********************************************************
+	 *  AtomicAdd()
+	 *
+	 *  Add to an atomic float without taking a lock.
+	 ***********************************************************/
+	void AtomicAdd(std::atomic<float>& target, float value)
+	{
+		float current = target.load(std::memory_order_relaxed);
+		while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	/***********************************************************
+	 *  HasPendingInput()
+	 *
+	 *  Whether the next step would have anything to apply.
+	 ***********************************************************/
+	bool HasPendingInput()
+	{
+		return((gHeldKeys != 0) || (gResetRequests != 0) || (gProjectionToggles != 0) ||
+			(gMouseDeltaX != 0.0f) || (gMouseDeltaY != 0.0f) || (gScrollDelta != 0.0f));
+	}
+
+	/***********************************************************
+	 *  SignalInput()
+	 *
+	 *  Wake the simulation thread after new input is queued;
+	 *  the lock keeps the wake-up from slipping in between its
+	 *  check and its wait.
+	 ***********************************************************/
+	void SignalInput()
+	{
+		{
+			std::lock_guard<std::mutex> lock(gInputMutex);
+		}
+		gInputSignal.notify_one();
+	}
+
+	/***********************************************************
+	 *  TakeTickInput()
+	 *
+	 *  Take the live input gathered since the previous step.
+	 ***********************************************************/
+	InputRecorder::TICK_INPUT TakeTickInput()
+	{
+		InputRecorder::TICK_INPUT input;
+		input.bResetCamera = gResetRequests.exchange(0) > 0;
+		input.bToggleProjection = gProjectionToggles.exchange(0) % 2 != 0;
+		// all mouse motion since the last step as one movement
+		input.mouseDeltaX = gMouseDeltaX.exchange(0.0f);
+		input.mouseDeltaY = gMouseDeltaY.exchange(0.0f);
+		input.scrollDelta = gScrollDelta.exchange(0.0f);
+		input.heldKeys = gHeldKeys;
+		return(input);
+	}
+
+	/***********************************************************
+	 *  ApplyTickInput()
+	 *
+	 *  Move the camera by the input of one simulation step.
+	 ***********************************************************/
+	void ApplyTickInput(const InputRecorder::TICK_INPUT& input, float deltaTime)
+	{
+		if (input.bResetCamera)
+		{
+			// Reset the camera position
+			g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
+			g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
+			g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+			std::cout << "Camera reset to default position." << std::endl;
+		}
+
+		// Toggle perspective/orthographic mode once per key press
+		if (input.bToggleProjection)
+		{
+			bOrthographicProjection = !bOrthographicProjection;
+			std::cout << "Projection Mode: " << (bOrthographicProjection ? "Orthographic" : "Perspective") << std::endl;
+		}
+
+		if ((input.mouseDeltaX != 0.0f) || (input.mouseDeltaY != 0.0f))
+		{
+			g_pCamera->ProcessMouseMovement(input.mouseDeltaX, input.mouseDeltaY);
+		}
+		if (input.scrollDelta != 0.0f)
+		{
+			g_pCamera->ProcessMouseScroll(input.scrollDelta);
+		}
+
+		// Movement speed multiplier
+		float cameraSpeed = deltaTime * 5.0f;
+
+		// Movement Controls
+		unsigned int heldKeys = input.heldKeys;
+		if (heldKeys & (1u << MOVE_FORWARD))
+			g_pCamera->ProcessKeyboard(FORWARD, cameraSpeed);
+		if (heldKeys & (1u << MOVE_BACKWARD))
+			g_pCamera->ProcessKeyboard(BACKWARD, cameraSpeed);
+		if (heldKeys & (1u << MOVE_LEFT))
+			g_pCamera->ProcessKeyboard(LEFT, cameraSpeed);
+		if (heldKeys & (1u << MOVE_RIGHT))
+			g_pCamera->ProcessKeyboard(RIGHT, cameraSpeed);
+		if (heldKeys & (1u << MOVE_UP))
+			g_pCamera->Position.y += cameraSpeed;
+		if (heldKeys & (1u << MOVE_DOWN))
+			g_pCamera->Position.y -= cameraSpeed;
+	}
 }
 
 /***********************************************************
@@ -51,12 +223,24 @@ ViewManager::ViewManager(ShaderManager* pShaderManager)
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_bViewChanged = true;
+	m_bMultiView = false;
+	m_bSimulating = false;
+	m_lastFrameTime = 0.0;
+	m_frameDelta = 0.0f;
+	m_stepTime = 0.0f;
+	m_replayStartTime = 0.0;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
 	g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
+
+	// the render thread starts from the default camera
+	CAMERA_SNAPSHOT initial = CAMERA_SNAPSHOT();
+	PublishCameraSnapshot(initial);
+	m_cameraSnapshots.Update();
 }
 
 /***********************************************************
@@ -66,6 +250,14 @@ ViewManager::ViewManager(ShaderManager* pShaderManager)
  ***********************************************************/
 ViewManager::~ViewManager()
 {
+	// stop the simulation before the camera goes away
+	if (m_bSimulating)
+	{
+		m_bSimulating = false;
+		SignalInput();
+		m_simulationThread.join();
+	}
+
 	// free up allocated memory
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
@@ -85,8 +277,25 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 {
 	GLFWwindow* window = nullptr;
 
+#ifdef __APPLE__
 	// try to create the displayed OpenGL window
 	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, windowTitle, NULL, NULL);
+#else
+	// try to create the displayed OpenGL window, stepping down the
+	// requested core version when the driver cannot provide it -
+	// Mesa's software rasterizer stops short of OpenGL 4.6
+	const int contextVersions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 3 }, { 3, 3 } };
+	for (const auto& version : contextVersions)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+		window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, windowTitle, NULL, NULL);
+		if (window != NULL)
+		{
+			break;
+		}
+	}
+#endif
 	if (window == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
@@ -100,13 +309,30 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 
 	// set up GLFW callbacks
 	glfwSetCursorPosCallback(window, ViewManager::Mouse_Position_Callback);
+	glfwSetMouseButtonCallback(window, ViewManager::Mouse_Button_Callback);
 	glfwSetScrollCallback(window, ViewManager::Mouse_Scroll_Callback);
+	glfwSetFramebufferSizeCallback(window, ViewManager::Framebuffer_Size_Callback);
+	glfwSetKeyCallback(window, ViewManager::Key_Callback);
 
-	// enable blending for supporting transparent rendering
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// the framebuffer can differ from the window size on high-DPI displays
+	glfwGetFramebufferSize(window, &gFramebufferWidth, &gFramebufferHeight);
 
 	m_pWindow = window;
+	m_lastFrameTime = glfwGetTime();
+
+	// a replay is profiled as fast as it can draw
+	if (m_inputRecorder.IsReplaying())
+	{
+		glfwSwapInterval(0);
+	}
+
+	// from here on the camera is owned by the simulation thread,
+	// unless recorded input steps it on the render loop
+	if (!m_inputRecorder.IsRecording() && !m_inputRecorder.IsReplaying())
+	{
+		m_bSimulating = true;
+		m_simulationThread = std::thread(&ViewManager::SimulationLoop, this);
+	}
 
 	return(window);
 }
@@ -137,8 +363,26 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	// queue the offsets for the next simulation step
+	AtomicAdd(gMouseDeltaX, xOffset);
+	AtomicAdd(gMouseDeltaY, yOffset);
+	SignalInput();
+}
+
+/***********************************************************
+ *  Mouse_Button_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  a mouse button is pressed or released in the display
+ *  window.
+ ***********************************************************/
+void ViewManager::Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods)
+{
+	if ((button == GLFW_MOUSE_BUTTON_LEFT) && (action == GLFW_PRESS))
+	{
+		glfwGetCursorPos(window, &gPickX, &gPickY);
+		gPickPending = true;
+	}
 }
 
 /***********************************************************
@@ -149,64 +393,382 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
  ***********************************************************/
 void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset)
 {
-	if (g_pCamera)
+	// queue the offset for the next simulation step
+	AtomicAdd(gScrollDelta, (float)yOffset);
+	SignalInput();
+}
+
+/***********************************************************
+ *  Key_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  a key is pressed or released in the display window.
+ ***********************************************************/
+void ViewManager::Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	// key repeats change nothing that is not already tracked
+	if (action == GLFW_REPEAT)
+	{
+		return;
+	}
+
+	// Close window if ESC is pressed
+	if ((key == GLFW_KEY_ESCAPE) && (action == GLFW_PRESS))
+	{
+		glfwSetWindowShouldClose(window, true);
+	}
+
+	if (action == GLFW_PRESS)
+	{
+		if (key == GLFW_KEY_O)
+			gResetRequests++;
+		if (key == GLFW_KEY_P)
+			gProjectionToggles++;
+		if (key == GLFW_KEY_H)
+		{
+			gHudVisible = !gHudVisible;
+			std::cout << "Performance HUD: " << (gHudVisible ? "On" : "Off") << std::endl;
+		}
+		if (key == GLFW_KEY_N)
+			gSceneSwitchPending = true;
+	}
+
+	for (int i = 0; i < (int)(sizeof(g_MovementKeys) / sizeof(g_MovementKeys[0])); i++)
+	{
+		if (key == g_MovementKeys[i])
+		{
+			if (action == GLFW_PRESS)
+				gHeldKeys |= (1u << i);
+			else
+				gHeldKeys &= ~(1u << i);
+		}
+	}
+
+	if (action == GLFW_PRESS)
 	{
-		g_pCamera->ProcessMouseScroll((float)yOffset);
+		SignalInput();
 	}
 }
 
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the display window's framebuffer is resized.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
+	gWindowChanged = true;
+}
+
+/***********************************************************
+ *  GetFramebufferWidth()
+ *
+ *  This method returns the framebuffer width in pixels.
+ ***********************************************************/
+int ViewManager::GetFramebufferWidth() const
+{
+	return(gFramebufferWidth);
+}
+
+/***********************************************************
+ *  GetFramebufferHeight()
+ *
+ *  This method returns the framebuffer height in pixels.
+ ***********************************************************/
+int ViewManager::GetFramebufferHeight() const
+{
+	return(gFramebufferHeight);
+}
+
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  This method is called by the simulation thread to apply
+ *  the input gathered since the previous step.
+ ***********************************************************/
+void ViewManager::ProcessKeyboardEvents(float deltaTime)
+{
+	// If camera object is NULL, exit early
+	if (NULL == g_pCamera)
+	{
+		return;
+	}
+
+	ApplyTickInput(TakeTickInput(), deltaTime);
+}
+
+/***********************************************************
+ *  RecordInput()
+ *
+ *  This method starts recording the camera input.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+bool ViewManager::RecordInput(const char* path)
 {
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+	if (NULL != m_pWindow)
 	{
-		// Reset the camera position
-		g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
-		g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
-		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
-		std::cout << "Camera reset to default position." << std::endl;
+		return(false);
 	}
-	
-	// Toggle perspective/orthographic mode
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+	return(m_inputRecorder.StartRecording(path, g_SimulationStep));
+}
+
+/***********************************************************
+ *  ReplayInput()
+ *
+ *  This method loads recorded camera input to replay in
+ *  place of the live input.
+ ***********************************************************/
+bool ViewManager::ReplayInput(const char* path)
+{
+	if (NULL != m_pWindow)
 	{
-		bOrthographicProjection = !bOrthographicProjection;
-		std::cout << "Projection Mode: " << (bOrthographicProjection ? "Orthographic" : "Perspective") << std::endl;
+		return(false);
 	}
+	return(m_inputRecorder.StartReplay(path, g_SimulationStep));
+}
 
-	// Close window if ESC is pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+/***********************************************************
+ *  StepRecordedInput()
+ *
+ *  This method runs the frame's simulation steps on the
+ *  render loop.  A recording steps the live input by the
+ *  time since the last frame, as the simulation thread
+ *  would, and stores what each step applied; a replay runs
+ *  the stored steps instead and closes the window after
+ *  the last recorded frame.
+ ***********************************************************/
+void ViewManager::StepRecordedInput()
+{
+	if (m_inputRecorder.IsReplaying())
 	{
-		glfwSetWindowShouldClose(m_pWindow, true);
+		if (m_inputRecorder.GetFrameCount() == 0)
+		{
+			m_replayStartTime = glfwGetTime();
+		}
+
+		float frameDelta = 0.0f;
+		if (!m_inputRecorder.ReadFrame(frameDelta, m_frameTicks))
+		{
+			int frameCount = m_inputRecorder.GetFrameCount();
+			double seconds = glfwGetTime() - m_replayStartTime;
+			std::cout << "INFO: Input replay finished, " << frameCount << " frames in " << seconds << "s";
+			if (frameCount > 0)
+			{
+				std::cout << " (" << seconds * 1000.0 / frameCount << " ms per frame)";
+			}
+			std::cout << std::endl;
+			m_inputRecorder.Stop();
+			m_frameDelta = 0.0f;
+			glfwSetWindowShouldClose(m_pWindow, true);
+			return;
+		}
+		m_frameDelta = frameDelta;
+		for (const InputRecorder::TICK_INPUT& tick : m_frameTicks)
+		{
+			ApplyTickInput(tick, g_SimulationStep);
+		}
+	}
+	else
+	{
+		m_frameTicks.clear();
+		m_stepTime += m_frameDelta;
+		while ((m_stepTime >= g_SimulationStep) && ((int)m_frameTicks.size() < g_MaxStepsPerWake))
+		{
+			m_frameTicks.push_back(TakeTickInput());
+			ApplyTickInput(m_frameTicks.back(), g_SimulationStep);
+			m_stepTime -= g_SimulationStep;
+		}
+		// drop the backlog after a stall instead of replaying it
+		if ((int)m_frameTicks.size() == g_MaxStepsPerWake)
+		{
+			m_stepTime = 0.0f;
+		}
+		m_inputRecorder.RecordFrame(m_frameDelta, m_frameTicks);
 	}
 
-	// If camera object is NULL, exit early
-	if (NULL == g_pCamera)
+	// this thread publishes and reads, so the read buffer holds
+	// the last published state
+	CAMERA_SNAPSHOT lastPublished = m_cameraSnapshots.GetReadBuffer();
+	PublishCameraSnapshot(lastPublished);
+}
+
+/***********************************************************
+ *  SimulationLoop()
+ *
+ *  The simulation thread steps the camera at a fixed rate
+ *  and publishes a snapshot whenever it changes.  With no
+ *  key held and nothing queued it sleeps until the input
+ *  callbacks wake it.
+ ***********************************************************/
+void ViewManager::SimulationLoop()
+{
+	typedef std::chrono::steady_clock Clock;
+	const Clock::duration step = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<float>(g_SimulationStep));
+
+	CAMERA_SNAPSHOT lastPublished = m_cameraSnapshots.GetReadBuffer();
+	Clock::time_point nextStep = Clock::now();
+	while (m_bSimulating)
+	{
+		int steps = 0;
+		while ((Clock::now() >= nextStep) && (steps < g_MaxStepsPerWake))
+		{
+			ProcessKeyboardEvents(g_SimulationStep);
+			nextStep += step;
+			steps++;
+		}
+		// drop the backlog after a stall instead of replaying it
+		if (steps == g_MaxStepsPerWake)
+		{
+			nextStep = Clock::now() + step;
+		}
+
+		PublishCameraSnapshot(lastPublished);
+
+		if (!HasPendingInput())
+		{
+			std::unique_lock<std::mutex> lock(gInputMutex);
+			gInputSignal.wait(lock, [this]() { return(!m_bSimulating || HasPendingInput()); });
+			// the idle time is not simulated
+			nextStep = Clock::now();
+			continue;
+		}
+		std::this_thread::sleep_until(nextStep);
+	}
+}
+
+/***********************************************************
+ *  PublishCameraSnapshot()
+ *
+ *  This method hands the camera state to the render thread
+ *  when it differs from the last published state, and wakes
+ *  the render loop if it is waiting for events.
+ ***********************************************************/
+void ViewManager::PublishCameraSnapshot(CAMERA_SNAPSHOT& lastPublished)
+{
+	CAMERA_SNAPSHOT& snapshot = m_cameraSnapshots.GetWriteBuffer();
+	snapshot.view = g_pCamera->GetViewMatrix();
+	snapshot.position = g_pCamera->Position;
+	snapshot.zoom = g_pCamera->Zoom;
+	snapshot.bOrthographic = bOrthographicProjection;
+
+	bool bChanged = (snapshot.view != lastPublished.view) ||
+		(snapshot.zoom != lastPublished.zoom) ||
+		(snapshot.bOrthographic != lastPublished.bOrthographic);
+	if (!bChanged)
 	{
 		return;
 	}
 
-	// Movement speed multiplier
-	float cameraSpeed = gDeltaTime * 5.0f;
+	lastPublished = snapshot;
+	m_cameraSnapshots.Publish();
+	if (m_bSimulating)
+	{
+		glfwPostEmptyEvent();
+	}
+}
+
+/***********************************************************
+ *  GetViewPosition()
+ *
+ *  This method returns the current camera position.
+ ***********************************************************/
+glm::vec3 ViewManager::GetViewPosition() const
+{
+	return(m_cameraSnapshots.GetReadBuffer().position);
+}
+
+/***********************************************************
+ *  TakePickRay()
+ *
+ *  This method unprojects the clicked cursor position onto
+ *  the near and far planes, which gives the ray for either
+ *  projection mode.
+ ***********************************************************/
+bool ViewManager::TakePickRay(glm::vec3& origin, glm::vec3& direction)
+{
+	if (!gPickPending || (NULL == m_pWindow))
+	{
+		return(false);
+	}
+	gPickPending = false;
+
+	// the cursor is in window coordinates, which can differ from
+	// the framebuffer on high-DPI displays
+	int windowWidth = 0;
+	int windowHeight = 0;
+	glfwGetWindowSize(m_pWindow, &windowWidth, &windowHeight);
+	if ((windowWidth <= 0) || (windowHeight <= 0))
+	{
+		return(false);
+	}
+
+	// the click picks in whichever view it landed in
+	float windowX = (float)(gPickX / windowWidth);
+	float windowY = (float)(1.0 - gPickY / windowHeight);
+	const VIEW_PANE* pPane = NULL;
+	for (const VIEW_PANE& pane : m_viewPanes)
+	{
+		const glm::vec4& rect = pane.viewportRect;
+		if ((windowX >= rect.x) && (windowX < rect.x + rect.z) &&
+			(windowY >= rect.y) && (windowY < rect.y + rect.w))
+		{
+			pPane = &pane;
+			break;
+		}
+	}
+	if (NULL == pPane)
+	{
+		return(false);
+	}
+
+	float x = 2.0f * (windowX - pPane->viewportRect.x) / pPane->viewportRect.z - 1.0f;
+	float y = 2.0f * (windowY - pPane->viewportRect.y) / pPane->viewportRect.w - 1.0f;
+	glm::mat4 toWorld = glm::inverse(pPane->projection * pPane->view);
+	glm::vec4 nearPoint = toWorld * glm::vec4(x, y, -1.0f, 1.0f);
+	glm::vec4 farPoint = toWorld * glm::vec4(x, y, 1.0f, 1.0f);
+
+	origin = glm::vec3(nearPoint) / nearPoint.w;
+	direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+	return(true);
+}
+
+/***********************************************************
+ *  IsHudVisible()
+ *
+ *  This method returns whether the performance overlay is
+ *  toggled on.
+ ***********************************************************/
+bool ViewManager::IsHudVisible() const
+{
+	return(gHudVisible);
+}
+
+/***********************************************************
+ *  TakeSceneSwitch()
+ *
+ *  This method returns whether N was pressed since the last
+ *  call.
+ ***********************************************************/
+bool ViewManager::TakeSceneSwitch()
+{
+	bool bPending = gSceneSwitchPending;
+	gSceneSwitchPending = false;
+	return(bPending);
+}
 
-	// Movement Controls
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
-		g_pCamera->ProcessKeyboard(FORWARD, cameraSpeed);
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
-		g_pCamera->ProcessKeyboard(BACKWARD, cameraSpeed);
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
-		g_pCamera->ProcessKeyboard(LEFT, cameraSpeed);
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
-		g_pCamera->ProcessKeyboard(RIGHT, cameraSpeed);
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
-		g_pCamera->Position.y += cameraSpeed;
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
-		g_pCamera->Position.y -= cameraSpeed;
+/***********************************************************
+ *  EnableMultiView()
+ *
+ *  This method turns the top and front orthographic views
+ *  beside the camera view on or off.
+ ***********************************************************/
+void ViewManager::EnableMultiView(bool bEnable)
+{
+	m_bMultiView = bEnable;
+	m_bViewChanged = true;
 }
 
 /***********************************************************
@@ -219,29 +781,89 @@ void ViewManager::PrepareSceneView()
 	glm::mat4 view;
 	glm::mat4 projection;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	double frameTime = glfwGetTime();
+	m_frameDelta = (float)(frameTime - m_lastFrameTime);
+	m_lastFrameTime = frameTime;
+	if (m_inputRecorder.IsRecording() || m_inputRecorder.IsReplaying())
+	{
+		StepRecordedInput();
+	}
 
-	// process any keyboard events
-	ProcessKeyboardEvents();
+	// pick up the newest camera state from the simulation thread
+	m_cameraSnapshots.Update();
+	const CAMERA_SNAPSHOT& camera = m_cameraSnapshots.GetReadBuffer();
 
 	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	view = camera.view;
+
+	// follow the window's shape, guarding against a minimized window
+	GLfloat aspectRatio = (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT;
+	if ((gFramebufferWidth > 0) && (gFramebufferHeight > 0))
+	{
+		aspectRatio = (GLfloat)gFramebufferWidth / (GLfloat)gFramebufferHeight;
+	}
+
+	// the camera view gives up part of the window to the others
+	GLfloat fullAspectRatio = aspectRatio;
+	if (m_bMultiView)
+	{
+		aspectRatio *= g_CameraPaneWidth;
+	}
 
 	// define the current projection matrix
-	if (bOrthographicProjection)
+	if (camera.bOrthographic)
 	{
-		float orthoSize = 10.0f;
-		projection = glm::ortho(-orthoSize, orthoSize, -orthoSize, orthoSize, 0.1f, 100.0f);
+		projection = glm::ortho(-g_OrthoHalfHeight * aspectRatio, g_OrthoHalfHeight * aspectRatio,
+			-g_OrthoHalfHeight, g_OrthoHalfHeight, 0.1f, 100.0f);
 	}
 	else
 	{
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(camera.zoom), aspectRatio, 0.1f, 100.0f);
+	}
+
+	// the camera, zoom and projection mode all show up in the
+	// matrices, so comparing them catches every view change
+	m_bViewChanged = gWindowChanged ||
+		(view != m_viewMatrix) ||
+		(projection != m_projectionMatrix);
+	gWindowChanged = false;
+
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+
+	VIEW_PANE cameraPane;
+	cameraPane.view = view;
+	cameraPane.projection = projection;
+	cameraPane.position = camera.position;
+	cameraPane.viewportRect = glm::vec4(0.0f, 0.0f, m_bMultiView ? g_CameraPaneWidth : 1.0f, 1.0f);
+	m_viewPanes.assign(1, cameraPane);
+
+	// the top view above the front view, stacked to the right
+	if (m_bMultiView)
+	{
+		glm::vec3 front = -glm::vec3(view[0][2], view[1][2], view[2][2]);
+		glm::vec3 center = camera.position + front * g_OrthoFocusDistance;
+		float paneAspectRatio = fullAspectRatio * (1.0f - g_CameraPaneWidth) * 2.0f;
+		glm::mat4 paneProjection = glm::ortho(
+			-g_OrthoHalfHeight * paneAspectRatio, g_OrthoHalfHeight * paneAspectRatio,
+			-g_OrthoHalfHeight, g_OrthoHalfHeight, 0.1f, 2.0f * g_OrthoEyeDistance);
+
+		VIEW_PANE topPane;
+		topPane.position = center + glm::vec3(0.0f, g_OrthoEyeDistance, 0.0f);
+		topPane.view = glm::lookAt(topPane.position, center, glm::vec3(0.0f, 0.0f, -1.0f));
+		topPane.projection = paneProjection;
+		topPane.viewportRect = glm::vec4(g_CameraPaneWidth, 0.5f, 1.0f - g_CameraPaneWidth, 0.5f);
+		m_viewPanes.push_back(topPane);
+
+		VIEW_PANE frontPane;
+		frontPane.position = center + glm::vec3(0.0f, 0.0f, g_OrthoEyeDistance);
+		frontPane.view = glm::lookAt(frontPane.position, center, glm::vec3(0.0f, 1.0f, 0.0f));
+		frontPane.projection = paneProjection;
+		frontPane.viewportRect = glm::vec4(g_CameraPaneWidth, 0.0f, 1.0f - g_CameraPaneWidth, 0.5f);
+		m_viewPanes.push_back(frontPane);
 	}
 
 	m_pShaderManager->setMat4Value(g_ViewName, view);
 	m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-	m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+	m_pShaderManager->setVec3Value("viewPosition", camera.position);
 }
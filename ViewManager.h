@@ -11,6 +11,12 @@
 
 #include "ShaderManager.h"
 #include "camera.h"
+#include "TripleBuffer.h"
+#include "InputRecorder.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
 
 // GLFW library
 #include "GLFW/glfw3.h" 
@@ -24,25 +30,121 @@ public:
 	// destructor
 	~ViewManager();
 
+	// record the camera input to a file, or replay a recorded
+	// file instead of the live input; either one steps the camera
+	// on the render loop so each frame sees exactly the recorded
+	// steps, and must be chosen before the window is created
+	bool RecordInput(const char* path);
+	bool ReplayInput(const char* path);
+
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
 
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
 
-	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	// apply the input gathered since the last simulation step
+	// to the camera, called on the simulation thread
+	void ProcessKeyboardEvents(float deltaTime);
+
+	// key callback for keys held down and single key presses
+	static void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 	// mouse position callback for mouse interaction with the 3D scene
 	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
 
+	// mouse button callback, a left click asks for a pick ray
+	static void Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods);
+
 	// Mouse scroll callback to handle zooming and movement speed adjustment
 	static void Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset); 
 
+	// framebuffer size callback to follow window resizes
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+
+	// one view drawn into part of the window
+	struct VIEW_PANE
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 position;
+		// x, y, width and height as fractions of the window
+		glm::vec4 viewportRect;
+	};
+
+	// draw a top and a front orthographic view beside the camera
+	// view, both centered on what the camera looks at
+	void EnableMultiView(bool bEnable);
+	// the views of the last PrepareSceneView(), the camera view
+	// first and filling the window unless multi-view is on
+	const std::vector<VIEW_PANE>& GetViewPanes() const { return m_viewPanes; }
+
+	// current size of the window's framebuffer in pixels
+	int GetFramebufferWidth() const;
+	int GetFramebufferHeight() const;
+
+	// camera matrices computed by the last PrepareSceneView()
+	const glm::mat4& GetViewMatrix() const { return m_viewMatrix; }
+	const glm::mat4& GetProjectionMatrix() const { return m_projectionMatrix; }
+	glm::vec3 GetViewPosition() const;
+
+	// seconds of scene time since the previous PrepareSceneView(),
+	// the recorded frame time while replaying
+	float GetFrameDelta() const { return m_frameDelta; }
+
+	// true when the last PrepareSceneView() found the camera,
+	// projection mode or window different from the frame before
+	bool HasViewChanged() const { return m_bViewChanged; }
+
+	// the world space ray under the last click, through the
+	// matrices of the last PrepareSceneView(); false when there
+	// was no click since the last call
+	bool TakePickRay(glm::vec3& origin, glm::vec3& direction);
+
+	// true while the performance overlay is toggled on with H
+	bool IsHudVisible() const;
+	// true once per press of N, which asks for the next scene
+	bool TakeSceneSwitch();
+
 private:
+	// camera state handed from the simulation thread to the
+	// render thread
+	struct CAMERA_SNAPSHOT
+	{
+		glm::mat4 view;
+		glm::vec3 position;
+		float zoom;
+		bool bOrthographic;
+	};
+
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+
+	// camera matrices for the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	bool m_bViewChanged;
+	// views for the current frame, including the camera's
+	bool m_bMultiView;
+	std::vector<VIEW_PANE> m_viewPanes;
+
+	// fixed timestep simulation thread that owns the camera
+	std::thread m_simulationThread;
+	std::atomic<bool> m_bSimulating;
+	TripleBuffer<CAMERA_SNAPSHOT> m_cameraSnapshots;
+
+	// frame timing and the recorded or replayed input
+	double m_lastFrameTime;
+	float m_frameDelta;
+	float m_stepTime;
+	double m_replayStartTime;
+	InputRecorder m_inputRecorder;
+	std::vector<InputRecorder::TICK_INPUT> m_frameTicks;
+
+	void SimulationLoop();
+	void StepRecordedInput();
+	void PublishCameraSnapshot(CAMERA_SNAPSHOT& lastPublished);
 };
\ No newline at end of file